@@ -7,6 +7,7 @@
 #include "../source/ff.application/app/app.h"
 #include "../source/ff.application/app/debug_stats.h"
 #include "../source/ff.application/app/game.h"
+#include "../source/ff.application/app/headless.h"
 #include "../source/ff.application/app/imgui.h"
 #include "../source/ff.application/app/settings.h"
 
@@ -21,6 +22,14 @@
 #include "../source/ff.application/audio/music_playing.h"
 #include "../source/ff.application/audio/wav_file.h"
 
+#include "../source/ff.application/graphics/cpu/buffer.h"
+#include "../source/ff.application/graphics/cpu/commands.h"
+#include "../source/ff.application/graphics/cpu/depth.h"
+#include "../source/ff.application/graphics/cpu/draw_device.h"
+#include "../source/ff.application/graphics/cpu/rasterizer.h"
+#include "../source/ff.application/graphics/cpu/target_texture.h"
+#include "../source/ff.application/graphics/cpu/texture.h"
+
 #include "../source/ff.application/graphics/dx12/access.h"
 #include "../source/ff.application/graphics/dx12/buffer.h"
 #include "../source/ff.application/graphics/dx12/commands.h"
@@ -87,6 +96,7 @@
 #include "../source/ff.application/graphics/resource/sprite_resource.h"
 #include "../source/ff.application/graphics/resource/texture_data.h"
 #include "../source/ff.application/graphics/resource/texture_metadata.h"
+#include "../source/ff.application/graphics/resource/texture_processor.h"
 #include "../source/ff.application/graphics/resource/texture_resource.h"
 
 #include "../source/ff.application/graphics/types/blob.h"
@@ -105,6 +115,7 @@
 #include "../source/ff.application/input/input_device_base.h"
 #include "../source/ff.application/input/input_device_event.h"
 #include "../source/ff.application/input/input_mapping.h"
+#include "../source/ff.application/input/input_record.h"
 #include "../source/ff.application/input/input_vk.h"
 #include "../source/ff.application/input/keyboard_device.h"
 #include "../source/ff.application/input/pointer_device.h"
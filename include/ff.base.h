@@ -15,12 +15,15 @@
 #include "../source/ff.base/data_persist/data.h"
 #include "../source/ff.base/data_persist/dict.h"
 #include "../source/ff.base/data_persist/dict_visitor.h"
+#include "../source/ff.base/data_persist/flat_dict.h"
 #include "../source/ff.base/data_persist/file.h"
 #include "../source/ff.base/data_persist/filesystem.h"
 #include "../source/ff.base/data_persist/json_persist.h"
+#include "../source/ff.base/data_persist/json_structural.h"
 #include "../source/ff.base/data_persist/json_tokenizer.h"
 #include "../source/ff.base/data_persist/persist.h"
 #include "../source/ff.base/data_persist/saved_data.h"
+#include "../source/ff.base/data_persist/saved_data_cache.h"
 #include "../source/ff.base/data_persist/stream.h"
 
 #include "../source/ff.base/data_value/bool_v.h"
@@ -62,15 +65,21 @@
 
 #include "../source/ff.base/thread/co_awaiters.h"
 #include "../source/ff.base/thread/co_exceptions.h"
+#include "../source/ff.base/thread/co_lean_task.h"
 #include "../source/ff.base/thread/co_task.h"
+#include "../source/ff.base/thread/mpsc_queue.h"
+#include "../source/ff.base/thread/task_scheduler.h"
 #include "../source/ff.base/thread/thread_dispatch.h"
 #include "../source/ff.base/thread/thread_pool.h"
+#include "../source/ff.base/thread/work_stealing_deque.h"
 
 #include "../source/ff.base/types/fixed.h"
 #include "../source/ff.base/types/flags.h"
 #include "../source/ff.base/types/frame_allocator.h"
+#include "../source/ff.base/types/interned_key.h"
 #include "../source/ff.base/types/intrusive_ptr.h"
 #include "../source/ff.base/types/perf_timer.h"
+#include "../source/ff.base/types/perf_trace.h"
 #include "../source/ff.base/types/point.h"
 #include "../source/ff.base/types/pool_allocator.h"
 #include "../source/ff.base/types/push_back.h"
@@ -80,6 +89,7 @@
 #include "../source/ff.base/types/stack_vector.h"
 #include "../source/ff.base/types/stash.h"
 #include "../source/ff.base/types/timer.h"
+#include "../source/ff.base/types/tlsf_allocator.h"
 #include "../source/ff.base/types/uuid.h"
 
 #include "../source/ff.base/windows/win32.h"
@@ -9,6 +9,7 @@
 #include "init_dx.h"
 #include "input/input.h"
 #include "input/input_device_base.h"
+#include "input/input_record.h"
 #include "graphics/types/color.h"
 
 namespace ff
@@ -58,6 +59,18 @@ static std::unique_ptr<ff::thread_dispatch> game_thread_dispatch;
 static std::unique_ptr<ff::thread_dispatch> frame_thread_dispatch;
 static std::shared_ptr<ff::resource_object_provider> app_resources;
 static std::unique_ptr<ff::internal::debug_stats> debug_stats;
+static std::unique_ptr<ff::input_recorder> input_recorder;
+
+// Pipelined rendering, the game thread hands one frame at a time to the render thread
+static std::thread render_thread;
+static ff::win_event render_frame_event;
+static ff::win_event render_done_event;
+static std::shared_ptr<const ff::render_snapshot> render_snapshot;
+static ff::app_update_t render_update_type{};
+static int64_t render_start_ticks{};
+static int64_t render_end_ticks{};
+static bool render_pending{}; // game thread only
+static bool render_thread_stop{};
 
 static ff::perf_results perf_results;
 static ff::perf_counter perf_input("Input", ff::perf_color::magenta);
@@ -65,14 +78,33 @@ static ff::perf_counter perf_frame("Frame", ff::perf_color::white, ff::perf_char
 static ff::perf_counter perf_update("Update", ::perf_input.color);
 static ff::perf_counter perf_render("Render", ff::perf_color::green, ff::perf_chart_t::render_total);
 static ff::perf_counter perf_render_game_render("Game", ::perf_render.color);
+static ff::perf_counter perf_render_snapshot("Snapshot", ff::perf_color::yellow);
+static ff::perf_counter perf_render_thread_wait("Render thread wait", ff::perf_color::cyan, ff::perf_chart_t::render_wait);
+static ff::perf_counter perf_render_overlap("Overlap", ff::perf_color::green);
 
-static void frame_update_input()
+static void frame_update_input(bool pipelined)
 {
     ff::perf_timer timer(::perf_input);
-    ff::internal::imgui::update_input();
-    ff::thread_dispatch::get_game()->flush();
+
+    // The render thread uses ImGui and debug stats, so pipelined frames update their input at the hand-off instead
+    if (!pipelined)
+    {
+        ff::internal::imgui::update_input();
+    }
+
+    if (!::render_pending)
+    {
+        // Posted work can use the GPU, so it waits while the render thread is busy
+        ff::thread_dispatch::get_game()->flush();
+    }
+
     ff::input::combined_devices().update();
-    ::debug_stats->update_input();
+
+    if (!pipelined)
+    {
+        ::debug_stats->update_input();
+    }
+
     ::app_params.game_input_func();
 }
 
@@ -140,18 +172,22 @@ static bool frame_update_timer(ff::app_update_t update_type, size_t& update_coun
     return true;
 }
 
-static void frame_update(ff::app_update_t update_type)
+static void frame_update(ff::app_update_t update_type, bool pipelined)
 {
     ff::perf_timer::no_op(::perf_input);
     ff::perf_timer::no_op(::perf_update);
-    ::debug_stats->frame_started(update_type);
 
     size_t update_count = 0;
     while (::frame_update_timer(update_type, update_count))
     {
         if (update_count > 1)
         {
-            ::frame_update_input();
+            ::frame_update_input(pipelined);
+        }
+
+        if (::input_recorder)
+        {
+            ::input_recorder->update();
         }
 
         ff::perf_timer timer(::perf_update);
@@ -159,14 +195,14 @@ static void frame_update(ff::app_update_t update_type)
     }
 }
 
-static void frame_render(ff::app_update_t update_type)
+static void frame_render(ff::app_update_t update_type, const ff::render_snapshot* snapshot = nullptr)
 {
     ff::perf_timer timer_render(::perf_render);
     ff::dxgi::command_context_base& context = ff::dxgi::frame_started();
     bool begin_render;
     {
         ff::perf_timer timer(::perf_render_game_render);
-        ff::render_params params{ update_type, context, *::target, *::depth };
+        ff::render_params params{ update_type, context, *::target, *::depth, snapshot };
         ::app_params.game_render_offscreen_func(params);
         if (begin_render = ::target->begin_render(context, ::app_params.game_clears_back_buffer_func() ? &ff::color_black() : nullptr))
         {
@@ -186,18 +222,116 @@ static void frame_render(ff::app_update_t update_type)
     ff::dxgi::frame_complete();
 }
 
+static void render_thread_func()
+{
+    ff::set_thread_name("ff::render");
+    ff::thread_dispatch dispatch(ff::thread_dispatch_type::task);
+
+    while (::render_frame_event.wait_and_reset(INFINITE, false) && !::render_thread_stop)
+    {
+        {
+            ff::frame_dispatch_scope frame_dispatch(dispatch);
+            ::render_start_ticks = ff::perf_measures::now_ticks();
+            ::frame_render(::render_update_type, ::render_snapshot.get());
+            ::render_end_ticks = ff::perf_measures::now_ticks();
+        }
+
+        ::render_done_event.set();
+    }
+}
+
+// Returns the ticks that the game thread was blocked
+static int64_t wait_for_render_thread()
+{
+    if (!::render_pending)
+    {
+        return 0;
+    }
+
+    const int64_t start_ticks = ff::perf_measures::now_ticks();
+    {
+        ff::perf_timer timer(::perf_render_thread_wait);
+        ::render_done_event.wait_and_reset(INFINITE, false);
+    }
+
+    ::render_pending = false;
+    return ff::perf_measures::now_ticks() - start_ticks;
+}
+
+static void stop_render_thread()
+{
+    if (::render_thread.joinable())
+    {
+        ::wait_for_render_thread();
+        ::render_thread_stop = true;
+        ::render_frame_event.set();
+        ::render_thread.join();
+        ::render_thread_stop = false;
+        ::render_snapshot.reset();
+    }
+}
+
+static void frame_render_pipelined(ff::app_update_t update_type)
+{
+    if (!::render_thread.joinable())
+    {
+        ::render_thread = std::thread(::render_thread_func);
+    }
+
+    // At most one frame is in flight, so rendering is never more than a frame behind
+    const int64_t wait_start_ticks = ff::perf_measures::now_ticks();
+    if (::wait_for_render_thread())
+    {
+        // The render thread can't collect perf measures, so report its work here
+        ff::perf_measures& measures = ff::perf_measures::game();
+        measures.start(::perf_render);
+        measures.end(::perf_render, ::render_end_ticks - ::render_start_ticks);
+        measures.start(::perf_render_overlap);
+        measures.end(::perf_render_overlap, std::max<int64_t>(std::min(::render_end_ticks, wait_start_ticks) - ::render_start_ticks, 0));
+    }
+
+    // The render thread is idle, so nothing else touches ImGui or debug stats until the next frame is handed off
+    ff::internal::imgui::update_input();
+    ::debug_stats->update_input();
+    ff::thread_dispatch::get_game()->flush();
+    ::debug_stats->frame_started(update_type);
+    {
+        ff::perf_timer timer(::perf_render_snapshot);
+        ::render_snapshot = ::app_params.game_snapshot_func();
+    }
+
+    ::render_update_type = update_type;
+    ::render_pending = true;
+    ::render_frame_event.set();
+}
+
 static ff::app_update_t frame_update_and_render(ff::app_update_t previous_update_type)
 {
+    const bool pipelined = ::app_params.game_pipelined_func();
+    if (!pipelined)
+    {
+        ::stop_render_thread();
+    }
+
     // Input is part of previous frame's perf measures. But it must be first, before the timer updates,
     // because user input can affect how time is computed (like stopping or single stepping through frames)
-    ::frame_update_input();
+    ::frame_update_input(pipelined);
 
     ff::app_update_t update_type = ::frame_start_timer(previous_update_type);
     ff::perf_measures::game().reset(::app_time.clock_seconds, &::perf_results, true, ::app_time.perf_clock_ticks);
     ff::perf_timer timer_frame(::perf_frame, ::app_time.perf_clock_ticks);
 
-    ::frame_update(update_type);
-    ::frame_render(update_type);
+    if (pipelined)
+    {
+        ::frame_update(update_type, pipelined);
+        ::frame_render_pipelined(update_type);
+    }
+    else
+    {
+        ::debug_stats->frame_started(update_type);
+        ::frame_update(update_type, pipelined);
+        ::frame_render(update_type);
+    }
 
     return update_type;
 }
@@ -207,6 +341,12 @@ static void init_game_thread()
     ::game_thread_dispatch = std::make_unique<ff::thread_dispatch>(ff::thread_dispatch_type::game);
     ::frame_thread_dispatch = std::make_unique<ff::thread_dispatch>(ff::thread_dispatch_type::frame);
     ::debug_stats = std::make_unique<ff::internal::debug_stats>(::target, ::app_resources, ::perf_results);
+
+    if (!::app_params.input_record_path.empty())
+    {
+        ::input_recorder = std::make_unique<ff::input_recorder>(ff::input::combined_devices());
+    }
+
     ::resources_rebuilt_connection = ff::global_resources::rebuild_end_sink().connect([] { ::app_params.game_resources_rebuilt(); });
     ::game_thread_event.set();
     ::app_params.game_thread_initialized_func();
@@ -215,12 +355,21 @@ static void init_game_thread()
 
 static void destroy_game_thread()
 {
+    ::stop_render_thread();
     ff::dxgi::trim_device();
     ff::internal::app::request_save_settings();
     ff::global_resources::destroy_game_thread();
     ::resources_rebuilt_connection.disconnect();
     ::app_params.game_thread_finished_func();
     ::debug_stats.reset();
+
+    if (::input_recorder)
+    {
+        ff::log::write(ff::log::type::application, "Save input recording: ", ff::filesystem::to_string(::app_params.input_record_path), " (", ::input_recorder->update_count(), " updates)");
+        verify(::input_recorder->save(::app_params.input_record_path));
+        ::input_recorder.reset();
+    }
+
     ff::internal::imgui::destroy();
     ff::thread_pool::flush();
     ::frame_thread_dispatch.reset();
@@ -237,6 +386,7 @@ static void game_thread()
         switch (::game_thread_state)
         {
             case ::game_thread_state_t::pausing:
+                ::wait_for_render_thread();
                 update_type = ff::app_update_t::stopped;
                 ::game_thread_state = ::game_thread_state_t::paused;
                 ::game_thread_event.set();
@@ -490,6 +640,7 @@ static void init_log()
     std::filesystem::path path = ff::app_local_path() / "log.txt";
     ::log_file = std::make_unique<std::ofstream>(path);
     ff::log::file(::log_file.get());
+    ff::log::async(true);
     ff::log::write(ff::log::type::application, "Init (", ::app_version.product_name, ")");
     ff::log::write(ff::log::type::application, "Log: ", ff::filesystem::to_string(path));
 }
@@ -497,6 +648,7 @@ static void init_log()
 static void destroy_log()
 {
     ff::log::write(ff::log::type::application, "Destroyed");
+    ff::log::async(false);
     ff::log::file(nullptr);
     ::log_file.reset();
 }
@@ -578,6 +730,11 @@ const ff::app_time_t& ff::app_time()
     return ::app_time;
 }
 
+void ff::internal::app::app_time(const ff::app_time_t& value)
+{
+    ::app_time = value;
+}
+
 const ff::window& ff::app_window()
 {
     return ::window;
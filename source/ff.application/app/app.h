@@ -40,4 +40,5 @@ namespace ff::internal::app
     void destroy();
 
     ff::resource_object_provider& app_resources();
+    void app_time(const ff::app_time_t& value); // for ff::run_headless
 }
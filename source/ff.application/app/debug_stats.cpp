@@ -1,6 +1,8 @@
 #include "pch.h"
 #include "app/app.h"
 #include "app/debug_stats.h"
+#include "graphics/dx12/dx12_globals.h"
+#include "graphics/dx12/mem_allocator.h"
 #include "graphics/dxgi/dxgi_globals.h"
 #include "graphics/dxgi/target_window_base.h"
 #include "input/input.h"
@@ -108,6 +110,7 @@ static bool target_params_visible_{};
 static bool stopped_visible_{};
 static bool options_visible_{};
 static bool imgui_demo_visible_{};
+static bool memory_visible_{};
 static std::vector<::debug_timer_model> timers_;
 static std::array<float, CHART_WIDTH> chart_total_{};
 static std::array<float, CHART_WIDTH> chart_render_{};
@@ -392,6 +395,44 @@ void ff::internal::debug_stats::render(ff::app_update_t type, ff::dxgi::command_
                     ImGui::EndTable();
                 }
             }
+
+            ImGui::SetNextItemOpen(::memory_visible_);
+            if (::memory_visible_ = ImGui::CollapsingHeader("GPU Memory"))
+            {
+                if (ImGui::BeginTable("##MemoryTable", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders))
+                {
+                    ImGui::TableSetupColumn("Heaps", ImGuiTableColumnFlags_WidthStretch);
+                    ImGui::TableSetupColumn("MB", ImGuiTableColumnFlags_WidthFixed, 30 * dpi_scale);
+                    ImGui::TableSetupColumn("Free", ImGuiTableColumnFlags_WidthFixed, 30 * dpi_scale);
+                    ImGui::TableSetupColumn("Frag", ImGuiTableColumnFlags_WidthFixed, 30 * dpi_scale);
+                    ImGui::TableHeadersRow();
+
+                    const std::pair<const char*, ff::dx12::mem_allocator*> allocators[] =
+                    {
+                        { "Buffers", &ff::dx12::static_buffer_allocator() },
+                        { "Textures", &ff::dx12::texture_allocator() },
+                        { "Targets", &ff::dx12::target_allocator() },
+                    };
+
+                    for (const auto& [name, allocator] : allocators)
+                    {
+                        const ff::dx12::mem_allocator_stats stats = allocator->stats();
+                        constexpr double one_meg = 1024.0 * 1024.0;
+
+                        ImGui::TableNextRow();
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%s (%zu)", name, stats.heap_count);
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%.1f", stats.heap_size / one_meg);
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%.1f", stats.free_size / one_meg);
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%.0f%%", stats.fragmentation() * 100.0);
+                    }
+
+                    ImGui::EndTable();
+                }
+            }
         }
 
         ImGui::End();
@@ -9,11 +9,11 @@
 
 using namespace std::string_view_literals;
 
-static const size_t ID_DEBUG_STEP_ONE_FRAME = ff::stable_hash_func("ff.game.step_one_frame"sv);
-static const size_t ID_DEBUG_CANCEL_STEP_ONE_FRAME = ff::stable_hash_func("ff.game.cancel_step_one_frame"sv);
-static const size_t ID_DEBUG_SPEED_SLOW = ff::stable_hash_func("ff.game.speed_slow"sv);
-static const size_t ID_DEBUG_SPEED_FAST = ff::stable_hash_func("ff.game.speed_fast"sv);
-static const size_t ID_SHOW_CUSTOM_DEBUG = ff::stable_hash_func("ff.game.show_custom_debug"sv);
+static constexpr size_t ID_DEBUG_STEP_ONE_FRAME = ff::stable_hash_func("ff.game.step_one_frame"sv);
+static constexpr size_t ID_DEBUG_CANCEL_STEP_ONE_FRAME = ff::stable_hash_func("ff.game.cancel_step_one_frame"sv);
+static constexpr size_t ID_DEBUG_SPEED_SLOW = ff::stable_hash_func("ff.game.speed_slow"sv);
+static constexpr size_t ID_DEBUG_SPEED_FAST = ff::stable_hash_func("ff.game.speed_fast"sv);
+static constexpr size_t ID_SHOW_CUSTOM_DEBUG = ff::stable_hash_func("ff.game.show_custom_debug"sv);
 
 static const ff::init_game_params* game_params;
 static bool debug_step_one_frame{};
@@ -122,7 +122,18 @@ static void game_input()
 static void game_render(const ff::render_params& params)
 {
     ::game_params->game_render_func(params);
+
+    if (ff::thread_dispatch::get_game()->current_thread())
+    {
+        ::debug_step_one_frame = false;
+    }
+}
+
+static std::shared_ptr<const ff::render_snapshot> game_snapshot()
+{
+    // In pipelined mode, rendering happens on another thread, so the step is done once the snapshot is taken
     ::debug_step_one_frame = false;
+    return ::game_params->game_snapshot_func();
 }
 
 static void clear_resources()
@@ -170,6 +181,7 @@ int ff::run_game(const ff::init_game_params& params)
     app_params.game_update_type_func = ::game_update_type;
     app_params.game_input_func = ::game_input;
     app_params.game_render_func = ::game_render;
+    app_params.game_snapshot_func = ::game_snapshot;
     app_params.game_thread_initialized_func = ::game_thread_initialized;
     app_params.game_thread_finished_func = ::game_thread_finished;
     app_params.game_resources_rebuilt = ::game_resources_rebuilt;
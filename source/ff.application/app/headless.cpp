@@ -0,0 +1,144 @@
+#include "pch.h"
+#include "app/app.h"
+#include "app/headless.h"
+#include "init_app.h"
+#include "input/gamepad_device.h"
+#include "input/input.h"
+#include "input/input_record.h"
+#include "input/keyboard_device.h"
+#include "input/pointer_device.h"
+
+static std::vector<ff::input_device_base*> real_input_devices()
+{
+    std::vector<ff::input_device_base*> devices{ &ff::input::keyboard(), &ff::input::pointer() };
+
+    for (size_t i = 0; i < ff::input::gamepad_count(); i++)
+    {
+        devices.push_back(&ff::input::gamepad(i));
+    }
+
+    return devices;
+}
+
+static double percentile_ms(const std::vector<double>& sorted_seconds, double percent)
+{
+    if (sorted_seconds.empty())
+    {
+        return 0.0;
+    }
+
+    const size_t index = static_cast<size_t>(std::ceil(percent * sorted_seconds.size())) - 1;
+    return sorted_seconds[std::min(index, sorted_seconds.size() - 1)] * 1000.0;
+}
+
+static void run_headless_updates(const ff::init_app_params& app_params, const ff::headless_params& params, size_t update_count, ff::headless_results& results)
+{
+    ff::thread_dispatch game_dispatch(ff::thread_dispatch_type::game);
+    ff::thread_dispatch frame_dispatch(ff::thread_dispatch_type::frame);
+    app_params.game_thread_initialized_func();
+
+    std::vector<double> update_seconds;
+    update_seconds.reserve(update_count);
+
+    ff::app_time_t time{};
+    ff::timer total_timer;
+    ff::timer update_timer;
+
+    for (size_t i = 0; i < update_count; i++)
+    {
+        ff::frame_dispatch_scope frame_dispatch_scope(frame_dispatch);
+
+        // No wall clock, each update is exactly one fixed step
+        time.frame_count++;
+        time.update_count++;
+        time.update_seconds = time.update_count * ff::constants::seconds_per_update<double>();
+        time.clock_seconds = time.update_seconds;
+        time.perf_clock_ticks = ff::perf_measures::now_ticks();
+        ff::internal::app::app_time(time);
+
+        game_dispatch.flush();
+        ff::input::combined_devices().update();
+        app_params.game_input_func();
+
+        update_timer.tick();
+        app_params.game_update_func();
+        update_seconds.push_back(update_timer.tick());
+
+        if (params.checksum_func && params.checksum_interval && (i + 1) % params.checksum_interval == 0)
+        {
+            results.checksums.push_back(params.checksum_func());
+        }
+    }
+
+    results.seconds = total_timer.tick();
+    app_params.game_thread_finished_func();
+    ff::thread_pool::flush();
+
+    std::sort(update_seconds.begin(), update_seconds.end());
+    results.update_count = update_count;
+    results.updates_per_second = results.seconds > 0.0 ? update_count / results.seconds : 0.0;
+    results.update_ms_p50 = ::percentile_ms(update_seconds, 0.50);
+    results.update_ms_p90 = ::percentile_ms(update_seconds, 0.90);
+    results.update_ms_p99 = ::percentile_ms(update_seconds, 0.99);
+    results.update_ms_max = ::percentile_ms(update_seconds, 1.00);
+}
+
+ff::headless_results ff::run_headless(const ff::init_app_params& app_params, const ff::headless_params& params)
+{
+    ff::headless_results results{};
+    std::unique_ptr<ff::input_replay_device> replay;
+
+    if (!params.replay_path.empty())
+    {
+        replay = std::make_unique<ff::input_replay_device>(ff::filesystem::read_binary_file(params.replay_path));
+        assert_msg_ret_val(replay->valid(), "Invalid input recording", results);
+    }
+
+    const size_t update_count = params.update_count ? params.update_count : (replay ? replay->update_count() : 0);
+    const bool init_input = !ff::internal::input::initialized();
+    if (init_input)
+    {
+        assert_ret_val(ff::internal::input::init(), results);
+    }
+
+    // Only recorded input is visible to the game, so runs are repeatable
+    const std::vector<ff::input_device_base*> real_devices = ::real_input_devices();
+    for (ff::input_device_base* device : real_devices)
+    {
+        ff::internal::input::remove_device(device);
+    }
+
+    if (replay)
+    {
+        ff::internal::input::add_device(replay.get());
+    }
+
+    const ff::app_time_t old_time = ff::app_time();
+    std::jthread([&]()
+        {
+            ::run_headless_updates(app_params, params, update_count, results);
+        });
+    ff::internal::app::app_time(old_time);
+
+    if (replay)
+    {
+        ff::internal::input::remove_device(replay.get());
+    }
+
+    if (init_input)
+    {
+        ff::internal::input::destroy();
+    }
+    else
+    {
+        for (ff::input_device_base* device : real_devices)
+        {
+            ff::internal::input::add_device(device);
+        }
+    }
+
+    ff::log::write(ff::log::type::application, "Headless: ", results.update_count, " updates, ", &std::fixed, std::setprecision(1), results.updates_per_second,
+        "/s, Update ms p50:", std::setprecision(3), results.update_ms_p50, ", p90:", results.update_ms_p90, ", p99:", results.update_ms_p99, ", max:", results.update_ms_max);
+
+    return results;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+namespace ff
+{
+    struct init_app_params;
+
+    struct headless_params
+    {
+        std::filesystem::path replay_path; // saved by init_app_params::input_record_path, or empty for no input
+        size_t update_count{}; // zero runs until the replay is done
+        size_t checksum_interval{ 60 };
+        std::function<uint64_t()> checksum_func{}; // hash of the game state, compared between runs to check determinism
+    };
+
+    struct headless_results
+    {
+        size_t update_count;
+        double seconds;
+        double updates_per_second;
+        double update_ms_p50;
+        double update_ms_p90;
+        double update_ms_p99;
+        double update_ms_max;
+        std::vector<uint64_t> checksums; // after every checksum_interval updates
+    };
+
+    /// <summary>
+    /// Runs fixed game updates as fast as possible on a new game thread, without a window or GPU
+    /// </summary>
+    /// <remarks>
+    /// Only the input, update and game thread funcs in app_params get called. The replayed input is the only
+    /// device in ff::input::combined_devices, and ff::app_time advances exactly one fixed step per update.
+    /// </remarks>
+    ff::headless_results run_headless(const ff::init_app_params& app_params, const ff::headless_params& params);
+}
@@ -0,0 +1,52 @@
+#include "pch.h"
+#include "graphics/cpu/buffer.h"
+
+ff::cpu::buffer::buffer(ff::dxgi::buffer_type type)
+    : type_(type)
+{
+}
+
+const uint8_t* ff::cpu::buffer::data() const
+{
+    return this->data_.data();
+}
+
+ff::dxgi::buffer_type ff::cpu::buffer::type() const
+{
+    return this->type_;
+}
+
+size_t ff::cpu::buffer::size() const
+{
+    return this->data_.size();
+}
+
+bool ff::cpu::buffer::writable() const
+{
+    return true;
+}
+
+bool ff::cpu::buffer::update(ff::dxgi::command_context_base& context, const void* data, size_t size)
+{
+    assert_ret_val(size, false);
+
+    std::memcpy(this->map(context, size), data, size);
+    this->unmap(context);
+    return true;
+}
+
+void* ff::cpu::buffer::map(ff::dxgi::command_context_base& context, size_t size)
+{
+    assert_ret_val(size, nullptr);
+    assert_msg(!this->mapped, "Forgot to unmap buffer");
+
+    this->data_.resize(size);
+    this->mapped = true;
+    return this->data_.data();
+}
+
+void ff::cpu::buffer::unmap(ff::dxgi::command_context_base& context)
+{
+    assert(this->mapped);
+    this->mapped = false;
+}
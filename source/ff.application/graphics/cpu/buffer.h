@@ -0,0 +1,35 @@
+#pragma once
+
+#include "../dxgi/buffer_base.h"
+
+namespace ff::cpu
+{
+    /// <summary>
+    /// Buffer in system memory, used by the CPU draw device to read instances and shader constants
+    /// </summary>
+    class buffer : public ff::dxgi::buffer_base
+    {
+    public:
+        buffer(ff::dxgi::buffer_type type);
+        buffer(buffer&& other) noexcept = default;
+        buffer(const buffer& other) = delete;
+
+        buffer& operator=(buffer&& other) noexcept = default;
+        buffer& operator=(const buffer& other) = delete;
+
+        const uint8_t* data() const;
+
+        // ff::dxgi::buffer_base
+        virtual ff::dxgi::buffer_type type() const override;
+        virtual size_t size() const override;
+        virtual bool writable() const override;
+        virtual bool update(ff::dxgi::command_context_base& context, const void* data, size_t size) override;
+        virtual void* map(ff::dxgi::command_context_base& context, size_t size) override;
+        virtual void unmap(ff::dxgi::command_context_base& context) override;
+
+    private:
+        std::vector<uint8_t> data_;
+        ff::dxgi::buffer_type type_;
+        bool mapped{};
+    };
+}
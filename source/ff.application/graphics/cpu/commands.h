@@ -0,0 +1,13 @@
+#pragma once
+
+#include "../dxgi/command_context_base.h"
+
+namespace ff::cpu
+{
+    /// <summary>
+    /// Command context for drawing with the CPU device, work is done immediately so there is nothing to record
+    /// </summary>
+    class commands : public ff::dxgi::command_context_base
+    {
+    };
+}
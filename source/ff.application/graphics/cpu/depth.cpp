@@ -0,0 +1,58 @@
+#include "pch.h"
+#include "graphics/cpu/depth.h"
+
+ff::cpu::depth::depth(const ff::point_size& size)
+    : data_(size.x * size.y)
+    , size_(size)
+{
+}
+
+ff::cpu::depth& ff::cpu::depth::get(ff::dxgi::depth_base& obj)
+{
+    return static_cast<ff::cpu::depth&>(obj);
+}
+
+const ff::cpu::depth& ff::cpu::depth::get(const ff::dxgi::depth_base& obj)
+{
+    return static_cast<const ff::cpu::depth&>(obj);
+}
+
+float* ff::cpu::depth::data() const
+{
+    return this->data_.data();
+}
+
+ff::point_size ff::cpu::depth::physical_size() const
+{
+    return this->size_;
+}
+
+bool ff::cpu::depth::physical_size(ff::dxgi::command_context_base& context, const ff::point_size& size)
+{
+    if (this->size_ != size)
+    {
+        this->data_.resize(size.x * size.y);
+        this->size_ = size;
+    }
+
+    return true;
+}
+
+size_t ff::cpu::depth::sample_count() const
+{
+    return 1;
+}
+
+void ff::cpu::depth::clear(ff::dxgi::command_context_base& context, float depth, uint8_t stencil) const
+{
+    this->clear_depth(context, depth);
+}
+
+void ff::cpu::depth::clear_depth(ff::dxgi::command_context_base& context, float depth) const
+{
+    std::fill(this->data_.begin(), this->data_.end(), depth);
+}
+
+void ff::cpu::depth::clear_stencil(ff::dxgi::command_context_base& context, uint8_t stencil) const
+{
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "../dxgi/depth_base.h"
+
+namespace ff::cpu
+{
+    /// <summary>
+    /// Depth buffer in system memory for the CPU draw device, there is no stencil
+    /// </summary>
+    class depth : public ff::dxgi::depth_base
+    {
+    public:
+        depth(const ff::point_size& size = {});
+        depth(depth&& other) noexcept = default;
+        depth(const depth& other) = delete;
+
+        static depth& get(ff::dxgi::depth_base& obj);
+        static const depth& get(const ff::dxgi::depth_base& obj);
+        depth& operator=(depth&& other) noexcept = default;
+        depth& operator=(const depth& other) = delete;
+
+        float* data() const;
+
+        // depth_base
+        virtual ff::point_size physical_size() const override;
+        virtual bool physical_size(ff::dxgi::command_context_base& context, const ff::point_size& size) override;
+        virtual size_t sample_count() const override;
+        virtual void clear(ff::dxgi::command_context_base& context, float depth, uint8_t stencil) const override;
+        virtual void clear_depth(ff::dxgi::command_context_base& context, float depth = 0.0f) const override;
+        virtual void clear_stencil(ff::dxgi::command_context_base& context, uint8_t stencil) const override;
+
+    private:
+        mutable std::vector<float> data_;
+        ff::point_size size_;
+    };
+}
@@ -0,0 +1,694 @@
+#include "pch.h"
+#include "graphics/cpu/buffer.h"
+#include "graphics/cpu/depth.h"
+#include "graphics/cpu/draw_device.h"
+#include "graphics/cpu/rasterizer.h"
+#include "graphics/cpu/target_texture.h"
+#include "graphics/cpu/texture.h"
+#include "graphics/dxgi/draw_util.h"
+#include "graphics/dxgi/format_util.h"
+#include "graphics/dxgi/palette_data_base.h"
+#include "graphics/dxgi/target_base.h"
+
+namespace ffdu = ff::dxgi::draw_util;
+
+constexpr size_t CIRCLE_POINT_COUNT = 32;
+
+// Same index lists as the static index buffer of the DX12 draw device
+static constexpr std::array<uint8_t, 3> triangle_indexes{ 0, 1, 2 };
+static constexpr std::array<uint8_t, 6> rectangle_indexes{ 0, 1, 2, 2, 1, 3 };
+static constexpr std::array<uint8_t, 24> rectangle_outline_indexes
+{
+    0, 1, 4, 4, 1, 5,
+    1, 3, 5, 5, 3, 7,
+    3, 2, 7, 7, 2, 6,
+    2, 0, 6, 6, 0, 4,
+};
+
+static bool target_format_valid(DXGI_FORMAT format)
+{
+    switch (format)
+    {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_R8_UINT:
+            return true;
+    }
+
+    return false;
+}
+
+static bool texture_format_direct(DXGI_FORMAT format)
+{
+    return ::target_format_valid(format);
+}
+
+static const std::array<DirectX::XMFLOAT2, ::CIRCLE_POINT_COUNT>& circle_cos_sin()
+{
+    static const std::array<DirectX::XMFLOAT2, ::CIRCLE_POINT_COUNT> points = []()
+        {
+            std::array<DirectX::XMFLOAT2, ::CIRCLE_POINT_COUNT> points;
+            for (size_t i = 0; i < points.size(); i++)
+            {
+                const float angle = DirectX::XM_2PI * i / points.size();
+                points[i] = DirectX::XMFLOAT2(std::cos(angle), std::sin(angle));
+            }
+
+            return points;
+        }();
+
+    return points;
+}
+
+static DirectX::XMFLOAT2 lerp(const DirectX::XMFLOAT2& lhs, const DirectX::XMFLOAT2& rhs, float t)
+{
+    return DirectX::XMFLOAT2(lhs.x + (rhs.x - lhs.x) * t, lhs.y + (rhs.y - lhs.y) * t);
+}
+
+static DirectX::XMFLOAT4 lerp(const DirectX::XMFLOAT4& lhs, const DirectX::XMFLOAT4& rhs, float t)
+{
+    return DirectX::XMFLOAT4(
+        lhs.x + (rhs.x - lhs.x) * t,
+        lhs.y + (rhs.y - lhs.y) * t,
+        lhs.z + (rhs.z - lhs.z) * t,
+        lhs.w + (rhs.w - lhs.w) * t);
+}
+
+static DirectX::XMFLOAT2 normalize(const DirectX::XMFLOAT2& value)
+{
+    DirectX::XMFLOAT2 result;
+    DirectX::XMStoreFloat2(&result, DirectX::XMVector2Normalize(DirectX::XMLoadFloat2(&value)));
+    return result;
+}
+
+namespace
+{
+    struct texture_entry
+    {
+        std::shared_ptr<DirectX::ScratchImage> source;
+        std::shared_ptr<DirectX::ScratchImage> converted;
+        ff::cpu::raster_image image;
+    };
+
+    // Vertexes before the world and projection transforms, like the output of the vertex shaders in model space
+    class vertex_builder
+    {
+    public:
+        vertex_builder(const DirectX::XMMATRIX& transform, const ff::rect_float& viewport, std::vector<ff::cpu::raster_triangle>& triangles)
+            : transform(transform)
+            , viewport(viewport)
+            , triangles(triangles)
+        {
+        }
+
+        ff::cpu::raster_vertex& vertex(size_t index, float x, float y, float z)
+        {
+            DirectX::XMFLOAT4 pos;
+            DirectX::XMStoreFloat4(&pos, DirectX::XMVector4Transform(DirectX::XMVectorSet(x, y, z, 1), this->transform));
+            const float inv_w = pos.w ? 1.0f / pos.w : 0.0f;
+
+            ff::cpu::raster_vertex& vertex = this->vertexes[index];
+            vertex.x = this->viewport.left + (pos.x * inv_w + 1.0f) * 0.5f * this->viewport.width();
+            vertex.y = this->viewport.top + (1.0f - pos.y * inv_w) * 0.5f * this->viewport.height();
+            vertex.z = pos.z * inv_w;
+            vertex.uv = {};
+            return vertex;
+        }
+
+        template<class T>
+        void triangles_from(const T& indexes, uint32_t texture_indexes = 0)
+        {
+            for (size_t i = 0; i + 2 < indexes.size(); i += 3)
+            {
+                this->triangles.push_back(ff::cpu::raster_triangle
+                    {
+                        { this->vertexes[indexes[i]], this->vertexes[indexes[i + 1]], this->vertexes[indexes[i + 2]] },
+                        texture_indexes,
+                    });
+            }
+        }
+
+        void triangle(size_t i0, size_t i1, size_t i2)
+        {
+            this->triangles.push_back(ff::cpu::raster_triangle{ { this->vertexes[i0], this->vertexes[i1], this->vertexes[i2] } });
+        }
+
+        void transform_from(const DirectX::XMMATRIX& transform)
+        {
+            this->transform = transform;
+        }
+
+    private:
+        DirectX::XMMATRIX transform;
+        ff::rect_float viewport;
+        std::array<ff::cpu::raster_vertex, ::CIRCLE_POINT_COUNT * 2 + 1> vertexes;
+        std::vector<ff::cpu::raster_triangle>& triangles;
+    };
+
+    class cpu_draw_device : public ffdu::draw_device_base, public ff::cpu::draw_device
+    {
+    public:
+        cpu_draw_device(bool rasterize)
+            : rasterize(rasterize)
+        {
+            this->as_device_child()->reset();
+        }
+
+        cpu_draw_device(cpu_draw_device&& other) noexcept = delete;
+        cpu_draw_device(const cpu_draw_device& other) = delete;
+        cpu_draw_device& operator=(cpu_draw_device&& other) noexcept = delete;
+        cpu_draw_device& operator=(const cpu_draw_device& other) = delete;
+
+        virtual bool valid() const override
+        {
+            return this->internal_valid();
+        }
+
+        virtual ff::dxgi::draw_ptr begin_draw(
+            ff::dxgi::command_context_base& context,
+            ff::dxgi::target_base& target,
+            ff::dxgi::depth_base* depth,
+            const ff::rect_float& view_rect,
+            const ff::rect_float& world_rect,
+            ff::dxgi::draw_options options) override
+        {
+            return this->internal_begin_draw(context, target, depth, view_rect, world_rect, options);
+        }
+
+        virtual const ff::cpu::draw_stats& stats() const override
+        {
+            return this->stats_;
+        }
+
+        virtual void reset_stats() override
+        {
+            this->stats_ = {};
+            this->draw_calls_saved_start = this->draw_calls_saved();
+        }
+
+    protected:
+        virtual void internal_destroy() override
+        {
+            assert(!this->context);
+            this->texture_entries.clear();
+        }
+
+        virtual void internal_reset() override
+        {
+        }
+
+        virtual std::shared_ptr<ff::dxgi::texture_base> internal_create_texture(const ff::point_size& size, DXGI_FORMAT format) override
+        {
+            return std::make_shared<ff::cpu::texture>(size, format);
+        }
+
+        virtual ff::dxgi::command_context_base* internal_setup(
+            ff::dxgi::command_context_base& context,
+            ff::dxgi::target_base& target,
+            ff::dxgi::depth_base* depth,
+            const ff::rect_float& view_rect,
+            bool ignore_rotation) override
+        {
+            assert_msg_ret_val(::target_format_valid(target.format()), "Invalid target format", nullptr);
+
+            const ff::cpu::raster_image target_image = ff::cpu::target_texture::get(target).image();
+            assert_ret_val(target_image, nullptr);
+
+            if (depth)
+            {
+                assert_ret_val(depth->physical_size(context, target.size().physical_pixel_size()), nullptr);
+                depth->clear(context, 0, 0);
+            }
+
+            const ff::rect_float viewport = !ignore_rotation ? target.size().logical_to_physical_rect(view_rect) : view_rect;
+
+            this->context = &context;
+            this->state.target = target_image;
+            this->state.depth = depth ? ff::cpu::depth::get(*depth).data() : nullptr;
+            this->state.clip = ff::rect_int(
+                static_cast<int>(std::floor(viewport.left + 0.5f)),
+                static_cast<int>(std::floor(viewport.top + 0.5f)),
+                static_cast<int>(std::floor(viewport.right + 0.5f)),
+                static_cast<int>(std::floor(viewport.bottom + 0.5f)));
+            this->viewport = viewport;
+
+            return this->context;
+        }
+
+        virtual ff::dxgi::command_context_base* internal_flush(ff::dxgi::command_context_base* context, bool end_draw) override
+        {
+            if (end_draw)
+            {
+                // Textures could change between draws, so converted copies are only kept during a single draw
+                this->texture_entries.clear();
+                this->state = {};
+                this->context = nullptr;
+            }
+
+            return this->context;
+        }
+
+        virtual void internal_flush_begin(ff::dxgi::command_context_base* context) override
+        {
+            this->stats_.flushes++;
+        }
+
+        virtual void internal_flush_end(ff::dxgi::command_context_base* context) override
+        {
+            this->stats_.draw_calls_saved = this->draw_calls_saved() - this->draw_calls_saved_start;
+        }
+
+        virtual void update_palette_texture(ff::dxgi::command_context_base& context,
+            size_t textures_using_palette_count,
+            ff::dxgi::texture_base& palette_texture, size_t* palette_texture_hashes, palette_to_index_t& palette_to_index,
+            ff::dxgi::texture_base& palette_remap_texture, size_t* palette_remap_texture_hashes, palette_remap_to_index_t& palette_remap_to_index) override
+        {
+            if (textures_using_palette_count && !palette_to_index.empty())
+            {
+                const DirectX::Image* dest_image = ff::cpu::texture::get(palette_texture).image();
+                assert_ret(dest_image);
+
+                for (const auto& iter : palette_to_index)
+                {
+                    ff::dxgi::palette_base* palette = iter.second.first;
+                    if (palette)
+                    {
+                        unsigned int index = iter.second.second;
+                        size_t palette_row = palette->current_row();
+                        const ff::dxgi::palette_data_base* palette_data = palette->data();
+                        size_t row_hash = palette_data->row_hash(palette_row);
+
+                        if (palette_texture_hashes[index] != row_hash)
+                        {
+                            std::shared_ptr<DirectX::ScratchImage> src_data = palette_data->texture()->data();
+                            const DirectX::Image* src_image = src_data ? src_data->GetImage(0, 0, 0) : nullptr;
+                            assert_ret(src_image && src_image->format == dest_image->format && palette_row < src_image->height);
+
+                            palette_texture_hashes[index] = row_hash;
+                            std::memcpy(
+                                dest_image->pixels + index * dest_image->rowPitch,
+                                src_image->pixels + palette_row * src_image->rowPitch,
+                                ff::dxgi::palette_size * 4);
+                        }
+                    }
+                }
+            }
+
+            if ((textures_using_palette_count || this->target_requires_palette()) && !palette_remap_to_index.empty())
+            {
+                const DirectX::Image* dest_image = ff::cpu::texture::get(palette_remap_texture).image();
+                assert_ret(dest_image);
+
+                for (const auto& iter : palette_remap_to_index)
+                {
+                    unsigned int row = iter.second.second;
+                    size_t row_hash = iter.first;
+
+                    if (palette_remap_texture_hashes[row] != row_hash)
+                    {
+                        palette_remap_texture_hashes[row] = row_hash;
+                        const ff::dxgi::remap_t& row_remap = iter.second.first;
+                        std::memcpy(dest_image->pixels + row * dest_image->rowPitch, row_remap.remap.data(), ff::dxgi::palette_size);
+                    }
+                }
+            }
+        }
+
+        virtual void apply_shader_input(ff::dxgi::command_context_base& context,
+            size_t texture_count, ff::dxgi::texture_view_base** in_textures,
+            size_t textures_using_palette_count, ff::dxgi::texture_view_base** in_textures_using_palette,
+            ff::dxgi::texture_base& palette_texture, ff::dxgi::texture_base& palette_remap_texture) override
+        {
+            for (size_t i = 0; i < texture_count; i++)
+            {
+                this->textures[i] = this->resolve_texture(*in_textures[i]);
+            }
+
+            for (size_t i = 0; i < textures_using_palette_count; i++)
+            {
+                this->palette_textures[i] = this->resolve_texture(*in_textures_using_palette[i]);
+            }
+
+            this->state.textures = std::span(this->textures.data(), texture_count);
+            this->state.palette_textures = std::span(this->palette_textures.data(), textures_using_palette_count);
+
+            if (textures_using_palette_count || this->target_requires_palette())
+            {
+                this->state.palette = this->resolve_texture(palette_texture);
+                this->state.palette_remap = this->resolve_texture(palette_remap_texture);
+            }
+            else
+            {
+                this->state.palette = {};
+                this->state.palette_remap = {};
+            }
+
+            // Combine the world and projection matrixes once, they are stored transposed for the shaders
+            assert_ret(this->vs_constants_buffer_0_.size() >= sizeof(ffdu::vs_constants_0));
+            const ffdu::vs_constants_0& vs_constants_0 = *reinterpret_cast<const ffdu::vs_constants_0*>(this->vs_constants_buffer_0_.data());
+            const DirectX::XMMATRIX projection = DirectX::XMMatrixTranspose(DirectX::XMLoadFloat4x4(&vs_constants_0.projection));
+            const size_t matrix_count = std::min(this->vs_constants_buffer_1_.size() / sizeof(DirectX::XMFLOAT4X4), ffdu::MAX_TRANSFORM_MATRIXES);
+            const DirectX::XMFLOAT4X4* models = reinterpret_cast<const DirectX::XMFLOAT4X4*>(this->vs_constants_buffer_1_.data());
+
+            for (size_t i = 0; i < matrix_count; i++)
+            {
+                this->transforms[i] = DirectX::XMMatrixMultiply(DirectX::XMMatrixTranspose(DirectX::XMLoadFloat4x4(&models[i])), projection);
+            }
+        }
+
+        virtual bool apply_instance_state(ff::dxgi::command_context_base& context, const ffdu::instance_bucket& bucket) override
+        {
+            const bool palette_out = (this->state.target.format == DXGI_FORMAT_R8_UINT);
+
+            this->instance_item_size = bucket.item_size();
+            this->state.blend = (bucket.is_transparent() && !palette_out)
+                ? (this->pre_multiplied_alpha() ? ff::cpu::raster_blend::pre_multiplied_alpha : ff::cpu::raster_blend::alpha)
+                : ff::cpu::raster_blend::opaque;
+
+            switch (bucket.bucket_type())
+            {
+                case ffdu::instance_bucket_type::sprites:
+                case ffdu::instance_bucket_type::sprites_out_transparent:
+                    this->state.shader = ff::cpu::raster_shader::sprite;
+                    break;
+
+                case ffdu::instance_bucket_type::palette_sprites:
+                case ffdu::instance_bucket_type::palette_sprites_out_transparent:
+                    this->state.shader = ff::cpu::raster_shader::palette_sprite;
+                    break;
+
+                default:
+                    this->state.shader = ff::cpu::raster_shader::color;
+                    break;
+            }
+
+            return this->state.target;
+        }
+
+        virtual ff::dxgi::buffer_base& instance_buffer() override
+        {
+            return this->instance_buffer_;
+        }
+
+        virtual ff::dxgi::buffer_base& vs_constants_buffer_0() override
+        {
+            return this->vs_constants_buffer_0_;
+        }
+
+        virtual ff::dxgi::buffer_base& vs_constants_buffer_1() override
+        {
+            return this->vs_constants_buffer_1_;
+        }
+
+        virtual ff::dxgi::buffer_base& ps_constants_buffer_0() override
+        {
+            return this->ps_constants_buffer_0_;
+        }
+
+        virtual void draw(ff::dxgi::command_context_base& context, ffdu::instance_bucket_type instance_type, size_t instance_start, size_t instance_count) override
+        {
+            const uint8_t* data = this->instance_buffer_.data() + instance_start * this->instance_item_size;
+            assert_ret(instance_start + instance_count <= this->instance_buffer_.size() / this->instance_item_size);
+
+            this->triangles.clear();
+            ::vertex_builder builder(DirectX::XMMatrixIdentity(), this->viewport, this->triangles);
+
+            switch (instance_type)
+            {
+                default:
+                    debug_fail_msg("Invalid instance type");
+                    return;
+
+                case ffdu::instance_bucket_type::sprites:
+                case ffdu::instance_bucket_type::sprites_out_transparent:
+                case ffdu::instance_bucket_type::palette_sprites:
+                case ffdu::instance_bucket_type::palette_sprites_out_transparent:
+                    this->add_sprites(builder, std::span(reinterpret_cast<const ffdu::sprite_instance*>(data), instance_count));
+                    break;
+
+                case ffdu::instance_bucket_type::lines:
+                case ffdu::instance_bucket_type::lines_out_transparent:
+                    this->add_lines(builder, std::span(reinterpret_cast<const ffdu::line_instance*>(data), instance_count));
+                    break;
+
+                case ffdu::instance_bucket_type::triangles:
+                case ffdu::instance_bucket_type::triangles_out_transparent:
+                    this->add_triangles(builder, std::span(reinterpret_cast<const ffdu::triangle_instance*>(data), instance_count));
+                    break;
+
+                case ffdu::instance_bucket_type::rectangles_filled:
+                case ffdu::instance_bucket_type::rectangles_filled_out_transparent:
+                case ffdu::instance_bucket_type::rectangles_outline:
+                case ffdu::instance_bucket_type::rectangles_outline_out_transparent:
+                    this->add_rectangles(builder, std::span(reinterpret_cast<const ffdu::rectangle_instance*>(data), instance_count),
+                        instance_type == ffdu::instance_bucket_type::rectangles_outline || instance_type == ffdu::instance_bucket_type::rectangles_outline_out_transparent);
+                    break;
+
+                case ffdu::instance_bucket_type::circles_filled:
+                case ffdu::instance_bucket_type::circles_filled_out_transparent:
+                case ffdu::instance_bucket_type::circles_outline:
+                case ffdu::instance_bucket_type::circles_outline_out_transparent:
+                    this->add_circles(builder, std::span(reinterpret_cast<const ffdu::circle_instance*>(data), instance_count),
+                        instance_type == ffdu::instance_bucket_type::circles_outline || instance_type == ffdu::instance_bucket_type::circles_outline_out_transparent);
+                    break;
+            }
+
+            this->stats_.draw_calls++;
+            this->stats_.instances += instance_count;
+            this->stats_.triangles += this->triangles.size();
+
+            if (this->rasterize)
+            {
+                this->stats_.pixels += ff::cpu::rasterize(this->state, this->triangles);
+            }
+        }
+
+    private:
+        const DirectX::XMMATRIX& transform(uint32_t matrix_index) const
+        {
+            return this->transforms[std::min<size_t>(matrix_index, ffdu::MAX_TRANSFORM_MATRIXES - 1)];
+        }
+
+        // Same as vs_sprite.hlsl
+        void add_sprites(::vertex_builder& builder, std::span<const ffdu::sprite_instance> instances)
+        {
+            for (const ffdu::sprite_instance& instance : instances)
+            {
+                builder.transform_from(this->transform(instance.indexes >> 24));
+
+                const float rotate_sin = instance.pos_rot.w ? std::sin(instance.pos_rot.w) : 0.0f;
+                const float rotate_cos = instance.pos_rot.w ? std::cos(instance.pos_rot.w) : 1.0f;
+
+                for (uint32_t id = 0; id < 4; id++)
+                {
+                    const float vx = static_cast<float>(id & 1);
+                    const float vy = static_cast<float>(id >> 1);
+                    const float x = instance.rect.x + (instance.rect.z - instance.rect.x) * vx;
+                    const float y = instance.rect.y + (instance.rect.w - instance.rect.y) * vy;
+
+                    ff::cpu::raster_vertex& vertex = builder.vertex(id,
+                        x * rotate_cos + y * rotate_sin + instance.pos_rot.x,
+                        y * rotate_cos - x * rotate_sin + instance.pos_rot.y,
+                        instance.pos_rot.z);
+
+                    vertex.color = instance.color;
+                    vertex.uv.x = instance.uv_rect.x + (instance.uv_rect.z - instance.uv_rect.x) * vx;
+                    vertex.uv.y = instance.uv_rect.y + (instance.uv_rect.w - instance.uv_rect.y) * vy;
+                }
+
+                builder.triangles_from(::rectangle_indexes, instance.indexes);
+            }
+        }
+
+        // Same as vs_line.hlsl
+        void add_lines(::vertex_builder& builder, std::span<const ffdu::line_instance> instances)
+        {
+            for (const ffdu::line_instance& instance : instances)
+            {
+                builder.transform_from(this->transform(instance.matrix_index));
+
+                for (uint32_t id = 0; id < 4; id++)
+                {
+                    const float vx = static_cast<float>(id & 1);
+                    const float vy = static_cast<float>(id >> 1);
+                    const float thickness = instance.start_thickness + (instance.end_thickness - instance.start_thickness) * vx;
+                    DirectX::XMFLOAT2 pos = ::lerp(instance.start, instance.end, vx);
+
+                    if (thickness)
+                    {
+                        const DirectX::XMFLOAT2 dir = ::normalize(DirectX::XMFLOAT2(instance.end.x - instance.start.x, instance.end.y - instance.start.y));
+                        DirectX::XMFLOAT2 prev_dir(instance.start.x - instance.before_start.x, instance.start.y - instance.before_start.y);
+                        DirectX::XMFLOAT2 next_dir(instance.after_end.x - instance.end.x, instance.after_end.y - instance.end.y);
+                        prev_dir = ::normalize((prev_dir.x || prev_dir.y) ? prev_dir : dir);
+                        next_dir = ::normalize((next_dir.x || next_dir.y) ? next_dir : dir);
+
+                        const DirectX::XMFLOAT2 perp(-dir.y, dir.x);
+                        const DirectX::XMFLOAT2 prev_perp(-prev_dir.y, prev_dir.x);
+                        const DirectX::XMFLOAT2 next_perp(-next_dir.y, next_dir.x);
+                        const DirectX::XMFLOAT2 side_perp = ::lerp(prev_perp, next_perp, vx);
+                        const DirectX::XMFLOAT2 miter_dir = ::normalize(DirectX::XMFLOAT2(perp.x + side_perp.x, perp.y + side_perp.y));
+                        const float miter_length = 1.0f / std::max(miter_dir.x * perp.x + miter_dir.y * perp.y, 0.1f);
+                        const float miter_scale = thickness * 0.5f * miter_length * (vy ? -1.0f : 1.0f);
+
+                        pos.x += miter_dir.x * miter_scale;
+                        pos.y += miter_dir.y * miter_scale;
+                    }
+
+                    builder.vertex(id, pos.x, pos.y, instance.depth).color = ::lerp(instance.start_color, instance.end_color, vx);
+                }
+
+                builder.triangles_from(::rectangle_indexes);
+            }
+        }
+
+        // Same as vs_triangle.hlsl
+        void add_triangles(::vertex_builder& builder, std::span<const ffdu::triangle_instance> instances)
+        {
+            for (const ffdu::triangle_instance& instance : instances)
+            {
+                builder.transform_from(this->transform(instance.matrix_index));
+
+                for (uint32_t id = 0; id < 3; id++)
+                {
+                    builder.vertex(id, instance.position[id].x, instance.position[id].y, instance.depth).color = instance.color[id];
+                }
+
+                builder.triangles_from(::triangle_indexes);
+            }
+        }
+
+        // Same as vs_rectangle.hlsl
+        void add_rectangles(::vertex_builder& builder, std::span<const ffdu::rectangle_instance> instances, bool outline)
+        {
+            const uint32_t vertex_count = outline ? 8 : 4;
+
+            for (const ffdu::rectangle_instance& instance : instances)
+            {
+                builder.transform_from(this->transform(instance.matrix_index));
+
+                for (uint32_t id = 0; id < vertex_count; id++)
+                {
+                    const float vx = static_cast<float>(id & 1);
+                    const float vy = static_cast<float>((id >> 1) & 1);
+                    const float offset = ((id >> 2) & 1) ? instance.thickness : 0.0f;
+                    const float left = instance.rect.x + offset;
+                    const float top = instance.rect.y + offset;
+                    const float right = instance.rect.z - offset;
+                    const float bottom = instance.rect.w - offset;
+
+                    builder.vertex(id, left + (right - left) * vx, top + (bottom - top) * vy, instance.depth).color = instance.color;
+                }
+
+                if (outline)
+                {
+                    builder.triangles_from(::rectangle_outline_indexes);
+                }
+                else
+                {
+                    builder.triangles_from(::rectangle_indexes);
+                }
+            }
+        }
+
+        // Same as vs_circle.hlsl, vertexes 0-31 are outside, 32-63 are inside, and 64 is the center
+        void add_circles(::vertex_builder& builder, std::span<const ffdu::circle_instance> instances, bool outline)
+        {
+            const std::array<DirectX::XMFLOAT2, ::CIRCLE_POINT_COUNT>& cos_sin = ::circle_cos_sin();
+            const size_t count = ::CIRCLE_POINT_COUNT;
+
+            for (const ffdu::circle_instance& instance : instances)
+            {
+                const DirectX::XMFLOAT4& pr = instance.position_radius;
+                const float inner_radius = outline ? pr.w - instance.thickness : 0.0f;
+                builder.transform_from(this->transform(instance.matrix_index));
+
+                for (size_t i = 0; i < count; i++)
+                {
+                    builder.vertex(i, cos_sin[i].x * pr.w + pr.x, cos_sin[i].y * pr.w + pr.y, pr.z).color = instance.outside_color;
+                }
+
+                if (outline)
+                {
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        builder.vertex(count + i, cos_sin[i].x * inner_radius + pr.x, cos_sin[i].y * inner_radius + pr.y, pr.z).color = instance.inside_color;
+                    }
+
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        const size_t next = (i + 1) % count;
+                        builder.triangle(i, count + i, next);
+                        builder.triangle(next, count + i, count + next);
+                    }
+                }
+                else
+                {
+                    // The center has the outside color, since its vertex ID doesn't have the inside bit set
+                    builder.vertex(count * 2, pr.x, pr.y, pr.z).color = instance.outside_color;
+
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        builder.triangle(i, count * 2, (i + 1) % count);
+                    }
+                }
+            }
+        }
+
+        ff::cpu::raster_image resolve_texture(ff::dxgi::texture_view_base& view)
+        {
+            auto i = this->texture_entries.find(&view);
+            if (i != this->texture_entries.end())
+            {
+                return i->second.image;
+            }
+
+            ::texture_entry& entry = this->texture_entries.try_emplace(&view).first->second;
+            entry.source = view.view_texture()->data();
+
+            const DirectX::Image* image = entry.source ? entry.source->GetImage(view.view_mip_start(), view.view_array_start(), 0) : nullptr;
+            if (image && !::texture_format_direct(image->format))
+            {
+                auto converted = std::make_shared<DirectX::ScratchImage>();
+                HRESULT hr = ff::dxgi::compressed_format(image->format)
+                    ? DirectX::Decompress(*image, DXGI_FORMAT_R8G8B8A8_UNORM, *converted)
+                    : DirectX::Convert(*image, DXGI_FORMAT_R8G8B8A8_UNORM, DirectX::TEX_FILTER_DEFAULT, 0, *converted);
+
+                image = SUCCEEDED(hr) ? converted->GetImage(0, 0, 0) : nullptr;
+                entry.converted = std::move(converted);
+                assert(image);
+            }
+
+            if (image)
+            {
+                entry.image = ff::cpu::raster_image{ image->pixels, image->rowPitch, image->width, image->height, image->format };
+            }
+
+            return entry.image;
+        }
+
+        // Shader constants and instances
+        ff::cpu::buffer instance_buffer_{ ff::dxgi::buffer_type::vertex };
+        ff::cpu::buffer vs_constants_buffer_0_{ ff::dxgi::buffer_type::constant };
+        ff::cpu::buffer vs_constants_buffer_1_{ ff::dxgi::buffer_type::constant };
+        ff::cpu::buffer ps_constants_buffer_0_{ ff::dxgi::buffer_type::constant };
+        std::array<DirectX::XMMATRIX, ffdu::MAX_TRANSFORM_MATRIXES> transforms{};
+        size_t instance_item_size{ 1 };
+
+        // Render state
+        ff::dxgi::command_context_base* context{};
+        ff::cpu::raster_state state{};
+        ff::rect_float viewport{};
+        std::array<ff::cpu::raster_image, ffdu::MAX_TEXTURES> textures{};
+        std::array<ff::cpu::raster_image, ffdu::MAX_PALETTE_TEXTURES> palette_textures{};
+        std::unordered_map<const ff::dxgi::texture_view_base*, ::texture_entry> texture_entries;
+        std::vector<ff::cpu::raster_triangle> triangles;
+        ff::cpu::draw_stats stats_{};
+        size_t draw_calls_saved_start{};
+        bool rasterize;
+    };
+}
+
+std::unique_ptr<ff::cpu::draw_device> ff::cpu::create_draw_device(bool rasterize)
+{
+    return std::make_unique<::cpu_draw_device>(rasterize);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "../dxgi/draw_device_base.h"
+
+namespace ff::cpu
+{
+    struct draw_stats
+    {
+        size_t flushes;
+        size_t draw_calls;
+        size_t instances;
+        size_t triangles;
+        size_t pixels;
+        size_t draw_calls_saved; // by draw_options::reorder_transparent
+    };
+
+    /// <summary>
+    /// Draw device that renders into system memory without a GPU, for tests, tools, and headless hosts
+    /// </summary>
+    /// <remarks>
+    /// Targets must be ff::cpu::target_texture and depth buffers must be ff::cpu::depth. Textures can come from
+    /// any device since their pixels are read through texture_base::data(), only the top mip of a view is sampled.
+    ///
+    /// It doesn't need a GPU, but it's still built into ff.application and is Windows-only. Porting it would need:
+    /// DXGI_FORMAT and DirectX::ScratchImage/Image for texture storage (with DirectX::Convert/Decompress for other formats),
+    /// DirectXMath for transforms, and ff::thread_pool::parallel_reduce for splitting batches into row bands. That runs on ff.base's
+    /// work-stealing task scheduler, which is plain std::jthread code, but the rest of ff.base still uses Win32 handles and events.
+    /// The draw_device_base interface it implements uses the same DXGI and DirectXMath types.
+    /// </remarks>
+    class draw_device : public ff::dxgi::draw_device_base
+    {
+    public:
+        virtual const ff::cpu::draw_stats& stats() const = 0;
+        virtual void reset_stats() = 0;
+    };
+
+    // When rasterize is false, instances are batched and transformed into triangles but no pixels are written
+    std::unique_ptr<ff::cpu::draw_device> create_draw_device(bool rasterize = true);
+}
@@ -0,0 +1,484 @@
+#include "pch.h"
+#include "graphics/cpu/rasterizer.h"
+
+static constexpr int64_t subpixel_one = 256; // 8 bits of sub-pixel precision, like D3D
+static constexpr int64_t subpixel_half = ::subpixel_one / 2;
+static constexpr float max_coordinate = 1 << 20; // guard band in pixels, keeps edge math inside of 64 bits
+static constexpr int band_height = 32;
+static constexpr int64_t min_parallel_pixels = 128 * 128;
+
+namespace
+{
+    struct triangle_setup
+    {
+        const ff::cpu::raster_triangle* triangle;
+        std::array<const ff::cpu::raster_vertex*, 3> vertexes; // ordered so that the area is positive
+        std::array<int64_t, 3> edge_a; // edge[i] is opposite to vertexes[i], edge(x, y) = a*x + b*y + c
+        std::array<int64_t, 3> edge_b;
+        std::array<int64_t, 3> edge_c;
+        std::array<int64_t, 3> edge_bias; // -1 for edges that aren't top-left, so pixel centers exactly on them aren't drawn
+        float inv_area;
+        ff::rect_int bounds;
+    };
+
+    struct pixel_input
+    {
+        int x;
+        int y;
+        float z;
+        DirectX::XMFLOAT4 color;
+        DirectX::XMFLOAT2 uv;
+        uint32_t indexes;
+    };
+}
+
+ff::cpu::raster_image::operator bool() const
+{
+    return this->pixels != nullptr;
+}
+
+static int64_t floor_div(int64_t value, int64_t divisor)
+{
+    return (value >= 0) ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+static float frac(float value)
+{
+    return value - std::floor(value);
+}
+
+static DirectX::XMFLOAT4 multiply(const DirectX::XMFLOAT4& lhs, const DirectX::XMFLOAT4& rhs)
+{
+    return DirectX::XMFLOAT4(lhs.x * rhs.x, lhs.y * rhs.y, lhs.z * rhs.z, lhs.w * rhs.w);
+}
+
+static DirectX::XMFLOAT4 lerp(const DirectX::XMFLOAT4& lhs, const DirectX::XMFLOAT4& rhs, float t)
+{
+    return DirectX::XMFLOAT4(
+        lhs.x + (rhs.x - lhs.x) * t,
+        lhs.y + (rhs.y - lhs.y) * t,
+        lhs.z + (rhs.z - lhs.z) * t,
+        lhs.w + (rhs.w - lhs.w) * t);
+}
+
+static uint8_t to_unorm(float value)
+{
+    return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+// Same as discard_for_dither() in functions.hlsli
+static bool discard_for_dither(const ::pixel_input& input, float a)
+{
+    if (a == 1)
+    {
+        return false;
+    }
+
+    const float x = input.x + 0.5f;
+    const float y = input.y + 0.5f;
+    const float dot = x * (y + 19.19f) + y * (a + 19.19f) + a * (x + 19.19f);
+    const float px = ::frac(x * 0.3183099f + dot);
+    const float py = ::frac(y * 0.3678794f + dot);
+    const float pz = ::frac(a * 0.7071068f + dot);
+
+    return ::frac((px + py) * pz) >= a;
+}
+
+static DirectX::XMFLOAT4 load_color(const ff::cpu::raster_image& image, size_t x, size_t y)
+{
+    constexpr float scale = 1.0f / 255.0f;
+    const uint8_t* pixel = image.pixels + y * image.row_pitch + x * 4;
+
+    return (image.format == DXGI_FORMAT_B8G8R8A8_UNORM)
+        ? DirectX::XMFLOAT4(pixel[2] * scale, pixel[1] * scale, pixel[0] * scale, pixel[3] * scale)
+        : DirectX::XMFLOAT4(pixel[0] * scale, pixel[1] * scale, pixel[2] * scale, pixel[3] * scale);
+}
+
+// Like Texture2D.Load(), out of range reads return zero
+static DirectX::XMFLOAT4 load_texel(const ff::cpu::raster_image& image, uint32_t x, uint32_t y)
+{
+    return (image && x < image.width && y < image.height) ? ::load_color(image, x, y) : DirectX::XMFLOAT4{};
+}
+
+static uint32_t load_index(const ff::cpu::raster_image& image, uint32_t x, uint32_t y)
+{
+    return (image && x < image.width && y < image.height) ? image.pixels[y * image.row_pitch + x] : 0;
+}
+
+static uint32_t load_palette_texture(const ff::cpu::raster_image& image, const DirectX::XMFLOAT2& uv)
+{
+    // Truncate toward zero like the int3() cast in the shader, negative values stay out of range
+    const int x = static_cast<int>(uv.x * image.width);
+    const int y = static_cast<int>(uv.y * image.height);
+    return ::load_index(image, static_cast<uint32_t>(x), static_cast<uint32_t>(y));
+}
+
+// Clamp addressing, point or linear filtering from the top mip
+static DirectX::XMFLOAT4 sample_color(const ff::cpu::raster_image& image, const DirectX::XMFLOAT2& uv, bool linear_filter)
+{
+    if (!image)
+    {
+        return {};
+    }
+
+    const int max_x = static_cast<int>(image.width) - 1;
+    const int max_y = static_cast<int>(image.height) - 1;
+    float x = uv.x * image.width;
+    float y = uv.y * image.height;
+
+    if (!linear_filter)
+    {
+        return ::load_color(image,
+            static_cast<size_t>(std::clamp(static_cast<int>(std::floor(x)), 0, max_x)),
+            static_cast<size_t>(std::clamp(static_cast<int>(std::floor(y)), 0, max_y)));
+    }
+
+    x -= 0.5f;
+    y -= 0.5f;
+
+    const float x_floor = std::floor(x);
+    const float y_floor = std::floor(y);
+    const float tx = x - x_floor;
+    const float ty = y - y_floor;
+    const size_t x0 = static_cast<size_t>(std::clamp(static_cast<int>(x_floor), 0, max_x));
+    const size_t y0 = static_cast<size_t>(std::clamp(static_cast<int>(y_floor), 0, max_y));
+    const size_t x1 = static_cast<size_t>(std::clamp(static_cast<int>(x_floor) + 1, 0, max_x));
+    const size_t y1 = static_cast<size_t>(std::clamp(static_cast<int>(y_floor) + 1, 0, max_y));
+
+    return ::lerp(
+        ::lerp(::load_color(image, x0, y0), ::load_color(image, x1, y0), tx),
+        ::lerp(::load_color(image, x0, y1), ::load_color(image, x1, y1), tx),
+        ty);
+}
+
+static const ff::cpu::raster_image& get_image(std::span<const ff::cpu::raster_image> images, size_t index)
+{
+    static const ff::cpu::raster_image null_image{};
+    return (index < images.size()) ? images[index] : null_image;
+}
+
+// Pixel shaders for RGBA output, return false to discard
+template<ff::cpu::raster_shader Shader>
+static bool shade_color(const ff::cpu::raster_state& state, const ::pixel_input& input, DirectX::XMFLOAT4& output)
+{
+    if constexpr (Shader == ff::cpu::raster_shader::color)
+    {
+        output = input.color;
+    }
+    else if constexpr (Shader == ff::cpu::raster_shader::sprite)
+    {
+        const ff::cpu::raster_image& texture = ::get_image(state.textures, input.indexes & 0xFF);
+        const bool linear_filter = ((input.indexes & 0xFF00) >> 8) != 0;
+        output = ::multiply(input.color, ::sample_color(texture, input.uv, linear_filter));
+    }
+    else if constexpr (Shader == ff::cpu::raster_shader::palette_sprite)
+    {
+        const ff::cpu::raster_image& texture = ::get_image(state.palette_textures, input.indexes & 0xFF);
+        const uint32_t palette_index = (input.indexes & 0xFF00) >> 8;
+        const uint32_t remap_index = (input.indexes & 0xFF0000) >> 16;
+
+        uint32_t index = ::load_palette_texture(texture, input.uv);
+        if (!index)
+        {
+            return false;
+        }
+
+        index = ::load_index(state.palette_remap, index, remap_index);
+        output = ::multiply(input.color, ::load_texel(state.palette, index, palette_index));
+    }
+
+    return output.w != 0;
+}
+
+// Pixel shaders for palette index output, return false to discard
+template<ff::cpu::raster_shader Shader>
+static bool shade_index(const ff::cpu::raster_state& state, const ::pixel_input& input, uint8_t& output)
+{
+    uint32_t index = 0;
+    float alpha = input.color.w;
+
+    if constexpr (Shader == ff::cpu::raster_shader::color)
+    {
+        index = static_cast<uint32_t>(input.color.x * 256) * static_cast<uint32_t>(alpha != 0);
+    }
+    else if constexpr (Shader == ff::cpu::raster_shader::sprite)
+    {
+        const ff::cpu::raster_image& texture = ::get_image(state.textures, input.indexes & 0xFF);
+        const bool linear_filter = ((input.indexes & 0xFF00) >> 8) != 0;
+        const uint32_t remap_index = (input.indexes & 0xFF0000) >> 16;
+        const DirectX::XMFLOAT4 color = ::sample_color(texture, input.uv, linear_filter);
+
+        alpha *= color.w;
+        index = static_cast<uint32_t>(((input.color.x != 1) ? input.color.x : color.x) * 256) * static_cast<uint32_t>(alpha != 0);
+        index = ::load_index(state.palette_remap, index, remap_index);
+    }
+    else if constexpr (Shader == ff::cpu::raster_shader::palette_sprite)
+    {
+        const ff::cpu::raster_image& texture = ::get_image(state.palette_textures, input.indexes & 0xFF);
+        const uint32_t remap_index = (input.indexes & 0xFF0000) >> 16;
+
+        index = ::load_palette_texture(texture, input.uv);
+        index = ((input.color.x != 1) ? static_cast<uint32_t>(input.color.x * 256) : index) * static_cast<uint32_t>(alpha != 0);
+        index = ::load_index(state.palette_remap, index, remap_index);
+    }
+
+    if (!index || ::discard_for_dither(input, alpha))
+    {
+        return false;
+    }
+
+    output = static_cast<uint8_t>(std::min<uint32_t>(index, 0xFF));
+    return true;
+}
+
+static void write_color(const ff::cpu::raster_state& state, const ::pixel_input& input, const DirectX::XMFLOAT4& color)
+{
+    const ff::cpu::raster_image& target = state.target;
+    DirectX::XMFLOAT4 result = color;
+
+    if (state.blend != ff::cpu::raster_blend::opaque)
+    {
+        // newColor = (srcColor * SrcBlend) + (destColor * (1 - srcAlpha))
+        // newAlpha = srcAlpha + (destAlpha * (1 - srcAlpha))
+        const DirectX::XMFLOAT4 dest = ::load_color(target, static_cast<size_t>(input.x), static_cast<size_t>(input.y));
+        const float src_blend = (state.blend == ff::cpu::raster_blend::alpha) ? color.w : 1.0f;
+        const float dest_blend = 1.0f - color.w;
+
+        result.x = color.x * src_blend + dest.x * dest_blend;
+        result.y = color.y * src_blend + dest.y * dest_blend;
+        result.z = color.z * src_blend + dest.z * dest_blend;
+        result.w = color.w + dest.w * dest_blend;
+    }
+
+    uint8_t* pixel = target.pixels + input.y * target.row_pitch + input.x * 4;
+    const bool bgra = (target.format == DXGI_FORMAT_B8G8R8A8_UNORM);
+    pixel[bgra ? 2 : 0] = ::to_unorm(result.x);
+    pixel[1] = ::to_unorm(result.y);
+    pixel[bgra ? 0 : 2] = ::to_unorm(result.z);
+    pixel[3] = ::to_unorm(result.w);
+}
+
+template<ff::cpu::raster_shader Shader, bool PaletteOut>
+static size_t rasterize_rows(const ff::cpu::raster_state& state, std::span<const ::triangle_setup> setups, int row_start, int row_end)
+{
+    size_t pixel_count = 0;
+    ::pixel_input input;
+
+    for (const ::triangle_setup& setup : setups)
+    {
+        const int top = std::max(setup.bounds.top, row_start);
+        const int bottom = std::min(setup.bounds.bottom, row_end);
+        const ff::cpu::raster_vertex& v0 = *setup.vertexes[0];
+        const ff::cpu::raster_vertex& v1 = *setup.vertexes[1];
+        const ff::cpu::raster_vertex& v2 = *setup.vertexes[2];
+        input.indexes = setup.triangle->indexes;
+
+        for (int y = top; y < bottom; y++)
+        {
+            const int64_t py = y * ::subpixel_one + ::subpixel_half;
+            const int64_t px = setup.bounds.left * ::subpixel_one + ::subpixel_half;
+            std::array<int64_t, 3> edge;
+
+            for (size_t i = 0; i < 3; i++)
+            {
+                edge[i] = setup.edge_a[i] * px + setup.edge_b[i] * py + setup.edge_c[i];
+            }
+
+            for (int x = setup.bounds.left; x < setup.bounds.right; x++,
+                edge[0] += setup.edge_a[0] * ::subpixel_one,
+                edge[1] += setup.edge_a[1] * ::subpixel_one,
+                edge[2] += setup.edge_a[2] * ::subpixel_one)
+            {
+                if (edge[0] + setup.edge_bias[0] < 0 || edge[1] + setup.edge_bias[1] < 0 || edge[2] + setup.edge_bias[2] < 0)
+                {
+                    continue;
+                }
+
+                const float w1 = edge[1] * setup.inv_area;
+                const float w2 = edge[2] * setup.inv_area;
+                const float w0 = 1.0f - w1 - w2;
+
+                input.x = x;
+                input.y = y;
+                input.z = v0.z * w0 + v1.z * w1 + v2.z * w2;
+
+                float* depth = state.depth ? state.depth + y * state.target.width + x : nullptr;
+                if (input.z < 0 || input.z > 1 || (depth && !(input.z > *depth)))
+                {
+                    continue;
+                }
+
+                input.color.x = v0.color.x * w0 + v1.color.x * w1 + v2.color.x * w2;
+                input.color.y = v0.color.y * w0 + v1.color.y * w1 + v2.color.y * w2;
+                input.color.z = v0.color.z * w0 + v1.color.z * w1 + v2.color.z * w2;
+                input.color.w = v0.color.w * w0 + v1.color.w * w1 + v2.color.w * w2;
+
+                if constexpr (Shader != ff::cpu::raster_shader::color)
+                {
+                    input.uv.x = v0.uv.x * w0 + v1.uv.x * w1 + v2.uv.x * w2;
+                    input.uv.y = v0.uv.y * w0 + v1.uv.y * w1 + v2.uv.y * w2;
+                }
+
+                if constexpr (PaletteOut)
+                {
+                    uint8_t index;
+                    if (!::shade_index<Shader>(state, input, index))
+                    {
+                        continue;
+                    }
+
+                    state.target.pixels[y * state.target.row_pitch + x] = index;
+                }
+                else
+                {
+                    DirectX::XMFLOAT4 color;
+                    if (!::shade_color<Shader>(state, input, color))
+                    {
+                        continue;
+                    }
+
+                    ::write_color(state, input, color);
+                }
+
+                if (depth)
+                {
+                    *depth = input.z;
+                }
+
+                pixel_count++;
+            }
+        }
+    }
+
+    return pixel_count;
+}
+
+using rasterize_rows_func = size_t(*)(const ff::cpu::raster_state& state, std::span<const ::triangle_setup> setups, int row_start, int row_end);
+
+static rasterize_rows_func get_rasterize_rows_func(ff::cpu::raster_shader shader, bool palette_out)
+{
+    switch (shader)
+    {
+        default:
+            debug_fail_ret_val(nullptr);
+
+        case ff::cpu::raster_shader::color:
+            return palette_out ? &::rasterize_rows<ff::cpu::raster_shader::color, true> : &::rasterize_rows<ff::cpu::raster_shader::color, false>;
+
+        case ff::cpu::raster_shader::sprite:
+            return palette_out ? &::rasterize_rows<ff::cpu::raster_shader::sprite, true> : &::rasterize_rows<ff::cpu::raster_shader::sprite, false>;
+
+        case ff::cpu::raster_shader::palette_sprite:
+            return palette_out ? &::rasterize_rows<ff::cpu::raster_shader::palette_sprite, true> : &::rasterize_rows<ff::cpu::raster_shader::palette_sprite, false>;
+    }
+}
+
+static bool setup_triangle(const ff::cpu::raster_triangle& triangle, const ff::rect_int& clip, ::triangle_setup& setup)
+{
+    std::array<int64_t, 3> x;
+    std::array<int64_t, 3> y;
+    setup.triangle = &triangle;
+
+    for (size_t i = 0; i < 3; i++)
+    {
+        const ff::cpu::raster_vertex& vertex = triangle.vertexes[i];
+        if (!(std::abs(vertex.x) < ::max_coordinate && std::abs(vertex.y) < ::max_coordinate))
+        {
+            return false;
+        }
+
+        setup.vertexes[i] = &vertex;
+        x[i] = static_cast<int64_t>(std::round(vertex.x * ::subpixel_one));
+        y[i] = static_cast<int64_t>(std::round(vertex.y * ::subpixel_one));
+    }
+
+    int64_t area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+    if (!area)
+    {
+        return false;
+    }
+
+    // There is no culling, so flip counter-clockwise triangles
+    if (area < 0)
+    {
+        std::swap(setup.vertexes[1], setup.vertexes[2]);
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        area = -area;
+    }
+
+    for (size_t i = 0; i < 3; i++)
+    {
+        const size_t a = (i + 1) % 3;
+        const size_t b = (i + 2) % 3;
+        const int64_t dx = x[b] - x[a];
+        const int64_t dy = y[b] - y[a];
+        const bool top_left = (dy == 0 && dx > 0) || dy < 0;
+
+        setup.edge_a[i] = -dy;
+        setup.edge_b[i] = dx;
+        setup.edge_c[i] = x[a] * y[b] - y[a] * x[b];
+        setup.edge_bias[i] = top_left ? 0 : -1;
+    }
+
+    // Pixels whose centers are inside of the sub-pixel bounds
+    const int64_t min_x = std::min({ x[0], x[1], x[2] });
+    const int64_t min_y = std::min({ y[0], y[1], y[2] });
+    const int64_t max_x = std::max({ x[0], x[1], x[2] });
+    const int64_t max_y = std::max({ y[0], y[1], y[2] });
+
+    setup.bounds = ff::rect_int(
+        static_cast<int>(::floor_div(min_x - ::subpixel_half + ::subpixel_one - 1, ::subpixel_one)),
+        static_cast<int>(::floor_div(min_y - ::subpixel_half + ::subpixel_one - 1, ::subpixel_one)),
+        static_cast<int>(::floor_div(max_x - ::subpixel_half, ::subpixel_one) + 1),
+        static_cast<int>(::floor_div(max_y - ::subpixel_half, ::subpixel_one) + 1)).intersection(clip);
+    setup.inv_area = 1.0f / static_cast<float>(area);
+
+    return setup.bounds.left < setup.bounds.right && setup.bounds.top < setup.bounds.bottom;
+}
+
+size_t ff::cpu::rasterize(const ff::cpu::raster_state& state, std::span<const ff::cpu::raster_triangle> triangles)
+{
+    const ff::rect_int target_rect(0, 0, static_cast<int>(state.target.width), static_cast<int>(state.target.height));
+    const ff::rect_int clip = state.clip.intersection(target_rect);
+    const bool palette_out = (state.target.format == DXGI_FORMAT_R8_UINT);
+    check_ret_val(state.target && clip.area() > 0 && !triangles.empty(), 0);
+
+    std::vector<::triangle_setup> setups;
+    setups.reserve(triangles.size());
+    int64_t total_pixels = 0;
+
+    for (const ff::cpu::raster_triangle& triangle : triangles)
+    {
+        ::triangle_setup& setup = setups.emplace_back();
+        if (::setup_triangle(triangle, clip, setup))
+        {
+            total_pixels += setup.bounds.area();
+        }
+        else
+        {
+            setups.pop_back();
+        }
+    }
+
+    rasterize_rows_func func = ::get_rasterize_rows_func(state.shader, palette_out);
+    check_ret_val(func && !setups.empty(), 0);
+
+    const size_t band_count = static_cast<size_t>((clip.height() + ::band_height - 1) / ::band_height);
+    if (band_count < 2 || total_pixels < ::min_parallel_pixels)
+    {
+        return func(state, setups, clip.top, clip.bottom);
+    }
+
+    return ff::thread_pool::parallel_reduce<size_t>(0, band_count, 0,
+        [&state, &setups, &clip, func](size_t band_begin, size_t band_end)
+        {
+            const int row_start = clip.top + static_cast<int>(band_begin) * ::band_height;
+            const int row_end = std::min(clip.top + static_cast<int>(band_end) * ::band_height, clip.bottom);
+            return func(state, setups, row_start, row_end);
+        },
+        [](size_t lhs, size_t rhs)
+        {
+            return lhs + rhs;
+        }, 1);
+}
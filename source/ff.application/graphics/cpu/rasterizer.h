@@ -0,0 +1,72 @@
+#pragma once
+
+namespace ff::cpu
+{
+    /// <summary>
+    /// View of 2D pixels in memory, with a format of R8G8B8A8_UNORM, B8G8R8A8_UNORM, or R8_UINT
+    /// </summary>
+    struct raster_image
+    {
+        operator bool() const;
+
+        uint8_t* pixels{};
+        size_t row_pitch{};
+        size_t width{};
+        size_t height{};
+        DXGI_FORMAT format{};
+    };
+
+    struct raster_vertex
+    {
+        float x; // target pixels
+        float y;
+        float z; // depth
+        DirectX::XMFLOAT4 color;
+        DirectX::XMFLOAT2 uv;
+    };
+
+    struct raster_triangle
+    {
+        std::array<ff::cpu::raster_vertex, 3> vertexes;
+        uint32_t indexes; // same bits as ff::dxgi::draw_util::sprite_instance::indexes
+    };
+
+    // Matches the pixel shaders in ps_sprite.hlsl and ps_color.hlsl
+    enum class raster_shader
+    {
+        color,
+        sprite,
+        palette_sprite,
+    };
+
+    enum class raster_blend
+    {
+        opaque,
+        alpha,
+        pre_multiplied_alpha,
+    };
+
+    struct raster_state
+    {
+        ff::cpu::raster_image target;
+        float* depth; // one value per target pixel, null to disable depth testing
+        ff::rect_int clip;
+        ff::cpu::raster_shader shader;
+        ff::cpu::raster_blend blend;
+        std::span<const ff::cpu::raster_image> textures;
+        std::span<const ff::cpu::raster_image> palette_textures;
+        ff::cpu::raster_image palette;
+        ff::cpu::raster_image palette_remap;
+    };
+
+    /// <summary>
+    /// Reference rasterizer that follows the D3D rules: pixel centers at 0.5, 8 bits of sub-pixel precision,
+    /// top-left fill convention, GREATER depth test, and the same blend equations as the DX12 draw device.
+    /// </summary>
+    /// <remarks>
+    /// Triangles are drawn in order. Large batches split the target into bands of rows that are rasterized
+    /// in parallel, which keeps the output deterministic since each pixel is still only touched by one thread.
+    /// </remarks>
+    /// <returns>The number of pixels written</returns>
+    size_t rasterize(const ff::cpu::raster_state& state, std::span<const ff::cpu::raster_triangle> triangles);
+}
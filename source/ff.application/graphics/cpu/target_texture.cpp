@@ -0,0 +1,150 @@
+#include "pch.h"
+#include "graphics/cpu/target_texture.h"
+#include "graphics/cpu/texture.h"
+#include "graphics/types/color.h"
+
+static bool target_format_valid(DXGI_FORMAT format)
+{
+    switch (format)
+    {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_R8_UINT:
+            return true;
+    }
+
+    return false;
+}
+
+ff::cpu::target_texture::target_texture(
+    const std::shared_ptr<ff::cpu::texture>& texture,
+    size_t array_index,
+    size_t mip_level,
+    int dmdo_rotate,
+    double dpi_scale)
+    : texture_(texture)
+    , array_index(array_index)
+    , mip_level(mip_level)
+    , dmdo_rotate(dmdo_rotate)
+    , dpi_scale(dpi_scale > 0.0 ? dpi_scale : 1.0)
+{
+    assert(*this);
+}
+
+ff::cpu::target_texture& ff::cpu::target_texture::get(ff::dxgi::target_base& obj)
+{
+    return static_cast<ff::cpu::target_texture&>(obj);
+}
+
+ff::cpu::target_texture::operator bool() const
+{
+    return this->texture_ && *this->texture_ && ::target_format_valid(this->texture_->format()) &&
+        this->texture_->image(this->array_index, this->mip_level);
+}
+
+const std::shared_ptr<ff::cpu::texture>& ff::cpu::target_texture::shared_texture() const
+{
+    return this->texture_;
+}
+
+ff::cpu::raster_image ff::cpu::target_texture::image() const
+{
+    const DirectX::Image* image = *this ? this->texture_->image(this->array_index, this->mip_level) : nullptr;
+    return image
+        ? ff::cpu::raster_image{ image->pixels, image->rowPitch, image->width, image->height, image->format }
+        : ff::cpu::raster_image{};
+}
+
+void ff::cpu::target_texture::clear(ff::dxgi::command_context_base& context, const ff::color& clear_color)
+{
+    ff::cpu::raster_image image = this->image();
+    check_ret(image);
+
+    const DirectX::XMFLOAT4 color = clear_color.to_shader_color();
+    std::array<uint8_t, 4> pixel{};
+
+    if (image.format == DXGI_FORMAT_R8_UINT)
+    {
+        // Palette colors store their index in red
+        pixel[0] = static_cast<uint8_t>(std::clamp(color.x * 256.0f + 0.5f, 0.0f, 255.0f));
+    }
+    else
+    {
+        const bool bgra = (image.format == DXGI_FORMAT_B8G8R8A8_UNORM);
+        pixel[bgra ? 2 : 0] = static_cast<uint8_t>(std::clamp(color.x, 0.0f, 1.0f) * 255.0f + 0.5f);
+        pixel[1] = static_cast<uint8_t>(std::clamp(color.y, 0.0f, 1.0f) * 255.0f + 0.5f);
+        pixel[bgra ? 0 : 2] = static_cast<uint8_t>(std::clamp(color.z, 0.0f, 1.0f) * 255.0f + 0.5f);
+        pixel[3] = static_cast<uint8_t>(std::clamp(color.w, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+
+    const size_t pixel_size = (image.format == DXGI_FORMAT_R8_UINT) ? 1 : 4;
+    for (size_t y = 0; y < image.height; y++)
+    {
+        uint8_t* row = image.pixels + y * image.row_pitch;
+        for (size_t x = 0; x < image.width; x++)
+        {
+            std::memcpy(row + x * pixel_size, pixel.data(), pixel_size);
+        }
+    }
+}
+
+bool ff::cpu::target_texture::begin_render(ff::dxgi::command_context_base& context, const ff::color* clear_color)
+{
+    check_ret_val(*this, false);
+
+    if (clear_color)
+    {
+        this->clear(context, *clear_color);
+    }
+
+    return true;
+}
+
+bool ff::cpu::target_texture::end_render(ff::dxgi::command_context_base& context)
+{
+    return true;
+}
+
+ff::dxgi::target_access_base& ff::cpu::target_texture::target_access()
+{
+    return *this;
+}
+
+size_t ff::cpu::target_texture::target_array_start() const
+{
+    return this->array_index;
+}
+
+size_t ff::cpu::target_texture::target_array_size() const
+{
+    return 1;
+}
+
+size_t ff::cpu::target_texture::target_mip_start() const
+{
+    return this->mip_level;
+}
+
+size_t ff::cpu::target_texture::target_mip_size() const
+{
+    return 1;
+}
+
+size_t ff::cpu::target_texture::target_sample_count() const
+{
+    return 1;
+}
+
+DXGI_FORMAT ff::cpu::target_texture::format() const
+{
+    return this->texture_ ? this->texture_->format() : DXGI_FORMAT_UNKNOWN;
+}
+
+ff::window_size ff::cpu::target_texture::size() const
+{
+    const DirectX::Image* image = *this ? this->texture_->image(this->array_index, this->mip_level) : nullptr;
+    ff::point_size size = image ? ff::point_size(image->width, image->height) : ff::point_size{};
+    ff::window_size result{ size, this->dpi_scale, this->dmdo_rotate };
+    result.logical_pixel_size = result.physical_pixel_size();
+    return result;
+}
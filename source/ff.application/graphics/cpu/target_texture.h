@@ -0,0 +1,54 @@
+#pragma once
+
+#include "../cpu/rasterizer.h"
+#include "../dxgi/target_access_base.h"
+#include "../dxgi/target_base.h"
+
+namespace ff::cpu
+{
+    class texture;
+
+    /// <summary>
+    /// Render target for the CPU draw device, pixels are written straight into one image of a CPU texture
+    /// </summary>
+    class target_texture : public ff::dxgi::target_base, public ff::dxgi::target_access_base
+    {
+    public:
+        target_texture(
+            const std::shared_ptr<ff::cpu::texture>& texture,
+            size_t array_index = 0,
+            size_t mip_level = 0,
+            int dmdo_rotate = DMDO_DEFAULT,
+            double dpi_scale = 1.0);
+        target_texture(target_texture&& other) noexcept = default;
+        target_texture(const target_texture& other) = delete;
+
+        static target_texture& get(ff::dxgi::target_base& obj);
+        target_texture& operator=(target_texture&& other) noexcept = default;
+        target_texture& operator=(const target_texture& other) = delete;
+        operator bool() const;
+
+        const std::shared_ptr<ff::cpu::texture>& shared_texture() const;
+        ff::cpu::raster_image image() const;
+
+        // target_base
+        virtual void clear(ff::dxgi::command_context_base& context, const ff::color& clear_color) override;
+        virtual bool begin_render(ff::dxgi::command_context_base& context, const ff::color* clear_color) override;
+        virtual bool end_render(ff::dxgi::command_context_base& context) override;
+        virtual ff::dxgi::target_access_base& target_access() override;
+        virtual size_t target_array_start() const override;
+        virtual size_t target_array_size() const override;
+        virtual size_t target_mip_start() const override;
+        virtual size_t target_mip_size() const override;
+        virtual size_t target_sample_count() const override;
+        virtual DXGI_FORMAT format() const override;
+        virtual ff::window_size size() const override;
+
+    private:
+        std::shared_ptr<ff::cpu::texture> texture_;
+        size_t array_index;
+        size_t mip_level;
+        int dmdo_rotate;
+        double dpi_scale;
+    };
+}
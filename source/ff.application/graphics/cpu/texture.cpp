@@ -0,0 +1,126 @@
+#include "pch.h"
+#include "graphics/cpu/texture.h"
+#include "graphics/dxgi/format_util.h"
+#include "graphics/dxgi/sprite_data.h"
+
+ff::cpu::texture::texture(const ff::point_size& size, DXGI_FORMAT format, size_t mip_count, size_t array_size)
+{
+    format = ff::dxgi::fix_format(format, size.x, size.y, mip_count);
+
+    auto data = std::make_shared<DirectX::ScratchImage>();
+    if (!ff::dxgi::compressed_format(format) && SUCCEEDED(data->Initialize2D(format, size.x, size.y, array_size, mip_count)))
+    {
+        std::memset(data->GetPixels(), 0, data->GetPixelsSize());
+        this->data_ = std::move(data);
+    }
+
+    this->sprite_type_ = ff::dxgi::palette_format(format) ? ff::dxgi::sprite_type::opaque_palette : ff::dxgi::sprite_type::transparent;
+}
+
+ff::cpu::texture::texture(const std::shared_ptr<DirectX::ScratchImage>& data, ff::dxgi::sprite_type sprite_type)
+    : data_(data)
+{
+    this->sprite_type_ = (sprite_type == ff::dxgi::sprite_type::unknown && this->data_)
+        ? ff::dxgi::get_sprite_type(*this->data_)
+        : sprite_type;
+}
+
+ff::cpu::texture& ff::cpu::texture::get(ff::dxgi::texture_base& obj)
+{
+    return static_cast<ff::cpu::texture&>(obj);
+}
+
+ff::cpu::texture::operator bool() const
+{
+    return this->data_ && this->data_->GetImageCount();
+}
+
+const DirectX::Image* ff::cpu::texture::image(size_t array_index, size_t mip_index) const
+{
+    return *this ? this->data_->GetImage(mip_index, array_index, 0) : nullptr;
+}
+
+ff::dxgi::sprite_type ff::cpu::texture::sprite_type() const
+{
+    return this->sprite_type_;
+}
+
+std::shared_ptr<DirectX::ScratchImage> ff::cpu::texture::data() const
+{
+    return this->data_;
+}
+
+bool ff::cpu::texture::update(ff::dxgi::command_context_base& context, size_t array_index, size_t mip_index, const ff::point_size& pos, const DirectX::Image& data)
+{
+    const DirectX::Image* dest = this->image(array_index, mip_index);
+    assert_ret_val(dest && data.format == dest->format && !ff::dxgi::compressed_format(data.format), false);
+    assert_ret_val(pos.x + data.width <= dest->width && pos.y + data.height <= dest->height, false);
+
+    const size_t pixel_size = DirectX::BitsPerPixel(data.format) / 8;
+    for (size_t y = 0; y < data.height; y++)
+    {
+        std::memcpy(
+            dest->pixels + (pos.y + y) * dest->rowPitch + pos.x * pixel_size,
+            data.pixels + y * data.rowPitch,
+            data.width * pixel_size);
+    }
+
+    return true;
+}
+
+ff::point_size ff::cpu::texture::size() const
+{
+    return *this
+        ? ff::point_size(this->data_->GetMetadata().width, this->data_->GetMetadata().height)
+        : ff::point_size{};
+}
+
+size_t ff::cpu::texture::mip_count() const
+{
+    return *this ? this->data_->GetMetadata().mipLevels : 0;
+}
+
+size_t ff::cpu::texture::array_size() const
+{
+    return *this ? this->data_->GetMetadata().arraySize : 0;
+}
+
+size_t ff::cpu::texture::sample_count() const
+{
+    return 1;
+}
+
+DXGI_FORMAT ff::cpu::texture::format() const
+{
+    return *this ? this->data_->GetMetadata().format : DXGI_FORMAT_UNKNOWN;
+}
+
+ff::dxgi::texture_view_access_base& ff::cpu::texture::view_access()
+{
+    return *this;
+}
+
+ff::dxgi::texture_base* ff::cpu::texture::view_texture()
+{
+    return this;
+}
+
+size_t ff::cpu::texture::view_array_start() const
+{
+    return 0;
+}
+
+size_t ff::cpu::texture::view_array_size() const
+{
+    return this->array_size();
+}
+
+size_t ff::cpu::texture::view_mip_start() const
+{
+    return 0;
+}
+
+size_t ff::cpu::texture::view_mip_size() const
+{
+    return this->mip_count();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "../dxgi/texture_base.h"
+#include "../dxgi/texture_view_access_base.h"
+
+namespace ff::cpu
+{
+    /// <summary>
+    /// Texture that only lives in system memory, it is its own view of every array item and mip
+    /// </summary>
+    class texture : public ff::dxgi::texture_base, public ff::dxgi::texture_view_access_base
+    {
+    public:
+        texture(const ff::point_size& size, DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM, size_t mip_count = 1, size_t array_size = 1);
+        texture(const std::shared_ptr<DirectX::ScratchImage>& data, ff::dxgi::sprite_type sprite_type = ff::dxgi::sprite_type::unknown);
+        texture(texture&& other) noexcept = default;
+        texture(const texture& other) = delete;
+
+        static texture& get(ff::dxgi::texture_base& obj);
+        texture& operator=(texture&& other) noexcept = default;
+        texture& operator=(const texture& other) = delete;
+        operator bool() const;
+
+        const DirectX::Image* image(size_t array_index = 0, size_t mip_index = 0) const;
+
+        // texture_base
+        virtual ff::dxgi::sprite_type sprite_type() const override;
+        virtual std::shared_ptr<DirectX::ScratchImage> data() const override;
+        virtual bool update(ff::dxgi::command_context_base& context, size_t array_index, size_t mip_index, const ff::point_size& pos, const DirectX::Image& data) override;
+
+        // texture_metadata_base
+        virtual ff::point_size size() const override;
+        virtual size_t mip_count() const override;
+        virtual size_t array_size() const override;
+        virtual size_t sample_count() const override;
+        virtual DXGI_FORMAT format() const override;
+
+        // texture_view_base
+        virtual ff::dxgi::texture_view_access_base& view_access() override;
+        virtual ff::dxgi::texture_base* view_texture() override;
+        virtual size_t view_array_start() const override;
+        virtual size_t view_array_size() const override;
+        virtual size_t view_mip_start() const override;
+        virtual size_t view_mip_size() const override;
+
+    private:
+        std::shared_ptr<DirectX::ScratchImage> data_;
+        ff::dxgi::sprite_type sprite_type_{};
+    };
+}
@@ -3,6 +3,11 @@
 #include "graphics/dx12/dx12_globals.h"
 #include "graphics/dx12/mem_allocator.h"
 
+double ff::dx12::mem_allocator_stats::fragmentation() const
+{
+    return this->free_size ? 1.0 - static_cast<double>(this->largest_free_size) / static_cast<double>(this->free_size) : 0.0;
+}
+
 void* ff::dx12::mem_buffer_base::cpu_data(uint64_t start)
 {
     return nullptr;
@@ -13,17 +18,13 @@ D3D12_GPU_VIRTUAL_ADDRESS ff::dx12::mem_buffer_base::gpu_data(uint64_t start)
     return 0;
 }
 
-uint64_t ff::dx12::mem_buffer_ring::range_t::after_end() const
+void ff::dx12::mem_buffer_base::add_stats(ff::dx12::mem_allocator_stats& stats)
 {
-    return this->start + this->size;
+    stats.heap_count++;
+    stats.heap_size += this->heap().size();
 }
 
-bool ff::dx12::mem_buffer_free_list::range_t::operator<(const range_t& other) const
-{
-    return this->start < other.start;
-}
-
-uint64_t ff::dx12::mem_buffer_free_list::range_t::after_end() const
+uint64_t ff::dx12::mem_buffer_ring::range_t::after_end() const
 {
     return this->start + this->size;
 }
@@ -153,48 +154,18 @@ void ff::dx12::mem_buffer_ring::before_reset()
 
 ff::dx12::mem_buffer_free_list::mem_buffer_free_list(uint64_t size, ff::dx12::heap::usage_t usage)
     : heap_(ff::string::concat("Free list ", ff::dx12::heap::usage_name(usage), " heap (", size, ")"), size, usage)
-{
-    this->free_ranges.emplace_back(range_t{ 0, size });
-}
+    , ranges(size)
+{}
 
 ff::dx12::mem_buffer_free_list::~mem_buffer_free_list()
 {
-    assert(this->free_ranges.size() == 1 && this->free_ranges.front().size == this->heap_.size());
+    assert(this->ranges.empty());
 }
 
 void ff::dx12::mem_buffer_free_list::free_range(const ff::dx12::mem_range& range)
 {
     std::scoped_lock lock(this->ranges_mutex);
-
-    range_t range2{ range.allocated_start(), range.allocated_size() };
-    auto i = std::lower_bound(this->free_ranges.begin(), this->free_ranges.end(), range2);
-    assert(i == this->free_ranges.end() || range2.start < i->start);
-
-    if (i != this->free_ranges.begin())
-    {
-        auto prev = std::prev(i);
-        if (prev->after_end() == range2.start)
-        {
-            prev->size += range2.size;
-
-            if (i != this->free_ranges.end() && i->start == prev->after_end())
-            {
-                prev->size += i->size;
-                this->free_ranges.erase(i);
-            }
-
-            return;
-        }
-    }
-
-    if (i != this->free_ranges.end() && i->start == range2.after_end())
-    {
-        i->start -= range2.size;
-        i->size += range2.size;
-        return;
-    }
-
-    this->free_ranges.insert(i, range2);
+    this->ranges.free(range.allocated_start());
 }
 
 void* ff::dx12::mem_buffer_free_list::cpu_data(uint64_t start)
@@ -219,41 +190,35 @@ ff::dx12::heap& ff::dx12::mem_buffer_free_list::heap()
 bool ff::dx12::mem_buffer_free_list::frame_complete()
 {
     std::scoped_lock lock(this->ranges_mutex);
-
-    return this->free_ranges.size() != 1 || this->free_ranges.front().size != this->heap_.size();
+    return !this->ranges.empty();
 }
 
 ff::dx12::mem_range ff::dx12::mem_buffer_free_list::alloc_bytes(uint64_t size, uint64_t align, const ff::dx12::fence_value& fence_value)
 {
-    if (size && size <= this->heap_.size())
+    ff::tlsf_allocator::range_t range{};
     {
         std::scoped_lock lock(this->ranges_mutex);
+        range = this->ranges.alloc(size, align);
+    }
 
-        for (auto i = this->free_ranges.begin(); i != this->free_ranges.end(); i++)
-        {
-            if (i->size >= size)
-            {
-                uint64_t allocated_start = i->start;
-                uint64_t aligned_start = ff::math::align_up(i->start, align);
-                uint64_t allocated_size = size + aligned_start - allocated_start;
-
-                if (i->after_end() - aligned_start >= size)
-                {
-                    i->start += allocated_size;
-                    i->size -= allocated_size;
-
-                    if (!i->size)
-                    {
-                        this->free_ranges.erase(i);
-                    }
+    return range
+        ? ff::dx12::mem_range(*this, range.start, range.size, range.allocated_start, range.allocated_size)
+        : ff::dx12::mem_range();
+}
 
-                    return ff::dx12::mem_range(*this, aligned_start, size, allocated_start, allocated_size);
-                }
-            }
-        }
+void ff::dx12::mem_buffer_free_list::add_stats(ff::dx12::mem_allocator_stats& stats)
+{
+    ff::tlsf_allocator::stats_t ranges_stats{};
+    {
+        std::scoped_lock lock(this->ranges_mutex);
+        ranges_stats = this->ranges.stats();
     }
 
-    return ff::dx12::mem_range();
+    this->ff::dx12::mem_buffer_base::add_stats(stats);
+    stats.free_size += ranges_stats.free_size;
+    stats.largest_free_size = std::max(stats.largest_free_size, ranges_stats.largest_free_size);
+    stats.free_block_count += ranges_stats.free_block_count;
+    stats.allocation_count += ranges_stats.allocation_count;
 }
 
 ff::dx12::mem_allocator_base::mem_allocator_base(uint64_t initial_size, uint64_t max_size, ff::dx12::heap::usage_t usage)
@@ -303,6 +268,19 @@ ff::dx12::mem_range ff::dx12::mem_allocator_base::alloc_bytes(uint64_t size, uin
     return range;
 }
 
+ff::dx12::mem_allocator_stats ff::dx12::mem_allocator_base::stats()
+{
+    ff::dx12::mem_allocator_stats stats{};
+    std::scoped_lock lock(this->buffers_mutex);
+
+    for (auto& buffer : this->buffers)
+    {
+        buffer->add_stats(stats);
+    }
+
+    return stats;
+}
+
 void ff::dx12::mem_allocator_base::frame_complete(size_t frame_count)
 {
     std::scoped_lock lock(this->buffers_mutex);
@@ -6,6 +6,18 @@
 
 namespace ff::dx12
 {
+    struct mem_allocator_stats
+    {
+        double fragmentation() const; // 0 when all free space is in one block, approaches 1 as it gets split up
+
+        size_t heap_count;
+        uint64_t heap_size;
+        uint64_t free_size;
+        uint64_t largest_free_size;
+        size_t free_block_count;
+        size_t allocation_count;
+    };
+
     class mem_buffer_base
     {
     public:
@@ -20,6 +32,7 @@ namespace ff::dx12
         virtual ff::dx12::heap& heap() = 0;
         virtual bool frame_complete() = 0;
         virtual ff::dx12::mem_range alloc_bytes(uint64_t size, uint64_t align, const ff::dx12::fence_value& fence_value) = 0;
+        virtual void add_stats(ff::dx12::mem_allocator_stats& stats);
     };
 
     class mem_buffer_ring : public ff::dx12::mem_buffer_base, private ff::dxgi::device_child_base
@@ -77,20 +90,12 @@ namespace ff::dx12
         virtual ff::dx12::heap& heap() override;
         virtual bool frame_complete() override;
         virtual ff::dx12::mem_range alloc_bytes(uint64_t size, uint64_t align, const ff::dx12::fence_value& fence_value) override;
+        virtual void add_stats(ff::dx12::mem_allocator_stats& stats) override;
 
     private:
-        struct range_t
-        {
-            bool operator<(const range_t& other) const;
-            uint64_t after_end() const;
-
-            uint64_t start;
-            uint64_t size;
-        };
-
         ff::dx12::heap heap_;
         std::mutex ranges_mutex;
-        std::vector<range_t> free_ranges;
+        ff::tlsf_allocator ranges;
     };
 
     class mem_allocator_base
@@ -98,6 +103,8 @@ namespace ff::dx12
     public:
         virtual ~mem_allocator_base() = default;
 
+        ff::dx12::mem_allocator_stats stats();
+
     protected:
         mem_allocator_base(uint64_t initial_size, uint64_t max_size, ff::dx12::heap::usage_t usage);
 
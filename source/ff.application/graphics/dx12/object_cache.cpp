@@ -193,7 +193,7 @@ static std::string cache_file_name(std::string_view category, std::string_view e
 {
     std::filesystem::path exe_path = ff::filesystem::executable_path();
     std::filesystem::path name = exe_path.filename().replace_extension();
-    size_t exe_hash = ff::stable_hash_func(exe_path);
+    size_t exe_hash = ff::stable_hash_func<ff::stable_hash_version::lookup3>(exe_path);
     return ff::string::concat("pso_", !category.empty() ? category : "dx12", "_", ff::filesystem::to_string(name), "_", exe_hash, extension);
 }
 
@@ -217,7 +217,7 @@ ID3D12RootSignature* ff::dx12::object_cache::root_signature(const D3D12_VERSIONE
     Microsoft::WRL::ComPtr<ID3DBlob> data, errors;
     if (SUCCEEDED(::D3D12SerializeVersionedRootSignature(&desc, data.GetAddressOf(), errors.GetAddressOf())) && data && data->GetBufferSize())
     {
-        size_t hash = ff::stable_hash_bytes(data->GetBufferPointer(), data->GetBufferSize());
+        size_t hash = ff::stable_hash_bytes(data->GetBufferPointer(), data->GetBufferSize(), ff::stable_hash_version::lookup3); // part of persisted pipeline hashes
         std::scoped_lock lock(this->mutex);
 
         auto i = this->root_signatures.find(hash);
@@ -46,6 +46,24 @@ static bool floor_float(std::span<const ff::dxgi::pixel_endpoint_t> points, ff::
     return true;
 }
 
+void ff::dxgi::draw_base::draw_sprites(std::span<const ff::dxgi::sprite_data* const> sprites, std::span<const ff::transform> transforms)
+{
+    assert(sprites.size() == transforms.size());
+
+    for (size_t i = 0, count = std::min(sprites.size(), transforms.size()); i < count; i++)
+    {
+        this->draw_sprite(*sprites[i], transforms[i]);
+    }
+}
+
+void ff::dxgi::draw_base::draw_sprites(const ff::dxgi::sprite_data& sprite, std::span<const ff::transform> transforms)
+{
+    for (const ff::transform& transform : transforms)
+    {
+        this->draw_sprite(sprite, transform);
+    }
+}
+
 void ff::dxgi::draw_base::draw_sprite(const ff::dxgi::sprite_data& sprite, const ff::pixel_transform& transform)
 {
     ff::transform new_transform = transform;
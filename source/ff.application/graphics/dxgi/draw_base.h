@@ -46,6 +46,10 @@ namespace ff::dxgi
         virtual void draw_rectangle(const ff::rect_float& rect, const ff::color& color, std::optional<float> thickness = std::nullopt) = 0;
         virtual void draw_circle(const ff::dxgi::endpoint_t& pos, std::optional<float> thickness = std::nullopt, const ff::color* outside_color = nullptr) = 0;
 
+        // Batched sprites, each sprite is drawn with the transform at the same index. Same result as calling draw_sprite() for each one.
+        virtual void draw_sprites(std::span<const ff::dxgi::sprite_data* const> sprites, std::span<const ff::transform> transforms);
+        virtual void draw_sprites(const ff::dxgi::sprite_data& sprite, std::span<const ff::transform> transforms);
+
         // Pixel drawing, converts to core drawing
         void draw_sprite(const ff::dxgi::sprite_data& sprite, const ff::pixel_transform& transform);
         void draw_lines(std::span<const ff::dxgi::pixel_endpoint_t> points);
@@ -75,6 +79,11 @@ namespace ff::dxgi
         virtual void pop_custom_context() = 0;
         virtual void push_sampler_linear_filter(bool linear_filter) = 0;
         virtual void pop_sampler_linear_filter() = 0;
+
+        // Multi-threaded drawing: each recorder can be filled on its own thread, then they get merged in the order they were created.
+        // Recorders are owned by this and are merged by merge_recorders() or end_draw(), they are invalid after that.
+        virtual ff::dxgi::draw_base* create_recorder() = 0;
+        virtual void merge_recorders() = 0;
     };
 
     using draw_ptr = typename std::unique_ptr<ff::dxgi::draw_base, void(*)(ff::dxgi::draw_base*)>;
@@ -13,6 +13,7 @@ namespace ff::dxgi
         none = 0x00,
         pre_multiplied_alpha = 0x01,
         ignore_rotation = 0x02,
+        reorder_transparent = 0x04, // batch transparent instances out of order when they don't overlap
     };
 
     class draw_device_base
@@ -128,15 +128,20 @@ void ffdu::instance_bucket::reset()
     this->data_end = nullptr;
 }
 
+void ffdu::instance_bucket::reserve(size_t count)
+{
+    size_t min_size = this->byte_size() + count * this->item_size_;
+    if (min_size > static_cast<size_t>(this->data_end - this->data_start))
+    {
+        this->grow(min_size);
+    }
+}
+
 void* ffdu::instance_bucket::add()
 {
     if (this->data_cur == this->data_end)
     {
-        size_t cur_size = this->data_end - this->data_start;
-        size_t new_size = std::max<size_t>(cur_size * 2, this->item_size_ * ffdu::MIN_INSTANCE_BUCKET_COUNT);
-        this->data_start = reinterpret_cast<uint8_t*>(_aligned_realloc(this->data_start, new_size, this->item_align));
-        this->data_cur = this->data_start + cur_size;
-        this->data_end = this->data_start + new_size;
+        this->grow(0);
     }
 
     void* result = this->data_cur;
@@ -200,6 +205,134 @@ size_t ffdu::instance_bucket::render_count() const
     return this->render_count_;
 }
 
+void ffdu::instance_bucket::grow(size_t min_byte_size)
+{
+    size_t cur_size = this->byte_size();
+    size_t new_size = std::max({ static_cast<size_t>(this->data_end - this->data_start) * 2, this->item_size_ * ffdu::MIN_INSTANCE_BUCKET_COUNT, min_byte_size });
+    this->data_start = reinterpret_cast<uint8_t*>(_aligned_realloc(this->data_start, new_size, this->item_align));
+    this->data_cur = this->data_start + cur_size;
+    this->data_end = this->data_start + new_size;
+}
+
+static bool bounds_overlap(const ff::rect_float& lhs, const ff::rect_float& rhs)
+{
+    return lhs.left < rhs.right && rhs.left < lhs.right && lhs.top < rhs.bottom && rhs.top < lhs.bottom;
+}
+
+size_t ffdu::transparent_batcher::batch(std::span<const ffdu::transparent_instance_entry> entries, std::span<const ff::rect_float> bounds)
+{
+    assert_ret_val(entries.size() == bounds.size() && entries.size() < ff::constants::invalid_unsigned<uint32_t>(), 0);
+
+    const size_t count = entries.size();
+    this->batch_of.resize(count);
+    this->order_.resize(count);
+    this->batches_.clear();
+    this->checked.assign(count, 0);
+
+    for (std::vector<uint32_t>& bucket_batches : this->bucket_batches)
+    {
+        bucket_batches.clear();
+    }
+
+    check_ret_val(count, 0);
+
+    // Bin the bounds into a grid that has about one instance per cell
+    ff::rect_float total_bounds = bounds[0];
+    for (const ff::rect_float& rect : bounds)
+    {
+        total_bounds = total_bounds.boundary(rect);
+    }
+
+    const int grid_size = std::clamp(static_cast<int>(std::sqrt(static_cast<double>(count))), 1, 64);
+    const float cell_scale_x = (total_bounds.width() > 0) ? grid_size / total_bounds.width() : 0.0f;
+    const float cell_scale_y = (total_bounds.height() > 0) ? grid_size / total_bounds.height() : 0.0f;
+    auto cell_x = [&total_bounds, cell_scale_x, grid_size](float x) { return std::clamp(static_cast<int>((x - total_bounds.left) * cell_scale_x), 0, grid_size - 1); };
+    auto cell_y = [&total_bounds, cell_scale_y, grid_size](float y) { return std::clamp(static_cast<int>((y - total_bounds.top) * cell_scale_y), 0, grid_size - 1); };
+
+    this->cells.resize(static_cast<size_t>(grid_size * grid_size));
+    for (std::vector<uint32_t>& cell : this->cells)
+    {
+        cell.clear();
+    }
+
+    for (uint32_t i = 0; i < static_cast<uint32_t>(count); i++)
+    {
+        const ff::rect_float& rect = bounds[i];
+        const ffdu::instance_bucket* bucket = entries[i].bucket;
+        const int left = cell_x(rect.left), top = cell_y(rect.top), right = cell_x(rect.right), bottom = cell_y(rect.bottom);
+        uint32_t min_batch = 0;
+
+        // Must be drawn after every overlapping instance from another bucket, or with overlapping instances from the same bucket
+        for (int y = top; y <= bottom; y++)
+        {
+            for (int x = left; x <= right; x++)
+            {
+                for (uint32_t j : this->cells[static_cast<size_t>(y * grid_size + x)])
+                {
+                    if (this->checked[j] != i + 1)
+                    {
+                        this->checked[j] = i + 1;
+
+                        if (::bounds_overlap(rect, bounds[j]))
+                        {
+                            min_batch = std::max(min_batch, this->batch_of[j] + (entries[j].bucket != bucket ? 1 : 0));
+                        }
+                    }
+                }
+            }
+        }
+
+        // Join the earliest batch from the same bucket that is allowed
+        std::vector<uint32_t>& bucket_batches = this->bucket_batches[static_cast<size_t>(bucket->bucket_type())];
+        auto iter = std::lower_bound(bucket_batches.begin(), bucket_batches.end(), min_batch);
+        if (iter != bucket_batches.end())
+        {
+            this->batch_of[i] = *iter;
+            this->batches_[*iter].count++;
+        }
+        else
+        {
+            this->batch_of[i] = static_cast<uint32_t>(this->batches_.size());
+            bucket_batches.push_back(this->batch_of[i]);
+            this->batches_.push_back(ffdu::transparent_batch{ bucket, 0, 1 });
+        }
+
+        for (int y = top; y <= bottom; y++)
+        {
+            for (int x = left; x <= right; x++)
+            {
+                this->cells[static_cast<size_t>(y * grid_size + x)].push_back(i);
+            }
+        }
+    }
+
+    // Sort by batch, keeping submission order within each batch
+    for (size_t i = 0, start = 0; i < this->batches_.size(); i++)
+    {
+        this->batches_[i].start = start;
+        start += this->batches_[i].count;
+        this->batches_[i].count = 0;
+    }
+
+    for (uint32_t i = 0; i < static_cast<uint32_t>(count); i++)
+    {
+        ffdu::transparent_batch& batch = this->batches_[this->batch_of[i]];
+        this->order_[batch.start + batch.count++] = i;
+    }
+
+    return this->batches_.size();
+}
+
+std::span<const uint32_t> ffdu::transparent_batcher::order() const
+{
+    return this->order_;
+}
+
+std::span<const ffdu::transparent_batch> ffdu::transparent_batcher::batches() const
+{
+    return this->batches_;
+}
+
 static const DirectX::XMMATRIX& get_rotate_matrix(int dmod, bool ignore_rotate)
 {
     static const DirectX::XMFLOAT4X4A rotate_0(
@@ -273,9 +406,9 @@ static bool setup_view_matrix(ff::dxgi::target_base& target, const ff::rect_floa
     return true;
 }
 
-ffdu::draw_device_base::draw_device_base()
-    : world_matrix_stack_changing_connection(this->world_matrix_stack_.matrix_changing().connect(std::bind(&draw_device_base::matrix_changing, this, std::placeholders::_1)))
-    , instance_buckets
+static std::array<ffdu::instance_bucket, static_cast<size_t>(ffdu::instance_bucket_type::count)> create_instance_buckets()
+{
+    return
     {
         ffdu::instance_bucket::create<ffdu::sprite_instance, ffdu::instance_bucket_type::sprites>(),
         ffdu::instance_bucket::create<ffdu::sprite_instance, ffdu::instance_bucket_type::palette_sprites>(),
@@ -294,226 +427,483 @@ ffdu::draw_device_base::draw_device_base()
         ffdu::instance_bucket::create<ffdu::rectangle_instance, ffdu::instance_bucket_type::rectangles_outline_out_transparent>(),
         ffdu::instance_bucket::create<ffdu::circle_instance, ffdu::instance_bucket_type::circles_filled_out_transparent>(),
         ffdu::instance_bucket::create<ffdu::circle_instance, ffdu::instance_bucket_type::circles_outline_out_transparent>(),
-    }
-{
+    };
 }
 
-ffdu::draw_device_base::~draw_device_base()
+static bool is_sprite_bucket(ffdu::instance_bucket_type bucket_type)
 {
-    assert(this->state != draw_device_base::state_t::drawing);
+    switch (bucket_type)
+    {
+        case ffdu::instance_bucket_type::sprites:
+        case ffdu::instance_bucket_type::sprites_out_transparent:
+        case ffdu::instance_bucket_type::palette_sprites:
+        case ffdu::instance_bucket_type::palette_sprites_out_transparent:
+            return true;
+
+        default:
+            return false;
+    }
 }
 
-void ffdu::draw_device_base::end_draw()
+// Returns the depth and the index that refers to a recorder's tables: texture entry for sprites, world matrix for everything else
+static std::pair<float, uint32_t> get_instance_depth_and_index(ffdu::instance_bucket_type bucket_type, const uint8_t* data)
 {
-    check_ret(this->state == state_t::drawing);
+    switch (bucket_type)
+    {
+        case ffdu::instance_bucket_type::sprites:
+        case ffdu::instance_bucket_type::sprites_out_transparent:
+        case ffdu::instance_bucket_type::palette_sprites:
+        case ffdu::instance_bucket_type::palette_sprites_out_transparent:
+            {
+                const ffdu::sprite_instance& instance = *reinterpret_cast<const ffdu::sprite_instance*>(data);
+                return { instance.pos_rot.z, instance.indexes };
+            }
 
-    this->flush(true);
+        case ffdu::instance_bucket_type::lines:
+        case ffdu::instance_bucket_type::lines_out_transparent:
+            {
+                const ffdu::line_instance& instance = *reinterpret_cast<const ffdu::line_instance*>(data);
+                return { instance.depth, instance.matrix_index };
+            }
 
-    this->state = draw_device_base::state_t::valid;
-    this->command_context_ = nullptr;
-    this->palette_stack.resize(1);
-    this->palette_remap_stack.resize(1);
-    this->sampler_stack.resize(1);
-    this->custom_context_stack.resize(1);
-    this->world_matrix_stack_.reset();
-    this->draw_depth = 0;
-    this->force_no_overlap = 0;
-    this->force_opaque = 0;
-    this->force_pre_multiplied_alpha = 0;
+        case ffdu::instance_bucket_type::triangles:
+        case ffdu::instance_bucket_type::triangles_out_transparent:
+            {
+                const ffdu::triangle_instance& instance = *reinterpret_cast<const ffdu::triangle_instance*>(data);
+                return { instance.depth, instance.matrix_index };
+            }
+
+        case ffdu::instance_bucket_type::rectangles_filled:
+        case ffdu::instance_bucket_type::rectangles_filled_out_transparent:
+        case ffdu::instance_bucket_type::rectangles_outline:
+        case ffdu::instance_bucket_type::rectangles_outline_out_transparent:
+            {
+                const ffdu::rectangle_instance& instance = *reinterpret_cast<const ffdu::rectangle_instance*>(data);
+                return { instance.depth, instance.matrix_index };
+            }
+
+        case ffdu::instance_bucket_type::circles_filled:
+        case ffdu::instance_bucket_type::circles_filled_out_transparent:
+        case ffdu::instance_bucket_type::circles_outline:
+        case ffdu::instance_bucket_type::circles_outline_out_transparent:
+            {
+                const ffdu::circle_instance& instance = *reinterpret_cast<const ffdu::circle_instance*>(data);
+                return { instance.position_radius.z, instance.matrix_index };
+            }
+
+        default:
+            debug_fail_ret_val(std::make_pair(0.0f, 0u));
+    }
 }
 
-void ffdu::draw_device_base::draw_sprite(const ff::dxgi::sprite_data& sprite, const ff::transform& transform)
+static void set_instance_depth_and_index(ffdu::instance_bucket_type bucket_type, uint8_t* data, float depth, uint32_t index)
 {
-    ::alpha_type alpha_type = ::get_alpha_type(sprite, transform.color.alpha(), this->allow_transparent());
-    check_ret(alpha_type != ::alpha_type::invisible && sprite.view());
+    switch (bucket_type)
+    {
+        case ffdu::instance_bucket_type::sprites:
+        case ffdu::instance_bucket_type::sprites_out_transparent:
+        case ffdu::instance_bucket_type::palette_sprites:
+        case ffdu::instance_bucket_type::palette_sprites_out_transparent:
+            {
+                ffdu::sprite_instance& instance = *reinterpret_cast<ffdu::sprite_instance*>(data);
+                instance.pos_rot.z = depth;
+                instance.indexes = index;
+            }
+            break;
 
-    bool is_palette_sprite = ff::flags::has(sprite.type(), ff::dxgi::sprite_type::palette);
-    uint32_t indexes = this->get_world_matrix_and_texture_index(*sprite.view(), is_palette_sprite);
+        case ffdu::instance_bucket_type::lines:
+        case ffdu::instance_bucket_type::lines_out_transparent:
+            {
+                ffdu::line_instance& instance = *reinterpret_cast<ffdu::line_instance*>(data);
+                instance.depth = depth;
+                instance.matrix_index = index;
+            }
+            break;
+
+        case ffdu::instance_bucket_type::triangles:
+        case ffdu::instance_bucket_type::triangles_out_transparent:
+            {
+                ffdu::triangle_instance& instance = *reinterpret_cast<ffdu::triangle_instance*>(data);
+                instance.depth = depth;
+                instance.matrix_index = index;
+            }
+            break;
 
-    ffdu::instance_bucket_type bucket_type = (alpha_type == ::alpha_type::transparent)
-        ? (is_palette_sprite ? ffdu::instance_bucket_type::palette_sprites_out_transparent : ffdu::instance_bucket_type::sprites_out_transparent)
-        : (is_palette_sprite ? ffdu::instance_bucket_type::palette_sprites : ffdu::instance_bucket_type::sprites);
+        case ffdu::instance_bucket_type::rectangles_filled:
+        case ffdu::instance_bucket_type::rectangles_filled_out_transparent:
+        case ffdu::instance_bucket_type::rectangles_outline:
+        case ffdu::instance_bucket_type::rectangles_outline_out_transparent:
+            {
+                ffdu::rectangle_instance& instance = *reinterpret_cast<ffdu::rectangle_instance*>(data);
+                instance.depth = depth;
+                instance.matrix_index = index;
+            }
+            break;
 
-    float depth = this->nudge_depth();
-    ffdu::sprite_instance& instance = this->add_instance<ffdu::sprite_instance>(bucket_type, depth);
+        case ffdu::instance_bucket_type::circles_filled:
+        case ffdu::instance_bucket_type::circles_filled_out_transparent:
+        case ffdu::instance_bucket_type::circles_outline:
+        case ffdu::instance_bucket_type::circles_outline_out_transparent:
+            {
+                ffdu::circle_instance& instance = *reinterpret_cast<ffdu::circle_instance*>(data);
+                instance.position_radius.z = depth;
+                instance.matrix_index = index;
+            }
+            break;
 
-    DirectX::XMStoreFloat4(&instance.rect, DirectX::XMVectorMultiply(
-        DirectX::XMLoadFloat4(&ff::dxgi::cast_rect(sprite.world())),
-        DirectX::XMVectorSet(transform.scale.x, transform.scale.y, transform.scale.x, transform.scale.y)));
-    instance.uv_rect = ff::dxgi::cast_rect(sprite.texture_uv());
-    instance.color = transform.color.to_shader_color(this->palette_remap());;
-    instance.pos_rot.x = transform.position.x;
-    instance.pos_rot.y = transform.position.y;
-    instance.pos_rot.z = depth;
-    instance.pos_rot.w = transform.rotation_radians();
-    instance.indexes = indexes;
+        default:
+            debug_fail();
+            break;
+    }
 }
 
-void ffdu::draw_device_base::draw_lines(std::span<const ff::dxgi::endpoint_t> points)
+// Grows geometrically, so reserving for each batch doesn't reallocate every time
+template<class T>
+static void reserve_more(std::vector<T>& vec, size_t count)
 {
-    size_t count = points.size();
-    check_ret(count > 1);
-
-    bool closed = count > 2 && points.front().pos == points.back().pos;
-    const uint32_t matrix_index = this->get_world_matrix_index();
-    const float depth = this->nudge_depth();
-    const ff::color* default_color = points.front().color ? points.front().color : &ff::color_none();
+    if (vec.capacity() - vec.size() < count)
+    {
+        vec.reserve(std::max(vec.size() + count, vec.capacity() * 2));
+    }
+}
 
-    for (size_t i = 0; i < count - 1; i++)
+// Builds instances for draw_device_base and draw_recorder, which each provide their own index tables and depth
+template<class Owner>
+class ffdu::instance_builder
+{
+public:
+    static void draw_sprite(Owner& owner, const ff::dxgi::sprite_data& sprite, const ff::transform& transform)
     {
-        const ff::dxgi::endpoint_t& p0 = points[i];
-        const ff::dxgi::endpoint_t& p1 = points[i + 1];
-        const ff::color* color0 = p0.color ? p0.color : default_color;
-        const ff::color* color1 = p1.color ? p1.color : default_color;
+        ::alpha_type alpha_type = ::get_alpha_type(sprite, transform.color.alpha(), owner.allow_transparent());
+        check_ret(alpha_type != ::alpha_type::invisible && sprite.view());
+
+        bool is_palette_sprite = ff::flags::has(sprite.type(), ff::dxgi::sprite_type::palette);
+        uint32_t indexes = owner.get_world_matrix_and_texture_index(*sprite.view(), is_palette_sprite);
+
+        ffdu::instance_bucket_type bucket_type = (alpha_type == ::alpha_type::transparent)
+            ? (is_palette_sprite ? ffdu::instance_bucket_type::palette_sprites_out_transparent : ffdu::instance_bucket_type::sprites_out_transparent)
+            : (is_palette_sprite ? ffdu::instance_bucket_type::palette_sprites : ffdu::instance_bucket_type::sprites);
+
+        float depth = owner.nudge_depth();
+        ffdu::sprite_instance& instance = owner.template add_instance<ffdu::sprite_instance>(bucket_type, depth);
+
+        DirectX::XMStoreFloat4(&instance.rect, DirectX::XMVectorMultiply(
+            DirectX::XMLoadFloat4(&ff::dxgi::cast_rect(sprite.world())),
+            DirectX::XMVectorSet(transform.scale.x, transform.scale.y, transform.scale.x, transform.scale.y)));
+        instance.uv_rect = ff::dxgi::cast_rect(sprite.texture_uv());
+        instance.color = transform.color.to_shader_color(owner.palette_remap());;
+        instance.pos_rot.x = transform.position.x;
+        instance.pos_rot.y = transform.position.y;
+        instance.pos_rot.z = depth;
+        instance.pos_rot.w = transform.rotation_radians();
+        instance.indexes = indexes;
+    }
 
-        if (p0.pos == p1.pos || (!p0.size && !p1.size))
+    template<class GetSprite>
+    static void draw_sprites(Owner& owner, size_t count, GetSprite&& get_sprite, std::span<const ff::transform> transforms)
+    {
+        // Consecutive sprites with the same texture and type share their state and bucket choice
+        for (size_t start = 0; start < count; )
         {
-            continue;
+            const ff::dxgi::sprite_data& sprite = get_sprite(start);
+            size_t end = start + 1;
+
+            while (end < count && get_sprite(end).view() == sprite.view() && get_sprite(end).type() == sprite.type())
+            {
+                end++;
+            }
+
+            if (sprite.view())
+            {
+                instance_builder::draw_sprite_run(owner, *sprite.view(), sprite.type(), start, end, get_sprite, transforms);
+            }
+
+            start = end;
         }
+    }
 
-        ::alpha_type alpha_type = ::get_alpha_type(color0->alpha(), this->allow_transparent());
-        alpha_type = ::get_alpha_type(color1->alpha(), this->allow_transparent(), alpha_type);
-        if (alpha_type == ::alpha_type::invisible)
+    static void draw_lines(Owner& owner, std::span<const ff::dxgi::endpoint_t> points)
+    {
+        size_t count = points.size();
+        check_ret(count > 1);
+
+        bool closed = count > 2 && points.front().pos == points.back().pos;
+        const uint32_t matrix_index = owner.get_world_matrix_index();
+        const float depth = owner.nudge_depth();
+        const ff::color* default_color = points.front().color ? points.front().color : &ff::color_none();
+
+        for (size_t i = 0; i < count - 1; i++)
         {
-            continue;
-        }
+            const ff::dxgi::endpoint_t& p0 = points[i];
+            const ff::dxgi::endpoint_t& p1 = points[i + 1];
+            const ff::color* color0 = p0.color ? p0.color : default_color;
+            const ff::color* color1 = p1.color ? p1.color : default_color;
 
-        ffdu::instance_bucket_type type = (alpha_type == ::alpha_type::transparent)
-            ? ffdu::instance_bucket_type::lines_out_transparent
-            : ffdu::instance_bucket_type::lines;
-
-        ffdu::line_instance& instance = this->add_instance<ffdu::line_instance>(type, depth);
-        instance.start = ff::dxgi::cast_point(p0.pos);
-        instance.end = ff::dxgi::cast_point(p1.pos);
-        instance.before_start = ff::dxgi::cast_point((i == 0) ? (closed ? points[count - 2].pos : p0.pos) : points[i - 1].pos);
-        instance.after_end = ff::dxgi::cast_point((i == count - 2) ? (closed ? points[1].pos : p1.pos) : points[i + 2].pos);
-        instance.start_color = color0->to_shader_color(this->palette_remap());
-        instance.end_color = color1->to_shader_color(this->palette_remap());
-        instance.start_thickness = std::abs(p0.size);
-        instance.end_thickness = std::abs(p1.size);
-        instance.depth = depth;
-        instance.matrix_index = matrix_index;
-    }
-}
+            if (p0.pos == p1.pos || (!p0.size && !p1.size))
+            {
+                continue;
+            }
 
-void ffdu::draw_device_base::draw_triangles(std::span<const ff::dxgi::endpoint_t> points)
-{
-    assert(points.size() % 3 == 0);
+            ::alpha_type alpha_type = ::get_alpha_type(color0->alpha(), owner.allow_transparent());
+            alpha_type = ::get_alpha_type(color1->alpha(), owner.allow_transparent(), alpha_type);
+            if (alpha_type == ::alpha_type::invisible)
+            {
+                continue;
+            }
 
-    const uint32_t matrix_index = this->get_world_matrix_index();
-    const float depth = this->nudge_depth();
+            ffdu::instance_bucket_type type = (alpha_type == ::alpha_type::transparent)
+                ? ffdu::instance_bucket_type::lines_out_transparent
+                : ffdu::instance_bucket_type::lines;
+
+            ffdu::line_instance& instance = owner.template add_instance<ffdu::line_instance>(type, depth);
+            instance.start = ff::dxgi::cast_point(p0.pos);
+            instance.end = ff::dxgi::cast_point(p1.pos);
+            instance.before_start = ff::dxgi::cast_point((i == 0) ? (closed ? points[count - 2].pos : p0.pos) : points[i - 1].pos);
+            instance.after_end = ff::dxgi::cast_point((i == count - 2) ? (closed ? points[1].pos : p1.pos) : points[i + 2].pos);
+            instance.start_color = color0->to_shader_color(owner.palette_remap());
+            instance.end_color = color1->to_shader_color(owner.palette_remap());
+            instance.start_thickness = std::abs(p0.size);
+            instance.end_thickness = std::abs(p1.size);
+            instance.depth = depth;
+            instance.matrix_index = matrix_index;
+        }
+    }
 
-    for (size_t i = 0; i + 2 < points.size(); i += 3)
+    static void draw_triangles(Owner& owner, std::span<const ff::dxgi::endpoint_t> points)
     {
-        const ff::color* color0 = points[i].color ? points[i].color : &ff::color_none();
-        const ff::color* color1 = points[i + 1].color ? points[i + 1].color : color0;
-        const ff::color* color2 = points[i + 2].color ? points[i + 2].color : color1;
+        assert(points.size() % 3 == 0);
+
+        const uint32_t matrix_index = owner.get_world_matrix_index();
+        const float depth = owner.nudge_depth();
+
+        for (size_t i = 0; i + 2 < points.size(); i += 3)
+        {
+            const ff::color* color0 = points[i].color ? points[i].color : &ff::color_none();
+            const ff::color* color1 = points[i + 1].color ? points[i + 1].color : color0;
+            const ff::color* color2 = points[i + 2].color ? points[i + 2].color : color1;
+
+            ::alpha_type alpha_type = ::get_alpha_type(color0->alpha(), owner.allow_transparent());
+            alpha_type = ::get_alpha_type(color1->alpha(), owner.allow_transparent(), alpha_type);
+            alpha_type = ::get_alpha_type(color2->alpha(), owner.allow_transparent(), alpha_type);
+            check_ret(alpha_type != ::alpha_type::invisible);
+
+            ffdu::instance_bucket_type type = (alpha_type == ::alpha_type::transparent)
+                ? ffdu::instance_bucket_type::triangles_out_transparent
+                : ffdu::instance_bucket_type::triangles;
+
+            ffdu::triangle_instance& instance = owner.template add_instance<ffdu::triangle_instance>(type, depth);
+            instance.position[0] = ff::dxgi::cast_point(points[i].pos);
+            instance.position[1] = ff::dxgi::cast_point(points[i + 1].pos);
+            instance.position[2] = ff::dxgi::cast_point(points[i + 2].pos);
+            instance.color[0] = color0->to_shader_color(owner.palette_remap());
+            instance.color[1] = color1->to_shader_color(owner.palette_remap());
+            instance.color[2] = color2->to_shader_color(owner.palette_remap());
+            instance.depth = depth;
+            instance.matrix_index = matrix_index;
+        }
+    }
 
-        ::alpha_type alpha_type = ::get_alpha_type(color0->alpha(), this->allow_transparent());
-        alpha_type = ::get_alpha_type(color1->alpha(), this->allow_transparent(), alpha_type);
-        alpha_type = ::get_alpha_type(color2->alpha(), this->allow_transparent(), alpha_type);
+    static void draw_rectangle(Owner& owner, const ff::rect_float& rect, const ff::color& color, std::optional<float> thickness)
+    {
+        ::alpha_type alpha_type = ::get_alpha_type(color.alpha(), owner.allow_transparent());
         check_ret(alpha_type != ::alpha_type::invisible);
 
+        ff::rect_float rect2 = rect.normalize();
+        check_ret(rect2.area());
+
+        float thickness2 = 0;
+        if (thickness.has_value())
+        {
+            thickness2 = thickness.value();
+            check_ret(thickness2);
+
+            if (thickness2 < 0)
+            {
+                rect2 = rect2.deflate(thickness2, thickness2);
+                thickness2 = -thickness2;
+            }
+
+            if (thickness2 * 2 >= rect2.width() || thickness2 * 2 >= rect2.height())
+            {
+                thickness2 = 0;
+            }
+        }
+
         ffdu::instance_bucket_type type = (alpha_type == ::alpha_type::transparent)
-            ? ffdu::instance_bucket_type::triangles_out_transparent
-            : ffdu::instance_bucket_type::triangles;
-
-        ffdu::triangle_instance& instance = this->add_instance<ffdu::triangle_instance>(type, depth);
-        instance.position[0] = ff::dxgi::cast_point(points[i].pos);
-        instance.position[1] = ff::dxgi::cast_point(points[i + 1].pos);
-        instance.position[2] = ff::dxgi::cast_point(points[i + 2].pos);
-        instance.color[0] = color0->to_shader_color(this->palette_remap());
-        instance.color[1] = color1->to_shader_color(this->palette_remap());
-        instance.color[2] = color2->to_shader_color(this->palette_remap());
+            ? (thickness2 ? ffdu::instance_bucket_type::rectangles_outline_out_transparent : ffdu::instance_bucket_type::rectangles_filled_out_transparent)
+            : (thickness2 ? ffdu::instance_bucket_type::rectangles_outline : ffdu::instance_bucket_type::rectangles_filled);
+        uint32_t matrix_index = owner.get_world_matrix_index();
+        float depth = owner.nudge_depth();
+
+        ffdu::rectangle_instance& instance = owner.template add_instance<ffdu::rectangle_instance>(type, depth);
+        instance.rect = ff::dxgi::cast_rect(rect2);
+        instance.color = color.to_shader_color(owner.palette_remap());
         instance.depth = depth;
+        instance.thickness = thickness2;
         instance.matrix_index = matrix_index;
     }
-}
-
-void ffdu::draw_device_base::draw_rectangle(const ff::rect_float& rect, const ff::color& color, std::optional<float> thickness)
-{
-    ::alpha_type alpha_type = ::get_alpha_type(color.alpha(), this->allow_transparent());
-    check_ret(alpha_type != ::alpha_type::invisible);
-
-    ff::rect_float rect2 = rect.normalize();
-    check_ret(rect2.area());
 
-    float thickness2 = 0;
-    if (thickness.has_value())
+    static void draw_circle(Owner& owner, const ff::dxgi::endpoint_t& pos, std::optional<float> thickness, const ff::color* outside_color)
     {
-        thickness2 = thickness.value();
-        check_ret(thickness2);
+        float radius = std::abs(pos.size);
+        check_ret(radius && (pos.color || outside_color));
+
+        const ff::color& inside_color2 = pos.color ? *pos.color : *outside_color;
+        const ff::color& outside_color2 = outside_color ? *outside_color : inside_color2;
+        ::alpha_type alpha_type = ::get_alpha_type(inside_color2.alpha(), owner.allow_transparent());
+        alpha_type = ::get_alpha_type(outside_color2.alpha(), owner.allow_transparent(), alpha_type);
+        check_ret(alpha_type != ::alpha_type::invisible);
 
-        if (thickness2 < 0)
+        float thickness2 = 0;
+        if (thickness.has_value())
         {
-            rect2 = rect2.deflate(thickness2, thickness2);
-            thickness2 = -thickness2;
+            thickness2 = thickness.value();
+            check_ret(thickness2);
+
+            if (thickness2 < 0)
+            {
+                radius += thickness2;
+                thickness2 = -thickness2;
+            }
+
+            if (thickness2 >= radius)
+            {
+                thickness2 = 0;
+            }
         }
 
-        if (thickness2 * 2 >= rect2.width() || thickness2 * 2 >= rect2.height())
+        ffdu::instance_bucket_type type = (alpha_type == ::alpha_type::transparent)
+            ? (thickness2 ? ffdu::instance_bucket_type::circles_outline_out_transparent : ffdu::instance_bucket_type::circles_filled_out_transparent)
+            : (thickness2 ? ffdu::instance_bucket_type::circles_outline : ffdu::instance_bucket_type::circles_filled);
+        uint32_t matrix_index = owner.get_world_matrix_index();
+        float depth = owner.nudge_depth();
+
+        ffdu::circle_instance& instance = owner.template add_instance<ffdu::circle_instance>(type, depth);
+        instance.position_radius.x = pos.pos.x;
+        instance.position_radius.y = pos.pos.y;
+        instance.position_radius.z = depth;
+        instance.position_radius.w = radius;
+        instance.inside_color = inside_color2.to_shader_color(owner.palette_remap());
+        instance.outside_color = outside_color2.to_shader_color(owner.palette_remap());
+        instance.thickness = thickness2;
+        instance.matrix_index = matrix_index;
+    }
+
+private:
+    template<class GetSprite>
+    static void draw_sprite_run(Owner& owner, ff::dxgi::texture_view_base& view, ff::dxgi::sprite_type type,
+        size_t start, size_t end, GetSprite& get_sprite, std::span<const ff::transform> transforms)
+    {
+        // Same choices as get_alpha_type(sprite, alpha, allow_transparent), only zero alpha depends on each sprite
+        const bool allow_transparent = owner.allow_transparent();
+        const bool is_palette_sprite = ff::flags::has(type, ff::dxgi::sprite_type::palette);
+        const ffdu::instance_bucket_type opaque_bucket_type = is_palette_sprite ? ffdu::instance_bucket_type::palette_sprites : ffdu::instance_bucket_type::sprites;
+        const ffdu::instance_bucket_type transparent_bucket_type = is_palette_sprite ? ffdu::instance_bucket_type::palette_sprites_out_transparent : ffdu::instance_bucket_type::sprites_out_transparent;
+        const ffdu::instance_bucket_type full_alpha_bucket_type = (allow_transparent && ff::flags::has(type, ff::dxgi::sprite_type::transparent)) ? transparent_bucket_type : opaque_bucket_type;
+        const ffdu::instance_bucket_type partial_alpha_bucket_type = (allow_transparent && !is_palette_sprite) ? transparent_bucket_type : opaque_bucket_type;
+        const uint8_t* palette_remap = owner.palette_remap(); // same call as draw_sprite(), palette sprite shaders apply the remap
+        uint32_t indexes = ::INVALID_INDEX;
+
+        for (size_t i = start; i < end; i++)
         {
-            thickness2 = 0;
+            const ff::transform& transform = transforms[i];
+            const float alpha = transform.color.alpha();
+            if (alpha == 0)
+            {
+                continue;
+            }
+
+            const ffdu::instance_bucket_type bucket_type = (alpha == 1) ? full_alpha_bucket_type : partial_alpha_bucket_type;
+            if (indexes == ::INVALID_INDEX)
+            {
+                // Resolved at the first visible sprite like draw_sprite(), and a flush can only happen before this run adds instances
+                indexes = owner.get_world_matrix_and_texture_index(view, is_palette_sprite);
+                owner.reserve_instances(bucket_type, end - i);
+            }
+
+            const ff::dxgi::sprite_data& sprite = get_sprite(i);
+            const float depth = owner.nudge_depth();
+            ffdu::sprite_instance& instance = owner.template add_instance<ffdu::sprite_instance>(bucket_type, depth);
+
+            const DirectX::XMVECTOR scale = DirectX::XMLoadFloat2(&ff::dxgi::cast_point(transform.scale));
+            DirectX::XMStoreFloat4(&instance.rect, DirectX::XMVectorMultiply(
+                DirectX::XMLoadFloat4(&ff::dxgi::cast_rect(sprite.world())),
+                DirectX::XMVectorSwizzle<0, 1, 0, 1>(scale)));
+            DirectX::XMStoreFloat4(&instance.uv_rect, DirectX::XMLoadFloat4(&ff::dxgi::cast_rect(sprite.texture_uv())));
+            DirectX::XMStoreFloat4(&instance.pos_rot, DirectX::XMVectorSet(transform.position.x, transform.position.y, depth, transform.rotation_radians()));
+            instance.color = transform.color.to_shader_color(palette_remap);
+            instance.indexes = indexes;
         }
     }
+};
+
+ffdu::draw_device_base::draw_device_base()
+    : world_matrix_stack_changing_connection(this->world_matrix_stack_.matrix_changing().connect(std::bind(&draw_device_base::matrix_changing, this, std::placeholders::_1)))
+    , instance_buckets(::create_instance_buckets())
+{
+}
+
+ffdu::draw_device_base::~draw_device_base()
+{
+    assert(this->state != draw_device_base::state_t::drawing);
+}
+
+void ffdu::draw_device_base::end_draw()
+{
+    check_ret(this->state == state_t::drawing);
 
-    ffdu::instance_bucket_type type = (alpha_type == ::alpha_type::transparent)
-        ? (thickness2 ? ffdu::instance_bucket_type::rectangles_outline_out_transparent : ffdu::instance_bucket_type::rectangles_filled_out_transparent)
-        : (thickness2 ? ffdu::instance_bucket_type::rectangles_outline : ffdu::instance_bucket_type::rectangles_filled);
-    uint32_t matrix_index = this->get_world_matrix_index();
-    float depth = this->nudge_depth();
+    this->merge_recorders();
+    this->flush(true);
 
-    ffdu::rectangle_instance& instance = this->add_instance<ffdu::rectangle_instance>(type, depth);
-    instance.rect = ff::dxgi::cast_rect(rect2);
-    instance.color = color.to_shader_color(this->palette_remap());
-    instance.depth = depth;
-    instance.thickness = thickness2;
-    instance.matrix_index = matrix_index;
+    this->state = draw_device_base::state_t::valid;
+    this->command_context_ = nullptr;
+    this->palette_stack.resize(1);
+    this->palette_remap_stack.resize(1);
+    this->sampler_stack.resize(1);
+    this->custom_context_stack.resize(1);
+    this->world_matrix_stack_.reset();
+    this->draw_depth = 0;
+    this->force_no_overlap = 0;
+    this->force_opaque = 0;
+    this->force_pre_multiplied_alpha = 0;
 }
 
-void ffdu::draw_device_base::draw_circle(const ff::dxgi::endpoint_t& pos, std::optional<float> thickness, const ff::color* outside_color)
+void ffdu::draw_device_base::draw_sprite(const ff::dxgi::sprite_data& sprite, const ff::transform& transform)
 {
-    float radius = std::abs(pos.size);
-    check_ret(radius && (pos.color || outside_color));
+    ffdu::instance_builder<ffdu::draw_device_base>::draw_sprite(*this, sprite, transform);
+}
 
-    const ff::color& inside_color2 = pos.color ? *pos.color : *outside_color;
-    const ff::color& outside_color2 = outside_color ? *outside_color : inside_color2;
-    ::alpha_type alpha_type = ::get_alpha_type(inside_color2.alpha(), this->allow_transparent());
-    alpha_type = ::get_alpha_type(outside_color2.alpha(), this->allow_transparent(), alpha_type);
-    check_ret(alpha_type != ::alpha_type::invisible);
+void ffdu::draw_device_base::draw_sprites(std::span<const ff::dxgi::sprite_data* const> sprites, std::span<const ff::transform> transforms)
+{
+    assert(sprites.size() == transforms.size());
+    ffdu::instance_builder<ffdu::draw_device_base>::draw_sprites(*this, std::min(sprites.size(), transforms.size()),
+        [sprites](size_t i) -> const ff::dxgi::sprite_data& { return *sprites[i]; }, transforms);
+}
 
-    float thickness2 = 0;
-    if (thickness.has_value())
-    {
-        thickness2 = thickness.value();
-        check_ret(thickness2);
+void ffdu::draw_device_base::draw_sprites(const ff::dxgi::sprite_data& sprite, std::span<const ff::transform> transforms)
+{
+    ffdu::instance_builder<ffdu::draw_device_base>::draw_sprites(*this, transforms.size(),
+        [&sprite](size_t) -> const ff::dxgi::sprite_data& { return sprite; }, transforms);
+}
 
-        if (thickness2 < 0)
-        {
-            radius += thickness2;
-            thickness2 = -thickness2;
-        }
+void ffdu::draw_device_base::draw_lines(std::span<const ff::dxgi::endpoint_t> points)
+{
+    ffdu::instance_builder<ffdu::draw_device_base>::draw_lines(*this, points);
+}
 
-        if (thickness2 >= radius)
-        {
-            thickness2 = 0;
-        }
-    }
+void ffdu::draw_device_base::draw_triangles(std::span<const ff::dxgi::endpoint_t> points)
+{
+    ffdu::instance_builder<ffdu::draw_device_base>::draw_triangles(*this, points);
+}
 
-    ffdu::instance_bucket_type type = (alpha_type == ::alpha_type::transparent)
-        ? (thickness2 ? ffdu::instance_bucket_type::circles_outline_out_transparent : ffdu::instance_bucket_type::circles_filled_out_transparent)
-        : (thickness2 ? ffdu::instance_bucket_type::circles_outline : ffdu::instance_bucket_type::circles_filled);
-    uint32_t matrix_index = this->get_world_matrix_index();
-    float depth = this->nudge_depth();
+void ffdu::draw_device_base::draw_rectangle(const ff::rect_float& rect, const ff::color& color, std::optional<float> thickness)
+{
+    ffdu::instance_builder<ffdu::draw_device_base>::draw_rectangle(*this, rect, color, thickness);
+}
 
-    ffdu::circle_instance& instance = this->add_instance<ffdu::circle_instance>(type, depth);
-    instance.position_radius.x = pos.pos.x;
-    instance.position_radius.y = pos.pos.y;
-    instance.position_radius.z = depth;
-    instance.position_radius.w = radius;
-    instance.inside_color = inside_color2.to_shader_color(this->palette_remap());
-    instance.outside_color = outside_color2.to_shader_color(this->palette_remap());
-    instance.thickness = thickness2;
-    instance.matrix_index = matrix_index;
+void ffdu::draw_device_base::draw_circle(const ff::dxgi::endpoint_t& pos, std::optional<float> thickness, const ff::color* outside_color)
+{
+    ffdu::instance_builder<ffdu::draw_device_base>::draw_circle(*this, pos, thickness, outside_color);
 }
 
 ff::matrix_stack& ffdu::draw_device_base::world_matrix_stack()
@@ -631,24 +1021,58 @@ void ffdu::draw_device_base::pop_sampler_linear_filter()
     this->sampler_stack.pop_back();
 }
 
-ff::dxgi::device_child_base* ffdu::draw_device_base::as_device_child()
+ff::dxgi::draw_base* ffdu::draw_device_base::create_recorder()
 {
-    return this;
+    check_ret_val(this->state == state_t::drawing, nullptr);
+
+    if (this->recorder_count == this->recorders.size())
+    {
+        this->recorders.push_back(std::make_unique<ffdu::draw_recorder>());
+    }
+
+    ffdu::draw_recorder& recorder = *this->recorders[this->recorder_count++];
+    recorder.begin(*this);
+    return &recorder;
 }
 
-bool ffdu::draw_device_base::internal_valid() const
+void ffdu::draw_device_base::merge_recorders()
 {
-    return this->state != draw_device_base::state_t::invalid;
+    for (size_t i = 0; i < this->recorder_count; i++)
+    {
+        this->merge_recorder(*this->recorders[i]);
+    }
+
+    this->recorder_count = 0;
 }
 
-bool ffdu::draw_device_base::linear_sampler() const
+ff::dxgi::device_child_base* ffdu::draw_device_base::as_device_child()
 {
-    return this->sampler_stack.back();
+    return this;
 }
 
-bool ffdu::draw_device_base::target_requires_palette() const
+std::shared_ptr<ff::dxgi::texture_base> ffdu::draw_device_base::internal_create_texture(const ff::point_size& size, DXGI_FORMAT format)
 {
-    return this->target_requires_palette_;
+    return ff::dxgi::create_render_texture(size, format);
+}
+
+size_t ffdu::draw_device_base::draw_calls_saved() const
+{
+    return this->draw_calls_saved_;
+}
+
+bool ffdu::draw_device_base::internal_valid() const
+{
+    return this->state != draw_device_base::state_t::invalid;
+}
+
+bool ffdu::draw_device_base::linear_sampler() const
+{
+    return this->sampler_stack.back();
+}
+
+bool ffdu::draw_device_base::target_requires_palette() const
+{
+    return this->target_requires_palette_;
 }
 
 bool ffdu::draw_device_base::pre_multiplied_alpha() const
@@ -679,6 +1103,7 @@ ff::dxgi::draw_ptr ffdu::draw_device_base::internal_begin_draw(
         this->init_vs_constants_buffer_0(target, view_rect, world_rect);
         this->target_requires_palette_ = ff::dxgi::palette_format(target.format());
         this->force_pre_multiplied_alpha = ff::flags::has(options, ff::dxgi::draw_options::pre_multiplied_alpha) && ff::dxgi::supports_pre_multiplied_alpha(target.format()) ? 1 : 0;
+        this->reorder_transparent = ff::flags::has(options, ff::dxgi::draw_options::reorder_transparent);
         this->state = draw_device_base::state_t::drawing;
 
         return { this, ::draw_ptr_deleter };
@@ -692,10 +1117,10 @@ bool ffdu::draw_device_base::reset()
     this->destroy();
 
     this->palette_stack.push_back(nullptr);
-    this->palette_texture = ff::dxgi::create_render_texture(ff::point_size(ff::dxgi::palette_size, ffdu::MAX_PALETTES));
+    this->palette_texture = this->internal_create_texture(ff::point_size(ff::dxgi::palette_size, ffdu::MAX_PALETTES), DXGI_FORMAT_R8G8B8A8_UNORM);
 
     this->palette_remap_stack.push_back(::default_palette_remap());
-    this->palette_remap_texture = ff::dxgi::create_render_texture(ff::point_size(ff::dxgi::palette_size, ffdu::MAX_PALETTE_REMAPS), DXGI_FORMAT_R8_UINT);
+    this->palette_remap_texture = this->internal_create_texture(ff::point_size(ff::dxgi::palette_size, ffdu::MAX_PALETTE_REMAPS), DXGI_FORMAT_R8_UINT);
 
     this->sampler_stack.push_back(false);
     this->custom_context_stack.push_back([](ff::dxgi::command_context_base&, const std::type_info&, bool) { return true; });
@@ -712,6 +1137,7 @@ void ffdu::draw_device_base::destroy()
 
     this->internal_destroy();
 
+    this->reorder_transparent = false;
     this->vs_constants_0 = ffdu::vs_constants_0{};
     this->vs_constants_1 = ffdu::vs_constants_1{};
     this->ps_constants_0 = ffdu::ps_constants_0{};
@@ -742,8 +1168,11 @@ void ffdu::draw_device_base::destroy()
     this->palette_remap_index = ::INVALID_INDEX;
 
     this->transparent_instances.clear();
+    this->transparent_batches.clear();
     this->last_depth_type = ffdu::last_depth_type::none;
     this->draw_depth = 0;
+    this->recorders.clear();
+    this->recorder_count = 0;
     this->force_no_overlap = 0;
     this->force_opaque = 0;
     this->force_pre_multiplied_alpha = 0;
@@ -752,10 +1181,20 @@ void ffdu::draw_device_base::destroy()
     {
         bucket.reset();
     }
+
+    for (std::vector<uint32_t>& order : this->transparent_orders)
+    {
+        order.clear();
+    }
 }
 
 void ffdu::draw_device_base::flush(bool end_draw)
 {
+    if (this->last_depth_type != ffdu::last_depth_type::none && this->reorder_transparent)
+    {
+        this->reorder_transparent_instances();
+    }
+
     if (this->last_depth_type != ffdu::last_depth_type::none && this->create_instance_buffer())
     {
         this->internal_flush_begin(this->command_context_);
@@ -794,7 +1233,14 @@ void ffdu::draw_device_base::flush(bool end_draw)
         this->textures_using_palette_count = 0;
 
         this->transparent_instances.clear();
+        this->transparent_batches.clear();
         this->last_depth_type = ffdu::last_depth_type::none;
+        this->flush_count++;
+
+        for (std::vector<uint32_t>& order : this->transparent_orders)
+        {
+            order.clear();
+        }
 
         this->command_context_ = this->internal_flush(this->command_context_, end_draw);
     }
@@ -865,7 +1311,25 @@ bool ffdu::draw_device_base::create_instance_buffer()
         {
             if (bucket.render_count())
             {
-                ::memcpy(reinterpret_cast<uint8_t*>(buffer_data) + bucket.render_start() * bucket.item_size(), bucket.data(), bucket.byte_size());
+                uint8_t* dest = reinterpret_cast<uint8_t*>(buffer_data) + bucket.render_start() * bucket.item_size();
+                const std::vector<uint32_t>& order = this->transparent_orders[static_cast<size_t>(bucket.bucket_type())];
+
+                if (order.empty())
+                {
+                    ::memcpy(dest, bucket.data(), bucket.byte_size());
+                }
+                else
+                {
+                    // Reordered transparent instances, so that each batch is contiguous
+                    assert(order.size() == bucket.render_count());
+
+                    for (uint32_t index : order)
+                    {
+                        ::memcpy(dest, bucket.data() + index * bucket.item_size(), bucket.item_size());
+                        dest += bucket.item_size();
+                    }
+                }
+
                 bucket.clear_items();
             }
         }
@@ -893,6 +1357,19 @@ void ffdu::draw_device_base::draw_opaque_instances(const ff::dxgi::draw_base::cu
 
 void ffdu::draw_device_base::draw_transparent_instances(const ff::dxgi::draw_base::custom_context_func* custom_func)
 {
+    if (!this->transparent_batches.empty())
+    {
+        for (const ffdu::transparent_batch& batch : this->transparent_batches)
+        {
+            if (this->apply_instance_state(*this->command_context_, *batch.bucket) && (*custom_func)(*this->command_context_, batch.bucket->item_type(), false))
+            {
+                this->draw(*this->command_context_, batch.bucket->bucket_type(), batch.bucket->render_start() + batch.start, batch.count);
+            }
+        }
+
+        return;
+    }
+
     for (size_t transparent_size = this->transparent_instances.size(), i = 0; i < transparent_size; )
     {
         const ffdu::transparent_instance_entry& entry = this->transparent_instances[i];
@@ -918,6 +1395,163 @@ void ffdu::draw_device_base::draw_transparent_instances(const ff::dxgi::draw_bas
     }
 }
 
+void ffdu::draw_device_base::reorder_transparent_instances()
+{
+    const size_t count = this->transparent_instances.size();
+    check_ret(count > 1);
+
+    // Bounds need the world matrixes, which aren't copied to the shader constants until later
+    for (const auto& iter : this->world_matrix_to_index)
+    {
+        this->vs_constants_1.model[iter.second] = iter.first;
+    }
+
+    this->transparent_bounds.resize(count);
+    size_t unordered_draw_count = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const ffdu::transparent_instance_entry& entry = this->transparent_instances[i];
+        this->transparent_bounds[i] = this->transparent_instance_bounds(entry);
+
+        // Same batching rule as draw_transparent_instances() without reordering
+        const ffdu::transparent_instance_entry* prev_entry = i ? &this->transparent_instances[i - 1] : nullptr;
+        if (!prev_entry || prev_entry->bucket != entry.bucket || prev_entry->depth != entry.depth || prev_entry->index + 1 != entry.index)
+        {
+            unordered_draw_count++;
+        }
+    }
+
+    const size_t batch_count = this->transparent_batcher.batch(this->transparent_instances, this->transparent_bounds);
+    check_ret(batch_count && batch_count < unordered_draw_count);
+
+    this->draw_calls_saved_ += unordered_draw_count - batch_count;
+
+    std::span<const uint32_t> order = this->transparent_batcher.order();
+    for (const ffdu::transparent_batch& batch : this->transparent_batcher.batches())
+    {
+        std::vector<uint32_t>& bucket_order = this->transparent_orders[static_cast<size_t>(batch.bucket->bucket_type())];
+        this->transparent_batches.push_back(ffdu::transparent_batch{ batch.bucket, bucket_order.size(), batch.count });
+
+        for (size_t i = batch.start; i < batch.start + batch.count; i++)
+        {
+            bucket_order.push_back(static_cast<uint32_t>(this->transparent_instances[order[i]].index));
+        }
+    }
+}
+
+ff::rect_float ffdu::draw_device_base::transparent_instance_bounds(const ffdu::transparent_instance_entry& entry) const
+{
+    const uint8_t* data = entry.bucket->data() + entry.index * entry.bucket->item_size();
+    ff::point_float local_min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+    ff::point_float local_max(-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max());
+    uint32_t matrix_index = 0;
+
+    auto add_point = [&local_min, &local_max](float x, float y, float radius)
+        {
+            local_min.x = std::min(local_min.x, x - radius);
+            local_min.y = std::min(local_min.y, y - radius);
+            local_max.x = std::max(local_max.x, x + radius);
+            local_max.y = std::max(local_max.y, y + radius);
+        };
+
+    switch (entry.bucket->bucket_type())
+    {
+        case ffdu::instance_bucket_type::sprites:
+        case ffdu::instance_bucket_type::sprites_out_transparent:
+        case ffdu::instance_bucket_type::palette_sprites:
+        case ffdu::instance_bucket_type::palette_sprites_out_transparent:
+            {
+                const ffdu::sprite_instance& instance = *reinterpret_cast<const ffdu::sprite_instance*>(data);
+                const DirectX::XMFLOAT4& rect = instance.rect;
+                matrix_index = instance.indexes >> 24;
+
+                if (instance.pos_rot.w)
+                {
+                    // Any rotation stays inside of the circle around the farthest corner
+                    const float radius = std::sqrt(std::max(rect.x * rect.x, rect.z * rect.z) + std::max(rect.y * rect.y, rect.w * rect.w));
+                    add_point(instance.pos_rot.x, instance.pos_rot.y, radius);
+                }
+                else
+                {
+                    add_point(instance.pos_rot.x + rect.x, instance.pos_rot.y + rect.y, 0);
+                    add_point(instance.pos_rot.x + rect.z, instance.pos_rot.y + rect.w, 0);
+                }
+            }
+            break;
+
+        case ffdu::instance_bucket_type::lines:
+        case ffdu::instance_bucket_type::lines_out_transparent:
+            {
+                const ffdu::line_instance& instance = *reinterpret_cast<const ffdu::line_instance*>(data);
+                const bool joined = (instance.before_start.x != instance.start.x || instance.before_start.y != instance.start.y ||
+                    instance.after_end.x != instance.end.x || instance.after_end.y != instance.end.y);
+
+                // The miter at joins can be up to 10x the thickness, see vs_line.hlsl
+                const float radius = std::max(instance.start_thickness, instance.end_thickness) * (joined ? 5.0f : 0.5f);
+                matrix_index = instance.matrix_index;
+                add_point(instance.start.x, instance.start.y, radius);
+                add_point(instance.end.x, instance.end.y, radius);
+            }
+            break;
+
+        case ffdu::instance_bucket_type::triangles:
+        case ffdu::instance_bucket_type::triangles_out_transparent:
+            {
+                const ffdu::triangle_instance& instance = *reinterpret_cast<const ffdu::triangle_instance*>(data);
+                matrix_index = instance.matrix_index;
+
+                for (const DirectX::XMFLOAT2& pos : instance.position)
+                {
+                    add_point(pos.x, pos.y, 0);
+                }
+            }
+            break;
+
+        case ffdu::instance_bucket_type::rectangles_filled:
+        case ffdu::instance_bucket_type::rectangles_filled_out_transparent:
+        case ffdu::instance_bucket_type::rectangles_outline:
+        case ffdu::instance_bucket_type::rectangles_outline_out_transparent:
+            {
+                const ffdu::rectangle_instance& instance = *reinterpret_cast<const ffdu::rectangle_instance*>(data);
+                matrix_index = instance.matrix_index;
+                add_point(instance.rect.x, instance.rect.y, 0);
+                add_point(instance.rect.z, instance.rect.w, 0);
+            }
+            break;
+
+        case ffdu::instance_bucket_type::circles_filled:
+        case ffdu::instance_bucket_type::circles_filled_out_transparent:
+        case ffdu::instance_bucket_type::circles_outline:
+        case ffdu::instance_bucket_type::circles_outline_out_transparent:
+            {
+                const ffdu::circle_instance& instance = *reinterpret_cast<const ffdu::circle_instance*>(data);
+                matrix_index = instance.matrix_index;
+                add_point(instance.position_radius.x, instance.position_radius.y, instance.position_radius.w);
+            }
+            break;
+
+        default:
+            debug_fail_ret_val(ff::rect_float(-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()));
+    }
+
+    // All instances share the same projection, so overlapping in world space is the same as overlapping on screen
+    const DirectX::XMMATRIX model = DirectX::XMMatrixTranspose(DirectX::XMLoadFloat4x4(&this->vs_constants_1.model[matrix_index]));
+    const std::array<DirectX::XMVECTOR, 4> corners
+    {
+        DirectX::XMVector2Transform(DirectX::XMVectorSet(local_min.x, local_min.y, 0, 1), model),
+        DirectX::XMVector2Transform(DirectX::XMVectorSet(local_max.x, local_min.y, 0, 1), model),
+        DirectX::XMVector2Transform(DirectX::XMVectorSet(local_min.x, local_max.y, 0, 1), model),
+        DirectX::XMVector2Transform(DirectX::XMVectorSet(local_max.x, local_max.y, 0, 1), model),
+    };
+
+    DirectX::XMFLOAT2 world_min, world_max;
+    DirectX::XMStoreFloat2(&world_min, DirectX::XMVectorMin(DirectX::XMVectorMin(corners[0], corners[1]), DirectX::XMVectorMin(corners[2], corners[3])));
+    DirectX::XMStoreFloat2(&world_max, DirectX::XMVectorMax(DirectX::XMVectorMax(corners[0], corners[1]), DirectX::XMVectorMax(corners[2], corners[3])));
+
+    return ff::rect_float(world_min.x, world_min.y, world_max.x, world_max.y);
+}
+
 float ffdu::draw_device_base::nudge_depth()
 {
     ffdu::last_depth_type depth_type = this->force_no_overlap ? ffdu::last_depth_type::instance_no_overlap : ffdu::last_depth_type::instance;
@@ -948,32 +1582,48 @@ uint32_t ffdu::draw_device_base::get_world_matrix_index_no_flush()
     {
         DirectX::XMFLOAT4X4 wm;
         DirectX::XMStoreFloat4x4(&wm, DirectX::XMMatrixTranspose(DirectX::XMLoadFloat4x4(&this->world_matrix_stack_.matrix())));
-        auto iter = this->world_matrix_to_index.find(wm);
+        this->world_matrix_index = this->get_world_matrix_index_no_flush(wm);
+    }
 
-        if (iter == this->world_matrix_to_index.cend() && this->world_matrix_to_index.size() != ffdu::MAX_TRANSFORM_MATRIXES)
-        {
-            iter = this->world_matrix_to_index.try_emplace(wm, static_cast<uint32_t>(this->world_matrix_to_index.size())).first;
-        }
+    return this->world_matrix_index;
+}
 
-        if (iter != this->world_matrix_to_index.cend())
-        {
-            this->world_matrix_index = iter->second;
-        }
+uint32_t ffdu::draw_device_base::get_world_matrix_index_no_flush(const DirectX::XMFLOAT4X4& transposed_matrix)
+{
+    auto iter = this->world_matrix_to_index.find(transposed_matrix);
+
+    if (iter == this->world_matrix_to_index.cend() && this->world_matrix_to_index.size() != ffdu::MAX_TRANSFORM_MATRIXES)
+    {
+        iter = this->world_matrix_to_index.try_emplace(transposed_matrix, static_cast<uint32_t>(this->world_matrix_to_index.size())).first;
     }
 
-    return this->world_matrix_index;
+    return (iter != this->world_matrix_to_index.cend()) ? iter->second : ::INVALID_INDEX;
 }
 
 uint32_t ffdu::draw_device_base::get_texture_index_no_flush(ff::dxgi::texture_view_base& texture_view, bool use_palette)
 {
+    uint32_t palette_index = 0;
+    uint32_t palette_remap_index = 0;
+
     if (use_palette)
     {
-        uint32_t palette_index = (this->palette_index == ::INVALID_INDEX) ? this->get_palette_index_no_flush() : this->palette_index;
+        palette_index = (this->palette_index == ::INVALID_INDEX) ? this->get_palette_index_no_flush() : this->palette_index;
         check_ret_val(palette_index != ::INVALID_INDEX, ::INVALID_INDEX);
+    }
 
-        uint32_t palette_remap_index = (this->palette_remap_index == ::INVALID_INDEX) ? this->get_palette_remap_index_no_flush() : this->palette_remap_index;
+    if (use_palette || this->target_requires_palette_)
+    {
+        palette_remap_index = (this->palette_remap_index == ::INVALID_INDEX) ? this->get_palette_remap_index_no_flush() : this->palette_remap_index;
         check_ret_val(palette_remap_index != ::INVALID_INDEX, ::INVALID_INDEX);
+    }
+
+    return this->get_texture_index_no_flush(texture_view, use_palette, palette_index, palette_remap_index, this->linear_sampler());
+}
 
+uint32_t ffdu::draw_device_base::get_texture_index_no_flush(ff::dxgi::texture_view_base& texture_view, bool use_palette, uint32_t palette_index, uint32_t palette_remap_index, bool linear_sampler)
+{
+    if (use_palette)
+    {
         uint32_t texture_index = ::INVALID_INDEX;
         for (size_t i = this->textures_using_palette_count; i != 0; i--)
         {
@@ -999,15 +1649,8 @@ uint32_t ffdu::draw_device_base::get_texture_index_no_flush(ff::dxgi::texture_vi
     }
     else
     {
-        uint32_t palette_remap_index = 0;
-        if (this->target_requires_palette_)
-        {
-            palette_remap_index = (this->palette_remap_index == ::INVALID_INDEX) ? this->get_palette_remap_index_no_flush() : this->palette_remap_index;
-            check_ret_val(palette_remap_index != ::INVALID_INDEX, ::INVALID_INDEX);
-        }
-
         uint32_t texture_index = ::INVALID_INDEX;
-        uint32_t sampler_index = static_cast<uint32_t>(this->linear_sampler());
+        uint32_t sampler_index = static_cast<uint32_t>(linear_sampler);
 
         for (size_t i = this->texture_count; i != 0; i--)
         {
@@ -1034,51 +1677,52 @@ uint32_t ffdu::draw_device_base::get_palette_index_no_flush()
 {
     if (this->palette_index == ::INVALID_INDEX)
     {
-        if (this->target_requires_palette_)
-        {
-            // Not converting palette to RGBA, so don't use a palette
-            this->palette_index = 0;
-        }
-        else
-        {
-            ff::dxgi::palette_base* palette = this->palette_stack.back();
-            size_t palette_hash = palette ? palette->data()->row_hash(palette->current_row()) : 0;
-            auto iter = this->palette_to_index.find(palette_hash);
+        ff::dxgi::palette_base* palette = this->palette_stack.back();
+        size_t palette_hash = (palette && !this->target_requires_palette_) ? palette->data()->row_hash(palette->current_row()) : 0;
+        this->palette_index = this->get_palette_index_no_flush(palette, palette_hash);
+    }
 
-            if (iter == this->palette_to_index.cend() && this->palette_to_index.size() != ffdu::MAX_PALETTES)
-            {
-                iter = this->palette_to_index.try_emplace(palette_hash, std::make_pair(palette, static_cast<uint32_t>(this->palette_to_index.size()))).first;
-            }
+    return this->palette_index;
+}
 
-            if (iter != this->palette_to_index.cend())
-            {
-                this->palette_index = iter->second.second;
-            }
-        }
+uint32_t ffdu::draw_device_base::get_palette_index_no_flush(ff::dxgi::palette_base* palette, size_t palette_hash)
+{
+    if (this->target_requires_palette_)
+    {
+        // Not converting palette to RGBA, so don't use a palette
+        return 0;
     }
 
-    return this->palette_index;
+    auto iter = this->palette_to_index.find(palette_hash);
+
+    if (iter == this->palette_to_index.cend() && this->palette_to_index.size() != ffdu::MAX_PALETTES)
+    {
+        iter = this->palette_to_index.try_emplace(palette_hash, std::make_pair(palette, static_cast<uint32_t>(this->palette_to_index.size()))).first;
+    }
+
+    return (iter != this->palette_to_index.cend()) ? iter->second.second : ::INVALID_INDEX;
 }
 
 uint32_t ffdu::draw_device_base::get_palette_remap_index_no_flush()
 {
     if (this->palette_remap_index == ::INVALID_INDEX)
     {
-        auto& remap_pair = this->palette_remap_stack.back();
-        auto iter = this->palette_remap_to_index.find(remap_pair.hash);
+        this->palette_remap_index = this->get_palette_remap_index_no_flush(this->palette_remap_stack.back());
+    }
 
-        if (iter == this->palette_remap_to_index.cend() && this->palette_remap_to_index.size() != ffdu::MAX_PALETTE_REMAPS)
-        {
-            iter = this->palette_remap_to_index.try_emplace(remap_pair.hash, std::make_pair(remap_pair, static_cast<uint32_t>(this->palette_remap_to_index.size()))).first;
-        }
+    return this->palette_remap_index;
+}
 
-        if (iter != this->palette_remap_to_index.cend())
-        {
-            this->palette_remap_index = iter->second.second;
-        }
+uint32_t ffdu::draw_device_base::get_palette_remap_index_no_flush(const ff::dxgi::remap_t& remap)
+{
+    auto iter = this->palette_remap_to_index.find(remap.hash);
+
+    if (iter == this->palette_remap_to_index.cend() && this->palette_remap_to_index.size() != ffdu::MAX_PALETTE_REMAPS)
+    {
+        iter = this->palette_remap_to_index.try_emplace(remap.hash, std::make_pair(remap, static_cast<uint32_t>(this->palette_remap_to_index.size()))).first;
     }
 
-    return this->palette_remap_index;
+    return (iter != this->palette_remap_to_index.cend()) ? iter->second.second : ::INVALID_INDEX;
 }
 
 uint32_t ffdu::draw_device_base::get_world_matrix_and_texture_index(ff::dxgi::texture_view_base& texture_view, bool use_palette)
@@ -1116,3 +1760,438 @@ void* ffdu::draw_device_base::add_instance_void(ffdu::instance_bucket_type bucke
 
     return bucket.add();
 }
+
+void ffdu::draw_device_base::reserve_instances(ffdu::instance_bucket_type bucket_type, size_t count)
+{
+    ffdu::instance_bucket& bucket = this->instance_buckets[static_cast<size_t>(bucket_type)];
+    bucket.reserve(count);
+
+    if (bucket.is_transparent())
+    {
+        ::reserve_more(this->transparent_instances, count);
+    }
+}
+
+void ffdu::draw_device_base::merge_recorder(const ffdu::draw_recorder& recorder)
+{
+    check_ret(!recorder.instances.empty());
+
+    // Recorded depths start at zero, so they go on top of everything drawn so far
+    const float depth_offset = this->draw_depth;
+    size_t merge_flush_count = this->flush_count - 1;
+
+    for (const ffdu::draw_recorder::instance_entry& entry : recorder.instances)
+    {
+        const ffdu::instance_bucket& source_bucket = recorder.instance_buckets[static_cast<size_t>(entry.bucket_type)];
+        const uint8_t* source = source_bucket.data() + entry.index * source_bucket.item_size();
+        auto [depth, recorded_index] = ::get_instance_depth_and_index(entry.bucket_type, source);
+        uint32_t index;
+
+        while (true)
+        {
+            if (merge_flush_count != this->flush_count)
+            {
+                // Device indexes are only valid until the next flush
+                merge_flush_count = this->flush_count;
+                this->merge_matrix_indexes.assign(recorder.world_matrixes.size(), ::INVALID_INDEX);
+                this->merge_texture_indexes.assign(recorder.textures.size(), ::INVALID_INDEX);
+            }
+
+            index = this->merge_recorded_index(recorder, entry.bucket_type, recorded_index);
+            if (index != ::INVALID_INDEX)
+            {
+                break;
+            }
+
+            this->flush();
+        }
+
+        depth += depth_offset;
+        uint8_t* dest = reinterpret_cast<uint8_t*>(this->add_instance_void(entry.bucket_type, depth));
+        std::memcpy(dest, source, source_bucket.item_size());
+        ::set_instance_depth_and_index(entry.bucket_type, dest, depth, index);
+        this->last_depth_type = ffdu::last_depth_type::instance;
+    }
+
+    this->draw_depth = depth_offset + recorder.draw_depth;
+}
+
+uint32_t ffdu::draw_device_base::merge_recorded_index(const ffdu::draw_recorder& recorder, ffdu::instance_bucket_type bucket_type, uint32_t recorded_index)
+{
+    if (!::is_sprite_bucket(bucket_type))
+    {
+        uint32_t& matrix_index = this->merge_matrix_indexes[recorded_index];
+        if (matrix_index == ::INVALID_INDEX)
+        {
+            matrix_index = this->get_world_matrix_index_no_flush(recorder.world_matrixes[recorded_index]);
+        }
+
+        return matrix_index;
+    }
+
+    uint32_t& indexes = this->merge_texture_indexes[recorded_index];
+    if (indexes == ::INVALID_INDEX)
+    {
+        const ffdu::draw_recorder::texture_entry& texture = recorder.textures[recorded_index];
+        uint32_t& matrix_index = this->merge_matrix_indexes[texture.matrix_index];
+        if (matrix_index == ::INVALID_INDEX)
+        {
+            matrix_index = this->get_world_matrix_index_no_flush(recorder.world_matrixes[texture.matrix_index]);
+            check_ret_val(matrix_index != ::INVALID_INDEX, ::INVALID_INDEX);
+        }
+
+        uint32_t palette_index = 0;
+        if (texture.use_palette)
+        {
+            const std::pair<ff::dxgi::palette_base*, size_t>& palette = recorder.palettes[texture.palette_index];
+            palette_index = this->get_palette_index_no_flush(palette.first, palette.second);
+            check_ret_val(palette_index != ::INVALID_INDEX, ::INVALID_INDEX);
+        }
+
+        uint32_t palette_remap_index = 0;
+        if (texture.use_palette || this->target_requires_palette_)
+        {
+            palette_remap_index = this->get_palette_remap_index_no_flush(recorder.palette_remaps[texture.palette_remap_index]);
+            check_ret_val(palette_remap_index != ::INVALID_INDEX, ::INVALID_INDEX);
+        }
+
+        uint32_t texture_index = this->get_texture_index_no_flush(*texture.view, texture.use_palette, palette_index, palette_remap_index, texture.linear_sampler);
+        check_ret_val(texture_index != ::INVALID_INDEX, ::INVALID_INDEX);
+
+        indexes = (matrix_index << 24) | texture_index;
+    }
+
+    return indexes;
+}
+
+ffdu::draw_recorder::draw_recorder()
+    : world_matrix_stack_changing_connection(this->world_matrix_stack_.matrix_changing().connect(std::bind(&draw_recorder::matrix_changing, this, std::placeholders::_1)))
+    , instance_buckets(::create_instance_buckets())
+{
+}
+
+ffdu::draw_recorder::~draw_recorder()
+{
+}
+
+void ffdu::draw_recorder::end_draw()
+{
+    // The device merges recorders when it's done drawing
+}
+
+void ffdu::draw_recorder::draw_sprite(const ff::dxgi::sprite_data& sprite, const ff::transform& transform)
+{
+    ffdu::instance_builder<ffdu::draw_recorder>::draw_sprite(*this, sprite, transform);
+}
+
+void ffdu::draw_recorder::draw_sprites(std::span<const ff::dxgi::sprite_data* const> sprites, std::span<const ff::transform> transforms)
+{
+    assert(sprites.size() == transforms.size());
+    ffdu::instance_builder<ffdu::draw_recorder>::draw_sprites(*this, std::min(sprites.size(), transforms.size()),
+        [sprites](size_t i) -> const ff::dxgi::sprite_data& { return *sprites[i]; }, transforms);
+}
+
+void ffdu::draw_recorder::draw_sprites(const ff::dxgi::sprite_data& sprite, std::span<const ff::transform> transforms)
+{
+    ffdu::instance_builder<ffdu::draw_recorder>::draw_sprites(*this, transforms.size(),
+        [&sprite](size_t) -> const ff::dxgi::sprite_data& { return sprite; }, transforms);
+}
+
+void ffdu::draw_recorder::draw_lines(std::span<const ff::dxgi::endpoint_t> points)
+{
+    ffdu::instance_builder<ffdu::draw_recorder>::draw_lines(*this, points);
+}
+
+void ffdu::draw_recorder::draw_triangles(std::span<const ff::dxgi::endpoint_t> points)
+{
+    ffdu::instance_builder<ffdu::draw_recorder>::draw_triangles(*this, points);
+}
+
+void ffdu::draw_recorder::draw_rectangle(const ff::rect_float& rect, const ff::color& color, std::optional<float> thickness)
+{
+    ffdu::instance_builder<ffdu::draw_recorder>::draw_rectangle(*this, rect, color, thickness);
+}
+
+void ffdu::draw_recorder::draw_circle(const ff::dxgi::endpoint_t& pos, std::optional<float> thickness, const ff::color* outside_color)
+{
+    ffdu::instance_builder<ffdu::draw_recorder>::draw_circle(*this, pos, thickness, outside_color);
+}
+
+ff::matrix_stack& ffdu::draw_recorder::world_matrix_stack()
+{
+    return this->world_matrix_stack_;
+}
+
+void ffdu::draw_recorder::push_palette(ff::dxgi::palette_base* palette)
+{
+    assert(palette);
+
+    if (!this->target_requires_palette_)
+    {
+        this->palette_stack.push_back(palette);
+        this->palette_index = ::INVALID_INDEX;
+    }
+
+    this->push_palette_remap(palette->remap());
+}
+
+void ffdu::draw_recorder::pop_palette()
+{
+    if (!this->target_requires_palette_)
+    {
+        assert(this->palette_stack.size() > 1);
+        this->palette_stack.pop_back();
+        this->palette_index = ::INVALID_INDEX;
+    }
+
+    this->pop_palette_remap();
+}
+
+void ffdu::draw_recorder::push_palette_remap(ff::dxgi::remap_t remap)
+{
+    this->palette_remap_stack.push_back(remap.hash ? remap : ::default_palette_remap());
+    this->palette_remap_index = ::INVALID_INDEX;
+}
+
+void ffdu::draw_recorder::pop_palette_remap()
+{
+    assert(this->palette_remap_stack.size() > 1);
+    this->palette_remap_stack.pop_back();
+    this->palette_remap_index = ::INVALID_INDEX;
+}
+
+void ffdu::draw_recorder::push_no_overlap()
+{
+    this->force_no_overlap++;
+}
+
+void ffdu::draw_recorder::pop_no_overlap()
+{
+    assert(this->force_no_overlap > 0);
+
+    if (!--this->force_no_overlap && this->last_depth_type == ffdu::last_depth_type::instance_no_overlap)
+    {
+        this->last_depth_type = ffdu::last_depth_type::instance;
+    }
+}
+
+void ffdu::draw_recorder::push_opaque()
+{
+    this->force_opaque++;
+}
+
+void ffdu::draw_recorder::pop_opaque()
+{
+    assert(this->force_opaque > 0);
+    this->force_opaque--;
+}
+
+void ffdu::draw_recorder::push_pre_multiplied_alpha()
+{
+    debug_fail_msg("Pre-multiplied alpha can't change while recording");
+}
+
+void ffdu::draw_recorder::pop_pre_multiplied_alpha()
+{
+    debug_fail_msg("Pre-multiplied alpha can't change while recording");
+}
+
+void ffdu::draw_recorder::push_custom_context(ff::dxgi::draw_base::custom_context_func&& func)
+{
+    debug_fail_msg("Custom contexts can't change while recording");
+}
+
+void ffdu::draw_recorder::pop_custom_context()
+{
+    debug_fail_msg("Custom contexts can't change while recording");
+}
+
+void ffdu::draw_recorder::push_sampler_linear_filter(bool linear_filter)
+{
+    this->sampler_stack.push_back(linear_filter);
+}
+
+void ffdu::draw_recorder::pop_sampler_linear_filter()
+{
+    assert(this->sampler_stack.size() > 1);
+    this->sampler_stack.pop_back();
+}
+
+ff::dxgi::draw_base* ffdu::draw_recorder::create_recorder()
+{
+    // Only the device can create recorders, since it decides the merge order
+    return nullptr;
+}
+
+void ffdu::draw_recorder::merge_recorders()
+{
+}
+
+void ffdu::draw_recorder::begin(const ffdu::draw_device_base& device)
+{
+    this->sampler_stack.assign(1, device.linear_sampler());
+    this->target_requires_palette_ = device.target_requires_palette_;
+    this->force_no_overlap = device.force_no_overlap;
+    this->force_opaque = device.force_opaque;
+
+    this->world_matrix_stack_.reset(&device.world_matrix_stack_.matrix());
+    this->world_matrix_to_index.clear();
+    this->world_matrixes.clear();
+    this->world_matrix_index = ::INVALID_INDEX;
+
+    this->texture_to_index.clear();
+    this->textures.clear();
+
+    this->palette_stack.assign(1, device.palette_stack.back());
+    this->palette_to_index.clear();
+    this->palettes.clear();
+    this->palette_index = ::INVALID_INDEX;
+
+    this->palette_remap_stack.assign(1, device.palette_remap_stack.back());
+    this->palette_remap_to_index.clear();
+    this->palette_remaps.clear();
+    this->palette_remap_index = ::INVALID_INDEX;
+
+    for (ffdu::instance_bucket& bucket : this->instance_buckets)
+    {
+        bucket.clear_items();
+    }
+
+    this->instances.clear();
+    this->last_depth_type = ffdu::last_depth_type::none;
+    this->draw_depth = 0;
+}
+
+void ffdu::draw_recorder::matrix_changing(const ff::matrix_stack& matrix_stack)
+{
+    this->world_matrix_index = ::INVALID_INDEX;
+}
+
+uint32_t ffdu::draw_recorder::get_world_matrix_index()
+{
+    if (this->world_matrix_index == ::INVALID_INDEX)
+    {
+        DirectX::XMFLOAT4X4 wm;
+        DirectX::XMStoreFloat4x4(&wm, DirectX::XMMatrixTranspose(DirectX::XMLoadFloat4x4(&this->world_matrix_stack_.matrix())));
+        auto [iter, inserted] = this->world_matrix_to_index.try_emplace(wm, static_cast<uint32_t>(this->world_matrixes.size()));
+
+        if (inserted)
+        {
+            this->world_matrixes.push_back(wm);
+        }
+
+        this->world_matrix_index = iter->second;
+    }
+
+    return this->world_matrix_index;
+}
+
+uint32_t ffdu::draw_recorder::get_world_matrix_and_texture_index(ff::dxgi::texture_view_base& texture_view, bool use_palette)
+{
+    ffdu::draw_recorder::texture_entry entry
+    {
+        &texture_view,
+        this->get_world_matrix_index(),
+        use_palette ? this->get_palette_index() : 0,
+        (use_palette || this->target_requires_palette_) ? this->get_palette_remap_index() : 0,
+        ::INVALID_INDEX,
+        use_palette,
+        this->sampler_stack.back(),
+    };
+
+    // Not limited like the device's tables, the index just gets stored in sprite_instance::indexes until the merge
+    auto [iter, inserted] = this->texture_to_index.try_emplace(&texture_view, static_cast<uint32_t>(this->textures.size()));
+    if (!inserted)
+    {
+        for (uint32_t i = iter->second; i != ::INVALID_INDEX; i = this->textures[i].next)
+        {
+            const ffdu::draw_recorder::texture_entry& other = this->textures[i];
+            if (other.matrix_index == entry.matrix_index &&
+                other.palette_index == entry.palette_index &&
+                other.palette_remap_index == entry.palette_remap_index &&
+                other.use_palette == entry.use_palette &&
+                other.linear_sampler == entry.linear_sampler)
+            {
+                return i;
+            }
+        }
+
+        entry.next = iter->second;
+        iter->second = static_cast<uint32_t>(this->textures.size());
+    }
+
+    this->textures.push_back(entry);
+    return static_cast<uint32_t>(this->textures.size() - 1);
+}
+
+uint32_t ffdu::draw_recorder::get_palette_index()
+{
+    if (this->palette_index == ::INVALID_INDEX)
+    {
+        ff::dxgi::palette_base* palette = this->palette_stack.back();
+        size_t palette_hash = (palette && !this->target_requires_palette_) ? palette->data()->row_hash(palette->current_row()) : 0;
+        auto [iter, inserted] = this->palette_to_index.try_emplace(palette_hash, static_cast<uint32_t>(this->palettes.size()));
+
+        if (inserted)
+        {
+            this->palettes.emplace_back(palette, palette_hash);
+        }
+
+        this->palette_index = iter->second;
+    }
+
+    return this->palette_index;
+}
+
+uint32_t ffdu::draw_recorder::get_palette_remap_index()
+{
+    if (this->palette_remap_index == ::INVALID_INDEX)
+    {
+        const ff::dxgi::remap_t& remap = this->palette_remap_stack.back();
+        auto [iter, inserted] = this->palette_remap_to_index.try_emplace(remap.hash, static_cast<uint32_t>(this->palette_remaps.size()));
+
+        if (inserted)
+        {
+            this->palette_remaps.push_back(remap);
+        }
+
+        this->palette_remap_index = iter->second;
+    }
+
+    return this->palette_remap_index;
+}
+
+const uint8_t* ffdu::draw_recorder::palette_remap() const
+{
+    return this->palette_remap_stack.back().remap.data();
+}
+
+bool ffdu::draw_recorder::allow_transparent() const
+{
+    return !this->force_opaque && !this->target_requires_palette_;
+}
+
+float ffdu::draw_recorder::nudge_depth()
+{
+    ffdu::last_depth_type depth_type = this->force_no_overlap ? ffdu::last_depth_type::instance_no_overlap : ffdu::last_depth_type::instance;
+    if (depth_type != ffdu::last_depth_type::instance_no_overlap || this->last_depth_type != depth_type)
+    {
+        this->draw_depth += ffdu::RENDER_DEPTH_DELTA;
+    }
+
+    this->last_depth_type = depth_type;
+    return this->draw_depth;
+}
+
+void* ffdu::draw_recorder::add_instance_void(ffdu::instance_bucket_type bucket_type, float depth)
+{
+    ffdu::instance_bucket& bucket = this->instance_buckets[static_cast<size_t>(bucket_type)];
+    this->instances.emplace_back(bucket_type, static_cast<uint32_t>(bucket.count()));
+    return bucket.add();
+}
+
+void ffdu::draw_recorder::reserve_instances(ffdu::instance_bucket_type bucket_type, size_t count)
+{
+    this->instance_buckets[static_cast<size_t>(bucket_type)].reserve(count);
+    ::reserve_more(this->instances, count);
+}
@@ -129,6 +129,7 @@ namespace ff::dxgi::draw_util
         }
 
         void reset();
+        void reserve(size_t count); // room for count more items
         void* add();
         size_t item_size() const;
         const std::type_info& item_type() const;
@@ -144,6 +145,8 @@ namespace ff::dxgi::draw_util
         size_t render_count() const;
 
     private:
+        void grow(size_t min_byte_size);
+
         ffdu::instance_bucket_type bucket_type_;
         const std::type_info& item_type_;
         size_t item_size_{};
@@ -162,6 +165,44 @@ namespace ff::dxgi::draw_util
         float depth;
     };
 
+    struct transparent_batch
+    {
+        const ffdu::instance_bucket* bucket;
+        size_t start; // index into transparent_batcher::order(), or the bucket's render data after reordering
+        size_t count;
+    };
+
+    /// <summary>
+    /// Groups transparent instances into as few same-bucket batches as possible, using their screen bounds
+    /// </summary>
+    /// <remarks>
+    /// Any two instances whose bounds overlap are still drawn in submission order, so blending and depth tests
+    /// produce the same result. Bounds are binned into a uniform grid so that only nearby instances are compared.
+    /// </remarks>
+    class transparent_batcher
+    {
+    public:
+        // Returns the number of batches
+        size_t batch(std::span<const ffdu::transparent_instance_entry> entries, std::span<const ff::rect_float> bounds);
+
+        // Entry indexes in the order they should be drawn, each batch is a range of this
+        std::span<const uint32_t> order() const;
+        std::span<const ffdu::transparent_batch> batches() const;
+
+    private:
+        std::vector<uint32_t> batch_of;
+        std::vector<uint32_t> order_;
+        std::vector<ffdu::transparent_batch> batches_;
+        std::array<std::vector<uint32_t>, static_cast<size_t>(ffdu::instance_bucket_type::count)> bucket_batches;
+        std::vector<std::vector<uint32_t>> cells;
+        std::vector<uint32_t> checked;
+    };
+
+    class draw_recorder;
+
+    template<class Owner>
+    class instance_builder;
+
     struct vs_constants_0
     {
         static const size_t DWORD_COUNT = 18; // don't include padding
@@ -194,6 +235,8 @@ namespace ff::dxgi::draw_util
 
         virtual void end_draw() override;
         virtual void draw_sprite(const ff::dxgi::sprite_data& sprite, const ff::transform& transform) override;
+        virtual void draw_sprites(std::span<const ff::dxgi::sprite_data* const> sprites, std::span<const ff::transform> transforms) override;
+        virtual void draw_sprites(const ff::dxgi::sprite_data& sprite, std::span<const ff::transform> transforms) override;
         virtual void draw_lines(std::span<const ff::dxgi::endpoint_t> points) override;
         virtual void draw_triangles(std::span<const ff::dxgi::endpoint_t> points) override;
         virtual void draw_rectangle(const ff::rect_float& rect, const ff::color& color, std::optional<float> thickness) override;
@@ -214,6 +257,8 @@ namespace ff::dxgi::draw_util
         virtual void pop_custom_context() override;
         virtual void push_sampler_linear_filter(bool linear_filter) override;
         virtual void pop_sampler_linear_filter() override;
+        virtual ff::dxgi::draw_base* create_recorder() override;
+        virtual void merge_recorders() override;
 
     protected:
         using palette_to_index_t = std::unordered_map<size_t, std::pair<ff::dxgi::palette_base*, uint32_t>, ff::no_hash<size_t>>;
@@ -225,6 +270,7 @@ namespace ff::dxgi::draw_util
         virtual ff::dxgi::command_context_base* internal_setup(ff::dxgi::command_context_base& context, ff::dxgi::target_base& target, ff::dxgi::depth_base* depth, const ff::rect_float& view_rect, bool ignore_rotation) = 0;
         virtual void internal_flush_begin(ff::dxgi::command_context_base* context) = 0;
         virtual void internal_flush_end(ff::dxgi::command_context_base* context) = 0;
+        virtual std::shared_ptr<ff::dxgi::texture_base> internal_create_texture(const ff::point_size& size, DXGI_FORMAT format);
 
         virtual ff::dxgi::buffer_base& instance_buffer() = 0;
         virtual ff::dxgi::buffer_base& vs_constants_buffer_0() = 0;
@@ -244,6 +290,7 @@ namespace ff::dxgi::draw_util
 
         ff::dxgi::device_child_base* as_device_child();
         bool internal_valid() const;
+        size_t draw_calls_saved() const;
         bool linear_sampler() const;
         bool target_requires_palette() const;
         bool pre_multiplied_alpha() const;
@@ -257,6 +304,9 @@ namespace ff::dxgi::draw_util
             ff::dxgi::draw_options options);
 
     private:
+        friend class ffdu::draw_recorder;
+        template<class> friend class ffdu::instance_builder;
+
         // device_child_base
         virtual bool reset() override;
 
@@ -271,18 +321,27 @@ namespace ff::dxgi::draw_util
         bool create_instance_buffer();
         void draw_opaque_instances(const ff::dxgi::draw_base::custom_context_func* custom_func);
         void draw_transparent_instances(const ff::dxgi::draw_base::custom_context_func* custom_func);
+        void reorder_transparent_instances();
+        ff::rect_float transparent_instance_bounds(const ffdu::transparent_instance_entry& entry) const;
         float nudge_depth();
 
         uint32_t get_world_matrix_index();
         uint32_t get_world_matrix_index_no_flush();
+        uint32_t get_world_matrix_index_no_flush(const DirectX::XMFLOAT4X4& transposed_matrix);
         uint32_t get_texture_index_no_flush(ff::dxgi::texture_view_base& texture_view, bool use_palette);
+        uint32_t get_texture_index_no_flush(ff::dxgi::texture_view_base& texture_view, bool use_palette, uint32_t palette_index, uint32_t palette_remap_index, bool linear_sampler);
         uint32_t get_palette_index_no_flush();
+        uint32_t get_palette_index_no_flush(ff::dxgi::palette_base* palette, size_t palette_hash);
         uint32_t get_palette_remap_index_no_flush();
+        uint32_t get_palette_remap_index_no_flush(const ff::dxgi::remap_t& remap);
         uint32_t get_world_matrix_and_texture_index(ff::dxgi::texture_view_base& texture_view, bool use_palette);
 
         const uint8_t* palette_remap() const;
         bool allow_transparent() const;
         void* add_instance_void(ffdu::instance_bucket_type bucket_type, float depth);
+        void reserve_instances(ffdu::instance_bucket_type bucket_type, size_t count);
+        void merge_recorder(const ffdu::draw_recorder& recorder);
+        uint32_t merge_recorded_index(const ffdu::draw_recorder& recorder, ffdu::instance_bucket_type bucket_type, uint32_t recorded_index);
 
         template<class T>
         T& add_instance(ffdu::instance_bucket_type bucket_type, float depth)
@@ -339,11 +398,145 @@ namespace ff::dxgi::draw_util
 
         // Render data
         std::vector<ffdu::transparent_instance_entry> transparent_instances;
+        std::vector<ffdu::transparent_batch> transparent_batches;
+        std::array<std::vector<uint32_t>, static_cast<size_t>(ffdu::instance_bucket_type::count)> transparent_orders;
+        std::vector<ff::rect_float> transparent_bounds;
+        ffdu::transparent_batcher transparent_batcher;
+        size_t draw_calls_saved_{};
+        bool reorder_transparent{};
         std::array<ffdu::instance_bucket, static_cast<size_t>(ffdu::instance_bucket_type::count)> instance_buckets;
         ffdu::last_depth_type last_depth_type{};
         float draw_depth{};
         int force_no_overlap{};
         int force_opaque{};
         int force_pre_multiplied_alpha{};
+        size_t flush_count{};
+
+        // Recording on other threads
+        std::vector<std::unique_ptr<ffdu::draw_recorder>> recorders;
+        size_t recorder_count{};
+        std::vector<uint32_t> merge_matrix_indexes; // recorder index to device index, for the current flush_count
+        std::vector<uint32_t> merge_texture_indexes;
+    };
+
+    /// <summary>
+    /// Builds instances on any thread into private buckets, which draw_device_base merges into its own buckets
+    /// </summary>
+    /// <remarks>
+    /// Matrix, texture, and palette indexes are local to the recorder until the merge remaps them to the device's tables,
+    /// which happens on the drawing thread in the order that the recorders were created, so the output is deterministic.
+    /// Custom contexts and pre-multiplied alpha changes need a flush, so they can't change while recording.
+    /// </remarks>
+    class draw_recorder : public ff::dxgi::draw_base
+    {
+    public:
+        draw_recorder();
+        virtual ~draw_recorder() override;
+
+        draw_recorder(draw_recorder&& other) noexcept = delete;
+        draw_recorder(const draw_recorder& other) = delete;
+        draw_recorder& operator=(draw_recorder&& other) noexcept = delete;
+        draw_recorder& operator=(const draw_recorder& other) = delete;
+
+        virtual void end_draw() override;
+        virtual void draw_sprite(const ff::dxgi::sprite_data& sprite, const ff::transform& transform) override;
+        virtual void draw_sprites(std::span<const ff::dxgi::sprite_data* const> sprites, std::span<const ff::transform> transforms) override;
+        virtual void draw_sprites(const ff::dxgi::sprite_data& sprite, std::span<const ff::transform> transforms) override;
+        virtual void draw_lines(std::span<const ff::dxgi::endpoint_t> points) override;
+        virtual void draw_triangles(std::span<const ff::dxgi::endpoint_t> points) override;
+        virtual void draw_rectangle(const ff::rect_float& rect, const ff::color& color, std::optional<float> thickness) override;
+        virtual void draw_circle(const ff::dxgi::endpoint_t& pos, std::optional<float> thickness, const ff::color* outside_color) override;
+
+        virtual ff::matrix_stack& world_matrix_stack() override;
+        virtual void push_palette(ff::dxgi::palette_base* palette) override;
+        virtual void pop_palette() override;
+        virtual void push_palette_remap(ff::dxgi::remap_t remap) override;
+        virtual void pop_palette_remap() override;
+        virtual void push_no_overlap() override;
+        virtual void pop_no_overlap() override;
+        virtual void push_opaque() override;
+        virtual void pop_opaque() override;
+        virtual void push_pre_multiplied_alpha() override;
+        virtual void pop_pre_multiplied_alpha() override;
+        virtual void push_custom_context(ff::dxgi::draw_base::custom_context_func&& func) override;
+        virtual void pop_custom_context() override;
+        virtual void push_sampler_linear_filter(bool linear_filter) override;
+        virtual void pop_sampler_linear_filter() override;
+        virtual ff::dxgi::draw_base* create_recorder() override;
+        virtual void merge_recorders() override;
+
+    private:
+        friend class ffdu::draw_device_base;
+        template<class> friend class ffdu::instance_builder;
+
+        struct texture_entry
+        {
+            ff::dxgi::texture_view_base* view;
+            uint32_t matrix_index;
+            uint32_t palette_index;
+            uint32_t palette_remap_index;
+            uint32_t next; // older entry for the same view
+            bool use_palette;
+            bool linear_sampler;
+        };
+
+        struct instance_entry
+        {
+            ffdu::instance_bucket_type bucket_type;
+            uint32_t index;
+        };
+
+        void begin(const ffdu::draw_device_base& device);
+        void matrix_changing(const ff::matrix_stack& matrix_stack);
+
+        uint32_t get_world_matrix_index();
+        uint32_t get_world_matrix_and_texture_index(ff::dxgi::texture_view_base& texture_view, bool use_palette);
+        uint32_t get_palette_index();
+        uint32_t get_palette_remap_index();
+        const uint8_t* palette_remap() const;
+        bool allow_transparent() const;
+        float nudge_depth();
+        void* add_instance_void(ffdu::instance_bucket_type bucket_type, float depth);
+        void reserve_instances(ffdu::instance_bucket_type bucket_type, size_t count);
+
+        template<class T>
+        T& add_instance(ffdu::instance_bucket_type bucket_type, float depth)
+        {
+            return *reinterpret_cast<T*>(this->add_instance_void(bucket_type, depth));
+        }
+
+        // Render state, starts out the same as the device
+        std::vector<bool> sampler_stack;
+        bool target_requires_palette_{};
+        int force_no_overlap{};
+        int force_opaque{};
+
+        // Matrixes
+        ff::matrix_stack world_matrix_stack_;
+        ff::signal_connection world_matrix_stack_changing_connection;
+        std::unordered_map<DirectX::XMFLOAT4X4, uint32_t, ff::stable_hash<DirectX::XMFLOAT4X4>> world_matrix_to_index;
+        std::vector<DirectX::XMFLOAT4X4> world_matrixes; // transposed
+        uint32_t world_matrix_index{};
+
+        // Textures
+        std::unordered_map<const ff::dxgi::texture_view_base*, uint32_t> texture_to_index; // newest entry for each view
+        std::vector<ffdu::draw_recorder::texture_entry> textures;
+
+        // Palettes
+        std::vector<ff::dxgi::palette_base*> palette_stack;
+        std::unordered_map<size_t, uint32_t, ff::no_hash<size_t>> palette_to_index;
+        std::vector<std::pair<ff::dxgi::palette_base*, size_t>> palettes;
+        uint32_t palette_index{};
+
+        std::vector<ff::dxgi::remap_t> palette_remap_stack;
+        std::unordered_map<size_t, uint32_t, ff::no_hash<size_t>> palette_remap_to_index;
+        std::vector<ff::dxgi::remap_t> palette_remaps;
+        uint32_t palette_remap_index{};
+
+        // Render data
+        std::array<ffdu::instance_bucket, static_cast<size_t>(ffdu::instance_bucket_type::count)> instance_buckets;
+        std::vector<ffdu::draw_recorder::instance_entry> instances; // in draw order
+        ffdu::last_depth_type last_depth_type{};
+        float draw_depth{};
     };
 }
@@ -4,6 +4,25 @@
 #include "graphics/types/matrix.h"
 #include "graphics/types/transform.h"
 
+template<class T>
+static bool sample_keys(const ff::animation_keys& keys, float frame, const ff::dict* params, T& out)
+{
+    if (keys.component_count())
+    {
+        // Typed keys don't allocate a value for each frame
+        return keys.sample_into(frame, out);
+    }
+
+    ff::value_ptr value = keys.get_value(frame, params)->try_convert<T>();
+    if (value)
+    {
+        out = value->get<T>();
+        return true;
+    }
+
+    return false;
+}
+
 ff::animation::animation()
     : play_length_(0)
     , frame_length_(0)
@@ -93,47 +112,70 @@ void ff::animation::draw_frame(ff::dxgi::draw_base& draw, const ff::transform& t
 
         if (info.position_keys)
         {
-            ff::value_ptr value = info.position_keys->get_value(visual_frame, params)->try_convert<ff::point_float>();
-            if (value)
+            ff::point_float value;
+            if (::sample_keys(*info.position_keys, visual_frame, params, value))
             {
-                visual_transform.position += value->get<ff::point_float>() * draw_transform.scale;
+                visual_transform.position += value * draw_transform.scale;
             }
         }
 
         if (info.scale_keys)
         {
-            ff::value_ptr value = info.scale_keys->get_value(visual_frame, params)->try_convert<ff::point_float>();
-            if (value)
+            ff::point_float value;
+            if (::sample_keys(*info.scale_keys, visual_frame, params, value))
             {
-                visual_transform.scale *= value->get<ff::point_float>();
+                visual_transform.scale *= value;
             }
         }
 
         if (info.rotate_keys)
         {
-            ff::value_ptr value = info.rotate_keys->get_value(visual_frame, params)->try_convert<float>();
-            if (value)
+            float value;
+            if (::sample_keys(*info.rotate_keys, visual_frame, params, value))
             {
-                visual_transform.rotation += value->get<float>();
+                visual_transform.rotation += value;
             }
         }
 
         if (info.color_keys)
         {
-            ff::value_ptr value = info.color_keys->get_value(visual_frame, params);
-            ff::value_ptr rect_value = value->try_convert<ff::rect_float>();
-            ff::value_ptr int_value = value->try_convert<int>();
+            DirectX::XMFLOAT4 rect_value;
+            float index_value;
 
-            if (rect_value)
+            if (info.color_keys->component_count() == 4)
+            {
+                if (info.color_keys->sample_into(visual_frame, rect_value))
+                {
+                    DirectX::XMStoreFloat4(&visual_transform.color.rgba(),
+                        DirectX::XMVectorMultiply(
+                            DirectX::XMLoadFloat4(&visual_transform.color.rgba()),
+                            DirectX::XMLoadFloat4(&rect_value)));
+                }
+            }
+            else if (info.color_keys->component_count() == 1)
             {
-                DirectX::XMStoreFloat4(&visual_transform.color.rgba(),
-                    DirectX::XMVectorMultiply(
-                        DirectX::XMLoadFloat4(&visual_transform.color.rgba()),
-                        DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&rect_value->get<ff::rect_float>()))));
+                if (info.color_keys->sample_into(visual_frame, index_value))
+                {
+                    visual_transform.color = ff::color(static_cast<int>(index_value));
+                }
             }
-            else if (int_value)
+            else
             {
-                visual_transform.color = ff::color(int_value->get<int>());
+                ff::value_ptr value = info.color_keys->get_value(visual_frame, params);
+                ff::value_ptr rect_value = value->try_convert<ff::rect_float>();
+                ff::value_ptr int_value = value->try_convert<int>();
+
+                if (rect_value)
+                {
+                    DirectX::XMStoreFloat4(&visual_transform.color.rgba(),
+                        DirectX::XMVectorMultiply(
+                            DirectX::XMLoadFloat4(&visual_transform.color.rgba()),
+                            DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&rect_value->get<ff::rect_float>()))));
+                }
+                else if (int_value)
+                {
+                    visual_transform.color = ff::color(int_value->get<int>());
+                }
             }
         }
 
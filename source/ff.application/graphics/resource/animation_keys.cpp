@@ -19,6 +19,27 @@ ff::animation_keys::animation_keys()
 
 ff::value_ptr ff::animation_keys::get_value(float frame, const ff::dict* params) const
 {
+    if (this->track.components)
+    {
+        std::array<float, 4> out;
+        if (!this->sample_components(frame, out.data(), this->track.components))
+        {
+            return nullptr;
+        }
+
+        switch (this->track.components)
+        {
+            case 1:
+                return ff::value::create<float>(out[0]);
+
+            case 2:
+                return ff::value::create<ff::point_float>(ff::point_float(out[0], out[1]));
+
+            default:
+                return ff::value::create<ff::rect_float>(ff::rect_float(out[0], out[1], out[2], out[3]));
+        }
+    }
+
     if (this->keys.size() && this->adjust_frame(frame, this->start_, this->length_, this->method))
     {
         auto key_iter = std::lower_bound(this->keys.cbegin(), this->keys.cend(), frame);
@@ -58,6 +79,91 @@ const std::string& ff::animation_keys::name() const
     return this->name_;
 }
 
+size_t ff::animation_keys::component_count() const
+{
+    return this->track.components;
+}
+
+bool ff::animation_keys::sample_into(float frame, float& out) const
+{
+    return this->sample_components(frame, &out, 1);
+}
+
+bool ff::animation_keys::sample_into(float frame, ff::point_float& out) const
+{
+    std::array<float, 2> values;
+    if (this->sample_components(frame, values.data(), values.size()))
+    {
+        out = ff::point_float(values[0], values[1]);
+        return true;
+    }
+
+    return false;
+}
+
+bool ff::animation_keys::sample_into(float frame, ff::rect_float& out) const
+{
+    return this->sample_components(frame, reinterpret_cast<float*>(&out), 4);
+}
+
+bool ff::animation_keys::sample_into(float frame, DirectX::XMFLOAT4& out) const
+{
+    return this->sample_components(frame, &out.x, 4);
+}
+
+bool ff::animation_keys::sample_batch(std::span<const float> frames, std::span<float> output) const
+{
+    const size_t components = this->track.components;
+    if (!components || output.size() < frames.size() * components)
+    {
+        return false;
+    }
+
+    if (components == 1)
+    {
+        this->sample_batch_1(frames, output);
+    }
+    else
+    {
+        for (size_t i = 0; i < frames.size(); i++)
+        {
+            this->sample_components(frames[i], &output[i * components], components);
+        }
+    }
+
+    return true;
+}
+
+void ff::animation_keys::sample_batch(std::span<const batch_track> tracks)
+{
+    size_t total_frames = 0;
+    for (const batch_track& track : tracks)
+    {
+        total_frames += track.frames.size();
+    }
+
+    auto sample_tracks = [tracks](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            const batch_track& track = tracks[i];
+            if (track.keys)
+            {
+                track.keys->sample_batch(track.frames, track.output);
+            }
+        }
+    };
+
+    if (total_frames >= 4096 && tracks.size() > 1)
+    {
+        ff::thread_pool::parallel_for(0, tracks.size(), sample_tracks);
+    }
+    else
+    {
+        sample_tracks(0, tracks.size());
+    }
+}
+
 ff::animation_keys ff::animation_keys::load_from_source(std::string_view name, const ff::dict& dict, ff::resource_load_context& context)
 {
     animation_keys frames;
@@ -130,6 +236,7 @@ bool ff::animation_keys::load_from_cache_internal(const ff::dict& dict)
         this->keys.push_back(std::move(key));
     }
 
+    this->compile_typed_track();
     return true;
 }
 
@@ -257,9 +364,249 @@ bool ff::animation_keys::load_from_source_internal(std::string_view name, const
         }
     }
 
+    this->compile_typed_track();
     return true;
 }
 
+static size_t key_value_components(const ff::value_ptr& value)
+{
+    if (value->is_type<float>())
+    {
+        return 1;
+    }
+    else if (value->is_type<ff::point_float>())
+    {
+        return 2;
+    }
+    else if (value->is_type<ff::rect_float>())
+    {
+        return 4;
+    }
+
+    return 0;
+}
+
+static void copy_key_components(const ff::value_ptr& value, size_t components, float* out)
+{
+    switch (components)
+    {
+        case 1:
+            *out = value->get<float>();
+            break;
+
+        case 2:
+            {
+                const ff::point_float& point = value->get<ff::point_float>();
+                out[0] = point.x;
+                out[1] = point.y;
+            }
+            break;
+
+        case 4:
+            std::memcpy(out, &value->get<ff::rect_float>(), sizeof(float) * 4);
+            break;
+    }
+}
+
+static DirectX::XMVECTOR load_components(const float* values, size_t components)
+{
+    switch (components)
+    {
+        case 1:
+            return DirectX::XMLoadFloat(values);
+
+        case 2:
+            return DirectX::XMLoadFloat2(reinterpret_cast<const DirectX::XMFLOAT2*>(values));
+
+        default:
+            return DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(values));
+    }
+}
+
+static void store_components(float* values, size_t components, DirectX::FXMVECTOR value)
+{
+    switch (components)
+    {
+        case 1:
+            DirectX::XMStoreFloat(values, value);
+            break;
+
+        case 2:
+            DirectX::XMStoreFloat2(reinterpret_cast<DirectX::XMFLOAT2*>(values), value);
+            break;
+
+        default:
+            DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*>(values), value);
+            break;
+    }
+}
+
+void ff::animation_keys::compile_typed_track()
+{
+    this->track = typed_track{};
+
+    // Keys that need params or can't be interpolated will always use the ff::value_ptr path
+    bool has_default = this->default_value && !this->default_value->is_type<nullptr_t>();
+    size_t components = this->keys.size()
+        ? ::key_value_components(this->keys[0].value)
+        : (has_default ? ::key_value_components(this->default_value) : 0);
+
+    if (!components || (has_default && ::key_value_components(this->default_value) != components))
+    {
+        return;
+    }
+
+    bool spline = ff::flags::has(this->method, method_t::interpolate_spline);
+    for (const key_frame& key : this->keys)
+    {
+        if (::key_value_components(key.value) != components)
+        {
+            return;
+        }
+
+        spline = spline && key.tangent_value && key.tangent_value->is_same_type(key.value);
+    }
+
+    typed_track& track = this->track;
+    track.components = components;
+    track.spline = spline;
+    track.has_default = has_default;
+    track.frames.reserve(this->keys.size());
+    track.values.resize(this->keys.size() * components);
+    track.tangents.resize(spline ? this->keys.size() * components : 0);
+
+    if (has_default)
+    {
+        ::copy_key_components(this->default_value, components, track.default_value.data());
+    }
+
+    for (size_t i = 0; i < this->keys.size(); i++)
+    {
+        const key_frame& key = this->keys[i];
+        track.frames.push_back(key.frame);
+        ::copy_key_components(key.value, components, &track.values[i * components]);
+
+        if (spline)
+        {
+            ::copy_key_components(key.tangent_value, components, &track.tangents[i * components]);
+        }
+    }
+}
+
+bool ff::animation_keys::sample_components(float frame, float* out, size_t components) const
+{
+    const typed_track& track = this->track;
+    if (!components || components != track.components)
+    {
+        return false;
+    }
+
+    if (track.frames.size() && ff::animation_keys::adjust_frame(frame, this->start_, this->length_, this->method))
+    {
+        auto key_iter = std::lower_bound(track.frames.cbegin(), track.frames.cend(), frame);
+        if (key_iter == track.frames.cend())
+        {
+            std::memcpy(out, &track.values[track.values.size() - components], sizeof(float) * components);
+        }
+        else if (key_iter == track.frames.cbegin() || *key_iter == frame)
+        {
+            std::memcpy(out, &track.values[(key_iter - track.frames.cbegin()) * components], sizeof(float) * components);
+        }
+        else
+        {
+            size_t next = key_iter - track.frames.cbegin();
+            size_t prev = next - 1;
+            float time = (frame - track.frames[prev]) / (track.frames[next] - track.frames[prev]);
+
+            DirectX::XMVECTOR v1 = ::load_components(&track.values[prev * components], components);
+            DirectX::XMVECTOR v2 = ::load_components(&track.values[next * components], components);
+
+            ::store_components(out, components, track.spline
+                ? DirectX::XMVectorHermite(
+                    v1, ::load_components(&track.tangents[prev * components], components),
+                    v2, ::load_components(&track.tangents[next * components], components),
+                    time)
+                : DirectX::XMVectorLerp(v1, v2, time));
+        }
+
+        return true;
+    }
+
+    if (track.has_default)
+    {
+        std::memcpy(out, track.default_value.data(), sizeof(float) * components);
+        return true;
+    }
+
+    return false;
+}
+
+void ff::animation_keys::sample_batch_1(std::span<const float> frames, std::span<float> output) const
+{
+    // Single float keys get interpolated four frames at a time
+    const typed_track& track = this->track;
+    const size_t key_count = track.frames.size();
+
+    for (size_t base = 0; base < frames.size(); base += 4)
+    {
+        const size_t lanes = std::min<size_t>(frames.size() - base, 4);
+        DirectX::XMFLOAT4A v1{}, v2{}, t1{}, t2{}, time{};
+        std::array<bool, 4> valid{};
+
+        for (size_t lane = 0; lane < lanes; lane++)
+        {
+            float frame = frames[base + lane];
+            float* lane_v1 = &v1.x + lane;
+            float* lane_v2 = &v2.x + lane;
+
+            if (key_count && ff::animation_keys::adjust_frame(frame, this->start_, this->length_, this->method))
+            {
+                size_t next = std::lower_bound(track.frames.cbegin(), track.frames.cend(), frame) - track.frames.cbegin();
+                valid[lane] = true;
+
+                if (next == key_count || next == 0 || track.frames[next] == frame)
+                {
+                    // Exact key, time stays at zero
+                    *lane_v1 = *lane_v2 = track.values[std::min(next, key_count - 1)];
+                }
+                else
+                {
+                    size_t prev = next - 1;
+                    *lane_v1 = track.values[prev];
+                    *lane_v2 = track.values[next];
+                    (&time.x)[lane] = (frame - track.frames[prev]) / (track.frames[next] - track.frames[prev]);
+
+                    if (track.spline)
+                    {
+                        (&t1.x)[lane] = track.tangents[prev];
+                        (&t2.x)[lane] = track.tangents[next];
+                    }
+                }
+            }
+            else if (track.has_default)
+            {
+                *lane_v1 = *lane_v2 = track.default_value[0];
+                valid[lane] = true;
+            }
+        }
+
+        DirectX::XMVECTOR result = track.spline
+            ? DirectX::XMVectorHermiteV(DirectX::XMLoadFloat4A(&v1), DirectX::XMLoadFloat4A(&t1), DirectX::XMLoadFloat4A(&v2), DirectX::XMLoadFloat4A(&t2), DirectX::XMLoadFloat4A(&time))
+            : DirectX::XMVectorLerpV(DirectX::XMLoadFloat4A(&v1), DirectX::XMLoadFloat4A(&v2), DirectX::XMLoadFloat4A(&time));
+
+        DirectX::XMFLOAT4A result_values;
+        DirectX::XMStoreFloat4A(&result_values, result);
+
+        for (size_t lane = 0; lane < lanes; lane++)
+        {
+            if (valid[lane])
+            {
+                output[base + lane] = (&result_values.x)[lane];
+            }
+        }
+    }
+}
+
 ff::value_ptr ff::animation_keys::interpolate(const key_frame& lhs, const key_frame& other, float time, method_t method, const ff::dict* params)
 {
     ff::value_ptr value = lhs.value;
@@ -39,6 +39,27 @@ namespace ff
         static method_t load_method(const ff::dict& dict, bool from_source);
         static bool adjust_frame(float& frame, float start, float length, method_t method);
 
+        // Typed sampling never allocates, it only works when all key values are the same float/point/rect type.
+        // Returns false when there is no value for the frame or the output type doesn't match the keys.
+        size_t component_count() const;
+        bool sample_into(float frame, float& out) const;
+        bool sample_into(float frame, ff::point_float& out) const;
+        bool sample_into(float frame, ff::rect_float& out) const;
+        bool sample_into(float frame, DirectX::XMFLOAT4& out) const;
+
+        // Samples the keys for many entities at once. The output needs component_count() floats for each frame,
+        // and output for a frame without a value is left unchanged.
+        bool sample_batch(std::span<const float> frames, std::span<float> output) const;
+
+        struct batch_track
+        {
+            const ff::animation_keys* keys;
+            std::span<const float> frames;
+            std::span<float> output;
+        };
+
+        static void sample_batch(std::span<const batch_track> tracks);
+
     private:
         struct key_frame
         {
@@ -50,13 +71,29 @@ namespace ff
             ff::value_ptr tangent_value;
         };
 
+        // Key values copied into contiguous arrays, with components floats per key
+        struct typed_track
+        {
+            size_t components{};
+            bool spline{};
+            bool has_default{};
+            std::array<float, 4> default_value{};
+            std::vector<float> frames;
+            std::vector<float> values;
+            std::vector<float> tangents;
+        };
+
         animation_keys();
         bool load_from_cache_internal(const ff::dict& dict);
         bool load_from_source_internal(std::string_view name, const ff::dict& dict, ff::resource_load_context& context);
+        void compile_typed_track();
+        bool sample_components(float frame, float* out, size_t components) const;
+        void sample_batch_1(std::span<const float> frames, std::span<float> output) const;
         static ff::value_ptr interpolate(const key_frame& lhs, const key_frame& other, float time, method_t method, const ff::dict* params);
 
         std::string name_;
         std::vector<key_frame> keys;
+        typed_track track;
         ff::value_ptr default_value;
         float start_;
         float length_;
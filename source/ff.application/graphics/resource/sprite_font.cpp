@@ -11,17 +11,6 @@
 #include "graphics/write/font_file.h"
 #include "graphics/write/write.h"
 
-static bool text_contains_outline_control(std::wstring_view text)
-{
-    static const std::wstring controls =
-    {
-        static_cast<wchar_t>(ff::sprite_font_control::outline_color),
-        static_cast<wchar_t>(ff::sprite_font_control::outline_palette_color),
-    };
-
-    return text.find_first_of(controls) != std::wstring_view::npos;
-}
-
 static std::wstring_view to_wstring(std::string_view text, std::array<wchar_t, 2048>& wtext_array, std::wstring& wtext_string)
 {
     if (!text.empty())
@@ -47,6 +36,7 @@ static std::wstring_view to_wstring(std::string_view text, std::array<wchar_t, 2
 
 ff::sprite_font::sprite_font(const std::shared_ptr<ff::resource>& font_file_resource, float size, int outline_thickness, bool anti_alias)
     : glyphs{}
+    , run_cache(std::make_unique<ff::sprite_font::shaped_run_cache>())
     , font_file_resource(font_file_resource)
     , size(size)
     , outline_thickness(outline_thickness)
@@ -60,17 +50,31 @@ ff::sprite_font::sprite_font(
     bool anti_alias,
     const std::shared_ptr<ff::sprite_list>& sprites,
     const std::shared_ptr<ff::sprite_list>& outline_sprites,
-    const std::shared_ptr<ff::data_base>& glyphs_data)
+    const std::shared_ptr<ff::data_base>& glyphs_data,
+    const std::shared_ptr<ff::data_base>& kerning_data)
     : sprites(sprites)
     , outline_sprites(outline_sprites)
     , glyphs{}
+    , run_cache(std::make_unique<ff::sprite_font::shaped_run_cache>())
     , font_file_resource(font_file_resource)
     , size(size)
     , outline_thickness(outline_thickness)
     , anti_alias(anti_alias)
 {
     assert(glyphs_data && glyphs_data->size() == ff::array_byte_size(this->glyphs));
-    std::memcpy(this->glyphs.data(), glyphs_data->data(), std::min(this->glyphs.size(), glyphs_data->size()));
+    std::memcpy(this->glyphs.data(), glyphs_data->data(), std::min(ff::array_byte_size(this->glyphs), glyphs_data->size()));
+
+    // Caches from before the kerning table existed will build it after the font file loads
+    if (kerning_data && kerning_data->size() % sizeof(ff::sprite_font::kerning_pair) == 0)
+    {
+        this->kerning.resize(kerning_data->size() / sizeof(ff::sprite_font::kerning_pair));
+        if (!this->kerning.empty())
+        {
+            std::memcpy(this->kerning.data(), kerning_data->data(), kerning_data->size());
+        }
+
+        this->kerning_valid = true;
+    }
 }
 
 ff::sprite_font::operator bool() const
@@ -85,54 +89,65 @@ ff::point_float ff::sprite_font::draw_text(
     const ff::color& outline_color,
     ff::sprite_font_options options) const
 {
-    std::array<wchar_t, 2048> wtext_array;
-    std::wstring wtext_string;
-    std::wstring_view wtext = ::to_wstring(text, wtext_array, wtext_string);
-    ff::point_float size{};
+    std::shared_ptr<const ff::sprite_font::shaped_run> run = this->shape_text(text);
+    if (!run || transform.scale.x * transform.scale.y == 0.0f)
+    {
+        return {};
+    }
 
-    if ((outline_color.alpha() > 0 || ::text_contains_outline_control(wtext)) && !ff::flags::has(options, ff::sprite_font_options::no_outline) && this->outline_sprites)
+    if ((outline_color.alpha() > 0 || run->has_outline_control) && !ff::flags::has(options, ff::sprite_font_options::no_outline) && this->outline_sprites)
     {
         ff::transform outline_transform = transform;
         outline_transform.color = outline_color;
-        size = this->internal_draw_text(draw, this->outline_sprites.get(), wtext, outline_transform, options);
+        this->internal_draw_text(draw, this->outline_sprites.get(), *run, outline_transform, options);
     }
 
     if (!ff::flags::has(options, ff::sprite_font_options::no_text))
     {
-        size = this->internal_draw_text(draw, this->sprites.get(), wtext, transform, options);
+        this->internal_draw_text(draw, this->sprites.get(), *run, transform, options);
     }
 
-    return size;
+    return run->size * transform.scale;
 }
 
 ff::point_float ff::sprite_font::measure_text(std::string_view text, ff::point_float scale) const
 {
-    std::array<wchar_t, 2048> wtext_array;
-    std::wstring wtext_string;
-    std::wstring_view wtext = ::to_wstring(text, wtext_array, wtext_string);
-
-    return this->internal_draw_text(nullptr, nullptr, wtext, ff::transform({}, scale), ff::sprite_font_options::no_control);
+    std::shared_ptr<const ff::sprite_font::shaped_run> run = this->shape_text(text);
+    return run ? run->size * scale : ff::point_float{};
 }
 
 float ff::sprite_font::line_spacing() const
 {
-    IDWriteFontFace5* font_face = this->font_file ? this->font_file->font_face() : nullptr;
-    assert(font_face);
+    assert(this->font_file);
+    return this->ascent + this->descent + this->line_gap;
+}
 
-    if (font_face)
+bool ff::sprite_font::resource_load_complete(bool from_source)
+{
+    this->font_file = this->font_file_resource.object();
+    this->init_metrics();
+
+    if (from_source)
     {
-        DWRITE_FONT_METRICS1 fm;
-        font_face->GetMetrics(&fm);
-        return (fm.ascent + fm.descent + fm.lineGap) * this->size / fm.designUnitsPerEm;
+        return this->init_sprites() && this->init_kerning();
     }
 
-    return 0.0f;
+    return this->kerning_valid || this->init_kerning();
 }
 
-bool ff::sprite_font::resource_load_complete(bool from_source)
+void ff::sprite_font::init_metrics()
 {
-    this->font_file = this->font_file_resource.object();
-    return !from_source || this->init_sprites();
+    IDWriteFontFace5* font_face = this->font_file ? this->font_file->font_face() : nullptr;
+    if (font_face)
+    {
+        DWRITE_FONT_METRICS1 fm;
+        font_face->GetMetrics(&fm);
+
+        this->design_unit_size = this->size / fm.designUnitsPerEm;
+        this->ascent = fm.ascent * this->design_unit_size;
+        this->descent = fm.descent * this->design_unit_size;
+        this->line_gap = fm.lineGap * this->design_unit_size;
+    }
 }
 
 bool ff::sprite_font::init_sprites()
@@ -377,111 +392,251 @@ bool ff::sprite_font::init_sprites()
     return true;
 }
 
-ff::point_float ff::sprite_font::internal_draw_text(ff::dxgi::draw_base* draw, const ff::sprite_list* sprites, std::wstring_view text, const ff::transform& transform, ff::sprite_font_options options) const
+bool ff::sprite_font::init_kerning()
 {
     IDWriteFontFace5* font_face = this->font_file ? this->font_file->font_face() : nullptr;
-    if (!font_face || text.empty() || transform.scale.x * transform.scale.y == 0.0f)
+    if (!font_face)
     {
-        return {};
+        return false;
+    }
+
+    this->kerning.clear();
+    this->kerning_valid = true;
+
+    if (!font_face->HasKerningPairs())
+    {
+        return true;
+    }
+
+    std::vector<uint16_t> used_glyphs;
+    for (const ff::sprite_font::char_and_glyph_info& info : this->glyphs)
+    {
+        if (info.char_to_glyph)
+        {
+            used_glyphs.push_back(info.char_to_glyph);
+        }
+    }
+
+    std::sort(used_glyphs.begin(), used_glyphs.end());
+    used_glyphs.erase(std::unique(used_glyphs.begin(), used_glyphs.end()), used_glyphs.end());
+
+    // For each glyph A, ask for the pairs of "A B0 A B1 A B2..." which returns both (A, Bn) and (Bn, A) in one call
+    std::vector<uint16_t> pair_glyphs;
+    std::vector<int> pair_kerns;
+
+    for (size_t i = 0; i < used_glyphs.size(); i++)
+    {
+        const uint16_t first_glyph = used_glyphs[i];
+        pair_glyphs.clear();
+        pair_glyphs.push_back(first_glyph);
+
+        for (size_t h = i; h < used_glyphs.size(); h++)
+        {
+            pair_glyphs.push_back(used_glyphs[h]);
+            pair_glyphs.push_back(first_glyph);
+        }
+
+        pair_kerns.resize(pair_glyphs.size());
+        if (FAILED(font_face->GetKerningPairAdjustments(static_cast<uint32_t>(pair_glyphs.size()), pair_glyphs.data(), pair_kerns.data())))
+        {
+            return false;
+        }
+
+        for (size_t h = 0; h + 1 < pair_glyphs.size(); h++)
+        {
+            if (pair_kerns[h])
+            {
+                uint32_t pair_key = (static_cast<uint32_t>(pair_glyphs[h]) << 16) | pair_glyphs[h + 1];
+                this->kerning.push_back(ff::sprite_font::kerning_pair{ pair_key, static_cast<int32_t>(pair_kerns[h]) });
+            }
+        }
     }
 
-    bool has_kerning = font_face->HasKerningPairs();
-    DWRITE_FONT_METRICS1 fm{};
-    font_face->GetMetrics(&fm);
+    std::sort(this->kerning.begin(), this->kerning.end(), [](const ff::sprite_font::kerning_pair& lhs, const ff::sprite_font::kerning_pair& rhs)
+        {
+            return lhs.glyphs < rhs.glyphs;
+        });
 
-    float design_unit_size = this->size / fm.designUnitsPerEm;
-    ff::point_float scaled_design_unit_size = transform.scale * design_unit_size;
-    ff::transform base_pos = transform;
-    base_pos.position.y += fm.ascent * scaled_design_unit_size.y;
-    ff::point_float max_pos(transform.position.x, transform.position.y + (fm.ascent + fm.descent) * scaled_design_unit_size.y);
-    float line_spacing = (fm.ascent + fm.descent + fm.lineGap) * scaled_design_unit_size.y;
+    // A glyph paired with itself was added twice
+    this->kerning.erase(std::unique(this->kerning.begin(), this->kerning.end(), [](const ff::sprite_font::kerning_pair& lhs, const ff::sprite_font::kerning_pair& rhs)
+        {
+            return lhs.glyphs == rhs.glyphs;
+        }), this->kerning.end());
 
-    if (draw)
+    return true;
+}
+
+int32_t ff::sprite_font::design_kerning(uint16_t first_glyph, uint16_t second_glyph) const
+{
+    const uint32_t pair_key = (static_cast<uint32_t>(first_glyph) << 16) | second_glyph;
+    auto iter = std::lower_bound(this->kerning.cbegin(), this->kerning.cend(), pair_key, [](const ff::sprite_font::kerning_pair& pair, uint32_t key)
+        {
+            return pair.glyphs < key;
+        });
+
+    return (iter != this->kerning.cend() && iter->glyphs == pair_key) ? iter->design_kern : 0;
+}
+
+std::shared_ptr<const ff::sprite_font::shaped_run> ff::sprite_font::shape_text(std::string_view text) const
+{
+    if (!this->font_file || text.empty())
     {
-        draw->push_no_overlap();
+        return {};
     }
 
-    for (const wchar_t* ch = text.data(), *ch_end = ch + text.size(); ch != ch_end; )
+    const size_t text_hash = ff::stable_hash_func(text);
+    if (this->run_cache)
+    {
+        std::scoped_lock lock(this->run_cache->mutex);
+        auto iter = this->run_cache->runs.find(text_hash);
+        if (iter != this->run_cache->runs.end() && iter->second.first->text == text)
+        {
+            iter->second.second = ++this->run_cache->use_counter;
+            return iter->second.first;
+        }
+    }
+
+    std::array<wchar_t, 2048> wtext_array;
+    std::wstring wtext_string;
+    std::wstring_view wtext = ::to_wstring(text, wtext_array, wtext_string);
+
+    auto run = std::make_shared<ff::sprite_font::shaped_run>();
+    run->text = text;
+    run->colors.emplace_back(); // index zero means the transform color
+    run->size = ff::point_float(0, this->ascent + this->descent);
+    run->has_outline_control = false;
+
+    ff::point_float pos(0, this->ascent);
+    uint16_t text_color = 0;
+    uint16_t outline_color = 0;
+    uint16_t prev_glyph = 0;
+
+    for (const wchar_t* ch = wtext.data(), *ch_end = ch + wtext.size(); ch != ch_end; )
     {
         if (*ch == '\r' || *ch == '\n')
         {
             ch += (*ch == '\r' && ch + 1 != ch_end && ch[1] == '\n') ? 2 : 1;
-            base_pos.position = ff::point_float(transform.position.x, base_pos.position.y + line_spacing);
-            max_pos.y += line_spacing;
+            pos = ff::point_float(0, pos.y + this->line_spacing());
+            run->size.y += this->line_spacing();
+            prev_glyph = 0;
             continue;
         }
         else if (*ch >= static_cast<wchar_t>(ff::sprite_font_control::none) && *ch <= static_cast<wchar_t>(ff::sprite_font_control::after_last))
         {
             ff::sprite_font_control control = static_cast<ff::sprite_font_control>(*ch++);
-            ff::color color;
 
             switch (control)
             {
                 case ff::sprite_font_control::outline_color:
                 case ff::sprite_font_control::text_color:
-                    color = ff::color(
+                    run->colors.emplace_back(
                         ((ch != ch_end) ? (int)*ch++ : 0) / 255.0f,
                         ((ch != ch_end) ? (int)*ch++ : 0) / 255.0f,
                         ((ch != ch_end) ? (int)*ch++ : 0) / 255.0f,
                         ((ch != ch_end) ? (int)*ch++ : 0) / 255.0f);
-
-                    if (!ff::flags::has(options, ff::sprite_font_options::no_control))
-                    {
-                        if ((control == ff::sprite_font_control::outline_color && sprites == this->outline_sprites.get()) ||
-                            (control == ff::sprite_font_control::text_color && sprites == this->sprites.get()))
-                        {
-                            base_pos.color = color;
-                        }
-                    }
                     break;
 
                 case ff::sprite_font_control::outline_palette_color:
                 case ff::sprite_font_control::text_palette_color:
-                    color = ff::color((ch != ch_end) ? static_cast<int>(*ch++) : 0);
-
-                    if (!ff::flags::has(options, ff::sprite_font_options::no_control))
-                    {
-                        if ((control == ff::sprite_font_control::outline_palette_color && sprites == this->outline_sprites.get()) ||
-                            (control == ff::sprite_font_control::text_palette_color && sprites == this->sprites.get()))
-                        {
-                            base_pos.color = color;
-                        }
-                    }
+                    run->colors.emplace_back((ch != ch_end) ? static_cast<int>(*ch++) : 0);
                     break;
+
+                default:
+                    continue;
+            }
+
+            const uint16_t color_index = static_cast<uint16_t>(std::min<size_t>(run->colors.size() - 1, 0xFFFF));
+            if (control == ff::sprite_font_control::outline_color || control == ff::sprite_font_control::outline_palette_color)
+            {
+                outline_color = color_index;
+                run->has_outline_control = true;
+            }
+            else
+            {
+                text_color = color_index;
             }
         }
         else
         {
-            const ff::sprite_font::char_and_glyph_info& glyph = this->glyphs[this->glyphs[*ch].char_to_glyph];
+            const uint16_t glyph_index = this->glyphs[*ch].char_to_glyph;
+            const ff::sprite_font::char_and_glyph_info& glyph = this->glyphs[glyph_index];
 
-            if (draw && sprites && glyph.glyph_to_sprite && glyph.glyph_to_sprite < sprites->size())
+            if (prev_glyph && glyph_index)
             {
-                draw->draw_sprite(sprites->get(static_cast<size_t>(glyph.glyph_to_sprite))->sprite_data(), base_pos);
+                pos.x += this->design_kerning(prev_glyph, glyph_index) * this->design_unit_size;
             }
 
-            base_pos.position.x += glyph.glyph_width * base_pos.scale.x;
-            max_pos.x = std::max(max_pos.x, base_pos.position.x);
-
-            if (has_kerning && ch + 1 != ch_end)
+            if (glyph.glyph_to_sprite)
             {
-                uint16_t two_glyphs[2] = { ch[0], ch[1] };
-                int two_design_kerns[2];
-                if (SUCCEEDED(font_face->GetKerningPairAdjustments(2, two_glyphs, two_design_kerns)))
-                {
-                    base_pos.position.x += two_design_kerns[0] * scaled_design_unit_size.x;
-                }
+                run->glyphs.push_back(ff::sprite_font::shaped_glyph{ pos, glyph.glyph_to_sprite, text_color, outline_color });
             }
 
+            pos.x += glyph.glyph_width;
+            run->size.x = std::max(run->size.x, pos.x);
+            prev_glyph = glyph_index;
             ch++;
         }
     }
 
-    if (draw)
+    if (this->run_cache)
     {
-        draw->pop_no_overlap();
+        std::scoped_lock lock(this->run_cache->mutex);
+        auto& runs = this->run_cache->runs;
+
+        if (runs.size() >= ff::sprite_font::MAX_SHAPED_RUN_COUNT && runs.find(text_hash) == runs.end())
+        {
+            // Evict the least recently used quarter at once so that a full cache doesn't scan on every miss
+            std::vector<size_t> uses;
+            uses.reserve(runs.size());
+            for (auto& i : runs)
+            {
+                uses.push_back(i.second.second);
+            }
+
+            auto nth = uses.begin() + ff::sprite_font::MAX_SHAPED_RUN_COUNT / 4;
+            std::nth_element(uses.begin(), nth, uses.end());
+            std::erase_if(runs, [oldest_use = *nth](const auto& i)
+                {
+                    return i.second.second <= oldest_use;
+                });
+        }
+
+        runs.insert_or_assign(text_hash, std::make_pair(run, ++this->run_cache->use_counter));
+    }
+
+    return run;
+}
+
+void ff::sprite_font::internal_draw_text(
+    ff::dxgi::draw_base* draw,
+    const ff::sprite_list* sprites,
+    const ff::sprite_font::shaped_run& run,
+    const ff::transform& transform,
+    ff::sprite_font_options options) const
+{
+    if (!draw || !sprites || run.glyphs.empty())
+    {
+        return;
+    }
+
+    const bool use_colors = !ff::flags::has(options, ff::sprite_font_options::no_control);
+    const bool outline = (sprites == this->outline_sprites.get());
+    ff::transform glyph_transform = transform;
+
+    draw->push_no_overlap();
+
+    for (const ff::sprite_font::shaped_glyph& glyph : run.glyphs)
+    {
+        if (glyph.sprite < sprites->size())
+        {
+            const uint16_t color_index = use_colors ? (outline ? glyph.outline_color : glyph.text_color) : 0;
+            glyph_transform.position = transform.position + glyph.offset * transform.scale;
+            glyph_transform.color = color_index ? run.colors[color_index] : transform.color;
+            draw->draw_sprite(sprites->get(static_cast<size_t>(glyph.sprite))->sprite_data(), glyph_transform);
+        }
     }
 
-    return max_pos - transform.position;
+    draw->pop_no_overlap();
 }
 
 std::vector<std::shared_ptr<ff::resource>> ff::sprite_font::resource_get_dependencies() const
@@ -503,6 +658,7 @@ bool ff::sprite_font::save_to_cache(ff::dict& dict) const
         dict.set<int>("outline", this->outline_thickness);
         dict.set<bool>("aa", this->anti_alias);
         dict.set_bytes("glyphs", this->glyphs.data(), ff::array_byte_size(this->glyphs));
+        dict.set_bytes("kerning", this->kerning.data(), ff::vector_byte_size(this->kerning));
         dict.set<ff::dict>("sprites", std::move(sprites_dict));
         dict.set<ff::dict>("outline_sprites", std::move(outline_sprites_dict));
 
@@ -535,12 +691,13 @@ std::shared_ptr<ff::resource_object_base> ff::internal::sprite_font_factory::loa
     int outline_thickness = dict.get<int>("outline");
     bool anti_alias = dict.get<bool>("aa");
     std::shared_ptr<ff::data_base> glyphs_data = dict.get<ff::data_base>("glyphs");
+    std::shared_ptr<ff::data_base> kerning_data = dict.get<ff::data_base>("kerning");
     std::shared_ptr<ff::sprite_list> sprites = std::dynamic_pointer_cast<ff::sprite_list>(dict.get<ff::resource_object_base>("sprites"));
     std::shared_ptr<ff::sprite_list> outline_sprites = std::dynamic_pointer_cast<ff::sprite_list>(dict.get<ff::resource_object_base>("outline_sprites"));
 
     if (font_file_resource && glyphs_data && sprites)
     {
-        return std::make_shared<ff::sprite_font>(font_file_resource, size, outline_thickness, anti_alias, sprites, outline_sprites, glyphs_data);
+        return std::make_shared<ff::sprite_font>(font_file_resource, size, outline_thickness, anti_alias, sprites, outline_sprites, glyphs_data, kerning_data);
     }
 
     assert(false);
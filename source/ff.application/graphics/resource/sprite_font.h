@@ -1,8 +1,9 @@
 #pragma once
 
+#include "../types/color.h"
+
 namespace ff
 {
-    class color;
     class font_file;
     class sprite_list;
 
@@ -32,7 +33,8 @@ namespace ff
         sprite_font(const std::shared_ptr<ff::resource>& font_file_resource, float size, int outline_thickness, bool anti_alias,
             const std::shared_ptr<ff::sprite_list>& sprites,
             const std::shared_ptr<ff::sprite_list>& outline_sprites,
-            const std::shared_ptr<ff::data_base>& glyphs_data);
+            const std::shared_ptr<ff::data_base>& glyphs_data,
+            const std::shared_ptr<ff::data_base>& kerning_data);
         sprite_font(sprite_font&& other) noexcept = default;
         sprite_font(const sprite_font& other) = delete;
 
@@ -51,10 +53,45 @@ namespace ff
         virtual bool save_to_cache(ff::dict& dict) const override;
 
     private:
+        struct shaped_glyph
+        {
+            ff::point_float offset; // unscaled, from the top-left of the text
+            uint16_t sprite;
+            uint16_t text_color; // index into shaped_run::colors, zero for the transform color
+            uint16_t outline_color;
+        };
+
+        struct shaped_run
+        {
+            std::string text;
+            std::vector<ff::sprite_font::shaped_glyph> glyphs;
+            std::vector<ff::color> colors;
+            ff::point_float size; // unscaled
+            bool has_outline_control;
+        };
+
+        struct shaped_run_cache
+        {
+            std::mutex mutex;
+            std::unordered_map<size_t, std::pair<std::shared_ptr<const ff::sprite_font::shaped_run>, size_t>, ff::no_hash<size_t>> runs; // text hash to run and last use
+            size_t use_counter{};
+        };
+
+        struct kerning_pair
+        {
+            uint32_t glyphs; // first glyph in the high 16 bits
+            int32_t design_kern;
+        };
+
         bool init_sprites();
-        ff::point_float internal_draw_text(ff::dxgi::draw_base* draw, const ff::sprite_list* sprites, std::wstring_view text, const ff::transform& transform, ff::sprite_font_options options) const;
+        bool init_kerning();
+        void init_metrics();
+        int32_t design_kerning(uint16_t first_glyph, uint16_t second_glyph) const;
+        std::shared_ptr<const ff::sprite_font::shaped_run> shape_text(std::string_view text) const;
+        void internal_draw_text(ff::dxgi::draw_base* draw, const ff::sprite_list* sprites, const ff::sprite_font::shaped_run& run, const ff::transform& transform, ff::sprite_font_options options) const;
 
         static const size_t MAX_GLYPH_COUNT = 0x10000;
+        static const size_t MAX_SHAPED_RUN_COUNT = 256;
 
         struct char_and_glyph_info
         {
@@ -66,12 +103,21 @@ namespace ff
         std::shared_ptr<ff::sprite_list> sprites;
         std::shared_ptr<ff::sprite_list> outline_sprites;
         std::array<char_and_glyph_info, ff::sprite_font::MAX_GLYPH_COUNT> glyphs;
+        std::vector<ff::sprite_font::kerning_pair> kerning; // sorted by glyphs
+        std::unique_ptr<ff::sprite_font::shaped_run_cache> run_cache;
 
         ff::auto_resource<ff::font_file> font_file_resource;
         std::shared_ptr<ff::font_file> font_file;
         float size;
         int outline_thickness;
         bool anti_alias;
+        bool kerning_valid{};
+
+        // From the font face, in unscaled pixels
+        float ascent{};
+        float descent{};
+        float line_gap{};
+        float design_unit_size{};
     };
 }
 
@@ -1,10 +1,12 @@
 #include "pch.h"
+#include "graphics/dxgi/dxgi_globals.h"
 #include "graphics/dxgi/sprite_data.h"
 #include "graphics/dxgi/format_util.h"
 #include "graphics/resource/sprite_base.h"
 #include "graphics/resource/sprite_list.h"
 #include "graphics/resource/sprite_optimizer.h"
 #include "graphics/resource/sprite_resource.h"
+#include "graphics/resource/texture_data.h"
 #include "graphics/resource/texture_resource.h"
 
 ff::sprite_list::sprite_list(std::vector<ff::sprite>&& sprites)
@@ -109,6 +111,23 @@ bool ff::sprite_list::save_to_cache(ff::dict& dict) const
     return true;
 }
 
+static bool parse_optimizer_options(const ff::dict& dict, ff::internal::sprite_optimizer_options& options)
+{
+    static const std::array<std::string_view, 3> packer_names{ "grid", "max_rects", "skyline" };
+    static const std::array<std::string_view, 4> heuristic_names{ "best_short_side_fit", "best_long_side_fit", "best_area_fit", "bottom_left" };
+
+    std::string packer = dict.get<std::string>("packer", std::string(packer_names[0]));
+    std::string heuristic = dict.get<std::string>("packer_heuristic", std::string(heuristic_names[0]));
+    auto packer_iter = std::find(packer_names.cbegin(), packer_names.cend(), packer);
+    auto heuristic_iter = std::find(heuristic_names.cbegin(), heuristic_names.cend(), heuristic);
+    check_ret_val(packer_iter != packer_names.cend() && heuristic_iter != heuristic_names.cend(), false);
+
+    options.packer = static_cast<ff::internal::sprite_packer>(packer_iter - packer_names.cbegin());
+    options.heuristic = static_cast<ff::internal::sprite_pack_heuristic>(heuristic_iter - heuristic_names.cbegin());
+    options.max_texture_size = dict.get<size_t>("max_texture_size", options.max_texture_size);
+    return true;
+}
+
 std::shared_ptr<ff::resource_object_base> ff::internal::sprite_list_factory::load_from_source(const ff::dict& dict, resource_load_context& context) const
 {
     bool optimize = dict.get<bool>("optimize", true);
@@ -132,11 +151,62 @@ std::shared_ptr<ff::resource_object_base> ff::internal::sprite_list_factory::loa
         return {};
     }
 
+    ff::internal::sprite_optimizer_options optimizer_options;
+    if (optimize && !::parse_optimizer_options(dict, optimizer_options))
+    {
+        context.add_error("Invalid packer or packer_heuristic");
+        return {};
+    }
+
     ff::dict sprites_dict = dict.get<ff::dict>("sprites");
     std::unordered_map<std::wstring, std::shared_ptr<ff::texture>> texture_views;
     std::vector<ff::sprite> sprites;
     std::vector<std::string_view> child_names = sprites_dict.child_names(true);
 
+    // Decode and convert all unique texture files in parallel, GPU textures get created afterwards on this thread
+    {
+        const DXGI_FORMAT texture_format = (optimize && ff::dxgi::color_format(format)) ? DXGI_FORMAT_R8G8B8A8_UNORM : format;
+        const size_t texture_mip_count = optimize ? 1 : mip_count;
+        std::vector<std::filesystem::path> files;
+
+        for (std::string_view child_name : child_names)
+        {
+            std::filesystem::path full_file = sprites_dict.get<ff::dict>(child_name).get<std::string>("file");
+            if (std::find(files.cbegin(), files.cend(), full_file) == files.cend())
+            {
+                files.push_back(std::move(full_file));
+            }
+        }
+
+        std::vector<std::shared_ptr<DirectX::ScratchImage>> datas(files.size());
+        std::vector<std::shared_ptr<DirectX::ScratchImage>> palettes(files.size());
+
+        ff::thread_pool::parallel_for(0, files.size(), [&](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; i++)
+                {
+                    datas[i] = ff::internal::load_texture_data(files[i], texture_format, texture_mip_count, palettes[i]);
+                }
+            }, 1);
+
+        for (size_t i = 0; i < files.size(); i++)
+        {
+            std::shared_ptr<ff::texture> texture = datas[i]
+                ? std::make_shared<ff::texture>(ff::dxgi::create_static_texture(datas[i], ff::dxgi::sprite_type::unknown), palettes[i])
+                : nullptr;
+
+            if (!texture || !*texture)
+            {
+                std::ostringstream str;
+                str << "Failed to load texture file: " << files[i];
+                context.add_error(str.str());
+                return nullptr;
+            }
+
+            texture_views.try_emplace(std::wstring(files[i].native()), std::move(texture));
+        }
+    }
+
     for (std::string_view child_name : child_names)
     {
         ff::dict sprite_dict = sprites_dict.get<ff::dict>(child_name);
@@ -161,29 +231,9 @@ std::shared_ptr<ff::resource_object_base> ff::internal::sprite_list_factory::loa
         ff::point_float scale = sprite_dict.get<ff::point_float>("scale", ff::point_float(1, 1));
         size_t repeat = sprite_dict.get<size_t>("repeat", 1);
 
-        std::shared_ptr<ff::texture> texture_view;
         auto iter = texture_views.find(full_file.native());
-        if (iter != texture_views.cend())
-        {
-            texture_view = iter->second;
-        }
-        else
-        {
-            std::shared_ptr<ff::texture> texture = std::make_shared<ff::texture>(full_file,
-                (optimize && ff::dxgi::color_format(format)) ? DXGI_FORMAT_R8G8B8A8_UNORM : format,
-                optimize ? 1 : mip_count);
-
-            if (!*texture)
-            {
-                std::ostringstream str;
-                str << "Failed to load texture file: " << full_file;
-                context.add_error(str.str());
-                return nullptr;
-            }
-
-            texture_view = texture;
-            texture_views.try_emplace(std::wstring(full_file.native()), texture_view);
-        }
+        assert_ret_val(iter != texture_views.cend(), nullptr);
+        const std::shared_ptr<ff::texture>& texture_view = iter->second;
 
         if (size == ff::point_float{} && handle == ff::point_float{})
         {
@@ -213,12 +263,16 @@ std::shared_ptr<ff::resource_object_base> ff::internal::sprite_list_factory::loa
 
     if (optimize)
     {
-        std::vector<ff::sprite> new_sprites = ff::internal::optimize_sprites(sprites, format, mip_count);
+        ff::internal::sprite_optimizer_stats stats{};
+        std::vector<ff::sprite> new_sprites = ff::internal::optimize_sprites(sprites, format, mip_count, optimizer_options, &stats);
         if (new_sprites.size() != sprites.size())
         {
             debug_fail_ret_val(nullptr);
         }
 
+        ff::log::write(ff::log::type::resource_load, "Optimized ", sprites.size(), " sprites into ", stats.texture_count,
+            " textures, ", static_cast<int>(stats.fill_ratio() * 100), "% filled");
+
         std::swap(sprites, new_sprites);
     }
 
@@ -7,7 +7,6 @@
 #include "graphics/resource/texture_data.h"
 #include "graphics/resource/texture_resource.h"
 
-static const int TEXTURE_SIZE_MAX = 1024;
 static const int TEXTURE_SIZE_MIN = 128;
 static const int TEXTURE_GRID_SIZE = 8;
 
@@ -23,6 +22,7 @@ namespace
             , dest_rect{}
             , sprite_index(sprite_index)
             , dest_texture(ff::constants::invalid_unsigned<size_t>())
+            , reused_dest(false)
         {}
 
         optimized_sprite_info(optimized_sprite_info&& other) noexcept = default;
@@ -64,6 +64,7 @@ namespace
         ff::rect_int dest_rect;
         size_t sprite_index;
         size_t dest_texture;
+        bool reused_dest; // same pixels as another sprite, so they only get copied once
     };
 
     // Cached RGBA original texture
@@ -73,25 +74,31 @@ namespace
         std::shared_ptr<DirectX::ScratchImage> rgb_scratch;
     };
 
-    // Destination texture RGBA (_texture) and final converted texture (_finalTexture)
-    struct optimized_texture_info
+    // Decides where sprites go within one texture
+    class texture_packer
     {
-        optimized_texture_info(ff::point_int size)
+    public:
+        virtual ~texture_packer() = default;
+
+        // Returns an empty rect when there is no room
+        virtual ff::rect_int find_placement(ff::point_int placement_size) = 0;
+        virtual bool place_rect(ff::rect_int rect) = 0;
+    };
+
+    // Original packer, fills rows of 8x8 pixel cells from the left or right side
+    class grid_packer : public ::texture_packer
+    {
+    public:
+        grid_packer(ff::point_int size)
             : size(size)
-            , row_left{}
-            , row_right{}
+            , row_left(static_cast<size_t>(size.y / ::TEXTURE_GRID_SIZE))
+            , row_right(static_cast<size_t>(size.y / ::TEXTURE_GRID_SIZE))
         {
-            // Column indexes must fit within a byte (even one beyond the last column)
-            assert(::TEXTURE_SIZE_MAX / ::TEXTURE_GRID_SIZE < 256 && this->row_left.size() == this->row_right.size());
+            // Column indexes must fit within 16 bits (even one beyond the last column)
+            assert(size.x / ::TEXTURE_GRID_SIZE < 0xFFFF);
         }
 
-        optimized_texture_info(const optimized_texture_info& other) = default;
-        optimized_texture_info(optimized_texture_info&& other) noexcept = default;
-
-        optimized_texture_info& operator=(const optimized_texture_info& other) = default;
-        optimized_texture_info& operator=(optimized_texture_info&& other) noexcept = default;
-
-        ff::rect_int find_placement(ff::point_int placement_size)
+        virtual ff::rect_int find_placement(ff::point_int placement_size) override
         {
             ff::point_int dest_pos(-1, -1);
 
@@ -181,7 +188,7 @@ namespace
                 : ff::rect_int(dest_pos.x, dest_pos.y, dest_pos.x + placement_size.x, dest_pos.y + placement_size.y);
         }
 
-        bool place_rect(ff::rect_int rect)
+        virtual bool place_rect(ff::rect_int rect) override
         {
             ff::rect_int rect_cells(
                 rect.left / ::TEXTURE_GRID_SIZE,
@@ -239,13 +246,13 @@ namespace
                 {
                     if (this->row_right[y])
                     {
-                        this->row_left[y] = std::min<BYTE>(this->row_left[y], rect_cells.left);
-                        this->row_right[y] = std::max<BYTE>(this->row_right[y], rect_cells.right);
+                        this->row_left[y] = std::min<uint16_t>(this->row_left[y], rect_cells.left);
+                        this->row_right[y] = std::max<uint16_t>(this->row_right[y], rect_cells.right);
                     }
                     else
                     {
-                        this->row_left[y] = rect_cells.left;
-                        this->row_right[y] = rect_cells.right;
+                        this->row_left[y] = static_cast<uint16_t>(rect_cells.left);
+                        this->row_right[y] = static_cast<uint16_t>(rect_cells.right);
                     }
                 }
             }
@@ -253,19 +260,283 @@ namespace
             return true;
         }
 
+    private:
         ff::point_int size;
-        DirectX::ScratchImage scratch_texture;
-        std::shared_ptr<ff::texture> final_texture;
+        std::vector<uint16_t> row_left;
+        std::vector<uint16_t> row_right;
+    };
+
+    // Keeps a list of maximal free rectangles, see "A Thousand Ways to Pack the Bin" by Jukka Jylanki
+    class max_rects_packer : public ::texture_packer
+    {
+    public:
+        max_rects_packer(ff::point_int size, ff::internal::sprite_pack_heuristic heuristic)
+            : heuristic(heuristic)
+            , free_rects{ ff::rect_int(ff::point_int{}, size) }
+        {}
+
+        virtual ff::rect_int find_placement(ff::point_int placement_size) override
+        {
+            ff::rect_int best_rect{};
+            std::pair<int, int> best_score(std::numeric_limits<int>::max(), std::numeric_limits<int>::max());
+
+            for (const ff::rect_int& free_rect : this->free_rects)
+            {
+                const int leftover_x = free_rect.width() - placement_size.x;
+                const int leftover_y = free_rect.height() - placement_size.y;
+
+                if (leftover_x >= 0 && leftover_y >= 0)
+                {
+                    const std::pair<int, int> score = this->score(free_rect, placement_size, leftover_x, leftover_y);
+                    if (score < best_score)
+                    {
+                        best_score = score;
+                        best_rect = ff::rect_int(free_rect.top_left(), free_rect.top_left() + placement_size);
+                    }
+                }
+            }
+
+            return best_rect;
+        }
+
+        virtual bool place_rect(ff::rect_int rect) override
+        {
+            // Replace every free rect that overlaps the new rect with the parts that are still free
+            this->split_rects.clear();
+
+            std::erase_if(this->free_rects, [this, &rect](const ff::rect_int& free_rect)
+                {
+                    if (!free_rect.intersects(rect))
+                    {
+                        return false;
+                    }
+
+                    if (rect.left > free_rect.left)
+                    {
+                        this->split_rects.emplace_back(free_rect.left, free_rect.top, rect.left, free_rect.bottom);
+                    }
+
+                    if (rect.right < free_rect.right)
+                    {
+                        this->split_rects.emplace_back(rect.right, free_rect.top, free_rect.right, free_rect.bottom);
+                    }
+
+                    if (rect.top > free_rect.top)
+                    {
+                        this->split_rects.emplace_back(free_rect.left, free_rect.top, free_rect.right, rect.top);
+                    }
+
+                    if (rect.bottom < free_rect.bottom)
+                    {
+                        this->split_rects.emplace_back(free_rect.left, rect.bottom, free_rect.right, free_rect.bottom);
+                    }
+
+                    return true;
+                });
+
+            // Only keep maximal rects, the new ones can only contain or be contained by another rect
+            for (size_t i = 0; i < this->split_rects.size(); i++)
+            {
+                const ff::rect_int& split_rect = this->split_rects[i];
+                bool contained = std::any_of(this->free_rects.cbegin(), this->free_rects.cend(), [&split_rect](const ff::rect_int& free_rect)
+                    {
+                        return split_rect.inside(free_rect);
+                    });
+
+                for (size_t h = 0; !contained && h < this->split_rects.size(); h++)
+                {
+                    // When two rects are equal, only the first one is kept
+                    contained = (h != i) && split_rect.inside(this->split_rects[h]) && (h < i || !this->split_rects[h].inside(split_rect));
+                }
+
+                if (!contained)
+                {
+                    std::erase_if(this->free_rects, [&split_rect](const ff::rect_int& free_rect)
+                        {
+                            return free_rect.inside(split_rect);
+                        });
+
+                    this->free_rects.push_back(split_rect);
+                }
+            }
+
+            return true;
+        }
 
     private:
-        std::array<uint8_t, ::TEXTURE_SIZE_MAX / ::TEXTURE_GRID_SIZE> row_left;
-        std::array<uint8_t, ::TEXTURE_SIZE_MAX / ::TEXTURE_GRID_SIZE> row_right;
+        std::pair<int, int> score(const ff::rect_int& free_rect, ff::point_int placement_size, int leftover_x, int leftover_y) const
+        {
+            const int short_side = std::min(leftover_x, leftover_y);
+            const int long_side = std::max(leftover_x, leftover_y);
+
+            switch (this->heuristic)
+            {
+                default:
+                case ff::internal::sprite_pack_heuristic::best_short_side_fit:
+                    return { short_side, long_side };
+
+                case ff::internal::sprite_pack_heuristic::best_long_side_fit:
+                    return { long_side, short_side };
+
+                case ff::internal::sprite_pack_heuristic::best_area_fit:
+                    return { free_rect.width() * free_rect.height() - placement_size.x * placement_size.y, short_side };
+
+                case ff::internal::sprite_pack_heuristic::bottom_left:
+                    return { free_rect.top + placement_size.y, free_rect.left };
+            }
+        }
+
+        ff::internal::sprite_pack_heuristic heuristic;
+        std::vector<ff::rect_int> free_rects;
+        std::vector<ff::rect_int> split_rects;
+    };
+
+    // Tracks the top edge of the placed sprites, faster than max_rects but leaves gaps below overhangs
+    class skyline_packer : public ::texture_packer
+    {
+    public:
+        skyline_packer(ff::point_int size)
+            : size(size)
+            , segments{ ::skyline_packer::segment{ 0, 0, size.x } }
+        {}
+
+        virtual ff::rect_int find_placement(ff::point_int placement_size) override
+        {
+            ff::rect_int best_rect{};
+            std::pair<int, int> best_score(std::numeric_limits<int>::max(), std::numeric_limits<int>::max());
+
+            for (size_t i = 0; i < this->segments.size(); i++)
+            {
+                const int x = this->segments[i].x;
+                if (x + placement_size.x > this->size.x)
+                {
+                    break;
+                }
+
+                // The sprite rests on the highest segment below it
+                int y = 0;
+                for (size_t h = i; h < this->segments.size() && this->segments[h].x < x + placement_size.x; h++)
+                {
+                    y = std::max(y, this->segments[h].y);
+                }
+
+                // Lowest bottom edge wins, then the narrowest segment to leave less of a gap
+                const std::pair<int, int> score(y + placement_size.y, this->segments[i].width);
+                if (y + placement_size.y <= this->size.y && score < best_score)
+                {
+                    best_score = score;
+                    best_rect = ff::rect_int(x, y, x + placement_size.x, y + placement_size.y);
+                }
+            }
+
+            return best_rect;
+        }
+
+        virtual bool place_rect(ff::rect_int rect) override
+        {
+            auto iter = std::find_if(this->segments.begin(), this->segments.end(), [&rect](const ::skyline_packer::segment& segment)
+                {
+                    return segment.x + segment.width > rect.left;
+                });
+
+            assert_ret_val(iter != this->segments.end(), false);
+
+            if (iter->x < rect.left)
+            {
+                // Split the segment that the rect starts in
+                ::skyline_packer::segment left_part{ iter->x, iter->y, rect.left - iter->x };
+                iter->width -= left_part.width;
+                iter->x = rect.left;
+                iter = this->segments.insert(iter, left_part) + 1;
+            }
+
+            // Remove or shorten the segments that are covered by the rect
+            iter = this->segments.insert(iter, ::skyline_packer::segment{ rect.left, rect.bottom, rect.width() }) + 1;
+            while (iter != this->segments.end() && iter->x < rect.right)
+            {
+                if (iter->x + iter->width <= rect.right)
+                {
+                    iter = this->segments.erase(iter);
+                }
+                else
+                {
+                    iter->width -= rect.right - iter->x;
+                    iter->x = rect.right;
+                    break;
+                }
+            }
+
+            // Merge neighbors at the same height
+            for (size_t i = 1; i < this->segments.size(); )
+            {
+                if (this->segments[i - 1].y == this->segments[i].y)
+                {
+                    this->segments[i - 1].width += this->segments[i].width;
+                    this->segments.erase(this->segments.begin() + i);
+                }
+                else
+                {
+                    i++;
+                }
+            }
+
+            return true;
+        }
+
+    private:
+        struct segment
+        {
+            int x;
+            int y;
+            int width;
+        };
+
+        ff::point_int size;
+        std::vector<::skyline_packer::segment> segments;
+    };
+
+    // Destination texture RGBA (scratch_texture) and final converted texture (final_texture)
+    struct optimized_texture_info
+    {
+        optimized_texture_info(ff::point_int size, const ff::internal::sprite_optimizer_options* options)
+            : size(size)
+        {
+            // Oversized textures only hold one sprite, so they don't need a packer
+            if (options)
+            {
+                switch (options->packer)
+                {
+                    default:
+                    case ff::internal::sprite_packer::grid:
+                        this->packer = std::make_unique<::grid_packer>(size);
+                        break;
+
+                    case ff::internal::sprite_packer::max_rects:
+                        this->packer = std::make_unique<::max_rects_packer>(size, options->heuristic);
+                        break;
+
+                    case ff::internal::sprite_packer::skyline:
+                        this->packer = std::make_unique<::skyline_packer>(size);
+                        break;
+                }
+            }
+        }
+
+        optimized_texture_info(optimized_texture_info&& other) noexcept = default;
+        optimized_texture_info& operator=(optimized_texture_info&& other) noexcept = default;
+
+        ff::point_int size;
+        std::unique_ptr<::texture_packer> packer;
+        DirectX::ScratchImage scratch_texture;
+        std::shared_ptr<ff::texture> final_texture;
     };
 }
 
 // Returns true when all done (sprites will still be placed when false is returned)
-static bool place_sprites(std::vector<::optimized_sprite_info>& sprites, std::vector<optimized_texture_info>& texture_infos, size_t start_texture)
+static bool place_sprites(std::vector<::optimized_sprite_info>& sprites, std::vector<optimized_texture_info>& texture_infos, size_t start_texture, const ff::internal::sprite_optimizer_options& options)
 {
+    const int texture_size_max = static_cast<int>(options.max_texture_size);
+
     size_t sprites_done = 0;
 
     for (size_t i = 0; i < sprites.size(); i++)
@@ -277,13 +548,14 @@ static bool place_sprites(std::vector<::optimized_sprite_info>& sprites, std::ve
         {
             sprite.dest_texture = sprites[i - 1].dest_texture;
             sprite.dest_rect = sprites[i - 1].dest_rect;
+            sprite.reused_dest = true;
         }
         else
         {
             if (sprite.dest_texture == ff::constants::invalid_unsigned<size_t>())
             {
-                if (sprite.source_rect.width() > ::TEXTURE_SIZE_MAX ||
-                    sprite.source_rect.height() > ::TEXTURE_SIZE_MAX)
+                if (sprite.source_rect.width() > texture_size_max ||
+                    sprite.source_rect.height() > texture_size_max)
                 {
                     ff::point_int size = sprite.source_rect.size();
 
@@ -295,7 +567,7 @@ static bool place_sprites(std::vector<::optimized_sprite_info>& sprites, std::ve
                     size.x = ff::math::nearest_power_of_two(size.x);
                     size.y = ff::math::nearest_power_of_two(size.y);
 
-                    texture_infos.emplace_back(size);
+                    texture_infos.emplace_back(size, nullptr);
                 }
             }
 
@@ -306,14 +578,13 @@ static bool place_sprites(std::vector<::optimized_sprite_info>& sprites, std::ve
                 {
                     ::optimized_texture_info& texture = texture_infos[h];
 
-                    if (texture.size.x <= ::TEXTURE_SIZE_MAX &&
-                        texture.size.y <= ::TEXTURE_SIZE_MAX)
+                    if (texture.packer)
                     {
-                        sprite.dest_rect = texture.find_placement(sprite.source_rect.size());
+                        sprite.dest_rect = texture.packer->find_placement(sprite.source_rect.size());
 
                         if (sprite.dest_rect != ff::rect_int{})
                         {
-                            bool success = texture.place_rect(sprite.dest_rect);
+                            bool success = texture.packer->place_rect(sprite.dest_rect);
                             assert(success);
                             sprite.dest_texture = h;
                             break;
@@ -390,19 +661,21 @@ static bool create_original_textures(
     return true;
 }
 
-static bool compute_optimized_sprites(std::vector<::optimized_sprite_info>& sprites, std::vector<::optimized_texture_info>& texture_infos)
+static bool compute_optimized_sprites(std::vector<::optimized_sprite_info>& sprites, std::vector<::optimized_texture_info>& texture_infos, const ff::internal::sprite_optimizer_options& options)
 {
+    const int texture_size_max = static_cast<int>(options.max_texture_size);
+
     for (bool done = false; !done && sprites.size(); )
     {
         // Add a new texture, start with the smallest size and work up
-        for (ff::point_int size(::TEXTURE_SIZE_MIN, ::TEXTURE_SIZE_MIN); !done && size.x <= ::TEXTURE_SIZE_MAX; size *= 2)
+        for (ff::point_int size(::TEXTURE_SIZE_MIN, ::TEXTURE_SIZE_MIN); !done && size.x <= texture_size_max; size *= 2)
         {
             size_t texture_info = texture_infos.size();
-            texture_infos.emplace_back(size);
+            texture_infos.emplace_back(size, &options);
 
-            done = ::place_sprites(sprites, texture_infos, texture_infos.size() - 1);
+            done = ::place_sprites(sprites, texture_infos, texture_infos.size() - 1, options);
 
-            if (!done && size.x < ::TEXTURE_SIZE_MAX)
+            if (!done && size.x < texture_size_max)
             {
                 // Remove this texture and use a bigger one instead
                 texture_infos.pop_back();
@@ -447,23 +720,23 @@ static bool create_optimized_textures(DXGI_FORMAT format, std::vector<::optimize
     return true;
 }
 
-static bool copy_optimized_sprites(
-    std::vector<::optimized_sprite_info>& sprite_infos,
-    std::unordered_map<const ff::texture*, ::original_texture_info>& original_textures,
+static bool copy_optimized_sprite(
+    ::optimized_sprite_info& sprite,
+    const std::unordered_map<const ff::texture*, ::original_texture_info>& original_textures,
     std::vector<::optimized_texture_info>& texture_infos)
 {
-    for (::optimized_sprite_info& sprite : sprite_infos)
+    auto iter = original_textures.find(sprite.sprite->texture().get());
+    if (sprite.dest_texture >= texture_infos.size() || iter == original_textures.cend())
     {
-        auto iter = original_textures.find(sprite.sprite->texture().get());
-        if (sprite.dest_texture >= texture_infos.size() || iter == original_textures.cend())
-        {
-            debug_fail_ret_val(false);
-        }
+        debug_fail_ret_val(false);
+    }
 
-        ::original_texture_info& original_info = iter->second;
-        ff::rect_size source_size = sprite.source_rect.cast<size_t>();
-        sprite.dest_sprite_type = ff::dxgi::get_sprite_type(*original_info.rgb_scratch, &source_size);
+    const ::original_texture_info& original_info = iter->second;
+    ff::rect_size source_size = sprite.source_rect.cast<size_t>();
+    sprite.dest_sprite_type = ff::dxgi::get_sprite_type(*original_info.rgb_scratch, &source_size);
 
+    if (!sprite.reused_dest)
+    {
         bool status = SUCCEEDED(DirectX::CopyRectangle(
             *original_info.rgb_scratch->GetImages(),
             DirectX::Rect(
@@ -481,20 +754,64 @@ static bool copy_optimized_sprites(
     return true;
 }
 
+static bool copy_optimized_sprites(
+    std::vector<::optimized_sprite_info>& sprite_infos,
+    const std::unordered_map<const ff::texture*, ::original_texture_info>& original_textures,
+    std::vector<::optimized_texture_info>& texture_infos,
+    bool parallel)
+{
+    if (!parallel)
+    {
+        for (::optimized_sprite_info& sprite : sprite_infos)
+        {
+            if (!::copy_optimized_sprite(sprite, original_textures, texture_infos))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Each sprite writes to its own dest rect, duplicate sprites don't write at all
+    std::atomic_bool status = true;
+    ff::thread_pool::parallel_for(0, sprite_infos.size(), [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                if (!::copy_optimized_sprite(sprite_infos[i], original_textures, texture_infos))
+                {
+                    status = false;
+                }
+            }
+        });
+
+    return status;
+}
+
 static bool convert_final_textures(
     DXGI_FORMAT format,
     size_t mip_count,
     std::vector<::optimized_texture_info>& texture_infos,
     const std::shared_ptr<DirectX::ScratchImage>& palette_scratch)
 {
-    for (::optimized_texture_info& texure_info : texture_infos)
+    // Mips and block compression of each texture run in parallel, GPU textures get created afterwards on this thread
+    std::vector<std::shared_ptr<DirectX::ScratchImage>> final_scratches(texture_infos.size());
+    ff::thread_pool::parallel_for(0, texture_infos.size(), [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                auto shared_scratch = std::make_shared<DirectX::ScratchImage>(std::move(texture_infos[i].scratch_texture));
+                final_scratches[i] = ff::internal::convert_texture_data(shared_scratch, format, mip_count);
+            }
+        }, 1);
+
+    for (size_t i = 0; i < texture_infos.size(); i++)
     {
-        auto shared_scratch = std::make_shared<DirectX::ScratchImage>(std::move(texure_info.scratch_texture));
-        auto dxgi_texture = ff::dxgi::create_static_texture(shared_scratch, ff::dxgi::sprite_type::unknown);
-        std::shared_ptr<ff::texture> rgb_texture = std::make_shared<ff::texture>(dxgi_texture);
-        texure_info.final_texture = std::make_shared<ff::texture>(*rgb_texture, format, mip_count);
+        assert_ret_val(final_scratches[i], false);
+        texture_infos[i].final_texture = std::make_shared<ff::texture>(ff::dxgi::create_static_texture(final_scratches[i], ff::dxgi::sprite_type::unknown));
 
-        if (!*texure_info.final_texture)
+        if (!*texture_infos[i].final_texture)
         {
             debug_fail_ret_val(false);
         }
@@ -524,7 +841,40 @@ static bool create_final_sprites(
     return true;
 }
 
-std::vector<ff::sprite> ff::internal::optimize_sprites(const std::vector<ff::sprite>& old_sprites, DXGI_FORMAT new_format, size_t new_mip_count)
+static void update_optimizer_stats(
+    const std::vector<::optimized_sprite_info>& sprite_infos,
+    const std::vector<::optimized_texture_info>& texture_infos,
+    ff::internal::sprite_optimizer_stats& stats)
+{
+    stats.texture_count = texture_infos.size();
+    stats.sprite_pixels = 0;
+    stats.texture_pixels = 0;
+
+    for (const ::optimized_sprite_info& sprite : sprite_infos)
+    {
+        if (!sprite.reused_dest)
+        {
+            stats.sprite_pixels += static_cast<size_t>(sprite.dest_rect.area());
+        }
+    }
+
+    for (const ::optimized_texture_info& texture : texture_infos)
+    {
+        stats.texture_pixels += static_cast<size_t>(texture.size.x) * static_cast<size_t>(texture.size.y);
+    }
+}
+
+double ff::internal::sprite_optimizer_stats::fill_ratio() const
+{
+    return this->texture_pixels ? static_cast<double>(this->sprite_pixels) / static_cast<double>(this->texture_pixels) : 0.0;
+}
+
+std::vector<ff::sprite> ff::internal::optimize_sprites(
+    const std::vector<ff::sprite>& old_sprites,
+    DXGI_FORMAT new_format,
+    size_t new_mip_count,
+    const ff::internal::sprite_optimizer_options& options,
+    ff::internal::sprite_optimizer_stats* stats)
 {
     std::vector<ff::sprite> new_sprites;
 
@@ -534,16 +884,39 @@ std::vector<ff::sprite> ff::internal::optimize_sprites(const std::vector<ff::spr
         return new_sprites;
     }
 
+    // Texture sizes must be powers of two, which also keeps the size loop in compute_optimized_sprites from getting stuck
+    ff::internal::sprite_optimizer_options options2 = options;
+    options2.max_texture_size = ::TEXTURE_SIZE_MIN;
+    while (options2.max_texture_size * 2 <= std::min<size_t>(options.max_texture_size, D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION))
+    {
+        options2.max_texture_size *= 2;
+    }
+
     std::vector<::optimized_sprite_info> sprite_infos = ::create_sprite_infos(old_sprites);
     std::sort(sprite_infos.begin(), sprite_infos.end());
 
     std::unordered_map<const ff::texture*, ::original_texture_info> original_textures;
     std::shared_ptr<DirectX::ScratchImage> scratch_palette;
     std::vector<::optimized_texture_info> texture_infos;
+    ff::timer timer;
+
+    if (!::create_original_textures(new_format, sprite_infos, original_textures, scratch_palette))
+    {
+        assert(false);
+        return new_sprites;
+    }
 
-    if (!::create_original_textures(new_format, sprite_infos, original_textures, scratch_palette) ||
-        !::compute_optimized_sprites(sprite_infos, texture_infos) ||
-        !::create_optimized_textures(new_format, texture_infos))
+    timer.tick();
+
+    if (!::compute_optimized_sprites(sprite_infos, texture_infos, options2))
+    {
+        assert(false);
+        return new_sprites;
+    }
+
+    const double pack_seconds = timer.tick();
+
+    if (!::create_optimized_textures(new_format, texture_infos))
     {
         assert(false);
         return new_sprites;
@@ -555,7 +928,18 @@ std::vector<ff::sprite> ff::internal::optimize_sprites(const std::vector<ff::spr
             return info1.sprite_index < info2.sprite_index;
         });
 
-    if (!::copy_optimized_sprites(sprite_infos, original_textures, texture_infos) ||
+    timer.tick();
+    bool copied = ::copy_optimized_sprites(sprite_infos, original_textures, texture_infos, options2.parallel_copy);
+    const double copy_seconds = timer.tick();
+
+    if (stats)
+    {
+        ::update_optimizer_stats(sprite_infos, texture_infos, *stats);
+        stats->pack_seconds = pack_seconds;
+        stats->copy_seconds = copy_seconds;
+    }
+
+    if (!copied ||
         !::convert_final_textures(new_format, new_mip_count, texture_infos, scratch_palette) ||
         !::create_final_sprites(sprite_infos, texture_infos, new_sprites))
     {
@@ -669,7 +1053,11 @@ static bool create_outline_sprites(
     return true;
 }
 
-std::vector<ff::sprite> ff::internal::outline_sprites(const std::vector<ff::sprite>& old_sprites, DXGI_FORMAT new_format, size_t new_mip_count)
+std::vector<ff::sprite> ff::internal::outline_sprites(
+    const std::vector<ff::sprite>& old_sprites,
+    DXGI_FORMAT new_format,
+    size_t new_mip_count,
+    const ff::internal::sprite_optimizer_options& options)
 {
     std::vector<ff::sprite> new_sprites;
 
@@ -690,5 +1078,5 @@ std::vector<ff::sprite> ff::internal::outline_sprites(const std::vector<ff::spri
         debug_fail_ret_val(new_sprites);
     }
 
-    return ff::internal::optimize_sprites(new_sprites, new_format, new_mip_count);
+    return ff::internal::optimize_sprites(new_sprites, new_format, new_mip_count, options);
 }
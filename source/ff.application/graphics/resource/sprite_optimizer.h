@@ -4,6 +4,51 @@
 
 namespace ff::internal
 {
-    std::vector<ff::sprite> optimize_sprites(const std::vector<ff::sprite>& old_sprites, DXGI_FORMAT new_format, size_t new_mip_count);
-    std::vector<ff::sprite> outline_sprites(const std::vector<ff::sprite>& old_sprites, DXGI_FORMAT new_format, size_t new_mip_count);
+    enum class sprite_packer
+    {
+        grid, // rows of 8x8 pixel cells
+        max_rects,
+        skyline,
+    };
+
+    // Only used by sprite_packer::max_rects
+    enum class sprite_pack_heuristic
+    {
+        best_short_side_fit,
+        best_long_side_fit,
+        best_area_fit,
+        bottom_left,
+    };
+
+    struct sprite_optimizer_options
+    {
+        ff::internal::sprite_packer packer{ ff::internal::sprite_packer::grid };
+        ff::internal::sprite_pack_heuristic heuristic{ ff::internal::sprite_pack_heuristic::best_short_side_fit };
+        size_t max_texture_size{ 1024 }; // rounded down to a power of two, bigger sprites get their own texture
+        bool parallel_copy{ true };
+    };
+
+    struct sprite_optimizer_stats
+    {
+        double fill_ratio() const;
+
+        size_t texture_count;
+        size_t sprite_pixels; // duplicate sprites are only counted once
+        size_t texture_pixels;
+        double pack_seconds;
+        double copy_seconds;
+    };
+
+    std::vector<ff::sprite> optimize_sprites(
+        const std::vector<ff::sprite>& old_sprites,
+        DXGI_FORMAT new_format,
+        size_t new_mip_count,
+        const ff::internal::sprite_optimizer_options& options = {},
+        ff::internal::sprite_optimizer_stats* stats = nullptr);
+
+    std::vector<ff::sprite> outline_sprites(
+        const std::vector<ff::sprite>& old_sprites,
+        DXGI_FORMAT new_format,
+        size_t new_mip_count,
+        const ff::internal::sprite_optimizer_options& options = {});
 }
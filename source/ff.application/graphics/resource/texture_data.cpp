@@ -3,6 +3,7 @@
 #include "graphics/resource/palette_data.h"
 #include "graphics/resource/png_image.h"
 #include "graphics/resource/texture_data.h"
+#include "graphics/resource/texture_processor.h"
 
 static DirectX::ScratchImage load_texture_png(
     const ff::resource_file& resource_file,
@@ -19,6 +20,15 @@ static DirectX::ScratchImage load_texture_png(
         return scratch_final;
     }
 
+    // Only mips and block compression are slow enough to be worth caching
+    const bool use_cache = ff::internal::texture_processor::cache_enabled() && (new_mip_count != 1 || ff::dxgi::compressed_format(new_format));
+    const uint64_t cache_key = use_cache ? ff::internal::texture_processor::cache_key(data->data(), data->size(), DirectX::TexMetadata{}, new_format, new_mip_count) : 0;
+    if (use_cache && ff::internal::texture_processor::cache_load(cache_key, scratch_final, palette_scratch))
+    {
+        return scratch_final;
+    }
+
+    ff::timer decode_timer;
     ff::png_image_reader png(data->data(), data->size());
     {
         std::unique_ptr<DirectX::ScratchImage> scratch_temp = png.read(new_format);
@@ -47,61 +57,19 @@ static DirectX::ScratchImage load_texture_png(
         }
     }
 
+    ff::internal::texture_processor::add_stage_time(ff::internal::texture_processor::stage_t::decode, decode_timer.tick());
     new_format = ff::dxgi::fix_format(new_format, scratch_final.GetMetadata().width, scratch_final.GetMetadata().height, new_mip_count);
 
-    if (new_mip_count != 1)
+    if ((new_mip_count != 1 && !ff::internal::texture_processor::generate_mips(scratch_final, new_mip_count)) ||
+        !ff::internal::texture_processor::convert(scratch_final, new_format))
     {
-        DirectX::ScratchImage scratch_mips;
-        if (FAILED(DirectX::GenerateMipMaps(
-            scratch_final.GetImages(),
-            scratch_final.GetImageCount(),
-            scratch_final.GetMetadata(),
-            DirectX::TEX_FILTER_DEFAULT,
-            new_mip_count,
-            scratch_mips)))
-        {
-            assert(false);
-            return DirectX::ScratchImage();
-        }
-
-        scratch_final = std::move(scratch_mips);
+        assert(false);
+        return DirectX::ScratchImage();
     }
 
-    if (ff::dxgi::compressed_format(new_format))
-    {
-        DirectX::ScratchImage scratch_new;
-        if (FAILED(DirectX::Compress(
-            scratch_final.GetImages(),
-            scratch_final.GetImageCount(),
-            scratch_final.GetMetadata(),
-            new_format,
-            DirectX::TEX_COMPRESS_DEFAULT,
-            0, // alpharef
-            scratch_new)))
-        {
-            assert(false);
-            return DirectX::ScratchImage();
-        }
-
-        scratch_final = std::move(scratch_new);
-    }
-    else if (new_format != scratch_final.GetMetadata().format)
+    if (use_cache)
     {
-        DirectX::ScratchImage scratch_new;
-        if (FAILED(DirectX::Convert(
-            scratch_final.GetImages(),
-            scratch_final.GetImageCount(),
-            scratch_final.GetMetadata(),
-            new_format,
-            DirectX::TEX_FILTER_DEFAULT,
-            0, // threshold
-            scratch_new)))
-        {
-            assert(false);
-            return DirectX::ScratchImage();
-        }
-
-        scratch_final = std::move(scratch_new);
+        ff::internal::texture_processor::cache_save(cache_key, scratch_final, palette_scratch);
     }
 
     return scratch_final;
@@ -176,3 +144,78 @@ std::shared_ptr<DirectX::ScratchImage> ff::internal::load_texture_data(
     assert(false);
     return nullptr;
 }
+
+std::shared_ptr<DirectX::ScratchImage> ff::internal::convert_texture_data(const std::shared_ptr<DirectX::ScratchImage>& data, DXGI_FORMAT new_format, size_t new_mip_count)
+{
+    if (!data || !data->GetImageCount())
+    {
+        return nullptr;
+    }
+
+    new_format = ff::dxgi::fix_format(new_format, data->GetMetadata().width, data->GetMetadata().height, new_mip_count);
+
+    if (data->GetMetadata().format == new_format && data->GetMetadata().mipLevels == new_mip_count)
+    {
+        return data;
+    }
+
+    const DirectX::Image& source_image = *data->GetImages();
+    const bool use_cache = ff::internal::texture_processor::cache_enabled() && (new_mip_count != 1 || ff::dxgi::compressed_format(new_format));
+    const uint64_t cache_key = use_cache ? ff::internal::texture_processor::cache_key(source_image.pixels, source_image.slicePitch, data->GetMetadata(), new_format, new_mip_count) : 0;
+    DirectX::ScratchImage scratch_final;
+    DirectX::ScratchImage scratch_palette;
+
+    if (use_cache && ff::internal::texture_processor::cache_load(cache_key, scratch_final, scratch_palette))
+    {
+        return std::make_shared<DirectX::ScratchImage>(std::move(scratch_final));
+    }
+
+    if (FAILED(scratch_final.InitializeFromImage(source_image)))
+    {
+        assert(false);
+        return nullptr;
+    }
+
+    if (ff::dxgi::compressed_format(scratch_final.GetMetadata().format))
+    {
+        ff::timer timer;
+        DirectX::ScratchImage scratch_rgb;
+        if (FAILED(DirectX::Decompress(
+            scratch_final.GetImages(),
+            scratch_final.GetImageCount(),
+            scratch_final.GetMetadata(),
+            DXGI_FORMAT_R8G8B8A8_UNORM,
+            scratch_rgb)))
+        {
+            assert(false);
+            return nullptr;
+        }
+
+        scratch_final = std::move(scratch_rgb);
+        ff::internal::texture_processor::add_stage_time(ff::internal::texture_processor::stage_t::decode, timer.tick());
+    }
+    else if (!ff::internal::texture_processor::convert(scratch_final, DXGI_FORMAT_R8G8B8A8_UNORM))
+    {
+        assert(false);
+        return nullptr;
+    }
+
+    if ((new_mip_count != 1 && !ff::internal::texture_processor::generate_mips(scratch_final, new_mip_count)) ||
+        !ff::internal::texture_processor::convert(scratch_final, new_format))
+    {
+        assert(false);
+        return nullptr;
+    }
+
+    if (!scratch_final.GetImageCount())
+    {
+        return nullptr;
+    }
+
+    if (use_cache)
+    {
+        ff::internal::texture_processor::cache_save(cache_key, scratch_final, scratch_palette);
+    }
+
+    return std::make_shared<DirectX::ScratchImage>(std::move(scratch_final));
+}
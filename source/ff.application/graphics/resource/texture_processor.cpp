@@ -0,0 +1,357 @@
+#include "pch.h"
+#include "graphics/dxgi/format_util.h"
+#include "graphics/resource/texture_processor.h"
+
+namespace
+{
+    struct cache_key_t
+    {
+        uint64_t source_hash;
+        uint64_t width;
+        uint64_t height;
+        uint64_t mip_count;
+        uint32_t source_format;
+        uint32_t new_format;
+        uint32_t version;
+        uint32_t padding;
+    };
+
+    struct cache_file_group_t
+    {
+        std::filesystem::file_time_type time;
+        uint64_t byte_size;
+        std::vector<std::filesystem::path> paths;
+    };
+
+    // Bump when processing changes the output for the same input
+    constexpr uint32_t cache_version = 1;
+
+    // Cache files are named with the 16 hex digit key first
+    constexpr size_t cache_key_length = 16;
+
+    // A multiple of the 4x4 block size, so bands compress exactly like the whole image would
+    constexpr size_t band_height = 64;
+}
+
+static std::mutex stats_mutex;
+static ff::internal::texture_processor::stats_t stats_;
+static std::atomic_bool cache_enabled_;
+
+static const std::filesystem::path& cache_directory()
+{
+    static const std::filesystem::path path = ff::filesystem::user_local_path() / "ff.cache" / "textures";
+    return path;
+}
+
+static std::filesystem::path cache_path(uint64_t key, std::string_view suffix)
+{
+    std::ostringstream name;
+    name << std::hex << std::setw(::cache_key_length) << std::setfill('0') << key << suffix;
+    return ::cache_directory() / name.str();
+}
+
+static bool load_dds(const std::filesystem::path& path, DirectX::ScratchImage& scratch)
+{
+    std::shared_ptr<ff::data_base> data = ff::filesystem::exists(path) ? ff::filesystem::read_binary_file(path) : nullptr;
+    return data && SUCCEEDED(DirectX::LoadFromDDSMemory(data->data(), data->size(), DirectX::DDS_FLAGS_NONE, nullptr, scratch));
+}
+
+static bool save_dds(const std::filesystem::path& path, const DirectX::ScratchImage& scratch)
+{
+    DirectX::Blob blob;
+    if (FAILED(DirectX::SaveToDDSMemory(scratch.GetImages(), scratch.GetImageCount(), scratch.GetMetadata(), DirectX::DDS_FLAGS_NONE, blob)))
+    {
+        debug_fail_ret_val(false);
+    }
+
+    // Other builds may be reading the cache, so only complete files get the real name
+    std::ostringstream temp_name;
+    temp_name << ff::filesystem::to_string(path.filename()) << "." << ::GetCurrentThreadId() << ".tmp";
+    std::filesystem::path temp_path = path.parent_path() / temp_name.str();
+    std::error_code ec;
+
+    if (!ff::filesystem::write_binary_file(temp_path, blob.GetBufferPointer(), blob.GetBufferSize()))
+    {
+        return false;
+    }
+
+    std::filesystem::rename(temp_path, path, ec);
+    if (ec)
+    {
+        ff::filesystem::remove(temp_path);
+        return false;
+    }
+
+    return true;
+}
+
+static bool convert_band(const DirectX::Image& source, const DirectX::Image& dest, size_t y, size_t height)
+{
+    DirectX::Image source_band = source;
+    source_band.height = height;
+    source_band.pixels = source.pixels + y * source.rowPitch;
+    source_band.slicePitch = height * source.rowPitch;
+
+    DirectX::ScratchImage scratch_band;
+    if (FAILED(ff::dxgi::compressed_format(dest.format)
+        ? DirectX::Compress(source_band, dest.format, DirectX::TEX_COMPRESS_DEFAULT, 0, scratch_band)
+        : DirectX::Convert(source_band, dest.format, DirectX::TEX_FILTER_DEFAULT, 0, scratch_band)))
+    {
+        debug_fail_ret_val(false);
+    }
+
+    const DirectX::Image& band = *scratch_band.GetImages();
+    const size_t dest_row = DirectX::ComputeScanlines(dest.format, y);
+    const size_t row_count = DirectX::ComputeScanlines(dest.format, height);
+    const size_t row_size = std::min(band.rowPitch, dest.rowPitch);
+
+    for (size_t i = 0; i < row_count; i++)
+    {
+        std::memcpy(dest.pixels + (dest_row + i) * dest.rowPitch, band.pixels + i * band.rowPitch, row_size);
+    }
+
+    return true;
+}
+
+ff::internal::texture_processor::stats_t ff::internal::texture_processor::stats()
+{
+    std::scoped_lock lock(::stats_mutex);
+    return ::stats_;
+}
+
+void ff::internal::texture_processor::reset_stats()
+{
+    std::scoped_lock lock(::stats_mutex);
+    ::stats_ = {};
+}
+
+void ff::internal::texture_processor::add_stage_time(stage_t stage, double seconds)
+{
+    std::scoped_lock lock(::stats_mutex);
+    ::stats_.seconds[static_cast<size_t>(stage)] += seconds;
+}
+
+bool ff::internal::texture_processor::generate_mips(DirectX::ScratchImage& scratch, size_t mip_count)
+{
+    ff::timer timer;
+    const DirectX::TexMetadata& metadata = scratch.GetMetadata();
+    DirectX::ScratchImage scratch_mips;
+
+    if (metadata.arraySize > 1 && metadata.dimension == DirectX::TEX_DIMENSION_TEXTURE2D && !metadata.IsCubemap())
+    {
+        // Each array slice gets its own mip chain
+        std::vector<DirectX::ScratchImage> slice_mips(metadata.arraySize);
+        std::atomic_bool status = true;
+
+        ff::thread_pool::parallel_for(0, metadata.arraySize, [&](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; i++)
+                {
+                    if (FAILED(DirectX::GenerateMipMaps(*scratch.GetImage(0, i, 0), DirectX::TEX_FILTER_DEFAULT, mip_count, slice_mips[i])))
+                    {
+                        status = false;
+                    }
+                }
+            }, 1);
+
+        assert_ret_val(status, false);
+
+        const size_t new_mip_count = slice_mips[0].GetMetadata().mipLevels;
+        assert_hr_ret_val(scratch_mips.Initialize2D(metadata.format, metadata.width, metadata.height, metadata.arraySize, new_mip_count), false);
+
+        for (size_t i = 0; i < metadata.arraySize; i++)
+        {
+            for (size_t mip = 0; mip < new_mip_count; mip++)
+            {
+                const DirectX::Image& source = *slice_mips[i].GetImage(mip, 0, 0);
+                const DirectX::Image& dest = *scratch_mips.GetImage(mip, i, 0);
+                std::memcpy(dest.pixels, source.pixels, std::min(source.slicePitch, dest.slicePitch));
+            }
+        }
+    }
+    else if (FAILED(DirectX::GenerateMipMaps(scratch.GetImages(), scratch.GetImageCount(), metadata, DirectX::TEX_FILTER_DEFAULT, mip_count, scratch_mips)))
+    {
+        debug_fail_ret_val(false);
+    }
+
+    scratch = std::move(scratch_mips);
+    texture_processor::add_stage_time(stage_t::mips, timer.tick());
+    return true;
+}
+
+bool ff::internal::texture_processor::convert(DirectX::ScratchImage& scratch, DXGI_FORMAT format)
+{
+    const DirectX::TexMetadata& metadata = scratch.GetMetadata();
+    check_ret_val(format != metadata.format, true);
+    assert_ret_val(!ff::dxgi::compressed_format(metadata.format), false);
+
+    ff::timer timer;
+    DirectX::TexMetadata new_metadata = metadata;
+    new_metadata.format = format;
+
+    DirectX::ScratchImage scratch_new;
+    assert_hr_ret_val(scratch_new.Initialize(new_metadata), false);
+
+    // Every band of every mip and array slice is independent
+    struct band_t
+    {
+        size_t image;
+        size_t y;
+        size_t height;
+    };
+
+    std::vector<band_t> bands;
+    for (size_t i = 0; i < scratch.GetImageCount(); i++)
+    {
+        for (size_t y = 0, height = scratch.GetImages()[i].height; y < height; y += ::band_height)
+        {
+            bands.push_back(band_t{ i, y, std::min(::band_height, height - y) });
+        }
+    }
+
+    std::atomic_bool status = true;
+    ff::thread_pool::parallel_for(0, bands.size(), [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end && status; i++)
+            {
+                const band_t& band = bands[i];
+                if (!::convert_band(scratch.GetImages()[band.image], scratch_new.GetImages()[band.image], band.y, band.height))
+                {
+                    status = false;
+                }
+            }
+        }, 1);
+
+    assert_ret_val(status, false);
+
+    scratch = std::move(scratch_new);
+    texture_processor::add_stage_time(stage_t::convert, timer.tick());
+    return true;
+}
+
+bool ff::internal::texture_processor::cache_enabled()
+{
+    return ::cache_enabled_;
+}
+
+void ff::internal::texture_processor::cache_enabled(bool enabled)
+{
+    ::cache_enabled_ = enabled;
+}
+
+void ff::internal::texture_processor::cache_trim(uint64_t max_byte_size)
+{
+    ff::timer timer;
+    std::unordered_map<std::wstring, ::cache_file_group_t> groups;
+    uint64_t total_byte_size = 0;
+    std::error_code ec;
+
+    // A texture's data and palette files are removed together
+    for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(::cache_directory(), ec))
+    {
+        std::error_code entry_ec;
+        const std::wstring name = entry.path().filename().native();
+        const uint64_t byte_size = entry.is_regular_file(entry_ec) ? entry.file_size(entry_ec) : 0;
+        if (!entry_ec && name.size() > ::cache_key_length)
+        {
+            ::cache_file_group_t& group = groups[name.substr(0, ::cache_key_length)];
+            group.time = std::max(group.time, entry.last_write_time(entry_ec));
+            group.byte_size += byte_size;
+            group.paths.push_back(entry.path());
+            total_byte_size += byte_size;
+        }
+    }
+
+    std::vector<::cache_file_group_t*> sorted_groups;
+    sorted_groups.reserve(groups.size());
+
+    for (auto& [key, group] : groups)
+    {
+        sorted_groups.push_back(&group);
+    }
+
+    std::sort(sorted_groups.begin(), sorted_groups.end(), [](const ::cache_file_group_t* lhs, const ::cache_file_group_t* rhs)
+        {
+            return lhs->time < rhs->time;
+        });
+
+    for (auto i = sorted_groups.begin(); i != sorted_groups.end() && total_byte_size > max_byte_size; i++)
+    {
+        // Shortest name first, so the data file goes before its palette and cache_load() never sees just the data
+        std::vector<std::filesystem::path>& paths = (*i)->paths;
+        std::sort(paths.begin(), paths.end(), [](const std::filesystem::path& lhs, const std::filesystem::path& rhs)
+            {
+                return lhs.native().size() < rhs.native().size();
+            });
+
+        for (const std::filesystem::path& path : paths)
+        {
+            ff::filesystem::remove(path);
+        }
+
+        total_byte_size -= (*i)->byte_size;
+    }
+
+    texture_processor::add_stage_time(stage_t::cache, timer.tick());
+}
+
+uint64_t ff::internal::texture_processor::cache_key(const void* data, size_t size, const DirectX::TexMetadata& source_metadata, DXGI_FORMAT new_format, size_t new_mip_count)
+{
+    // Cache file names are persisted, so pin the hash version
+    ::cache_key_t key{};
+    key.source_hash = ff::stable_hash_bytes(data, size, ff::stable_hash_version::wyhash);
+    key.width = source_metadata.width;
+    key.height = source_metadata.height;
+    key.mip_count = new_mip_count;
+    key.source_format = static_cast<uint32_t>(source_metadata.format);
+    key.new_format = static_cast<uint32_t>(new_format);
+    key.version = ::cache_version;
+
+    return ff::stable_hash_bytes(&key, sizeof(key), ff::stable_hash_version::wyhash);
+}
+
+bool ff::internal::texture_processor::cache_load(uint64_t key, DirectX::ScratchImage& data, DirectX::ScratchImage& palette)
+{
+    ff::timer timer;
+
+    // The palette is saved first, so it's complete if the data exists
+    bool hit = ::load_dds(::cache_path(key, ".dds"), data);
+    if (hit)
+    {
+        std::filesystem::path palette_path = ::cache_path(key, ".palette.dds");
+        hit = !ff::filesystem::exists(palette_path) || ::load_dds(palette_path, palette);
+    }
+
+    if (hit)
+    {
+        // cache_trim() removes the oldest files first
+        std::error_code ec;
+        std::filesystem::last_write_time(::cache_path(key, ".dds"), std::filesystem::file_time_type::clock::now(), ec);
+    }
+
+    if (!hit)
+    {
+        data.Release();
+        palette.Release();
+    }
+
+    const double seconds = timer.tick();
+    std::scoped_lock lock(::stats_mutex);
+    ::stats_.seconds[static_cast<size_t>(stage_t::cache)] += seconds;
+    (hit ? ::stats_.cache_hit_count : ::stats_.cache_miss_count)++;
+
+    return hit;
+}
+
+void ff::internal::texture_processor::cache_save(uint64_t key, const DirectX::ScratchImage& data, const DirectX::ScratchImage& palette)
+{
+    ff::timer timer;
+
+    if (ff::filesystem::create_directories(::cache_directory()) &&
+        (!palette.GetImageCount() || ::save_dds(::cache_path(key, ".palette.dds"), palette)))
+    {
+        ::save_dds(::cache_path(key, ".dds"), data);
+    }
+
+    texture_processor::add_stage_time(stage_t::cache, timer.tick());
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+namespace ff::internal::texture_processor
+{
+    enum class stage_t
+    {
+        decode,
+        mips,
+        convert, // format conversion and block compression
+        cache, // reading and writing the on-disk cache
+
+        count
+    };
+
+    /// <summary>
+    /// Time spent in each texture processing stage, summed over all threads since the last reset_stats()
+    /// </summary>
+    struct stats_t
+    {
+        std::array<double, static_cast<size_t>(stage_t::count)> seconds;
+        size_t cache_hit_count;
+        size_t cache_miss_count;
+    };
+
+    stats_t stats();
+    void reset_stats();
+    void add_stage_time(stage_t stage, double seconds);
+
+    // Both split their work across the thread pool: mips by array slice, conversion by bands of rows in every image
+    bool generate_mips(DirectX::ScratchImage& scratch, size_t mip_count);
+    bool convert(DirectX::ScratchImage& scratch, DXGI_FORMAT format);
+
+    /// <summary>
+    /// Content addressed cache of processed textures, keyed by a hash of the source bytes and the processing parameters
+    /// </summary>
+    /// <remarks>
+    /// Only worth using when mips or block compression will be generated. Files live in the user's local "ff.cache\textures" folder.
+    /// It's off until cache_enabled(true) is called, which the resource build tool does. Nothing is evicted while the cache is used,
+    /// so whoever enables it should also call cache_trim() when done.
+    /// </remarks>
+    bool cache_enabled();
+    void cache_enabled(bool enabled);
+    void cache_trim(uint64_t max_byte_size); // removes the least recently used textures until the folder fits
+    uint64_t cache_key(const void* data, size_t size, const DirectX::TexMetadata& source_metadata, DXGI_FORMAT new_format, size_t new_mip_count);
+    bool cache_load(uint64_t key, DirectX::ScratchImage& data, DirectX::ScratchImage& palette);
+    void cache_save(uint64_t key, const DirectX::ScratchImage& data, const DirectX::ScratchImage& palette);
+}
@@ -12,12 +12,22 @@ namespace ff
 {
     enum class app_update_t;
 
+    /// <summary>
+    /// Immutable game state that the render thread draws from in pipelined mode
+    /// </summary>
+    class render_snapshot
+    {
+    public:
+        virtual ~render_snapshot() = default;
+    };
+
     struct render_params
     {
         ff::app_update_t update_type;
         ff::dxgi::command_context_base& context;
         ff::dxgi::target_base& target;
         ff::dxgi::depth_base& depth;
+        const ff::render_snapshot* snapshot{}; // only in pipelined mode
     };
 
     struct init_app_params
@@ -38,6 +48,15 @@ namespace ff
         std::function<void(const ff::render_params&)> game_render_offscreen_func{ std::bind([] {}) };
         std::function<void(const ff::render_params&)> game_render_func{ std::bind([] {}) };
 
+        // Pipelined mode renders one frame on a render thread while the game thread updates the next frame.
+        // The snapshot func runs on the game thread after updates while the render thread is idle, then the
+        // render funcs run on the render thread and should only read game state from params.snapshot.
+        std::function<bool()> game_pipelined_func{ [] { return false; } };
+        std::function<std::shared_ptr<const ff::render_snapshot>()> game_snapshot_func{ [] { return nullptr; } };
+
+        // Saves combined input for each game update, so that ff::run_headless can replay it
+        std::filesystem::path input_record_path{};
+
         ff::init_dx_params init_dx_params{};
         ff::dxgi::target_window_params target_window{};
     };
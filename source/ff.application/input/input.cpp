@@ -138,6 +138,11 @@ void ff::internal::input::destroy()
     ::combined_devices_.reset();
 }
 
+bool ff::internal::input::initialized()
+{
+    return ::combined_devices_ != nullptr;
+}
+
 bool ff::internal::input::app_window_active()
 {
     return ::app_window_active;
@@ -22,6 +22,7 @@ namespace ff::internal::input
 {
     bool init();
     void destroy();
+    bool initialized();
     bool app_window_active();
 
     void add_device(ff::input_device_base* device);
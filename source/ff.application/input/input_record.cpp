@@ -0,0 +1,290 @@
+#include "pch.h"
+#include "input/input_record.h"
+
+namespace
+{
+    struct record_header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t update_count;
+    };
+
+    constexpr uint32_t record_magic = 0x52494646; // "FFIR"
+    constexpr uint32_t record_version = 1;
+
+    constexpr uint8_t state_pressing = 0x01;
+    constexpr uint8_t state_press_count = 0x02;
+    constexpr uint8_t state_analog_value = 0x04;
+}
+
+static void write_unsigned(std::vector<uint8_t>& data, uint64_t value)
+{
+    for (; value >= 0x80; value >>= 7)
+    {
+        data.push_back(static_cast<uint8_t>(value | 0x80));
+    }
+
+    data.push_back(static_cast<uint8_t>(value));
+}
+
+static void write_signed(std::vector<uint8_t>& data, int64_t value)
+{
+    ::write_unsigned(data, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+static bool read_unsigned(const uint8_t* data, size_t size, size_t& pos, uint64_t& value)
+{
+    value = 0;
+
+    for (size_t shift = 0; pos < size && shift < 64; shift += 7)
+    {
+        const uint8_t byte = data[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool read_signed(const uint8_t* data, size_t size, size_t& pos, int64_t& value)
+{
+    uint64_t raw;
+    if (::read_unsigned(data, size, pos, raw))
+    {
+        value = static_cast<int64_t>(raw >> 1) ^ -static_cast<int64_t>(raw & 1);
+        return true;
+    }
+
+    return false;
+}
+
+ff::input_recorder::input_recorder(ff::input_device_base& device)
+    : device(device)
+{
+    ::record_header header{ ::record_magic, ::record_version, 0 };
+    this->data_.resize(sizeof(header));
+    std::memcpy(this->data_.data(), &header, sizeof(header));
+
+    this->device_connection = device.event_sink().connect([this](const ff::input_device_event& event)
+        {
+            std::scoped_lock lock(this->events_mutex);
+            this->events.push_back(event);
+        });
+}
+
+void ff::input_recorder::update()
+{
+    std::vector<ff::input_device_event> events;
+    {
+        std::scoped_lock lock(this->events_mutex);
+        events.swap(this->events);
+    }
+
+    ::write_unsigned(this->data_, events.size());
+
+    for (const ff::input_device_event& event : events)
+    {
+        this->data_.push_back(static_cast<uint8_t>(event.type));
+        ::write_unsigned(this->data_, event.id);
+        ::write_signed(this->data_, event.count);
+        ::write_signed(this->data_, event.pos.x);
+        ::write_signed(this->data_, event.pos.y);
+    }
+
+    std::array<uint8_t, ff::internal::input_record_vk_count> changed_vks;
+    size_t changed_count = 0;
+
+    for (size_t vk = 0; vk < this->states.size(); vk++)
+    {
+        const int vk_int = static_cast<int>(vk);
+        const ff::internal::input_vk_state state{ this->device.press_count(vk_int), this->device.analog_value(vk_int), this->device.pressing(vk_int) };
+
+        if (state != this->states[vk])
+        {
+            this->states[vk] = state;
+            changed_vks[changed_count++] = static_cast<uint8_t>(vk);
+        }
+    }
+
+    ::write_unsigned(this->data_, changed_count);
+
+    for (size_t i = 0; i < changed_count; i++)
+    {
+        const ff::internal::input_vk_state& state = this->states[changed_vks[i]];
+        const bool default_analog = state.analog_value == (state.pressing ? 1.0f : 0.0f);
+        const uint8_t flags = (state.pressing ? ::state_pressing : 0) | (state.press_count ? ::state_press_count : 0) | (default_analog ? 0 : ::state_analog_value);
+
+        this->data_.push_back(changed_vks[i]);
+        this->data_.push_back(flags);
+
+        if (state.press_count)
+        {
+            ::write_signed(this->data_, state.press_count);
+        }
+
+        if (!default_analog)
+        {
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&state.analog_value);
+            this->data_.insert(this->data_.end(), bytes, bytes + sizeof(state.analog_value));
+        }
+    }
+
+    const uint64_t update_count = ++this->update_count_;
+    std::memcpy(this->data_.data() + offsetof(::record_header, update_count), &update_count, sizeof(update_count));
+}
+
+size_t ff::input_recorder::update_count() const
+{
+    return this->update_count_;
+}
+
+const std::vector<uint8_t>& ff::input_recorder::data() const
+{
+    return this->data_;
+}
+
+bool ff::input_recorder::save(const std::filesystem::path& path) const
+{
+    return ff::filesystem::write_binary_file(path, this->data_.data(), this->data_.size());
+}
+
+ff::input_replay_device::input_replay_device(std::shared_ptr<ff::data_base> data)
+    : data(data)
+    , pos(sizeof(::record_header))
+{
+    ::record_header header{};
+    if (this->data && this->data->size() >= sizeof(header))
+    {
+        std::memcpy(&header, this->data->data(), sizeof(header));
+    }
+
+    this->valid_ = header.magic == ::record_magic && header.version == ::record_version;
+    this->update_count_ = this->valid_ ? static_cast<size_t>(header.update_count) : 0;
+}
+
+bool ff::input_replay_device::valid() const
+{
+    return this->valid_;
+}
+
+bool ff::input_replay_device::done() const
+{
+    return this->updated_count >= this->update_count_;
+}
+
+size_t ff::input_replay_device::update_count() const
+{
+    return this->update_count_;
+}
+
+bool ff::input_replay_device::pressing(int vk) const
+{
+    return vk >= 0 && static_cast<size_t>(vk) < this->states.size() && this->states[vk].pressing;
+}
+
+int ff::input_replay_device::press_count(int vk) const
+{
+    return (vk >= 0 && static_cast<size_t>(vk) < this->states.size()) ? this->states[vk].press_count : 0;
+}
+
+float ff::input_replay_device::analog_value(int vk) const
+{
+    return (vk >= 0 && static_cast<size_t>(vk) < this->states.size()) ? this->states[vk].analog_value : 0.0f;
+}
+
+void ff::input_replay_device::update()
+{
+    this->events.clear();
+
+    if (this->done())
+    {
+        this->states = {};
+        return;
+    }
+
+    const uint8_t* data = this->data->data();
+    const size_t size = this->data->size();
+    size_t& pos = this->pos;
+    uint64_t event_count, changed_count;
+    bool success = ::read_unsigned(data, size, pos, event_count);
+
+    for (uint64_t i = 0; success && i < event_count; i++)
+    {
+        uint64_t id;
+        int64_t count, x, y;
+        success = pos < size;
+
+        if (success)
+        {
+            const ff::input_device_event_type type = static_cast<ff::input_device_event_type>(data[pos++]);
+            success = ::read_unsigned(data, size, pos, id) && ::read_signed(data, size, pos, count) && ::read_signed(data, size, pos, x) && ::read_signed(data, size, pos, y);
+
+            if (success)
+            {
+                this->events.emplace_back(type, static_cast<unsigned int>(id), static_cast<int>(count), ff::point_int(static_cast<int>(x), static_cast<int>(y)));
+            }
+        }
+    }
+
+    success = success && ::read_unsigned(data, size, pos, changed_count);
+
+    for (uint64_t i = 0; success && i < changed_count; i++)
+    {
+        success = pos + 2 <= size;
+
+        if (success)
+        {
+            ff::internal::input_vk_state& state = this->states[data[pos++]];
+            const uint8_t flags = data[pos++];
+            int64_t press_count = 0;
+
+            state.pressing = (flags & ::state_pressing) != 0;
+            state.analog_value = state.pressing ? 1.0f : 0.0f;
+
+            if (flags & ::state_press_count)
+            {
+                success = ::read_signed(data, size, pos, press_count);
+            }
+
+            if (success && (flags & ::state_analog_value))
+            {
+                success = pos + sizeof(state.analog_value) <= size;
+
+                if (success)
+                {
+                    std::memcpy(&state.analog_value, data + pos, sizeof(state.analog_value));
+                    pos += sizeof(state.analog_value);
+                }
+            }
+
+            state.press_count = static_cast<int>(press_count);
+        }
+    }
+
+    if (!success)
+    {
+        debug_fail_msg("Corrupt input recording");
+        this->valid_ = false;
+        this->updated_count = this->update_count_;
+        this->states = {};
+        this->events.clear();
+        return;
+    }
+
+    this->updated_count++;
+
+    for (const ff::input_device_event& event : this->events)
+    {
+        this->device_event.notify(event);
+    }
+}
+
+void ff::input_replay_device::kill_pending()
+{
+    // Recorded input can't be interrupted
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "../input/input_device_base.h"
+#include "../input/input_device_event.h"
+
+namespace ff::internal
+{
+    struct input_vk_state
+    {
+        bool operator==(const input_vk_state& other) const = default;
+
+        int press_count;
+        float analog_value;
+        bool pressing;
+    };
+
+    constexpr size_t input_record_vk_count = 256;
+}
+
+namespace ff
+{
+    /// <summary>
+    /// Saves the events and virtual key states of an input device for each game update
+    /// </summary>
+    /// <remarks>
+    /// Call update() once per game update, after the device was updated. Only events and keys that changed
+    /// since the previous update get saved, so an idle update takes two bytes.
+    /// </remarks>
+    class input_recorder
+    {
+    public:
+        input_recorder(ff::input_device_base& device);
+        input_recorder(input_recorder&& other) noexcept = delete;
+        input_recorder(const input_recorder& other) = delete;
+
+        input_recorder& operator=(input_recorder&& other) noexcept = delete;
+        input_recorder& operator=(const input_recorder& other) = delete;
+
+        void update();
+        size_t update_count() const;
+        const std::vector<uint8_t>& data() const;
+        bool save(const std::filesystem::path& path) const;
+
+    private:
+        ff::input_device_base& device;
+        std::mutex events_mutex; // kill_pending can send events from the main thread
+        std::vector<ff::input_device_event> events;
+        std::array<ff::internal::input_vk_state, ff::internal::input_record_vk_count> states{};
+        std::vector<uint8_t> data_;
+        size_t update_count_{};
+        ff::signal_connection device_connection; // last, so it disconnects first
+    };
+
+    /// <summary>
+    /// Input device that plays back what ff::input_recorder saved, one recorded update for each call to update()
+    /// </summary>
+    class input_replay_device : public ff::input_device_base
+    {
+    public:
+        input_replay_device(std::shared_ptr<ff::data_base> data);
+        input_replay_device(input_replay_device&& other) noexcept = delete;
+        input_replay_device(const input_replay_device& other) = delete;
+
+        input_replay_device& operator=(input_replay_device&& other) noexcept = delete;
+        input_replay_device& operator=(const input_replay_device& other) = delete;
+
+        bool valid() const;
+        bool done() const;
+        size_t update_count() const; // total recorded updates
+
+        // input_vk
+        virtual bool pressing(int vk) const override;
+        virtual int press_count(int vk) const override;
+        virtual float analog_value(int vk) const override;
+
+        // input_device_base
+        virtual void update() override;
+        virtual void kill_pending() override;
+
+    private:
+        std::shared_ptr<ff::data_base> data;
+        std::array<ff::internal::input_vk_state, ff::internal::input_record_vk_count> states{};
+        std::vector<ff::input_device_event> events;
+        size_t pos{};
+        size_t update_count_{};
+        size_t updated_count{};
+        bool valid_{};
+    };
+}
@@ -3,7 +3,9 @@
 #include "base/log.h"
 #include "base/stable_hash.h"
 #include "base/string.h"
+#include "thread/thread_pool.h"
 #include "types/scope_exit.h"
+#include "windows/win_handle.h"
 
 namespace
 {
@@ -12,6 +14,57 @@ namespace
         std::string name;
         bool enabled;
     };
+
+    constexpr size_t async_ring_size = 1 << 18; // per thread
+    constexpr size_t async_batch_ms = 50;
+    constexpr size_t async_crash_wait_ms = 1000;
+    constexpr uint32_t async_skip_arg_count = ff::constants::invalid_unsigned<uint32_t>();
+
+    // Record sizes are a multiple of this header size, so a skip header always fits at the end of the ring
+    struct alignas(32) async_record_header
+    {
+        uint32_t size; // includes this header
+        uint32_t arg_count; // async_skip_arg_count means continue at the start of the ring
+        ff::log::type type;
+        uint64_t sequence;
+        uint64_t file_time;
+    };
+
+    struct alignas(32) async_block
+    {
+        uint8_t bytes[32];
+    };
+
+    // Written by one thread, read by whoever holds async_drain_mutex
+    struct async_ring
+    {
+        uint8_t* data() const
+        {
+            return this->blocks.get()->bytes;
+        }
+
+        alignas(64) std::atomic_size_t read_pos{};
+        alignas(64) std::atomic_size_t write_pos{};
+        std::atomic_bool owned{ true };
+        std::unique_ptr<::async_block[]> blocks{ std::make_unique<::async_block[]>(::async_ring_size / sizeof(::async_block)) };
+    };
+
+    // Lets another thread reuse the ring after this thread exits
+    struct async_ring_owner
+    {
+        ~async_ring_owner()
+        {
+            if (this->ring)
+            {
+                this->ring->owned = false;
+            }
+        }
+
+        ::async_ring* ring{};
+        uint8_t* record{}; // between async_begin and async_end
+        size_t record_size{};
+        size_t record_end_pos{};
+    };
 }
 
 static std::unordered_map<ff::log::type, ::log_type> types
@@ -44,9 +97,188 @@ static bool statics_destroyed{};
 static ff::scope_exit statics_invalidate([]
     {
         assert_msg(!::file_stream, "ff::log::file(nullptr) must be called before exit.");
+        assert_msg(!ff::internal::log::async_enabled, "ff::log::async(false) must be called before exit.");
         ::statics_destroyed = true;
     });
 
+std::atomic_bool ff::internal::log::async_enabled;
+
+// Rings live until the process ends, since threads hold raw pointers to them
+static std::mutex async_rings_mutex;
+static std::vector<std::unique_ptr<::async_ring>> async_rings;
+static thread_local ::async_ring_owner async_ring_owner;
+static std::atomic_uint64_t async_sequence;
+
+static std::mutex async_mutex; // start and stop
+static std::mutex async_drain_mutex;
+static std::thread async_thread;
+static ff::win_handle async_wake_event;
+static std::atomic_bool async_wake_pending;
+static std::atomic_bool async_stop;
+static LPTOP_LEVEL_EXCEPTION_FILTER async_prev_exception_filter;
+static std::terminate_handler async_prev_terminate;
+
+static ::async_ring& get_async_ring()
+{
+    if (!::async_ring_owner.ring)
+    {
+        std::scoped_lock lock(::async_rings_mutex);
+
+        for (std::unique_ptr<::async_ring>& ring : ::async_rings)
+        {
+            bool owned = false;
+            if (ring->owned.compare_exchange_strong(owned, true))
+            {
+                ::async_ring_owner.ring = ring.get();
+                break;
+            }
+        }
+
+        if (!::async_ring_owner.ring)
+        {
+            ::async_ring_owner.ring = ::async_rings.emplace_back(std::make_unique<::async_ring>()).get();
+        }
+    }
+
+    return *::async_ring_owner.ring;
+}
+
+static void wake_async_thread()
+{
+    if (!::async_wake_pending.exchange(true) && ::async_wake_event)
+    {
+        ::SetEvent(::async_wake_event);
+    }
+}
+
+static std::string format_async_record(const ::async_record_header& header)
+{
+    const uint64_t file_time = header.file_time;
+    FILETIME utc_time{ static_cast<DWORD>(file_time), static_cast<DWORD>(file_time >> 32) };
+    FILETIME local_time{};
+    SYSTEMTIME st{};
+    ::FileTimeToLocalFileTime(&utc_time, &local_time);
+    ::FileTimeToSystemTime(&local_time, &st);
+
+    std::ostringstream ostr;
+    ostr << "[" << ff::log::type_name(header.type) << ","
+        << std::setfill('0') << std::setw(2) << st.wHour << ':' << std::setw(2) << st.wMinute << ':' << std::setw(2) << st.wSecond << "] ";
+    ostr << std::setfill(' ');
+
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(&header + 1);
+    for (uint32_t i = 0; i < header.arg_count; i++)
+    {
+        const ff::internal::log::async_arg_header& arg = *reinterpret_cast<const ff::internal::log::async_arg_header*>(data);
+        data += sizeof(ff::internal::log::async_arg_header);
+        arg.format(ostr, data, arg.size);
+        data += ff::internal::log::async_align(arg.size);
+    }
+
+    ostr << "\r\n";
+    return ostr.str();
+}
+
+// Caller must own async_drain_mutex. Records from all threads get written in the order they were logged.
+static void drain_async_rings()
+{
+    std::vector<std::pair<uint64_t, std::string>> records;
+    {
+        std::scoped_lock lock(::async_rings_mutex);
+
+        for (std::unique_ptr<::async_ring>& ring : ::async_rings)
+        {
+            size_t read_pos = ring->read_pos.load(std::memory_order_relaxed);
+            const size_t write_pos = ring->write_pos.load(std::memory_order_acquire);
+
+            while (read_pos != write_pos)
+            {
+                const ::async_record_header& header = *reinterpret_cast<const ::async_record_header*>(ring->data() + read_pos % ::async_ring_size);
+                if (header.arg_count != ::async_skip_arg_count)
+                {
+                    records.emplace_back(header.sequence, ::format_async_record(header));
+                }
+
+                read_pos += header.size;
+            }
+
+            ring->read_pos.store(read_pos, std::memory_order_release);
+        }
+    }
+
+    if (!records.empty())
+    {
+        std::sort(records.begin(), records.end(), [](const auto& lhs, const auto& rhs)
+            {
+                return lhs.first < rhs.first;
+            });
+
+        std::string text;
+        for (auto& i : records)
+        {
+            text += i.second;
+        }
+
+        ff::internal::log::write(text);
+        ff::internal::log::write_debug(text);
+    }
+}
+
+static void async_thread_func()
+{
+    ff::set_thread_name("ff::log");
+
+    while (!::async_stop)
+    {
+        // Wake up now and then to write out everything in one batch, callers only wake this thread when a ring is filling up
+        ::async_wake_event.wait(::async_batch_ms, false);
+        ::ResetEvent(::async_wake_event);
+        ::async_wake_pending = false;
+
+        std::scoped_lock lock(::async_drain_mutex);
+        ::drain_async_rings();
+    }
+}
+
+// The crashing thread might be holding the drain lock, so don't wait forever
+static void flush_after_crash()
+{
+    for (size_t i = 0; i < ::async_crash_wait_ms; i += 10)
+    {
+        if (::async_drain_mutex.try_lock())
+        {
+            ::drain_async_rings();
+
+            if (::file_stream)
+            {
+                ::file_stream->flush();
+            }
+
+            ::async_drain_mutex.unlock();
+            break;
+        }
+
+        ::Sleep(10);
+    }
+}
+
+static LONG WINAPI async_exception_filter(EXCEPTION_POINTERS* info)
+{
+    ::flush_after_crash();
+    return ::async_prev_exception_filter ? ::async_prev_exception_filter(info) : EXCEPTION_CONTINUE_SEARCH;
+}
+
+static void async_terminate()
+{
+    ::flush_after_crash();
+
+    if (::async_prev_terminate)
+    {
+        ::async_prev_terminate();
+    }
+
+    std::abort();
+}
+
 void ff::internal::log::write(std::string_view text)
 {
     if (::file_stream)
@@ -68,11 +300,122 @@ void ff::internal::log::write_debug(std::string_view text)
     }
 }
 
+uint8_t* ff::internal::log::async_begin(size_t args_size)
+{
+    const size_t size = (sizeof(::async_record_header) + args_size + sizeof(::async_record_header) - 1) & ~(sizeof(::async_record_header) - 1);
+    if (size > ::async_ring_size / 4)
+    {
+        // Too big, so write it synchronously after everything before it
+        ff::log::flush();
+        return nullptr;
+    }
+
+    ::async_ring& ring = ::get_async_ring();
+    uint8_t* data = ring.data();
+    size_t write_pos = ring.write_pos.load(std::memory_order_relaxed);
+    const size_t offset = write_pos % ::async_ring_size;
+    const size_t skip_size = (offset + size > ::async_ring_size) ? ::async_ring_size - offset : 0;
+
+    while (::async_ring_size - (write_pos - ring.read_pos.load(std::memory_order_acquire)) < skip_size + size)
+    {
+        // Full, so help write it out
+        std::unique_lock lock(::async_drain_mutex, std::try_to_lock);
+        if (lock)
+        {
+            ::drain_async_rings();
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    if (skip_size)
+    {
+        ::async_record_header& skip = *reinterpret_cast<::async_record_header*>(data + offset);
+        skip.size = static_cast<uint32_t>(skip_size);
+        skip.arg_count = ::async_skip_arg_count;
+        write_pos += skip_size;
+    }
+
+    ::async_ring_owner.record = data + write_pos % ::async_ring_size;
+    ::async_ring_owner.record_size = size;
+    ::async_ring_owner.record_end_pos = write_pos + size;
+    return ::async_ring_owner.record + sizeof(::async_record_header);
+}
+
+void ff::internal::log::async_end(ff::log::type type, size_t arg_count)
+{
+    ::async_ring& ring = *::async_ring_owner.ring;
+    ::async_record_header& header = *reinterpret_cast<::async_record_header*>(::async_ring_owner.record);
+    const size_t write_pos = ::async_ring_owner.record_end_pos;
+
+    FILETIME file_time;
+    ::GetSystemTimePreciseAsFileTime(&file_time);
+
+    header.size = static_cast<uint32_t>(::async_ring_owner.record_size);
+    header.arg_count = static_cast<uint32_t>(arg_count);
+    header.type = type;
+    header.sequence = ::async_sequence.fetch_add(1, std::memory_order_relaxed);
+    header.file_time = (static_cast<uint64_t>(file_time.dwHighDateTime) << 32) | file_time.dwLowDateTime;
+
+    ring.write_pos.store(write_pos, std::memory_order_release);
+
+    if (write_pos - ring.read_pos.load(std::memory_order_relaxed) > ::async_ring_size / 2)
+    {
+        ::wake_async_thread();
+    }
+}
+
 void ff::log::file(std::ostream* file_stream)
 {
+    ff::log::flush();
     ::file_stream = file_stream;
 }
 
+void ff::log::async(bool value)
+{
+    std::scoped_lock lock(::async_mutex);
+    if (value == ::async_thread.joinable())
+    {
+        return;
+    }
+
+    if (value)
+    {
+        ::async_stop = false;
+        ::async_wake_event = ff::win_handle::create_event();
+        ::async_thread = std::thread(::async_thread_func);
+        ::async_prev_exception_filter = ::SetUnhandledExceptionFilter(::async_exception_filter);
+        ::async_prev_terminate = std::set_terminate(::async_terminate);
+        ff::internal::log::async_enabled = true;
+    }
+    else
+    {
+        ff::internal::log::async_enabled = false;
+        ::SetUnhandledExceptionFilter(::async_prev_exception_filter);
+        std::set_terminate(::async_prev_terminate);
+
+        ::async_stop = true;
+        ::SetEvent(::async_wake_event);
+        ::async_thread.join();
+        ::async_wake_event.close();
+
+        ff::log::flush();
+    }
+}
+
+void ff::log::flush()
+{
+    std::scoped_lock lock(::async_drain_mutex);
+    ::drain_async_rings();
+
+    if (::file_stream)
+    {
+        ::file_stream->flush();
+    }
+}
+
 std::vector<ff::log::type> ff::log::types()
 {
     std::vector<ff::log::type> types;
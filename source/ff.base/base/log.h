@@ -3,16 +3,14 @@
 #include "../base/constants.h"
 #include "../base/string.h"
 
-namespace ff::internal::log
-{
-    void write(std::string_view text);
-    void write_debug(std::string_view text);
-}
-
 namespace ff::log
 {
     void file(std::ostream* file_stream);
 
+    // Async logging copies arguments into a per-thread buffer, and a background thread formats and writes them
+    void async(bool value);
+    void flush();
+
     enum class type : size_t
     {
         none, // not visible by default
@@ -45,20 +43,155 @@ namespace ff::log
     std::string_view type_name(ff::log::type type);
     bool type_enabled(ff::log::type type);
     void type_enabled(ff::log::type type, bool value);
+}
+
+namespace ff::internal::log
+{
+    void write(std::string_view text);
+    void write_debug(std::string_view text);
+
+    // Async records hold a header for each argument, followed by its data (aligned to 16 bytes)
+    using format_func = void(*)(std::ostream& output, const void* data, size_t size);
+
+    struct alignas(16) async_arg_header
+    {
+        ff::internal::log::format_func format;
+        size_t size;
+    };
+
+    extern std::atomic_bool async_enabled;
+    uint8_t* async_begin(size_t args_size); // returns null when the record can't be queued
+    void async_end(ff::log::type type, size_t arg_count);
+
+    constexpr size_t async_align(size_t size)
+    {
+        return (size + 15) & ~static_cast<size_t>(15);
+    }
+
+    template<class T>
+    constexpr bool async_text = std::is_same_v<std::decay_t<T>, char*> || std::is_same_v<std::decay_t<T>, const char*> ||
+        std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>;
+
+    // Plain values (numbers, pointers, enums, manipulators) are copied as bytes and formatted later
+    template<class T>
+    constexpr bool async_value = !ff::internal::log::async_text<T> && !std::is_array_v<T> &&
+        std::is_trivially_copyable_v<T> && sizeof(T) <= 64 && alignof(T) <= 16;
+
+    template<class T>
+    std::string_view async_text_view(const T& value)
+    {
+        if constexpr (std::is_pointer_v<T>)
+        {
+            return value ? std::string_view(value) : std::string_view();
+        }
+        else
+        {
+            return std::string_view(value);
+        }
+    }
+
+    // Anything that isn't text or a plain value gets formatted on the calling thread
+    template<class T>
+    decltype(auto) async_prepare_arg(const T& value)
+    {
+        if constexpr (ff::internal::log::async_text<T> || ff::internal::log::async_value<T>)
+        {
+            return (value);
+        }
+        else
+        {
+            std::ostringstream ostr;
+            ostr << value;
+            return ostr.str();
+        }
+    }
+
+    template<class T>
+    size_t async_arg_size(const T& value)
+    {
+        if constexpr (ff::internal::log::async_text<T>)
+        {
+            return sizeof(ff::internal::log::async_arg_header) + ff::internal::log::async_align(ff::internal::log::async_text_view(value).size());
+        }
+        else
+        {
+            return sizeof(ff::internal::log::async_arg_header) + ff::internal::log::async_align(sizeof(T));
+        }
+    }
+
+    template<class T>
+    uint8_t* async_store_arg(uint8_t* data, const T& value)
+    {
+        ff::internal::log::async_arg_header& header = *reinterpret_cast<ff::internal::log::async_arg_header*>(data);
+        uint8_t* arg_data = data + sizeof(ff::internal::log::async_arg_header);
+
+        if constexpr (ff::internal::log::async_text<T>)
+        {
+            std::string_view text = ff::internal::log::async_text_view(value);
+            std::memcpy(arg_data, text.data(), text.size());
+            header.size = text.size();
+            header.format = [](std::ostream& output, const void* data, size_t size)
+                {
+                    output << std::string_view(static_cast<const char*>(data), size);
+                };
+        }
+        else
+        {
+            std::memcpy(arg_data, &value, sizeof(T));
+            header.size = sizeof(T);
+            header.format = [](std::ostream& output, const void* data, size_t size)
+                {
+                    output << *static_cast<const T*>(data);
+                };
+        }
+
+        return arg_data + ff::internal::log::async_align(header.size);
+    }
 
+    template<class... Args>
+    void write_sync(ff::log::type type, const Args&... args)
+    {
+        std::ostringstream ostr;
+        ostr << "[" << ff::log::type_name(type) << "," << ff::string::time() << "] ";
+        (ostr << ... << args);
+        ostr << "\r\n";
+
+        std::string str = ostr.str();
+        ff::internal::log::write(str);
+        ff::internal::log::write_debug(str);
+    }
+
+    template<class... Args>
+    void write_async(ff::log::type type, const Args&... args)
+    {
+        uint8_t* data = ff::internal::log::async_begin((static_cast<size_t>(0) + ... + ff::internal::log::async_arg_size(args)));
+        if (data)
+        {
+            ((data = ff::internal::log::async_store_arg(data, args)), ...);
+            ff::internal::log::async_end(type, sizeof...(Args));
+        }
+        else
+        {
+            ff::internal::log::write_sync(type, args...);
+        }
+    }
+}
+
+namespace ff::log
+{
     template<class... Args>
     void write(ff::log::type type, Args&&... args)
     {
         if (ff::log::type_enabled(type))
         {
-            std::ostringstream ostr;
-            ostr << "[" << ff::log::type_name(type) << "," << ff::string::time() << "] ";
-            (ostr << ... << args);
-            ostr << "\r\n";
-
-            std::string str = ostr.str();
-            ff::internal::log::write(str);
-            ff::internal::log::write_debug(str);
+            if (ff::internal::log::async_enabled.load(std::memory_order_relaxed))
+            {
+                ff::internal::log::write_async(type, ff::internal::log::async_prepare_arg(args)...);
+            }
+            else
+            {
+                ff::internal::log::write_sync(type, args...);
+            }
         }
     }
 
@@ -69,6 +202,7 @@ namespace ff::log
 
         if constexpr (ff::constants::debug_build)
         {
+            ff::log::flush();
             __debugbreak();
         }
     }
@@ -1,51 +1,45 @@
 #include "pch.h"
+#include "base/assert.h"
 #include "base/stable_hash.h"
 
-// By Bob Jenkins, 2006. bob_jenkins@burtleburtle.net. You may use this
-// code any way you wish, private, educational, or commercial. It's free.
-// See http://burtleburtle.net/bob/hash/evahash.html
-// See http://burtleburtle.net/bob/c/lookup3.c
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <immintrin.h>
+#define FF_HASH_SSE2 1
+#endif
 
-inline constexpr static size_t create_hash_result(uint32_t b, uint32_t c)
+namespace
 {
-    static_assert(sizeof(size_t) == 4 || sizeof(size_t) == 8);
-
-    if constexpr (sizeof(size_t) == 8)
+    // Reads bytes in place at runtime, any alignment
+    struct memory_reader
     {
-        return (static_cast<uint64_t>(b) << 32) | static_cast<uint64_t>(c);
-    }
-    else
-    {
-        return c;
-    }
-}
+        uint8_t byte(size_t i) const
+        {
+            return this->data[i];
+        }
 
-inline constexpr static uint32_t rotate_bits(uint32_t val, uint32_t count)
-{
-    return (val << count) | (val >> (32 - count));
-}
+        uint32_t read32(size_t i) const
+        {
+            uint32_t value;
+            std::memcpy(&value, this->data + i, sizeof(value));
+            return value;
+        }
 
-inline constexpr static void hash_mix(uint32_t& a, uint32_t& b, uint32_t& c)
-{
-    a -= c; a ^= ::rotate_bits(c, 4); c += b;
-    b -= a; b ^= ::rotate_bits(a, 6); a += c;
-    c -= b; c ^= ::rotate_bits(b, 8); b += a;
-    a -= c; a ^= ::rotate_bits(c, 16); c += b;
-    b -= a; b ^= ::rotate_bits(a, 19); a += c;
-    c -= b; c ^= ::rotate_bits(b, 4); b += a;
-}
+        uint64_t read64(size_t i) const
+        {
+            uint64_t value;
+            std::memcpy(&value, this->data + i, sizeof(value));
+            return value;
+        }
 
-inline constexpr static void final_hash_mix(uint32_t& a, uint32_t& b, uint32_t& c)
-{
-    c ^= b; c -= ::rotate_bits(b, 14);
-    a ^= c; a -= ::rotate_bits(c, 11);
-    b ^= a; b -= ::rotate_bits(a, 25);
-    c ^= b; c -= ::rotate_bits(b, 16);
-    a ^= c; a -= ::rotate_bits(c, 4);
-    b ^= a; b -= ::rotate_bits(a, 14);
-    c ^= b; c -= ::rotate_bits(b, 24);
+        const uint8_t* data;
+    };
 }
 
+// lookup3 by Bob Jenkins, 2006. bob_jenkins@burtleburtle.net. You may use this
+// code any way you wish, private, educational, or commercial. It's free.
+// See http://burtleburtle.net/bob/hash/evahash.html
+// See http://burtleburtle.net/bob/c/lookup3.c
+
 ff::stable_hash_data_t::stable_hash_data_t()
     : a(0x9e3779b9)
     , b(0x9e3779b9)
@@ -72,8 +66,8 @@ void ff::stable_hash_data_t::hash(const void* data, size_t size)
 size_t ff::stable_hash_data_t::hash() const
 {
     stable_hash_data_t other = *this;
-    ::final_hash_mix(other.a, other.b, other.c);
-    return ::create_hash_result(other.b, other.c);
+    ff::internal::stable_hashing::lookup3_final_mix(other.a, other.b, other.c);
+    return ff::internal::stable_hashing::lookup3_result(other.b, other.c);
 }
 
 ff::stable_hash_data_t::operator size_t() const
@@ -97,7 +91,7 @@ ff::stable_hash_data_t ff::stable_hash_incremental(const void* data, size_t size
             b += key_data[1];
             c += key_data[2];
 
-            ::hash_mix(a, b, c);
+            ff::internal::stable_hashing::lookup3_mix(a, b, c);
 
             size -= 12;
             key_data += 3;
@@ -129,7 +123,7 @@ ff::stable_hash_data_t ff::stable_hash_incremental(const void* data, size_t size
             b += key_data[2] + (static_cast<uint32_t>(key_data[3]) << 16);
             c += key_data[4] + (static_cast<uint32_t>(key_data[5]) << 16);
 
-            ::hash_mix(a, b, c);
+            ff::internal::stable_hashing::lookup3_mix(a, b, c);
 
             size -= 12;
             key_data += 6;
@@ -215,7 +209,7 @@ ff::stable_hash_data_t ff::stable_hash_incremental(const void* data, size_t size
             c += static_cast<uint32_t>(key_data[10]) << 16;
             c += static_cast<uint32_t>(key_data[11]) << 24;
 
-            ::hash_mix(a, b, c);
+            ff::internal::stable_hashing::lookup3_mix(a, b, c);
 
             size -= 12;
             key_data += 12;
@@ -242,7 +236,91 @@ ff::stable_hash_data_t ff::stable_hash_incremental(const void* data, size_t size
     return ff::stable_hash_data_t(a, b, c);
 }
 
-size_t ff::stable_hash_bytes(const void* data, size_t size) noexcept
+#if FF_HASH_SSE2
+static void wyhash_accumulate_stripe(__m128i* lanes, const uint8_t* data, const __m128i* keys)
 {
-    return ff::stable_hash_incremental(data, size, ff::stable_hash_data_t(size));
+    for (size_t i = 0; i < 4; i++)
+    {
+        const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data) + i);
+        const __m128i keyed = _mm_xor_si128(value, keys[i]);
+
+        // Each 64-bit lane adds its neighbor's value and the product of its own keyed halves
+        const __m128i product = _mm_mul_epu32(keyed, _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+        lanes[i] = _mm_add_epi64(lanes[i], _mm_add_epi64(product, _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2))));
+    }
+}
+
+static void wyhash_scramble(__m128i* lanes, const __m128i* scramble_keys)
+{
+    const __m128i prime = _mm_set1_epi32(static_cast<int>(ff::internal::stable_hashing::wyhash_scramble_prime));
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        __m128i lane = _mm_xor_si128(lanes[i], _mm_srli_epi64(lanes[i], 47));
+        lane = _mm_xor_si128(lane, scramble_keys[i]);
+
+        // 64-bit times 32-bit: low * prime + (high * prime) << 32
+        const __m128i low = _mm_mul_epu32(lane, prime);
+        const __m128i high = _mm_mul_epu32(_mm_srli_epi64(lane, 32), prime);
+        lanes[i] = _mm_add_epi64(low, _mm_slli_epi64(high, 32));
+    }
+}
+
+static uint64_t wyhash_long_sse2(const uint8_t* data, size_t size)
+{
+    std::array<uint64_t, 8> start = ff::internal::stable_hashing::wyhash_long_start();
+    std::array<uint64_t, 8> scramble_keys{};
+    for (size_t lane = 0; lane < scramble_keys.size(); lane++)
+    {
+        scramble_keys[lane] = ff::internal::stable_hashing::wyhash_lane_keys[(lane + 1) % scramble_keys.size()];
+    }
+
+    __m128i lanes[4], keys[4], scramble_keys_sse[4];
+    for (size_t i = 0; i < 4; i++)
+    {
+        lanes[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(start.data()) + i);
+        keys[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ff::internal::stable_hashing::wyhash_lane_keys.data()) + i);
+        scramble_keys_sse[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(scramble_keys.data()) + i);
+    }
+
+    const size_t stripe_count = ff::internal::stable_hashing::wyhash_long_stripe_count(size);
+    for (size_t stripe = 0; stripe < stripe_count; stripe++)
+    {
+        ::wyhash_accumulate_stripe(lanes, data + stripe * ff::internal::stable_hashing::wyhash_stripe_size, keys);
+
+        if ((stripe + 1) % ff::internal::stable_hashing::wyhash_stripes_per_scramble == 0)
+        {
+            ::wyhash_scramble(lanes, scramble_keys_sse);
+        }
+    }
+
+    ::wyhash_accumulate_stripe(lanes, data + size - ff::internal::stable_hashing::wyhash_stripe_size, keys);
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(start.data()) + i, lanes[i]);
+    }
+
+    return ff::internal::stable_hashing::wyhash_long_finish(start, size);
+}
+#endif
+
+size_t ff::stable_hash_bytes(const void* data, size_t size, ff::stable_hash_version version) noexcept
+{
+    if (version == ff::stable_hash_version::lookup3)
+    {
+        return ff::stable_hash_incremental(data, size, ff::stable_hash_data_t(size));
+    }
+
+    assert(version == ff::stable_hash_version::wyhash);
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+#if FF_HASH_SSE2
+    if (size > ff::internal::stable_hashing::wyhash_long_size)
+    {
+        return static_cast<size_t>(::wyhash_long_sse2(bytes, size));
+    }
+#endif
+
+    return static_cast<size_t>(ff::internal::stable_hashing::wyhash(::memory_reader{ bytes }, size));
 }
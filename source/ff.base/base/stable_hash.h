@@ -1,5 +1,316 @@
 #pragma once
 
+namespace ff
+{
+    /// <summary>
+    /// Stable hash algorithms. Their results never change, so anything persisted with one must keep using it.
+    /// </summary>
+    enum class stable_hash_version
+    {
+        lookup3 = 1, // Bob Jenkins' lookup3 on 32-bit lanes, used by all persisted formats before wyhash
+        wyhash = 2, // 64-bit wyhash (final4), with eight independent lanes for long input so it can use SIMD
+
+        current = wyhash,
+    };
+}
+
+namespace ff::internal::stable_hashing
+{
+    // Reads little endian bytes from any integer string, so string literals can be hashed at compile time
+    template<class Elem>
+    struct string_reader
+    {
+        constexpr uint8_t byte(size_t i) const
+        {
+            using unsigned_type = typename std::make_unsigned_t<Elem>;
+            return static_cast<uint8_t>(static_cast<unsigned_type>(this->data[i / sizeof(Elem)]) >> (8 * (i % sizeof(Elem))));
+        }
+
+        constexpr uint32_t read32(size_t i) const
+        {
+            return static_cast<uint32_t>(this->byte(i)) |
+                (static_cast<uint32_t>(this->byte(i + 1)) << 8) |
+                (static_cast<uint32_t>(this->byte(i + 2)) << 16) |
+                (static_cast<uint32_t>(this->byte(i + 3)) << 24);
+        }
+
+        constexpr uint64_t read64(size_t i) const
+        {
+            return static_cast<uint64_t>(this->read32(i)) | (static_cast<uint64_t>(this->read32(i + 4)) << 32);
+        }
+
+        const Elem* data;
+    };
+
+    constexpr size_t lookup3_result(uint32_t b, uint32_t c)
+    {
+        static_assert(sizeof(size_t) == 4 || sizeof(size_t) == 8);
+
+        if constexpr (sizeof(size_t) == 8)
+        {
+            return (static_cast<uint64_t>(b) << 32) | static_cast<uint64_t>(c);
+        }
+        else
+        {
+            return c;
+        }
+    }
+
+    constexpr uint32_t rotate_bits(uint32_t val, uint32_t count)
+    {
+        return (val << count) | (val >> (32 - count));
+    }
+
+    constexpr void lookup3_mix(uint32_t& a, uint32_t& b, uint32_t& c)
+    {
+        a -= c; a ^= rotate_bits(c, 4); c += b;
+        b -= a; b ^= rotate_bits(a, 6); a += c;
+        c -= b; c ^= rotate_bits(b, 8); b += a;
+        a -= c; a ^= rotate_bits(c, 16); c += b;
+        b -= a; b ^= rotate_bits(a, 19); a += c;
+        c -= b; c ^= rotate_bits(b, 4); b += a;
+    }
+
+    constexpr void lookup3_final_mix(uint32_t& a, uint32_t& b, uint32_t& c)
+    {
+        c ^= b; c -= rotate_bits(b, 14);
+        a ^= c; a -= rotate_bits(c, 11);
+        b ^= a; b -= rotate_bits(a, 25);
+        c ^= b; c -= rotate_bits(b, 16);
+        a ^= c; a -= rotate_bits(c, 4);
+        b ^= a; b -= rotate_bits(a, 14);
+        c ^= b; c -= rotate_bits(b, 24);
+    }
+
+    // Same result as ff::stable_hash_bytes with stable_hash_version::lookup3, which has faster paths for aligned data
+    template<class Reader>
+    constexpr size_t lookup3(const Reader& reader, size_t size)
+    {
+        uint32_t a = 0x9e3779b9 + static_cast<uint32_t>(size);
+        uint32_t b = a;
+        uint32_t c = a;
+        size_t i = 0;
+
+        for (; size - i > 12; i += 12)
+        {
+            a += reader.read32(i);
+            b += reader.read32(i + 4);
+            c += reader.read32(i + 8);
+            lookup3_mix(a, b, c);
+        }
+
+        switch (size - i)
+        {
+            case 12: c += static_cast<uint32_t>(reader.byte(i + 11)) << 24; [[fallthrough]];
+            case 11: c += static_cast<uint32_t>(reader.byte(i + 10)) << 16; [[fallthrough]];
+            case 10: c += static_cast<uint32_t>(reader.byte(i + 9)) << 8; [[fallthrough]];
+            case 9: c += reader.byte(i + 8); [[fallthrough]];
+            case 8: b += static_cast<uint32_t>(reader.byte(i + 7)) << 24; [[fallthrough]];
+            case 7: b += static_cast<uint32_t>(reader.byte(i + 6)) << 16; [[fallthrough]];
+            case 6: b += static_cast<uint32_t>(reader.byte(i + 5)) << 8; [[fallthrough]];
+            case 5: b += reader.byte(i + 4); [[fallthrough]];
+            case 4: a += static_cast<uint32_t>(reader.byte(i + 3)) << 24; [[fallthrough]];
+            case 3: a += static_cast<uint32_t>(reader.byte(i + 2)) << 16; [[fallthrough]];
+            case 2: a += static_cast<uint32_t>(reader.byte(i + 1)) << 8; [[fallthrough]];
+            case 1: a += reader.byte(i);
+                break;
+        }
+
+        lookup3_final_mix(a, b, c);
+        return lookup3_result(b, c);
+    }
+
+    constexpr std::array<uint64_t, 4> wyhash_secret{ 0x2d358dccaa6c78a5, 0x8bb84b93962eacc9, 0x4b33a62ed433d4a3, 0x4d5a2da51de1aa47 };
+
+    // Input longer than this goes through eight 64-bit lanes, 64 bytes at a time, with a scramble every 1KB
+    constexpr size_t wyhash_long_size = 256;
+    constexpr size_t wyhash_stripe_size = 64;
+    constexpr size_t wyhash_stripes_per_scramble = 16;
+    constexpr uint32_t wyhash_scramble_prime = 0x9e3779b1;
+
+    constexpr std::array<uint64_t, 8> wyhash_lane_keys // hex digits of pi
+    {
+        0x243f6a8885a308d3, 0x13198a2e03707344, 0xa4093822299f31d0, 0x082efa98ec4e6c89,
+        0x452821e638d01377, 0xbe5466cf34e90c6c, 0xc0ac29b7c97c50dd, 0x3f84d5b5b5470917,
+    };
+
+    // 64x64 to 128-bit multiply, a and b become the low and high halves
+    constexpr void wyhash_mum(uint64_t& a, uint64_t& b)
+    {
+        if (!std::is_constant_evaluated())
+        {
+#if defined(_M_X64)
+            uint64_t high;
+            a = ::_umul128(a, b, &high);
+            b = high;
+            return;
+#elif defined(__SIZEOF_INT128__)
+            const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+            a = static_cast<uint64_t>(product);
+            b = static_cast<uint64_t>(product >> 64);
+            return;
+#endif
+        }
+
+        const uint64_t ha = a >> 32, hb = b >> 32, la = static_cast<uint32_t>(a), lb = static_cast<uint32_t>(b);
+        const uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32);
+        uint64_t carry = t < rl;
+        const uint64_t lo = t + (rm1 << 32);
+        carry += lo < t;
+        a = lo;
+        b = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+    }
+
+    constexpr uint64_t wyhash_mix(uint64_t a, uint64_t b)
+    {
+        wyhash_mum(a, b);
+        return a ^ b;
+    }
+
+    constexpr void wyhash_accumulate(std::array<uint64_t, 8>& lanes, uint64_t value, size_t lane)
+    {
+        const uint64_t keyed = value ^ wyhash_lane_keys[lane];
+        lanes[lane ^ 1] += value;
+        lanes[lane] += (keyed & 0xffffffff) * (keyed >> 32);
+    }
+
+    constexpr void wyhash_scramble(std::array<uint64_t, 8>& lanes)
+    {
+        for (size_t lane = 0; lane < lanes.size(); lane++)
+        {
+            lanes[lane] ^= lanes[lane] >> 47;
+            lanes[lane] ^= wyhash_lane_keys[(lane + 1) % lanes.size()];
+            lanes[lane] *= wyhash_scramble_prime;
+        }
+    }
+
+    constexpr std::array<uint64_t, 8> wyhash_long_start()
+    {
+        std::array<uint64_t, 8> lanes{};
+        for (size_t lane = 0; lane < lanes.size(); lane++)
+        {
+            lanes[lane] = wyhash_lane_keys[lanes.size() - 1 - lane] ^ wyhash_secret[lane % wyhash_secret.size()];
+        }
+
+        return lanes;
+    }
+
+    constexpr uint64_t wyhash_long_finish(const std::array<uint64_t, 8>& lanes, size_t size)
+    {
+        uint64_t hash = static_cast<uint64_t>(size) * wyhash_secret[0];
+        for (size_t lane = 0; lane < lanes.size(); lane += 2)
+        {
+            hash = wyhash_mix(lanes[lane] ^ wyhash_secret[1], lanes[lane + 1] ^ hash);
+        }
+
+        return wyhash_mix(hash ^ wyhash_secret[2], static_cast<uint64_t>(size) ^ wyhash_secret[3]);
+    }
+
+    // The number of full stripes before the last 64 bytes, which are always hashed as one more (maybe overlapping) stripe
+    constexpr size_t wyhash_long_stripe_count(size_t size)
+    {
+        return (size - 1) / wyhash_stripe_size;
+    }
+
+    // Scalar version of the long input lanes, the runtime version uses SIMD but must give the same result
+    template<class Reader>
+    constexpr uint64_t wyhash_long(const Reader& reader, size_t size)
+    {
+        std::array<uint64_t, 8> lanes = wyhash_long_start();
+        const size_t stripe_count = wyhash_long_stripe_count(size);
+
+        for (size_t stripe = 0; stripe < stripe_count; stripe++)
+        {
+            for (size_t lane = 0; lane < lanes.size(); lane++)
+            {
+                wyhash_accumulate(lanes, reader.read64(stripe * wyhash_stripe_size + lane * 8), lane);
+            }
+
+            if ((stripe + 1) % wyhash_stripes_per_scramble == 0)
+            {
+                wyhash_scramble(lanes);
+            }
+        }
+
+        for (size_t lane = 0; lane < lanes.size(); lane++)
+        {
+            wyhash_accumulate(lanes, reader.read64(size - wyhash_stripe_size + lane * 8), lane);
+        }
+
+        return wyhash_long_finish(lanes, size);
+    }
+
+    // Short and medium input is wyhash final4 with a zero seed, by Wang Yi, public domain (The Unlicense).
+    // See https://github.com/wangyi-fudan/wyhash
+    template<class Reader>
+    constexpr uint64_t wyhash(const Reader& reader, size_t size)
+    {
+        if (size > wyhash_long_size)
+        {
+            return wyhash_long(reader, size);
+        }
+
+        uint64_t seed = wyhash_mix(wyhash_secret[0], wyhash_secret[1]);
+        uint64_t a = 0, b = 0;
+
+        if (size <= 16)
+        {
+            if (size >= 4)
+            {
+                const size_t offset = (size >> 3) << 2;
+                a = (static_cast<uint64_t>(reader.read32(0)) << 32) | reader.read32(offset);
+                b = (static_cast<uint64_t>(reader.read32(size - 4)) << 32) | reader.read32(size - 4 - offset);
+            }
+            else if (size > 0)
+            {
+                a = (static_cast<uint64_t>(reader.byte(0)) << 16) | (static_cast<uint64_t>(reader.byte(size >> 1)) << 8) | reader.byte(size - 1);
+            }
+        }
+        else
+        {
+            size_t i = 0;
+            size_t remaining = size;
+
+            if (remaining > 48)
+            {
+                uint64_t see1 = seed, see2 = seed;
+                do
+                {
+                    seed = wyhash_mix(reader.read64(i) ^ wyhash_secret[1], reader.read64(i + 8) ^ seed);
+                    see1 = wyhash_mix(reader.read64(i + 16) ^ wyhash_secret[2], reader.read64(i + 24) ^ see1);
+                    see2 = wyhash_mix(reader.read64(i + 32) ^ wyhash_secret[3], reader.read64(i + 40) ^ see2);
+                    i += 48;
+                    remaining -= 48;
+                }
+                while (remaining > 48);
+
+                seed ^= see1 ^ see2;
+            }
+
+            for (; remaining > 16; i += 16, remaining -= 16)
+            {
+                seed = wyhash_mix(reader.read64(i) ^ wyhash_secret[1], reader.read64(i + 8) ^ seed);
+            }
+
+            a = reader.read64(i + remaining - 16);
+            b = reader.read64(i + remaining - 8);
+        }
+
+        a ^= wyhash_secret[1];
+        b ^= seed;
+        wyhash_mum(a, b);
+        return wyhash_mix(a ^ wyhash_secret[0] ^ static_cast<uint64_t>(size), b ^ wyhash_secret[1]);
+    }
+
+    template<class Reader>
+    constexpr size_t hash(const Reader& reader, size_t size, ff::stable_hash_version version)
+    {
+        return (version == ff::stable_hash_version::lookup3)
+            ? lookup3(reader, size)
+            : static_cast<size_t>(wyhash(reader, size));
+    }
+}
+
 namespace ff
 {
     struct stable_hash_data_t
@@ -19,23 +330,38 @@ namespace ff
         uint32_t a, b, c;
     };
 
+    // Incremental hashing is always lookup3
     ff::stable_hash_data_t stable_hash_incremental(const void* data, size_t size, const ff::stable_hash_data_t& prev_data = ff::stable_hash_data_t()) noexcept;
-    size_t stable_hash_bytes(const void* data, size_t size) noexcept;
+    size_t stable_hash_bytes(const void* data, size_t size, ff::stable_hash_version version = ff::stable_hash_version::current) noexcept;
+
+    /// <summary>
+    /// Hashes the bytes of a string, at compile time when possible
+    /// </summary>
+    template<class Elem>
+    constexpr size_t stable_hash_string(const Elem* data, size_t size, ff::stable_hash_version version = ff::stable_hash_version::current) noexcept
+    {
+        if (std::is_constant_evaluated())
+        {
+            return ff::internal::stable_hashing::hash(ff::internal::stable_hashing::string_reader<Elem>{ data }, size * sizeof(Elem), version);
+        }
+
+        return ff::stable_hash_bytes(data, size * sizeof(Elem), version);
+    }
 
     /// <summary>
     /// Replacement for std::hash that is always stable, the hashes could be persisted.
     /// </summary>
-    template<class T>
+    template<class T, ff::stable_hash_version Version = ff::stable_hash_version::current>
     struct stable_hash
     {
         size_t operator()(const T& value) const noexcept
         {
-            return ff::stable_hash_bytes(&value, sizeof(T));
+            return ff::stable_hash_bytes(&value, sizeof(T), Version);
         }
     };
 
-    template<>
-    struct stable_hash<std::type_index>
+    template<ff::stable_hash_version Version>
+    struct stable_hash<std::type_index, Version>
     {
         size_t operator()(const std::type_index& value) const noexcept
         {
@@ -43,30 +369,30 @@ namespace ff
         }
     };
 
-    template<class Elem, class Traits>
-    struct stable_hash<std::basic_string_view<Elem, Traits>>
+    template<class Elem, class Traits, ff::stable_hash_version Version>
+    struct stable_hash<std::basic_string_view<Elem, Traits>, Version>
     {
-        size_t operator()(const std::basic_string_view<Elem, Traits>& value) const noexcept
+        constexpr size_t operator()(const std::basic_string_view<Elem, Traits>& value) const noexcept
         {
-            return ff::stable_hash_bytes(value.data(), value.size() * sizeof(Elem));
+            return ff::stable_hash_string(value.data(), value.size(), Version);
         }
     };
 
-    template<class Elem, class Traits, class Alloc>
-    struct stable_hash<std::basic_string<Elem, Traits, Alloc>>
+    template<class Elem, class Traits, class Alloc, ff::stable_hash_version Version>
+    struct stable_hash<std::basic_string<Elem, Traits, Alloc>, Version>
     {
-        size_t operator()(const std::basic_string<Elem, Traits, Alloc>& value) const noexcept
+        constexpr size_t operator()(const std::basic_string<Elem, Traits, Alloc>& value) const noexcept
         {
-            return ff::stable_hash_bytes(value.data(), value.size() * sizeof(Elem));
+            return ff::stable_hash_string(value.data(), value.size(), Version);
         }
     };
 
-    template<>
-    struct stable_hash<std::filesystem::path>
+    template<ff::stable_hash_version Version>
+    struct stable_hash<std::filesystem::path, Version>
     {
         size_t operator()(const std::filesystem::path& value) const noexcept
         {
-            return ff::stable_hash<std::wstring>()(value.native());
+            return ff::stable_hash<std::wstring, Version>()(value.native());
         }
     };
 
@@ -82,9 +408,10 @@ namespace ff
         }
     };
 
-    template<class T>
-    size_t stable_hash_func(const T& value)
+    // Persisted hashes must pass their version, like ff::stable_hash_func<ff::stable_hash_version::lookup3>("cookie"sv)
+    template<ff::stable_hash_version Version = ff::stable_hash_version::current, class T>
+    constexpr size_t stable_hash_func(const T& value)
     {
-        return ff::stable_hash<T>()(value);
+        return ff::stable_hash<T, Version>()(value);
     }
 }
@@ -1,10 +1,28 @@
 #include "pch.h"
 #include "base/assert.h"
+#include "base/stable_hash.h"
 #include "data_persist/compression.h"
 #include "data_persist/data.h"
+#include "data_persist/persist.h"
 #include "data_persist/stream.h"
+#include "thread/thread_pool.h"
 #include <zlib/zlib.h>
 
+using namespace std::string_view_literals;
+
+namespace
+{
+    struct block_header_t
+    {
+        uint64_t cookie;
+        uint64_t full_size;
+        uint32_t block_size;
+        uint32_t block_count;
+    };
+}
+
+static constexpr uint64_t BLOCKS_PERSIST_COOKIE = static_cast<uint64_t>(ff::stable_hash_func<ff::stable_hash_version::lookup3>("ff::compression::blocks@1"sv));
+
 static size_t get_chunk_size_for_data_size(size_t data_size)
 {
     static const size_t max_chunk_size = 1024 * 256;
@@ -119,6 +137,146 @@ bool ff::compression::uncompress(reader_base& reader, size_t saved_size, writer_
     return status;
 }
 
+bool ff::compression::compress_blocks(reader_base& reader, size_t full_size, writer_base& writer, int level, size_t block_size)
+{
+    assert_ret_val(block_size && block_size <= std::numeric_limits<uint32_t>::max() && level >= 0 && level <= Z_BEST_COMPRESSION, false);
+
+    std::vector<uint8_t> input(full_size);
+    assert_ret_val(reader.read(input.data(), full_size) == full_size, false);
+
+    const size_t block_count = (full_size + block_size - 1) / block_size;
+    assert_ret_val(block_count <= std::numeric_limits<uint32_t>::max(), false);
+
+    std::vector<std::vector<uint8_t>> blocks(block_count);
+    std::atomic_bool status = true;
+
+    ff::thread_pool::parallel_for(0, block_count, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                const uint8_t* block_data = input.data() + i * block_size;
+                const size_t block_data_size = std::min(block_size, full_size - i * block_size);
+                std::vector<uint8_t>& block = blocks[i];
+
+                uLongf compressed_size = ::compressBound(static_cast<uLong>(block_data_size));
+                block.resize(compressed_size);
+
+                if (::compress2(block.data(), &compressed_size, block_data, static_cast<uLong>(block_data_size), level) == Z_OK)
+                {
+                    block.resize(compressed_size);
+                }
+                else
+                {
+                    status = false;
+                }
+            }
+        }, 1);
+
+    assert_ret_val(status, false);
+
+    // The index stores where each compressed block ends, relative to the first block
+    std::vector<uint64_t> block_ends;
+    block_ends.reserve(block_count);
+
+    for (const std::vector<uint8_t>& block : blocks)
+    {
+        block_ends.push_back((block_ends.empty() ? 0 : block_ends.back()) + block.size());
+    }
+
+    const block_header_t header{ ::BLOCKS_PERSIST_COOKIE, full_size, static_cast<uint32_t>(block_size), static_cast<uint32_t>(block_count) };
+    assert_ret_val(ff::save(writer, header), false);
+    assert_ret_val(block_ends.empty() || ff::save_bytes(writer, block_ends.data(), block_ends.size() * sizeof(uint64_t)), false);
+
+    for (const std::vector<uint8_t>& block : blocks)
+    {
+        assert_ret_val(writer.write(block.data(), block.size()) == block.size(), false);
+    }
+
+    return true;
+}
+
+bool ff::compression::uncompress_blocks(reader_base& reader, size_t saved_size, writer_base& writer)
+{
+    std::shared_ptr<ff::data_base> data = ff::compression::uncompress_blocks(reader, saved_size, 0, std::numeric_limits<size_t>::max());
+    return data && writer.write(data->data(), data->size()) == data->size();
+}
+
+std::shared_ptr<ff::data_base> ff::compression::uncompress_blocks(reader_base& reader, size_t saved_size, size_t offset, size_t size)
+{
+    const size_t start_pos = reader.pos();
+    block_header_t header;
+    assert_ret_val(saved_size >= sizeof(header) && ff::load(reader, header) && header.cookie == ::BLOCKS_PERSIST_COOKIE && header.block_size, nullptr);
+
+    const size_t block_size = header.block_size;
+    const size_t full_size = static_cast<size_t>(header.full_size);
+    const size_t index_size = header.block_count * sizeof(uint64_t);
+    assert_ret_val(saved_size >= sizeof(header) + index_size && header.block_count == (full_size + block_size - 1) / block_size, nullptr);
+
+    // The size is clamped to the end of the data
+    assert_ret_val(offset <= full_size, nullptr);
+    size = std::min(size, full_size - offset);
+
+    std::vector<uint8_t> output(size);
+    if (size)
+    {
+        std::vector<uint64_t> block_ends(header.block_count);
+        assert_ret_val(ff::load_bytes(reader, block_ends.data(), index_size), nullptr);
+
+        // Only read the compressed bytes for blocks that overlap the range
+        const size_t first_block = offset / block_size;
+        const size_t last_block = (offset + size - 1) / block_size;
+        const size_t compressed_start = first_block ? static_cast<size_t>(block_ends[first_block - 1]) : 0;
+        const size_t compressed_end = static_cast<size_t>(block_ends[last_block]);
+        const size_t payload_pos = start_pos + sizeof(header) + index_size;
+        assert_ret_val(compressed_end <= saved_size - sizeof(header) - index_size, nullptr);
+        assert_ret_val(std::is_sorted(block_ends.begin(), block_ends.end()), nullptr);
+
+        std::vector<uint8_t> compressed(compressed_end - compressed_start);
+        assert_ret_val(reader.pos(payload_pos + compressed_start) == payload_pos + compressed_start &&
+            reader.read(compressed.data(), compressed.size()) == compressed.size(), nullptr);
+
+        std::atomic_bool status = true;
+        ff::thread_pool::parallel_for(first_block, last_block + 1, [&](size_t begin, size_t end)
+            {
+                std::vector<uint8_t> partial_block;
+
+                for (size_t i = begin; i < end && status; i++)
+                {
+                    const size_t block_start = i * block_size;
+                    const size_t block_data_size = std::min(block_size, full_size - block_start);
+                    const size_t copy_start = std::max(block_start, offset);
+                    const size_t copy_end = std::min(block_start + block_data_size, offset + size);
+                    const size_t block_compressed_start = (i ? static_cast<size_t>(block_ends[i - 1]) : 0) - compressed_start;
+                    const size_t block_compressed_size = static_cast<size_t>(block_ends[i]) - compressed_start - block_compressed_start;
+
+                    // Blocks completely inside of the range are uncompressed in place
+                    const bool whole_block = (copy_start == block_start && copy_end == block_start + block_data_size);
+                    if (!whole_block)
+                    {
+                        partial_block.resize(block_data_size);
+                    }
+
+                    uint8_t* dest = whole_block ? output.data() + (block_start - offset) : partial_block.data();
+                    uLongf dest_size = static_cast<uLongf>(block_data_size);
+
+                    if (::uncompress(dest, &dest_size, compressed.data() + block_compressed_start, static_cast<uLong>(block_compressed_size)) != Z_OK || dest_size != block_data_size)
+                    {
+                        status = false;
+                    }
+                    else if (!whole_block)
+                    {
+                        std::memcpy(output.data() + (copy_start - offset), partial_block.data() + (copy_start - block_start), copy_end - copy_start);
+                    }
+                }
+            }, 1);
+
+        assert_ret_val(status, nullptr);
+    }
+
+    reader.pos(start_pos + saved_size);
+    return std::make_shared<ff::data_vector>(std::move(output));
+}
+
 static uint8_t CHAR_TO_BYTE[] =
 {
     62, // +
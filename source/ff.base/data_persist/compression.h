@@ -9,8 +9,18 @@ namespace ff
 
 namespace ff::compression
 {
+    constexpr int best_level = 9;
+    constexpr int default_level = 6;
+    constexpr int fastest_level = 1;
+    constexpr size_t default_block_size = 256 * 1024;
+
     bool compress(reader_base& reader, size_t full_size, writer_base& writer);
     bool uncompress(reader_base& reader, size_t saved_size, writer_base& writer);
 
+    // Independent zlib blocks after a block index, so blocks compress in parallel and any range can be uncompressed alone
+    bool compress_blocks(reader_base& reader, size_t full_size, writer_base& writer, int level = ff::compression::best_level, size_t block_size = ff::compression::default_block_size);
+    bool uncompress_blocks(reader_base& reader, size_t saved_size, writer_base& writer);
+    std::shared_ptr<data_base> uncompress_blocks(reader_base& reader, size_t saved_size, size_t offset, size_t size);
+
     std::shared_ptr<data_base> decode_base64(std::string_view text);
 }
@@ -4,6 +4,7 @@
 #include "base/stable_hash.h"
 #include "data_persist/data.h"
 #include "data_persist/dict.h"
+#include "data_persist/flat_dict.h"
 #include "data_persist/persist.h"
 #include "data_persist/saved_data.h"
 #include "data_persist/stream.h"
@@ -15,31 +16,7 @@
 
 using namespace std::string_view_literals;
 
-static const size_t DICT_PERSIST_COOKIE = ff::stable_hash_func("ff::dict@0"sv);
-
-static const std::string& get_cached_string(std::string_view str)
-{
-    static std::forward_list<std::string> string_list;
-    static std::unordered_map<std::string_view, const std::string&> string_map;
-    static std::shared_mutex mutex;
-
-    // Check if it's cached already
-    {
-        std::shared_lock lock(mutex);
-        auto i = string_map.find(str);
-        if (i != string_map.cend())
-        {
-            return i->second;
-        }
-    }
-
-    // Add to the cache
-    {
-        std::unique_lock lock(mutex);
-        const std::string& new_str = string_list.emplace_front(str);
-        return string_map.try_emplace(new_str, new_str).first->second;
-    }
-}
+static constexpr size_t DICT_PERSIST_COOKIE = ff::stable_hash_func<ff::stable_hash_version::lookup3>("ff::dict@0"sv);
 
 bool ff::dict::operator==(const dict& other) const
 {
@@ -111,11 +88,30 @@ void ff::dict::set(std::string_view name, const value* value)
 {
     if (!value)
     {
-        this->map.erase(name);
+        // A name that was never interned can't be in any dict
+        ff::interned_key key = ff::interned_key::find(name);
+        if (key.valid())
+        {
+            this->map.erase(key);
+        }
     }
     else
     {
-        this->map.insert_or_assign(::get_cached_string(name), value);
+        this->map.insert_or_assign(ff::interned_key(name), value);
+    }
+}
+
+void ff::dict::set(const ff::interned_key& key, const value* value)
+{
+    assert_ret(key.valid());
+
+    if (!value)
+    {
+        this->map.erase(key);
+    }
+    else
+    {
+        this->map.insert_or_assign(key, value);
     }
 }
 
@@ -137,13 +133,22 @@ ff::value_ptr ff::dict::get(std::string_view name) const
     value_ptr value = this->get_by_path(name);
     if (!value)
     {
-        auto i = this->map.find(name);
-        value = (i != this->map.cend()) ? i->second : nullptr;
+        ff::interned_key key = ff::interned_key::find(name);
+        if (key.valid())
+        {
+            value = this->get(key);
+        }
     }
 
     return value;
 }
 
+ff::value_ptr ff::dict::get(const ff::interned_key& key) const
+{
+    auto i = this->map.find(key);
+    return (i != this->map.cend()) ? i->second : nullptr;
+}
+
 bool ff::dict::get_bytes(std::string_view name, void* data, size_t size) const
 {
     std::shared_ptr<ff::data_base> value = this->get<ff::data_base>(name);
@@ -221,6 +226,11 @@ bool ff::dict::load_child_dicts()
 }
 
 bool ff::dict::save(ff::writer_base& writer, ff::push_base<ff::dict::location_t>* saved_locations) const
+{
+    return ff::flat_dict::save(*this, writer, saved_locations);
+}
+
+bool ff::dict::save_legacy(ff::writer_base& writer, ff::push_base<ff::dict::location_t>* saved_locations) const
 {
     const size_t start_pos = writer.pos();
     const size_t size = this->size();
@@ -247,9 +257,28 @@ bool ff::dict::save(ff::writer_base& writer, ff::push_base<ff::dict::location_t>
 
 bool ff::dict::load(ff::reader_base& reader, ff::dict& data)
 {
-    size_t cookie, size;
-    if (!ff::load(reader, cookie) || cookie != ::DICT_PERSIST_COOKIE ||
-        !ff::load(reader, size))
+    const size_t start_pos = reader.pos();
+    uint64_t cookie;
+    if (!ff::load(reader, cookie))
+    {
+        return false;
+    }
+
+    if (ff::flat_dict::is_flat(cookie))
+    {
+        std::shared_ptr<ff::data_base> flat_data = (reader.pos(start_pos) == start_pos) ? ff::flat_dict::read(reader) : nullptr;
+        if (!flat_data)
+        {
+            return false;
+        }
+
+        data.set(ff::flat_dict(flat_data).to_dict(), false);
+        return true;
+    }
+
+    // Older cookie based format
+    size_t size;
+    if (cookie != ::DICT_PERSIST_COOKIE || !ff::load(reader, size))
     {
         return false;
     }
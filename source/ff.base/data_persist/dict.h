@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../types/interned_key.h"
 #include "../types/push_back.h"
 #include "../data_value/value.h"
 
@@ -11,7 +12,7 @@ namespace ff
     class dict
     {
     public:
-        using map_type = typename std::unordered_map<std::string_view, value_ptr>;
+        using map_type = typename std::unordered_map<ff::interned_key, value_ptr, ff::interned_key::hasher, ff::interned_key::equal_to>;
         using iterator = typename map_type::iterator;
         using const_iterator = typename map_type::const_iterator;
 
@@ -31,8 +32,10 @@ namespace ff
 
         void set(const dict& other, bool merge_child_dicts);
         void set(std::string_view name, const value* value);
+        void set(const ff::interned_key& key, const value* value);
         void set_bytes(std::string_view name, const void* data, size_t size);
         value_ptr get(std::string_view name) const;
+        value_ptr get(const ff::interned_key& key) const; // no hashing or string compares, and no "/path" lookups
         bool get_bytes(std::string_view name, void* data, size_t size) const;
 
         struct location_t
@@ -44,6 +47,7 @@ namespace ff
 
         std::vector<std::string_view> child_names(bool sorted = false) const;
         bool save(ff::writer_base& writer, ff::push_base<ff::dict::location_t>* saved_locations = nullptr) const;
+        bool save_legacy(ff::writer_base& writer, ff::push_base<ff::dict::location_t>* saved_locations = nullptr) const;
         static bool load(ff::reader_base& reader, ff::dict& data);
         bool load_child_dicts();
 
@@ -64,12 +68,24 @@ namespace ff
             this->set(name, ff::value::create<T>(std::forward<Args>(args)...));
         }
 
+        template<class T, typename... Args>
+        void set(const ff::interned_key& key, Args&&... args)
+        {
+            this->set(key, ff::value::create<T>(std::forward<Args>(args)...));
+        }
+
         template<class T>
         auto get(std::string_view name) const -> typename ff::type::value_traits<T>::raw_type
         {
             return this->get(name)->convert_or_default<T>()->get<T>();
         }
 
+        template<class T>
+        auto get(const ff::interned_key& key) const -> typename ff::type::value_traits<T>::raw_type
+        {
+            return this->get(key)->convert_or_default<T>()->get<T>();
+        }
+
         template<class T, typename... Args>
         auto get(std::string_view name, Args&&... default_value_args) const -> typename ff::type::value_traits<T>::raw_type
         {
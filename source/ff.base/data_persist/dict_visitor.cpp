@@ -6,10 +6,22 @@
 #include "data_value/saved_data_v.h"
 #include "data_value/value.h"
 #include "data_value/value_vector_v.h"
-#include "thread/thread_dispatch.h"
 #include "thread/thread_pool.h"
 #include "windows/win_handle.h"
 
+namespace
+{
+    // Shared with helper tasks that might only start after the transform is done, they won't touch anything else once closed
+    struct transform_async_data
+    {
+        std::mutex mutex;
+        std::atomic_size_t next{};
+        size_t active{};
+        bool closed{};
+        ff::win_event done_event;
+    };
+}
+
 ff::dict_visitor_base::dict_visitor_base()
 {}
 
@@ -163,17 +175,18 @@ ff::value_ptr ff::dict_visitor_base::transform_dict_async(const ff::dict& dict)
     bool root = this->is_root();
     std::vector<std::string_view> names = dict.child_names();
     std::vector<ff::value_ptr> values(names.size());
-    std::vector<ff::win_event> value_events(names.size());
     DWORD main_thread_id = ::GetCurrentThreadId();
 
     for (size_t i = 0; i < names.size(); i++)
     {
         values[i] = dict.get(names[i]);
-        value_events[i] = ff::win_event();
+    }
 
-        ff::thread_pool::add_task([this, root, main_thread_id, i, &names, &values, &value_events]()
+    auto data = std::make_shared<::transform_async_data>();
+    auto transform_values = [this, root, &names, &values, data]()
+        {
+            for (size_t i; (i = data->next.fetch_add(1)) < names.size(); )
             {
-                this->async_thread_started(main_thread_id);
                 this->push_path(names[i]);
 
                 values[i] = root
@@ -181,31 +194,60 @@ ff::value_ptr ff::dict_visitor_base::transform_dict_async(const ff::dict& dict)
                     : this->transform_value(values[i]);
 
                 this->pop_path();
-                this->async_thread_done();
+            }
+        };
 
-                value_events[i].set();
+    const size_t helper_count = names.empty() ? 0 : std::min(names.size() - 1, ff::thread_pool::thread_count());
+    for (size_t i = 0; i < helper_count; i++)
+    {
+        ff::thread_pool::add_task([this, main_thread_id, data, transform_values]()
+            {
+                {
+                    std::scoped_lock lock(data->mutex);
+                    if (data->closed)
+                    {
+                        return;
+                    }
+
+                    data->active++;
+                }
+
+                // Tasks run inline when the pool is shutting down, and the calling thread already has its own path
+                const bool other_thread = (::GetCurrentThreadId() != main_thread_id);
+                if (other_thread)
+                {
+                    this->async_thread_started(main_thread_id);
+                }
+
+                transform_values();
+
+                if (other_thread)
+                {
+                    this->async_thread_done();
+                }
+
+                std::scoped_lock lock(data->mutex);
+                if (!--data->active && data->closed)
+                {
+                    data->done_event.set();
+                }
             });
     }
 
-    std::vector<HANDLE> handles(value_events.size());
-    for (size_t i = 0; i < value_events.size(); i++)
+    transform_values();
     {
-        handles[i] = value_events[i];
-    }
+        std::scoped_lock lock(data->mutex);
+        data->closed = true;
 
-    while (!handles.empty())
-    {
-        size_t handle_count = std::min<size_t>(ff::thread_dispatch::maximum_wait_objects, handles.size());
-        if (ff::wait_for_all_handles(handles.data(), handle_count))
+        if (!data->active)
         {
-            handles.erase(handles.cbegin(), handles.cbegin() + handle_count);
-        }
-        else
-        {
-            handles.clear();
+            data->done_event.set();
         }
     }
 
+    // Transforms can post work back to this thread and wait for it, so keep dispatching while helpers finish
+    data->done_event.wait();
+
     ff::dict output_dict;
     output_dict.reserve(names.size());
 
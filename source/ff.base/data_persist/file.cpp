@@ -56,6 +56,20 @@ size_t ff::file_base::pos(size_t new_pos)
     return static_cast<size_t>(cur.QuadPart);
 }
 
+uint64_t ff::file_base::last_write_time() const
+{
+    assert(this->handle_);
+
+    FILE_BASIC_INFO info;
+    if (!::GetFileInformationByHandleEx(this->handle_, FileBasicInfo, &info, sizeof(info)))
+    {
+        assert(false);
+        return 0;
+    }
+
+    return static_cast<uint64_t>(info.LastWriteTime.QuadPart);
+}
+
 const ff::win_handle& ff::file_base::handle() const
 {
     return this->handle_;
@@ -18,6 +18,7 @@ namespace ff
         size_t size() const;
         size_t pos() const;
         size_t pos(size_t new_pos);
+        uint64_t last_write_time() const; // FILETIME ticks
         const ff::win_handle& handle() const;
         const std::filesystem::path& path() const;
 
@@ -0,0 +1,301 @@
+#include "pch.h"
+#include "base/assert.h"
+#include "base/math.h"
+#include "base/stable_hash.h"
+#include "data_persist/data.h"
+#include "data_persist/dict.h"
+#include "data_persist/flat_dict.h"
+#include "data_persist/persist.h"
+#include "data_persist/stream.h"
+#include "types/push_back.h"
+
+using namespace std::string_view_literals;
+
+static constexpr uint64_t FLAT_DICT_PERSIST_COOKIE = static_cast<uint64_t>(ff::stable_hash_func<ff::stable_hash_version::lookup3>("ff::flat_dict@1"sv));
+static constexpr size_t max_inline_size = 8;
+
+static uint64_t hash_name(std::string_view name)
+{
+    return static_cast<uint64_t>(ff::stable_hash_func<ff::stable_hash_version::lookup3>(name));
+}
+
+ff::flat_dict::flat_dict(const std::shared_ptr<ff::data_base>& data)
+{
+    header_t header;
+    assert_ret(data && data->size() >= sizeof(header) && data->data());
+    std::memcpy(&header, data->data(), sizeof(header));
+    assert_ret(header.cookie == ::FLAT_DICT_PERSIST_COOKIE && header.version == ff::flat_dict::current_version);
+    assert_ret(header.size >= sizeof(header) && header.size <= data->size() && header.count <= (header.size - sizeof(header)) / sizeof(entry_t));
+
+    std::shared_ptr<ff::data_base> aligned_data = data;
+    if (reinterpret_cast<size_t>(data->data()) % alignof(entry_t))
+    {
+        // The entry table is read in place, so it must be aligned
+        std::vector<uint8_t> bytes(data->data(), data->data() + static_cast<size_t>(header.size));
+        aligned_data = std::make_shared<ff::data_vector>(std::move(bytes));
+    }
+
+    // Names and values are read in place later without checks, 32-bit offsets and sizes can't overflow when added as 64-bit
+    const entry_t* entries = reinterpret_cast<const entry_t*>(aligned_data->data() + sizeof(header));
+    for (const entry_t* entry = entries, *end = entries + header.count; entry != end; entry++)
+    {
+        assert_ret(static_cast<uint64_t>(entry->name_offset) + entry->name_size <= header.size &&
+            static_cast<uint64_t>(entry->value_offset) + entry->value_size <= header.size);
+    }
+
+    this->data_ = std::move(aligned_data);
+    this->entries = entries;
+    this->count = header.count;
+    this->values.resize(this->count);
+}
+
+ff::flat_dict::flat_dict(flat_dict&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+ff::flat_dict& ff::flat_dict::operator=(flat_dict&& other) noexcept
+{
+    if (this != &other)
+    {
+        std::scoped_lock lock(this->values_mutex, other.values_mutex);
+        this->data_ = std::move(other.data_);
+        this->entries = std::exchange(other.entries, nullptr);
+        this->count = std::exchange(other.count, 0);
+        this->values = std::move(other.values);
+    }
+
+    return *this;
+}
+
+bool ff::flat_dict::is_flat(uint64_t cookie)
+{
+    return cookie == ::FLAT_DICT_PERSIST_COOKIE;
+}
+
+std::shared_ptr<ff::data_base> ff::flat_dict::read(ff::reader_base& reader)
+{
+    header_t header;
+    if (!ff::load(reader, header) || header.cookie != ::FLAT_DICT_PERSIST_COOKIE ||
+        header.version != ff::flat_dict::current_version || header.size < sizeof(header) ||
+        header.size - sizeof(header) > reader.size() - std::min(reader.pos(), reader.size()))
+    {
+        // Don't allocate a size that the stream can't possibly contain
+        return nullptr;
+    }
+
+    std::vector<uint8_t> bytes(static_cast<size_t>(header.size));
+    std::memcpy(bytes.data(), &header, sizeof(header));
+
+    if (!ff::load_bytes(reader, bytes.data() + sizeof(header), bytes.size() - sizeof(header)))
+    {
+        return nullptr;
+    }
+
+    return std::make_shared<ff::data_vector>(std::move(bytes));
+}
+
+bool ff::flat_dict::save(const ff::dict& dict, ff::writer_base& writer, ff::push_base<ff::dict::location_t>* saved_locations)
+{
+    struct save_entry_t
+    {
+        uint64_t hash;
+        std::string_view name;
+        size_t value_start;
+        size_t value_size;
+    };
+
+    // Values are saved first so that all offsets are known before writing the entry table
+    auto value_bytes = std::make_shared<std::vector<uint8_t>>();
+    std::vector<save_entry_t> save_entries;
+    save_entries.reserve(dict.size());
+    {
+        ff::data_writer value_writer(value_bytes);
+        for (const auto& i : dict)
+        {
+            const size_t value_start = value_writer.pos();
+            assert_ret_val(i.second->save_typed(value_writer), false);
+            save_entries.push_back(save_entry_t{ ::hash_name(i.first), i.first, value_start, value_writer.pos() - value_start });
+        }
+    }
+
+    std::sort(save_entries.begin(), save_entries.end(), [](const save_entry_t& lhs, const save_entry_t& rhs)
+        {
+            return lhs.hash < rhs.hash || (lhs.hash == rhs.hash && lhs.name < rhs.name);
+        });
+
+    size_t names_size = 0;
+    size_t values_size = 0;
+    for (const save_entry_t& i : save_entries)
+    {
+        names_size += i.name.size();
+        values_size += (i.value_size > ::max_inline_size) ? i.value_size : 0;
+    }
+
+    // Values must keep their four byte alignment since they were saved with padding
+    const size_t names_start = sizeof(header_t) + save_entries.size() * sizeof(entry_t);
+    const size_t values_start = ff::math::round_up<size_t>(names_start + names_size, 8);
+    const size_t total_size = ff::math::round_up<size_t>(values_start + values_size, 8);
+    assert_ret_val(total_size <= std::numeric_limits<uint32_t>::max(), false);
+
+    header_t header{ ::FLAT_DICT_PERSIST_COOKIE, ff::flat_dict::current_version, static_cast<uint32_t>(save_entries.size()), total_size };
+    std::vector<entry_t> entries;
+    entries.reserve(save_entries.size());
+
+    size_t name_offset = names_start;
+    size_t value_offset = values_start;
+    for (const save_entry_t& i : save_entries)
+    {
+        entry_t& entry = entries.emplace_back(entry_t{ i.hash, static_cast<uint32_t>(name_offset), static_cast<uint32_t>(i.name.size()) });
+        entry.value_size = static_cast<uint32_t>(i.value_size);
+
+        if (i.value_size <= ::max_inline_size)
+        {
+            entry.value_offset = static_cast<uint32_t>(sizeof(header_t) + (entries.size() - 1) * sizeof(entry_t) + offsetof(entry_t, inline_value));
+            std::memcpy(entry.inline_value.data(), value_bytes->data() + i.value_start, i.value_size);
+        }
+        else
+        {
+            entry.value_offset = static_cast<uint32_t>(value_offset);
+            value_offset += i.value_size;
+        }
+
+        name_offset += i.name.size();
+
+        if (saved_locations)
+        {
+            saved_locations->push(ff::dict::location_t{ i.name, entry.value_offset, entry.value_size });
+        }
+    }
+
+    writer.reserve(total_size);
+    assert_ret_val(ff::save(writer, header), false);
+    assert_ret_val(entries.empty() || ff::save_bytes(writer, entries.data(), entries.size() * sizeof(entry_t)), false);
+
+    for (const save_entry_t& i : save_entries)
+    {
+        assert_ret_val(writer.write(i.name.data(), i.name.size()) == i.name.size(), false);
+    }
+
+    const std::array<uint8_t, 8> padding{};
+    const size_t names_padding = values_start - names_start - names_size;
+    assert_ret_val(writer.write(padding.data(), names_padding) == names_padding, false);
+
+    for (const save_entry_t& i : save_entries)
+    {
+        if (i.value_size > ::max_inline_size)
+        {
+            assert_ret_val(writer.write(value_bytes->data() + i.value_start, i.value_size) == i.value_size, false);
+        }
+    }
+
+    const size_t values_padding = total_size - values_start - values_size;
+    return writer.write(padding.data(), values_padding) == values_padding;
+}
+
+bool ff::flat_dict::valid() const
+{
+    return this->data_ != nullptr;
+}
+
+bool ff::flat_dict::empty() const
+{
+    return !this->count;
+}
+
+size_t ff::flat_dict::size() const
+{
+    return this->count;
+}
+
+const std::shared_ptr<ff::data_base>& ff::flat_dict::data() const
+{
+    return this->data_;
+}
+
+ff::value_ptr ff::flat_dict::get(std::string_view name) const
+{
+    const entry_t* entry = this->find_entry(name);
+    return entry ? this->value_at(entry - this->entries) : nullptr;
+}
+
+ff::value_ptr ff::flat_dict::value_at(size_t index) const
+{
+    {
+        std::shared_lock lock(this->values_mutex);
+        if (this->values[index])
+        {
+            return this->values[index];
+        }
+    }
+
+    // Decode outside of the lock, if another thread wins the race then its value is used
+    ff::value_ptr value = this->decode_value(this->entries[index]);
+    std::unique_lock lock(this->values_mutex);
+    if (!this->values[index])
+    {
+        this->values[index] = value;
+    }
+
+    return this->values[index];
+}
+
+std::vector<std::string_view> ff::flat_dict::child_names() const
+{
+    std::vector<std::string_view> names;
+    names.reserve(this->count);
+
+    for (size_t i = 0; i < this->count; i++)
+    {
+        names.push_back(this->entry_name(this->entries[i]));
+    }
+
+    return names;
+}
+
+ff::dict ff::flat_dict::to_dict() const
+{
+    ff::dict dict;
+    dict.reserve(this->count);
+
+    // Walk the entry table in order, there's no need to look up names that are already known
+    for (size_t i = 0; i < this->count; i++)
+    {
+        dict.set(this->entry_name(this->entries[i]), this->value_at(i));
+    }
+
+    return dict;
+}
+
+const ff::flat_dict::entry_t* ff::flat_dict::find_entry(std::string_view name) const
+{
+    const uint64_t hash = ::hash_name(name);
+    const entry_t* end = this->entries + this->count;
+    const entry_t* i = std::lower_bound(this->entries, end, hash, [](const entry_t& entry, uint64_t hash)
+        {
+            return entry.hash < hash;
+        });
+
+    for (; i != end && i->hash == hash; i++)
+    {
+        if (this->entry_name(*i) == name)
+        {
+            return i;
+        }
+    }
+
+    return nullptr;
+}
+
+std::string_view ff::flat_dict::entry_name(const entry_t& entry) const
+{
+    return std::string_view(reinterpret_cast<const char*>(this->data_->data() + entry.name_offset), entry.name_size);
+}
+
+ff::value_ptr ff::flat_dict::decode_value(const entry_t& entry) const
+{
+    assert_ret_val(static_cast<size_t>(entry.value_offset) + entry.value_size <= this->data_->size(), nullptr);
+
+    ff::data_reader reader(this->data_->subdata(entry.value_offset, entry.value_size));
+    return ff::value::load_typed(reader);
+}
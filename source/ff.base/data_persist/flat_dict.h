@@ -0,0 +1,98 @@
+#pragma once
+
+#include "../data_persist/dict.h"
+#include "../data_value/value.h"
+#include "../types/push_back.h"
+
+namespace ff
+{
+    class data_base;
+    class reader_base;
+    class writer_base;
+
+    /// <summary>
+    /// Read-only view of a dict saved in the flat binary format, opened directly over its bytes
+    /// </summary>
+    /// <remarks>
+    /// Layout: a header, then a table of fixed size entries sorted by key hash, then the key names,
+    /// then the saved values. Lookups binary search the entry table and compare names in place, so
+    /// no key strings are copied. Values are only decoded the first time they are asked for. Values
+    /// that save into eight bytes or less (with their type ID) are stored inline in their entry.
+    /// </remarks>
+    class flat_dict
+    {
+    public:
+        flat_dict() = default;
+        flat_dict(const std::shared_ptr<ff::data_base>& data);
+        flat_dict(flat_dict&& other) noexcept;
+        flat_dict(const flat_dict& other) = delete;
+
+        flat_dict& operator=(flat_dict&& other) noexcept;
+        flat_dict& operator=(const flat_dict& other) = delete;
+
+        static bool is_flat(uint64_t cookie);
+        static std::shared_ptr<ff::data_base> read(ff::reader_base& reader);
+        static bool save(const ff::dict& dict, ff::writer_base& writer, ff::push_base<ff::dict::location_t>* saved_locations = nullptr);
+
+        bool valid() const;
+        bool empty() const;
+        size_t size() const;
+        const std::shared_ptr<ff::data_base>& data() const;
+
+        ff::value_ptr get(std::string_view name) const;
+        std::vector<std::string_view> child_names() const;
+        ff::dict to_dict() const;
+
+        template<class T>
+        auto get(std::string_view name) const -> typename ff::type::value_traits<T>::raw_type
+        {
+            return this->get(name)->convert_or_default<T>()->get<T>();
+        }
+
+        template<class T, typename... Args>
+        auto get(std::string_view name, Args&&... default_value_args) const -> typename ff::type::value_traits<T>::raw_type
+        {
+            value_ptr value = this->get(name)->try_convert<T>();
+            if (!value)
+            {
+                value = ff::value::create<T>(std::forward<Args>(default_value_args)...);
+            }
+
+            return value->get<T>();
+        }
+
+        static constexpr uint32_t current_version = 1;
+
+    private:
+        struct header_t
+        {
+            uint64_t cookie;
+            uint32_t version;
+            uint32_t count;
+            uint64_t size;
+        };
+
+        struct entry_t
+        {
+            uint64_t hash;
+            uint32_t name_offset;
+            uint32_t name_size;
+            uint32_t value_offset;
+            uint32_t value_size;
+            std::array<uint8_t, 8> inline_value;
+        };
+
+        static_assert(sizeof(header_t) == 24 && sizeof(entry_t) == 32);
+
+        const entry_t* find_entry(std::string_view name) const;
+        ff::value_ptr value_at(size_t index) const;
+        std::string_view entry_name(const entry_t& entry) const;
+        ff::value_ptr decode_value(const entry_t& entry) const;
+
+        std::shared_ptr<ff::data_base> data_;
+        const entry_t* entries{};
+        size_t count{};
+        mutable std::shared_mutex values_mutex;
+        mutable std::vector<ff::value_ptr> values;
+    };
+}
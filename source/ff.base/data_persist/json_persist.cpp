@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "base/assert.h"
 #include "data_persist/json_persist.h"
+#include "data_persist/json_structural.h"
 #include "data_persist/json_tokenizer.h"
 #include "data_value/bool_v.h"
 #include "data_value/dict_v.h"
@@ -15,10 +16,15 @@ constexpr size_t INDENT_SPACES = 2;
 
 static bool json_write_value(const ff::value* value, size_t spaces, std::ostream& output);
 static void json_write_object(const ff::dict& dict, size_t spaces, std::ostream& output);
-static ff::dict parse_object(ff::internal::json_tokenizer& tokenizer, const char** error_pos);
-static ff::value_vector parse_array(ff::internal::json_tokenizer& tokenizer, const char** error_pos);
 
-static ff::value_ptr parse_value(ff::internal::json_tokenizer& tokenizer, const ff::internal::json_token* first_token, const char** error_pos)
+template<class Tokenizer>
+static ff::dict parse_object(Tokenizer& tokenizer, const char** error_pos);
+
+template<class Tokenizer>
+static ff::value_vector parse_array(Tokenizer& tokenizer, const char** error_pos);
+
+template<class Tokenizer>
+static ff::value_ptr parse_value(Tokenizer& tokenizer, const ff::internal::json_token* first_token, const char** error_pos)
 {
     ff::internal::json_token token = first_token ? *first_token : tokenizer.next();
     ff::value_ptr value = token.get();
@@ -53,7 +59,8 @@ static ff::value_ptr parse_value(ff::internal::json_tokenizer& tokenizer, const
     return value;
 }
 
-static ff::value_vector parse_array(ff::internal::json_tokenizer& tokenizer, const char** error_pos)
+template<class Tokenizer>
+static ff::value_vector parse_array(Tokenizer& tokenizer, const char** error_pos)
 {
     ff::value_vector values;
 
@@ -84,7 +91,8 @@ static ff::value_vector parse_array(ff::internal::json_tokenizer& tokenizer, con
     return values;
 }
 
-static ff::dict parse_object(ff::internal::json_tokenizer& tokenizer, const char** error_pos)
+template<class Tokenizer>
+static ff::dict parse_object(Tokenizer& tokenizer, const char** error_pos)
 {
     ff::dict dict;
 
@@ -97,12 +105,19 @@ static ff::dict parse_object(ff::internal::json_tokenizer& tokenizer, const char
             break;
         }
 
-        // Get string from token
-        ff::value_ptr key = token.get();
-        if (!key)
+        // Get string from token, keys without escapes can be used in place
+        std::string_view key = token.text.substr(1, token.size() - 2);
+        ff::value_ptr decoded_key;
+        if (key.find('\\') != std::string_view::npos)
         {
-            *error_pos = token.begin();
-            break;
+            decoded_key = token.get();
+            if (!decoded_key)
+            {
+                *error_pos = token.begin();
+                break;
+            }
+
+            key = decoded_key->get<std::string>();
         }
 
         // Colon must be after name
@@ -119,7 +134,7 @@ static ff::dict parse_object(ff::internal::json_tokenizer& tokenizer, const char
             break;
         }
 
-        dict.set(key->get<std::string>(), value);
+        dict.set(key, value);
 
         token = tokenizer.next();
         if (token.type != ff::internal::json_token_type::comma &&
@@ -138,7 +153,8 @@ static ff::dict parse_object(ff::internal::json_tokenizer& tokenizer, const char
     return dict;
 }
 
-static ff::dict parse_root_object(ff::internal::json_tokenizer& tokenizer, const char** error_pos)
+template<class Tokenizer>
+static ff::dict parse_root_object(Tokenizer& tokenizer, const char** error_pos)
 {
     ff::internal::json_token token = tokenizer.next();
     if (token.type == ff::internal::json_token_type::open_curly)
@@ -151,6 +167,19 @@ static ff::dict parse_root_object(ff::internal::json_tokenizer& tokenizer, const
 }
 
 bool ff::json_parse(std::string_view text, ff::dict& dict, const char** error_pos)
+{
+    ff::internal::json_structural_index index(text);
+    ff::internal::json_structural_tokenizer tokenizer(index);
+
+    const char* my_error_pos;
+    error_pos = error_pos ? error_pos : &my_error_pos;
+    *error_pos = nullptr;
+
+    dict = ::parse_root_object(tokenizer, error_pos);
+    return !*error_pos;
+}
+
+bool ff::internal::json_parse_tokenizer(std::string_view text, ff::dict& dict, const char** error_pos)
 {
     ff::internal::json_tokenizer tokenizer(text);
 
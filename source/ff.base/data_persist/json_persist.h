@@ -7,3 +7,9 @@ namespace ff
 	bool json_parse(std::string_view text, ff::dict& dict, const char** error_pos = nullptr);
 	void json_write(const ff::dict& dict, std::ostream& output);
 }
+
+namespace ff::internal
+{
+	// Original char by char parser, json_parse must always return the same results
+	bool json_parse_tokenizer(std::string_view text, ff::dict& dict, const char** error_pos = nullptr);
+}
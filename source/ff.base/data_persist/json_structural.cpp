@@ -0,0 +1,449 @@
+#include "pch.h"
+#include "base/assert.h"
+#include "data_persist/json_structural.h"
+
+#if defined(_M_ARM64) || defined(__aarch64__)
+#include <arm_neon.h>
+#define FF_JSON_NEON 1
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <immintrin.h>
+#define FF_JSON_SSE2 1
+#endif
+
+namespace
+{
+    struct block_masks
+    {
+        uint64_t quote;
+        uint64_t backslash;
+        uint64_t slash;
+        uint64_t op;
+        uint64_t space;
+        uint64_t control;
+    };
+}
+
+static constexpr size_t block_size = 64;
+
+static void classify_block_scalar(const uint8_t* block, ::block_masks& masks)
+{
+    masks = {};
+
+    for (size_t i = 0; i < ::block_size; i++)
+    {
+        const uint64_t bit = uint64_t(1) << i;
+        const uint8_t ch = block[i];
+
+        switch (ch)
+        {
+            case '\"':
+                masks.quote |= bit;
+                break;
+
+            case '\\':
+                masks.backslash |= bit;
+                break;
+
+            case '/':
+                masks.slash |= bit;
+                break;
+
+            case '{':
+            case '}':
+            case '[':
+            case ']':
+            case ':':
+            case ',':
+                masks.op |= bit;
+                break;
+
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\v':
+            case '\f':
+            case '\r':
+                masks.space |= bit;
+                break;
+        }
+
+        if (ch < ' ')
+        {
+            masks.control |= bit;
+        }
+    }
+}
+
+#if FF_JSON_SSE2 && defined(__AVX2__)
+
+static void classify_block_simd(const uint8_t* block, ::block_masks& masks)
+{
+    masks = {};
+
+    for (size_t i = 0; i < ::block_size; i += 32)
+    {
+        const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i));
+        auto eq = [&chars](char ch)
+        {
+            return _mm256_cmpeq_epi8(chars, _mm256_set1_epi8(ch));
+        };
+
+        auto bits = [i](__m256i mask)
+        {
+            return static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(mask))) << i;
+        };
+
+        const __m256i op = _mm256_or_si256(
+            _mm256_or_si256(_mm256_or_si256(eq('{'), eq('}')), _mm256_or_si256(eq('['), eq(']'))),
+            _mm256_or_si256(eq(':'), eq(',')));
+
+        // \t \n \v \f \r are contiguous, and signed compares leave out bytes >= 0x80
+        const __m256i space = _mm256_or_si256(eq(' '),
+            _mm256_and_si256(_mm256_cmpgt_epi8(chars, _mm256_set1_epi8('\t' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('\r' + 1), chars)));
+
+        const __m256i control = _mm256_and_si256(
+            _mm256_cmpgt_epi8(chars, _mm256_set1_epi8(-1)), _mm256_cmpgt_epi8(_mm256_set1_epi8(' '), chars));
+
+        masks.quote |= bits(eq('\"'));
+        masks.backslash |= bits(eq('\\'));
+        masks.slash |= bits(eq('/'));
+        masks.op |= bits(op);
+        masks.space |= bits(space);
+        masks.control |= bits(control);
+    }
+}
+
+#elif FF_JSON_SSE2
+
+static void classify_block_simd(const uint8_t* block, ::block_masks& masks)
+{
+    masks = {};
+
+    for (size_t i = 0; i < ::block_size; i += 16)
+    {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+        auto eq = [&chars](char ch)
+        {
+            return _mm_cmpeq_epi8(chars, _mm_set1_epi8(ch));
+        };
+
+        auto bits = [i](__m128i mask)
+        {
+            return static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(mask))) << i;
+        };
+
+        const __m128i op = _mm_or_si128(
+            _mm_or_si128(_mm_or_si128(eq('{'), eq('}')), _mm_or_si128(eq('['), eq(']'))),
+            _mm_or_si128(eq(':'), eq(',')));
+
+        // \t \n \v \f \r are contiguous, and signed compares leave out bytes >= 0x80
+        const __m128i space = _mm_or_si128(eq(' '),
+            _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('\t' - 1)), _mm_cmplt_epi8(chars, _mm_set1_epi8('\r' + 1))));
+
+        const __m128i control = _mm_and_si128(
+            _mm_cmpgt_epi8(chars, _mm_set1_epi8(-1)), _mm_cmplt_epi8(chars, _mm_set1_epi8(' ')));
+
+        masks.quote |= bits(eq('\"'));
+        masks.backslash |= bits(eq('\\'));
+        masks.slash |= bits(eq('/'));
+        masks.op |= bits(op);
+        masks.space |= bits(space);
+        masks.control |= bits(control);
+    }
+}
+
+#elif FF_JSON_NEON
+
+static uint64_t neon_movemask(uint8x16_t mask)
+{
+    static const uint8_t weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    const uint8x16_t weighted = vandq_u8(mask, vld1q_u8(weights));
+    return static_cast<uint64_t>(vaddv_u8(vget_low_u8(weighted))) | (static_cast<uint64_t>(vaddv_u8(vget_high_u8(weighted))) << 8);
+}
+
+static void classify_block_simd(const uint8_t* block, ::block_masks& masks)
+{
+    masks = {};
+
+    for (size_t i = 0; i < ::block_size; i += 16)
+    {
+        const uint8x16_t chars = vld1q_u8(block + i);
+        auto eq = [&chars](uint8_t ch)
+        {
+            return vceqq_u8(chars, vdupq_n_u8(ch));
+        };
+
+        auto bits = [i](uint8x16_t mask)
+        {
+            return ::neon_movemask(mask) << i;
+        };
+
+        const uint8x16_t op = vorrq_u8(
+            vorrq_u8(vorrq_u8(eq('{'), eq('}')), vorrq_u8(eq('['), eq(']'))),
+            vorrq_u8(eq(':'), eq(',')));
+
+        const uint8x16_t space = vorrq_u8(eq(' '), vandq_u8(vcgeq_u8(chars, vdupq_n_u8('\t')), vcleq_u8(chars, vdupq_n_u8('\r'))));
+
+        masks.quote |= bits(eq('\"'));
+        masks.backslash |= bits(eq('\\'));
+        masks.slash |= bits(eq('/'));
+        masks.op |= bits(op);
+        masks.space |= bits(space);
+        masks.control |= bits(vcltq_u8(chars, vdupq_n_u8(' ')));
+    }
+}
+
+#else
+
+static void classify_block_simd(const uint8_t* block, ::block_masks& masks)
+{
+    ::classify_block_scalar(block, masks);
+}
+
+#endif
+
+// Returns a mask of characters that follow an odd length run of backslashes
+static uint64_t find_escaped(uint64_t backslash, bool& escape_carry)
+{
+    uint64_t escaped = escape_carry ? 1 : 0;
+    escape_carry = false;
+
+    for (uint64_t bits = backslash & ~escaped; bits; )
+    {
+        const int i = std::countr_zero(bits);
+        if (i == 63)
+        {
+            escape_carry = true;
+            break;
+        }
+
+        // The next char is escaped, so it can't start another escape
+        escaped |= uint64_t(2) << i;
+        bits &= ~(uint64_t(3) << i);
+    }
+
+    return escaped;
+}
+
+// Each bit becomes the XOR of itself and all lower bits, so everything from an opening quote up to its closing quote is set
+static uint64_t prefix_xor(uint64_t bits)
+{
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+ff::internal::json_structural_index::json_structural_index(std::string_view text, bool allow_simd)
+    : text_(text)
+    , bad_string_char_(std::string_view::npos)
+{
+    assert_ret(text.size() <= std::numeric_limits<uint32_t>::max());
+    this->positions_.reserve(text.size() / 8);
+
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(text.data());
+    const size_t size = text.size();
+    std::array<uint8_t, ::block_size> padded_block;
+    bool in_string = false;
+    bool prev_scalar = false;
+    bool escape_carry = false;
+
+    for (size_t pos = 0; pos < size; )
+    {
+        const size_t count = std::min(size - pos, ::block_size);
+        const uint8_t* block = data + pos;
+        if (count < ::block_size)
+        {
+            // Pad the end with spaces, which are never structural
+            std::memcpy(padded_block.data(), block, count);
+            std::memset(padded_block.data() + count, ' ', ::block_size - count);
+            block = padded_block.data();
+        }
+
+        ::block_masks masks;
+        if (allow_simd)
+        {
+            ::classify_block_simd(block, masks);
+        }
+        else
+        {
+            ::classify_block_scalar(block, masks);
+        }
+
+        const uint64_t valid = (count < ::block_size) ? (uint64_t(1) << count) - 1 : ~uint64_t(0);
+        const uint64_t quote = masks.quote & ~::find_escaped(masks.backslash, escape_carry);
+        const uint64_t string = ::prefix_xor(quote) ^ (in_string ? ~uint64_t(0) : 0);
+        const uint64_t outside = ~(string | quote);
+        const uint64_t slash = masks.slash & outside & valid;
+        const uint64_t before_slash = slash ? (slash & (~slash + 1)) - 1 : ~uint64_t(0);
+        const uint64_t scalar = outside & ~(masks.space | masks.op | masks.slash);
+        const uint64_t scalar_start = scalar & ~((scalar << 1) | (prev_scalar ? 1 : 0));
+        const uint64_t bad_chars = masks.control & string & valid & before_slash;
+
+        if (bad_chars && this->bad_string_char_ == std::string_view::npos)
+        {
+            this->bad_string_char_ = pos + std::countr_zero(bad_chars);
+        }
+
+        for (uint64_t bits = ((masks.op & outside) | quote | scalar_start) & valid & before_slash; bits; bits &= bits - 1)
+        {
+            this->positions_.push_back(static_cast<uint32_t>(pos + std::countr_zero(bits)));
+        }
+
+        if (slash)
+        {
+            // Comments can only start outside of strings, so all state resets after them
+            pos = this->skip_comment(pos + std::countr_zero(slash));
+            in_string = false;
+            prev_scalar = false;
+            escape_carry = false;
+        }
+        else
+        {
+            pos += ::block_size;
+            in_string = (string >> 63) != 0;
+            prev_scalar = (scalar >> 63) != 0;
+        }
+    }
+}
+
+std::string_view ff::internal::json_structural_index::text() const
+{
+    return this->text_;
+}
+
+const std::vector<uint32_t>& ff::internal::json_structural_index::positions() const
+{
+    return this->positions_;
+}
+
+size_t ff::internal::json_structural_index::bad_string_char() const
+{
+    return this->bad_string_char_;
+}
+
+size_t ff::internal::json_structural_index::skip_comment(size_t pos)
+{
+    const std::string_view text = this->text_;
+    const char next = (pos + 1 < text.size()) ? text[pos + 1] : '\0';
+
+    if (next == '/')
+    {
+        size_t end = text.find_first_of("\r\n", pos + 2);
+        return (end != std::string_view::npos) ? end : text.size();
+    }
+
+    if (next == '*')
+    {
+        size_t end = text.find("*/", pos + 2);
+        if (end != std::string_view::npos)
+        {
+            return end + 2;
+        }
+
+        // No end for the comment, the tokenizer will return an error at the slash
+        this->positions_.push_back(static_cast<uint32_t>(pos));
+        return text.size();
+    }
+
+    // Not a comment, the tokenizer will return an error at the slash
+    this->positions_.push_back(static_cast<uint32_t>(pos));
+    return pos + 1;
+}
+
+ff::internal::json_structural_tokenizer::json_structural_tokenizer(const ff::internal::json_structural_index& index)
+    : index(index)
+    , pending_error(nullptr)
+    , index_pos(0)
+{}
+
+ff::internal::json_token ff::internal::json_structural_tokenizer::next()
+{
+    const std::string_view text = this->index.text();
+    const char* end = text.data() + text.size();
+
+    if (this->pending_error)
+    {
+        return json_token{ json_token_type::error, std::string_view(std::exchange(this->pending_error, nullptr), 0) };
+    }
+
+    const std::vector<uint32_t>& positions = this->index.positions();
+    if (this->index_pos >= positions.size())
+    {
+        return json_token{ json_token_type::none, std::string_view(end, 0) };
+    }
+
+    const size_t pos = positions[this->index_pos++];
+    const char* start = text.data() + pos;
+
+    switch (*start)
+    {
+        case ',':
+            return json_token{ json_token_type::comma, std::string_view(start, 1) };
+
+        case ':':
+            return json_token{ json_token_type::colon, std::string_view(start, 1) };
+
+        case '{':
+            return json_token{ json_token_type::open_curly, std::string_view(start, 1) };
+
+        case '}':
+            return json_token{ json_token_type::close_curly, std::string_view(start, 1) };
+
+        case '[':
+            return json_token{ json_token_type::open_bracket, std::string_view(start, 1) };
+
+        case ']':
+            return json_token{ json_token_type::close_bracket, std::string_view(start, 1) };
+
+        case '\"':
+            // Quotes are always indexed in pairs, unless the last string never ends
+            if (this->index_pos < positions.size())
+            {
+                const size_t close_pos = positions[this->index_pos++];
+                const size_t bad_pos = this->index.bad_string_char();
+                if (bad_pos < pos || bad_pos > close_pos)
+                {
+                    return json_token{ json_token_type::string_token, std::string_view(start, close_pos - pos + 1) };
+                }
+            }
+
+            return json_token{ json_token_type::error, std::string_view(start, 0) };
+    }
+
+    // Numbers and identifiers are rare enough to just use the char by char tokenizer
+    ff::internal::json_tokenizer tokenizer(std::string_view(start, static_cast<size_t>(end - start)));
+    json_token token = tokenizer.next();
+
+    if (token.type != json_token_type::error && token.end() < end)
+    {
+        switch (*token.end())
+        {
+            case ',':
+            case ':':
+            case '{':
+            case '}':
+            case '[':
+            case ']':
+            case '\"':
+            case '/':
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\v':
+            case '\f':
+            case '\r':
+                break;
+
+            default:
+                // The old tokenizer would start a new (invalid) token right after this one
+                this->pending_error = token.end();
+                break;
+        }
+    }
+
+    return token;
+}
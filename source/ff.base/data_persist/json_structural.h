@@ -0,0 +1,53 @@
+#pragma once
+
+#include "../data_persist/json_tokenizer.h"
+
+namespace ff::internal
+{
+    /// <summary>
+    /// First stage of JSON parsing, finds the position of every structural character
+    /// </summary>
+    /// <remarks>
+    /// Text is classified 64 bytes at a time with SIMD compares (SSE2, AVX2 or NEON, with a scalar fallback).
+    /// Quote, backslash and whitespace masks are combined with bit math to find which characters are inside
+    /// strings, so only braces, brackets, colons, commas, both quotes of every string, and the first character
+    /// of every number or identifier get indexed. Comments are rare, so they are skipped one char at a time.
+    /// </remarks>
+    class json_structural_index
+    {
+    public:
+        json_structural_index(std::string_view text, bool allow_simd = true);
+        json_structural_index(json_structural_index&& other) noexcept = default;
+        json_structural_index(const json_structural_index& other) = delete;
+
+        json_structural_index& operator=(json_structural_index&& other) noexcept = default;
+        json_structural_index& operator=(const json_structural_index& other) = delete;
+
+        std::string_view text() const;
+        const std::vector<uint32_t>& positions() const;
+        size_t bad_string_char() const;
+
+    private:
+        size_t skip_comment(size_t pos);
+
+        std::string_view text_;
+        std::vector<uint32_t> positions_;
+        size_t bad_string_char_;
+    };
+
+    /// <summary>
+    /// Second stage of JSON parsing, returns the same tokens as json_tokenizer by walking a structural index
+    /// </summary>
+    class json_structural_tokenizer
+    {
+    public:
+        json_structural_tokenizer(const ff::internal::json_structural_index& index);
+
+        json_token next();
+
+    private:
+        const ff::internal::json_structural_index& index;
+        const char* pending_error;
+        size_t index_pos;
+    };
+}
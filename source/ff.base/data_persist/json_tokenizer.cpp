@@ -39,11 +39,20 @@ ff::value_ptr ff::internal::json_token::get() const
 
         case json_token_type::string_token:
             {
+                std::string_view contents = this->text.substr(1, this->text.size() - 2);
+                size_t escape_pos = contents.find('\\');
+                if (escape_pos == std::string_view::npos)
+                {
+                    // Most strings don't need any decoding
+                    return ff::value::create<std::string>(std::string(contents));
+                }
+
                 std::string val;
-                val.reserve(this->text.size());
+                val.reserve(contents.size());
+                val.append(contents.substr(0, escape_pos));
 
-                const char* cur = this->text.data() + 1;
-                for (const char* end = this->text.data() + this->text.size() - 1; cur && cur < end; )
+                const char* cur = contents.data() + escape_pos;
+                for (const char* end = contents.data() + contents.size(); cur && cur < end; )
                 {
                     if (*cur == '\\')
                     {
@@ -1,17 +1,78 @@
 #include "pch.h"
+#include "base/assert.h"
+#include "base/stable_hash.h"
 #include "types/flags.h"
 #include "data_persist/compression.h"
 #include "data_persist/data.h"
 #include "data_persist/file.h"
 #include "data_persist/saved_data.h"
+#include "data_persist/saved_data_cache.h"
 #include "data_persist/stream.h"
 
+namespace
+{
+    struct static_key_t
+    {
+        uint64_t data_hash;
+        uint64_t loaded_size;
+        uint64_t type;
+    };
+
+    struct file_key_t
+    {
+        uint64_t path_hash;
+        uint64_t offset;
+        uint64_t saved_size;
+        uint64_t loaded_size;
+        uint64_t type;
+        uint64_t file_time;
+    };
+}
+
+static bool is_compressed(ff::saved_data_type type)
+{
+    return ff::flags::has_any(type, ff::flags::set(ff::saved_data_type::zlib_compressed, ff::saved_data_type::zlib_blocks));
+}
+
 std::shared_ptr<ff::reader_base> ff::saved_data_base::loaded_reader() const
 {
     return std::make_shared<data_reader>(this->loaded_data());
 }
 
 std::shared_ptr<ff::data_base> ff::saved_data_base::loaded_data() const
+{
+    if (::is_compressed(this->type()))
+    {
+        return ff::saved_data_cache::get(this->cache_key(), [this]()
+            {
+                return this->uncompressed_data();
+            });
+    }
+
+    return this->saved_data();
+}
+
+std::shared_ptr<ff::data_base> ff::saved_data_base::loaded_data(size_t offset, size_t size) const
+{
+    assert_ret_val(offset <= this->loaded_size() && size <= this->loaded_size() - offset, nullptr);
+
+    if (ff::flags::has(this->type(), saved_data_type::zlib_blocks))
+    {
+        // Only the blocks that overlap the range get uncompressed, unless all of it is already cached
+        std::shared_ptr<data_base> data = ff::saved_data_cache::find(this->cache_key());
+        return data ? data->subdata(offset, size) : ff::compression::uncompress_blocks(*this->saved_reader(), this->saved_size(), offset, size);
+    }
+
+    std::shared_ptr<data_base> data = this->loaded_data();
+    return data ? data->subdata(offset, size) : nullptr;
+}
+
+uint64_t ff::saved_data_base::cache_key() const
+{
+    return 0;
+}
+
+std::shared_ptr<ff::data_base> ff::saved_data_base::uncompressed_data() const
 {
     if (ff::flags::has(this->type(), saved_data_type::zlib_compressed))
     {
@@ -30,15 +91,58 @@ std::shared_ptr<ff::data_base> ff::saved_data_base::loaded_data() const
         }
     }
 
-    return this->saved_data();
+    std::shared_ptr<data_base> data = ff::compression::uncompress_blocks(*this->saved_reader(), this->saved_size(), 0, this->loaded_size());
+    assert(data && data->size() == this->loaded_size());
+    return data;
 }
 
 ff::saved_data_static::saved_data_static(const std::shared_ptr<data_base>& data, size_t loaded_size, saved_data_type type)
     : data(data)
     , data_loaded_size(loaded_size)
     , data_type(type)
+    , data_cache_key(0)
+{}
+
+ff::saved_data_static::saved_data_static(const saved_data_static& other)
+    : data(other.data)
+    , data_loaded_size(other.data_loaded_size)
+    , data_type(other.data_type)
+    , data_cache_key(other.data_cache_key.load())
+{}
+
+ff::saved_data_static::saved_data_static(saved_data_static&& other) noexcept
+    : data(std::move(other.data))
+    , data_loaded_size(other.data_loaded_size)
+    , data_type(other.data_type)
+    , data_cache_key(other.data_cache_key.exchange(0))
 {}
 
+ff::saved_data_static& ff::saved_data_static::operator=(const saved_data_static& other)
+{
+    if (this != &other)
+    {
+        this->data = other.data;
+        this->data_loaded_size = other.data_loaded_size;
+        this->data_type = other.data_type;
+        this->data_cache_key = other.data_cache_key.load();
+    }
+
+    return *this;
+}
+
+ff::saved_data_static& ff::saved_data_static::operator=(saved_data_static&& other) noexcept
+{
+    if (this != &other)
+    {
+        this->data = std::move(other.data);
+        this->data_loaded_size = other.data_loaded_size;
+        this->data_type = other.data_type;
+        this->data_cache_key = other.data_cache_key.exchange(0);
+    }
+
+    return *this;
+}
+
 std::shared_ptr<ff::reader_base> ff::saved_data_static::saved_reader() const
 {
     return std::make_shared<data_reader>(this->data);
@@ -64,12 +168,34 @@ ff::saved_data_type ff::saved_data_static::type() const
     return this->data_type;
 }
 
-ff::saved_data_file::saved_data_file(const std::filesystem::path& path, size_t offset, size_t saved_size, size_t loaded_size, saved_data_type type)
+uint64_t ff::saved_data_static::cache_key() const
+{
+    check_ret_val(::is_compressed(this->data_type) && this->data, 0);
+
+    uint64_t cache_key = this->data_cache_key.load();
+    if (!cache_key)
+    {
+        // Memory gets reused and every read of a pack wraps it in new data objects, so only the contents identify it.
+        // Hashing all of it is slow (and pages in mapped files), so it's only done once per object.
+        ::static_key_t key{};
+        key.data_hash = ff::stable_hash_bytes(this->data->data(), this->data->size());
+        key.loaded_size = this->data_loaded_size;
+        key.type = static_cast<uint64_t>(this->data_type);
+
+        cache_key = ff::stable_hash_bytes(&key, sizeof(key));
+        this->data_cache_key = cache_key;
+    }
+
+    return cache_key;
+}
+
+ff::saved_data_file::saved_data_file(const std::filesystem::path& path, size_t offset, size_t saved_size, size_t loaded_size, saved_data_type type, uint64_t file_time)
     : path(path)
     , data_offset(offset)
     , data_saved_size(saved_size)
     , data_loaded_size(loaded_size)
     , data_type(type)
+    , file_time(file_time)
 {}
 
 std::shared_ptr<ff::reader_base> ff::saved_data_file::saved_reader() const
@@ -117,3 +243,19 @@ ff::saved_data_type ff::saved_data_file::type() const
 {
     return this->data_type;
 }
+
+uint64_t ff::saved_data_file::cache_key() const
+{
+    // Without the write time, the file could've changed since this data was found
+    check_ret_val(::is_compressed(this->data_type) && this->file_time, 0);
+
+    ::file_key_t key{};
+    key.path_hash = ff::stable_hash_func(this->path.native());
+    key.offset = this->data_offset;
+    key.saved_size = this->data_saved_size;
+    key.loaded_size = this->data_loaded_size;
+    key.type = static_cast<uint64_t>(this->data_type);
+    key.file_time = this->file_time;
+
+    return ff::stable_hash_bytes(&key, sizeof(key));
+}
@@ -11,6 +11,7 @@ namespace ff
 
         // type of bits
         zlib_compressed = 0x01,
+        zlib_blocks = 0x02, // independently compressed blocks, see ff::compression::compress_blocks
 
         // type of data
         dict = 0x0100,
@@ -25,21 +26,28 @@ namespace ff
         virtual std::shared_ptr<data_base> saved_data() const = 0;
         virtual std::shared_ptr<reader_base> loaded_reader() const;
         virtual std::shared_ptr<data_base> loaded_data() const;
+        virtual std::shared_ptr<data_base> loaded_data(size_t offset, size_t size) const;
 
         virtual size_t saved_size() const = 0;
         virtual size_t loaded_size() const = 0;
         virtual saved_data_type type() const = 0;
+
+        // Identifies the uncompressed data in ff::saved_data_cache, zero when it can't be cached
+        virtual uint64_t cache_key() const;
+
+    private:
+        std::shared_ptr<data_base> uncompressed_data() const;
     };
 
     class saved_data_static : public saved_data_base
     {
     public:
         saved_data_static(const std::shared_ptr<data_base>& data, size_t loaded_size, saved_data_type type);
-        saved_data_static(const saved_data_static& other) = default;
-        saved_data_static(saved_data_static&& other) noexcept = default;
+        saved_data_static(const saved_data_static& other);
+        saved_data_static(saved_data_static&& other) noexcept;
 
-        saved_data_static& operator=(const saved_data_static& other) = default;
-        saved_data_static& operator=(saved_data_static&& other) noexcept = default;
+        saved_data_static& operator=(const saved_data_static& other);
+        saved_data_static& operator=(saved_data_static&& other) noexcept;
 
         virtual std::shared_ptr<reader_base> saved_reader() const override;
         virtual std::shared_ptr<data_base> saved_data() const override;
@@ -47,17 +55,20 @@ namespace ff
         virtual size_t saved_size() const  override;
         virtual size_t loaded_size() const  override;
         virtual saved_data_type type() const  override;
+        virtual uint64_t cache_key() const override;
 
     private:
         std::shared_ptr<data_base> data;
         size_t data_loaded_size;
         saved_data_type data_type;
+        mutable std::atomic_uint64_t data_cache_key; // zero until the first cache_key() call hashes the data
     };
 
     class saved_data_file : public saved_data_base
     {
     public:
-        saved_data_file(const std::filesystem::path& path, size_t offset, size_t saved_size, size_t loaded_size, saved_data_type type);
+        // file_time is the file's last write time when the data was found, zero when unknown, which turns off caching
+        saved_data_file(const std::filesystem::path& path, size_t offset, size_t saved_size, size_t loaded_size, saved_data_type type, uint64_t file_time = 0);
         saved_data_file(const saved_data_file& other) = default;
         saved_data_file(saved_data_file&& other) noexcept = default;
 
@@ -70,6 +81,7 @@ namespace ff
         virtual size_t saved_size() const  override;
         virtual size_t loaded_size() const  override;
         virtual saved_data_type type() const  override;
+        virtual uint64_t cache_key() const override;
 
     private:
         std::filesystem::path path;
@@ -77,5 +89,6 @@ namespace ff
         size_t data_saved_size;
         size_t data_loaded_size;
         saved_data_type data_type;
+        uint64_t file_time;
     };
 }
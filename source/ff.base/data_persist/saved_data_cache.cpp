@@ -0,0 +1,248 @@
+#include "pch.h"
+#include "base/assert.h"
+#include "base/stable_hash.h"
+#include "data_persist/data.h"
+#include "data_persist/saved_data_cache.h"
+#include "types/scope_exit.h"
+#include "windows/win_handle.h"
+
+namespace
+{
+    struct loading_t
+    {
+        ff::win_event done;
+        std::shared_ptr<ff::data_base> data;
+    };
+
+    struct entry_t
+    {
+        uint64_t key;
+        std::shared_ptr<ff::data_base> data; // only while the budget keeps it alive
+        std::weak_ptr<ff::data_base> weak_data;
+        std::shared_ptr<::loading_t> loading;
+        size_t byte_size;
+
+        // Least recently used list of entries that have data
+        entry_t* newer;
+        entry_t* older;
+    };
+
+    // Entries that only have weak data get removed once there are this many more of them than strong ones
+    constexpr size_t sweep_count = 1024;
+}
+
+static std::mutex mutex;
+static std::unordered_map<uint64_t, ::entry_t, ff::no_hash<uint64_t>> entries;
+static ::entry_t* newest_entry{};
+static ::entry_t* oldest_entry{};
+static size_t strong_count{};
+static size_t budget_ = ff::saved_data_cache::default_budget;
+static ff::saved_data_cache::stats_t stats_{};
+
+// caller must own mutex for all of these
+static void unlink_entry(::entry_t& entry)
+{
+    (entry.newer ? entry.newer->older : ::newest_entry) = entry.older;
+    (entry.older ? entry.older->newer : ::oldest_entry) = entry.newer;
+    entry.newer = nullptr;
+    entry.older = nullptr;
+}
+
+static void link_newest_entry(::entry_t& entry)
+{
+    entry.newer = nullptr;
+    entry.older = ::newest_entry;
+    (::newest_entry ? ::newest_entry->newer : ::oldest_entry) = &entry;
+    ::newest_entry = &entry;
+}
+
+static void release_entry_data(::entry_t& entry)
+{
+    if (entry.data)
+    {
+        ::unlink_entry(entry);
+        ::stats_.byte_size -= entry.byte_size;
+        ::strong_count--;
+        entry.data.reset();
+    }
+}
+
+static void sweep_entries()
+{
+    if (::entries.size() > ::strong_count * 2 + ::sweep_count)
+    {
+        std::erase_if(::entries, [](const auto& pair)
+            {
+                const ::entry_t& entry = pair.second;
+                return !entry.data && !entry.loading && entry.weak_data.expired();
+            });
+    }
+}
+
+static void evict_entries()
+{
+    while (::stats_.byte_size > ::budget_ && ::oldest_entry)
+    {
+        ::release_entry_data(*::oldest_entry);
+        ::stats_.eviction_count++;
+    }
+
+    ::sweep_entries();
+}
+
+static void keep_entry_data(::entry_t& entry, const std::shared_ptr<ff::data_base>& data)
+{
+    entry.weak_data = data;
+    entry.byte_size = data->size();
+
+    // Data bigger than the whole budget is only kept weakly
+    if (entry.byte_size <= ::budget_)
+    {
+        entry.data = data;
+        ::link_newest_entry(entry);
+        ::stats_.byte_size += entry.byte_size;
+        ::strong_count++;
+        ::evict_entries();
+    }
+}
+
+static std::shared_ptr<ff::data_base> use_entry_data(::entry_t& entry)
+{
+    if (entry.data)
+    {
+        ::unlink_entry(entry);
+        ::link_newest_entry(entry);
+        return entry.data;
+    }
+
+    // Evicted, but someone else kept it alive
+    std::shared_ptr<ff::data_base> data = entry.weak_data.lock();
+    if (data)
+    {
+        ::keep_entry_data(entry, data);
+    }
+
+    return data;
+}
+
+std::shared_ptr<ff::data_base> ff::saved_data_cache::get(uint64_t key, const std::function<std::shared_ptr<ff::data_base>()>& load_func)
+{
+    if (!key)
+    {
+        return load_func();
+    }
+
+    std::shared_ptr<::loading_t> loading;
+    bool wait;
+    {
+        std::scoped_lock lock(::mutex);
+        ::entry_t& entry = ::entries.try_emplace(key, ::entry_t{ key }).first->second;
+
+        std::shared_ptr<ff::data_base> data = ::use_entry_data(entry);
+        if (data)
+        {
+            ::stats_.hit_count++;
+            return data;
+        }
+
+        wait = (entry.loading != nullptr);
+        if (!wait)
+        {
+            entry.loading = std::make_shared<::loading_t>();
+        }
+
+        loading = entry.loading;
+        (wait ? ::stats_.wait_count : ::stats_.miss_count)++;
+    }
+
+    if (wait)
+    {
+        loading->done.wait();
+        return loading->data;
+    }
+
+    // Also runs if load_func throws, so the entry can be loaded again and waiters don't hang
+    ff::scope_exit finish_loading([key, &loading]()
+        {
+            {
+                std::scoped_lock lock(::mutex);
+                auto i = ::entries.find(key);
+                if (i != ::entries.end() && i->second.loading == loading)
+                {
+                    i->second.loading.reset();
+
+                    if (loading->data)
+                    {
+                        ::keep_entry_data(i->second, loading->data);
+                    }
+                }
+            }
+
+            loading->done.set();
+        });
+
+    loading->data = load_func();
+    return loading->data;
+}
+
+std::shared_ptr<ff::data_base> ff::saved_data_cache::find(uint64_t key)
+{
+    check_ret_val(key, nullptr);
+
+    std::scoped_lock lock(::mutex);
+    auto i = ::entries.find(key);
+    std::shared_ptr<ff::data_base> data = (i != ::entries.end()) ? ::use_entry_data(i->second) : nullptr;
+
+    if (data)
+    {
+        ::stats_.hit_count++;
+    }
+
+    return data;
+}
+
+size_t ff::saved_data_cache::budget()
+{
+    std::scoped_lock lock(::mutex);
+    return ::budget_;
+}
+
+void ff::saved_data_cache::budget(size_t byte_size)
+{
+    std::scoped_lock lock(::mutex);
+    ::budget_ = byte_size;
+    ::evict_entries();
+}
+
+void ff::saved_data_cache::clear()
+{
+    std::scoped_lock lock(::mutex);
+
+    while (::oldest_entry)
+    {
+        ::release_entry_data(*::oldest_entry);
+    }
+
+    // Loads that are still running will look for their entry when they finish
+    std::erase_if(::entries, [](const auto& pair)
+        {
+            return !pair.second.loading;
+        });
+}
+
+ff::saved_data_cache::stats_t ff::saved_data_cache::stats()
+{
+    std::scoped_lock lock(::mutex);
+    ff::saved_data_cache::stats_t stats = ::stats_;
+    stats.entry_count = ::entries.size();
+    return stats;
+}
+
+void ff::saved_data_cache::reset_stats()
+{
+    std::scoped_lock lock(::mutex);
+    ::stats_.hit_count = 0;
+    ::stats_.miss_count = 0;
+    ::stats_.wait_count = 0;
+    ::stats_.eviction_count = 0;
+}
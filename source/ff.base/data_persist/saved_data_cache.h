@@ -0,0 +1,42 @@
+#pragma once
+
+namespace ff
+{
+    class data_base;
+}
+
+namespace ff::saved_data_cache
+{
+    constexpr size_t default_budget = 64 * 1024 * 1024;
+
+    /// <summary>
+    /// Counters since the last reset_stats(), and the current size of the cache
+    /// </summary>
+    struct stats_t
+    {
+        size_t hit_count;
+        size_t miss_count;
+        size_t wait_count; // requests that waited for another thread to load the same data
+        size_t eviction_count;
+        size_t entry_count;
+        size_t byte_size; // only counts data kept alive by the budget
+    };
+
+    /// <summary>
+    /// Process-wide cache of uncompressed saved_data, so loading the same compressed data again doesn't uncompress it again
+    /// </summary>
+    /// <remarks>
+    /// The least recently used data is evicted when the cache is over its byte budget, but it can still be found while anyone else holds onto it.
+    /// When many threads ask for the same key at once, only one of them calls load_func and the others wait for its result.
+    /// A zero key is never cached, so load_func is always called.
+    /// </remarks>
+    std::shared_ptr<ff::data_base> get(uint64_t key, const std::function<std::shared_ptr<ff::data_base>()>& load_func);
+    std::shared_ptr<ff::data_base> find(uint64_t key); // never loads
+
+    size_t budget();
+    void budget(size_t byte_size);
+    void clear();
+
+    ff::saved_data_cache::stats_t stats();
+    void reset_stats();
+}
@@ -287,7 +287,7 @@ size_t ff::file_reader::pos(size_t new_pos)
 std::shared_ptr<ff::saved_data_base> ff::file_reader::saved_data(size_t offset, size_t saved_size, size_t loaded_size, saved_data_type type) const
 {
     assert(offset + saved_size <= this->size());
-    return std::make_shared<saved_data_file>(this->file.path(), offset, saved_size, loaded_size, type);
+    return std::make_shared<saved_data_file>(this->file.path(), offset, saved_size, loaded_size, type, this->file.last_write_time());
 }
 
 ff::data_writer::data_writer(const std::shared_ptr<std::vector<uint8_t>>& data)
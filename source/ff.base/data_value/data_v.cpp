@@ -3,6 +3,7 @@
 #include "data_persist/compression.h"
 #include "data_persist/data.h"
 #include "data_persist/dict.h"
+#include "data_persist/flat_dict.h"
 #include "data_persist/saved_data.h"
 #include "data_persist/stream.h"
 #include "data_value/data_v.h"
@@ -47,7 +48,21 @@ ff::value_ptr ff::type::data_type::try_convert_to(const value* val, std::type_in
         auto& data = val->get<ff::data_base>();
         ff::saved_data_type saved_data_type = static_cast<const data_v*>(val)->saved_data_type();
 
-        if (data && data->size() && ff::flags::has(saved_data_type, ff::saved_data_type::zlib_compressed))
+        if (data && data->size() && ff::flags::has(saved_data_type, ff::saved_data_type::zlib_blocks))
+        {
+            auto buffer_compressed = std::make_shared<std::vector<uint8_t>>();
+            buffer_compressed->reserve(data->size());
+
+            ff::data_reader reader(data);
+            ff::data_writer writer(buffer_compressed);
+            if (ff::compression::compress_blocks(reader, data->size(), writer))
+            {
+                auto saved_data = std::make_shared<ff::saved_data_static>(std::make_shared<ff::data_vector>(buffer_compressed), data->size(),
+                    ff::flags::clear(saved_data_type, ff::saved_data_type::zlib_compressed));
+                return ff::value::create<ff::saved_data_base>(saved_data);
+            }
+        }
+        else if (data && data->size() && ff::flags::has(saved_data_type, ff::saved_data_type::zlib_compressed))
         {
             auto buffer_compressed = std::make_shared<std::vector<uint8_t>>();
             buffer_compressed->reserve(data->size());
@@ -62,7 +77,7 @@ ff::value_ptr ff::type::data_type::try_convert_to(const value* val, std::type_in
         }
         else
         {
-            auto saved_data = data ? std::make_shared<ff::saved_data_static>(data, data->size(), ff::flags::clear(saved_data_type, ff::saved_data_type::zlib_compressed)) : nullptr;
+            auto saved_data = data ? std::make_shared<ff::saved_data_static>(data, data->size(), ff::flags::clear(saved_data_type, ff::flags::set(ff::saved_data_type::zlib_compressed, ff::saved_data_type::zlib_blocks))) : nullptr;
             return ff::value::create<ff::saved_data_base>(saved_data);
         }
     }
@@ -74,6 +89,22 @@ ff::value_ptr ff::type::data_type::try_convert_to(const value* val, std::type_in
 
         if (data && ff::flags::has(saved_data_type, ff::saved_data_type::dict))
         {
+            uint64_t cookie = 0;
+            if (data->size() >= sizeof(cookie))
+            {
+                std::memcpy(&cookie, data->data(), sizeof(cookie));
+            }
+
+            if (ff::flat_dict::is_flat(cookie))
+            {
+                // Read the flat format in place, without copying the whole buffer first
+                ff::flat_dict flat_dict(data);
+                if (flat_dict.valid())
+                {
+                    return ff::value::create<ff::dict>(flat_dict.to_dict());
+                }
+            }
+
             ff::dict dict;
             ff::data_reader reader(data);
             if (ff::dict::load(reader, dict))
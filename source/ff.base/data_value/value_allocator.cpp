@@ -2,6 +2,12 @@
 #include "types/pool_allocator.h"
 #include "data_value/value_allocator.h"
 
+static constexpr size_t size_class_count = ff::internal::value_allocator::size_class_count;
+static constexpr size_t stats_count = ::size_class_count + 1;
+static constexpr size_t magazine_size = 64;
+static constexpr size_t batch_size = ::magazine_size / 2;
+static constexpr size_t max_depot_batches = 64;
+
 template<size_t SizeCount>
 static ff::byte_pool_allocator<std::array<size_t, SizeCount>>& get_byte_pool()
 {
@@ -14,95 +20,369 @@ constexpr size_t get_pool_size_count(size_t byte_size)
     return (byte_size + sizeof(size_t) - 1) / sizeof(size_t);
 }
 
-void* ff::internal::value_allocator::new_bytes(size_t size)
+namespace
+{
+    struct pool_funcs_t
+    {
+        void* (*new_bytes)();
+        void (*delete_bytes)(void*);
+    };
+
+    template<size_t Index>
+    void* pool_new_bytes()
+    {
+        return ::get_byte_pool<Index + 1>().new_bytes();
+    }
+
+    template<size_t Index>
+    void pool_delete_bytes(void* value)
+    {
+        ::get_byte_pool<Index + 1>().delete_bytes(value);
+    }
+
+    template<size_t... Indexes>
+    constexpr std::array<pool_funcs_t, sizeof...(Indexes)> make_pool_funcs(std::index_sequence<Indexes...>)
+    {
+        return { pool_funcs_t{ &::pool_new_bytes<Indexes>, &::pool_delete_bytes<Indexes> }... };
+    }
+
+    constexpr std::array<pool_funcs_t, ::size_class_count> pool_funcs = ::make_pool_funcs(std::make_index_sequence<::size_class_count>());
+
+    // Only the owning thread writes, so relaxed loads and stores are enough for other threads to read stats
+    struct counters_t
+    {
+        static void add(std::atomic_size_t& counter, size_t value)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        std::atomic_size_t allocs{};
+        std::atomic_size_t frees{};
+        std::atomic_size_t bytes_allocated{};
+        std::atomic_size_t bytes_freed{};
+        std::atomic_size_t remote_frees{};
+    };
+
+    using batch_type = std::array<void*, ::batch_size>;
+
+    struct depot_t
+    {
+        std::mutex mutex;
+        std::vector<batch_type> batches;
+    };
+
+    struct thread_cache_t;
+
+    struct globals_t
+    {
+        globals_t()
+        {
+            // Make sure that the pools outlive the depots
+            for (const pool_funcs_t& funcs : ::pool_funcs)
+            {
+                funcs.delete_bytes(nullptr);
+            }
+        }
+
+        ~globals_t()
+        {
+            for (size_t i = 0; i < ::size_class_count; i++)
+            {
+                for (batch_type& batch : this->depots[i].batches)
+                {
+                    for (void* value : batch)
+                    {
+                        ::pool_funcs[i].delete_bytes(value);
+                    }
+                }
+            }
+        }
+
+        std::array<depot_t, ::size_class_count> depots;
+        std::mutex threads_mutex;
+        std::vector<thread_cache_t*> threads;
+
+        // Stats from threads that exited, or from frees after a thread's cache was destroyed
+        std::array<std::atomic_size_t, ::stats_count> retired_allocs{};
+        std::array<std::atomic_size_t, ::stats_count> retired_frees{};
+        std::array<std::atomic_size_t, ::stats_count> retired_bytes_allocated{};
+        std::array<std::atomic_size_t, ::stats_count> retired_bytes_freed{};
+        std::array<std::atomic_size_t, ::stats_count> retired_remote_frees{};
+    };
+
+    globals_t& get_globals()
+    {
+        static globals_t globals;
+        return globals;
+    }
+
+    struct magazine_t
+    {
+        std::array<void*, ::magazine_size> items;
+        size_t count{};
+    };
+
+    struct thread_cache_t
+    {
+        thread_cache_t();
+        ~thread_cache_t();
+
+        void flush();
+        void flush_batch(size_t index);
+        void refill(size_t index);
+
+        std::array<magazine_t, ::size_class_count> magazines;
+        std::array<counters_t, ::stats_count> counters;
+        std::array<ptrdiff_t, ::stats_count> balances{};
+    };
+}
+
+static thread_local bool thread_cache_destroyed{};
+
+thread_cache_t::thread_cache_t()
+{
+    globals_t& globals = ::get_globals();
+    std::scoped_lock lock(globals.threads_mutex);
+    globals.threads.push_back(this);
+}
+
+thread_cache_t::~thread_cache_t()
+{
+    this->flush();
+
+    globals_t& globals = ::get_globals();
+    std::scoped_lock lock(globals.threads_mutex);
+
+    for (size_t i = 0; i < ::stats_count; i++)
+    {
+        globals.retired_allocs[i].fetch_add(this->counters[i].allocs.load());
+        globals.retired_frees[i].fetch_add(this->counters[i].frees.load());
+        globals.retired_bytes_allocated[i].fetch_add(this->counters[i].bytes_allocated.load());
+        globals.retired_bytes_freed[i].fetch_add(this->counters[i].bytes_freed.load());
+        globals.retired_remote_frees[i].fetch_add(this->counters[i].remote_frees.load());
+    }
+
+    globals.threads.erase(std::find(globals.threads.begin(), globals.threads.end(), this));
+    ::thread_cache_destroyed = true;
+}
+
+void thread_cache_t::flush()
+{
+    for (size_t i = 0; i < ::size_class_count; i++)
+    {
+        magazine_t& magazine = this->magazines[i];
+        while (magazine.count >= ::batch_size)
+        {
+            this->flush_batch(i);
+        }
+
+        for (; magazine.count; magazine.count--)
+        {
+            ::pool_funcs[i].delete_bytes(magazine.items[magazine.count - 1]);
+        }
+    }
+}
+
+void thread_cache_t::flush_batch(size_t index)
 {
-    size_t count = ::get_pool_size_count(size);
+    magazine_t& magazine = this->magazines[index];
+    assert(magazine.count >= ::batch_size);
+    magazine.count -= ::batch_size;
 
-    switch (count)
+    void** items = magazine.items.data() + magazine.count;
+    depot_t& depot = ::get_globals().depots[index];
     {
-        case 1:
-            return ::get_byte_pool<1>().new_bytes();
+        std::scoped_lock lock(depot.mutex);
+        if (depot.batches.size() < ::max_depot_batches)
+        {
+            std::copy(items, items + ::batch_size, depot.batches.emplace_back().begin());
+            return;
+        }
+    }
 
-        case 2:
-            return ::get_byte_pool<2>().new_bytes();
+    // The depot is full enough, give the memory back to the pool
+    for (size_t i = 0; i < ::batch_size; i++)
+    {
+        ::pool_funcs[index].delete_bytes(items[i]);
+    }
+}
+
+void thread_cache_t::refill(size_t index)
+{
+    magazine_t& magazine = this->magazines[index];
+    assert(!magazine.count);
 
-        case 3:
-            return ::get_byte_pool<3>().new_bytes();
+    depot_t& depot = ::get_globals().depots[index];
+    {
+        std::scoped_lock lock(depot.mutex);
+        if (!depot.batches.empty())
+        {
+            std::copy(depot.batches.back().begin(), depot.batches.back().end(), magazine.items.begin());
+            depot.batches.pop_back();
+            magazine.count = ::batch_size;
+            return;
+        }
+    }
 
-        case 4:
-            return ::get_byte_pool<4>().new_bytes();
+    for (; magazine.count < ::batch_size; magazine.count++)
+    {
+        magazine.items[magazine.count] = ::pool_funcs[index].new_bytes();
+    }
+}
+
+static thread_cache_t* get_thread_cache()
+{
+    if (::thread_cache_destroyed)
+    {
+        return nullptr;
+    }
+
+    static thread_local thread_cache_t thread_cache;
+    return &thread_cache;
+}
+
+static void count_alloc(thread_cache_t* cache, size_t index, size_t size)
+{
+    if (cache)
+    {
+        counters_t& counters = cache->counters[index];
+        counters_t::add(counters.allocs, 1);
+        counters_t::add(counters.bytes_allocated, size);
+        cache->balances[index]++;
+    }
+    else
+    {
+        globals_t& globals = ::get_globals();
+        globals.retired_allocs[index].fetch_add(1);
+        globals.retired_bytes_allocated[index].fetch_add(size);
+    }
+}
 
-        case 5:
-            return ::get_byte_pool<5>().new_bytes();
+static void count_free(thread_cache_t* cache, size_t index, size_t size)
+{
+    if (cache)
+    {
+        counters_t& counters = cache->counters[index];
+        counters_t::add(counters.frees, 1);
+        counters_t::add(counters.bytes_freed, size);
 
-        case 6:
-            return ::get_byte_pool<6>().new_bytes();
+        // This thread can't free more than it allocated, unless the memory came from another thread
+        if (--cache->balances[index] < 0)
+        {
+            cache->balances[index] = 0;
+            counters_t::add(counters.remote_frees, 1);
+        }
+    }
+    else
+    {
+        globals_t& globals = ::get_globals();
+        globals.retired_frees[index].fetch_add(1);
+        globals.retired_bytes_freed[index].fetch_add(size);
+    }
+}
 
-        case 7:
-            return ::get_byte_pool<7>().new_bytes();
+void* ff::internal::value_allocator::new_bytes(size_t size)
+{
+    const size_t count = ::get_pool_size_count(size);
+    thread_cache_t* cache = ::get_thread_cache();
 
-        case 8:
-            return ::get_byte_pool<8>().new_bytes();
+    if (count && count <= ::size_class_count)
+    {
+        const size_t index = count - 1;
+        ::count_alloc(cache, index, count * sizeof(size_t));
 
-        case 9:
-            return ::get_byte_pool<9>().new_bytes();
+        if (!cache)
+        {
+            return ::pool_funcs[index].new_bytes();
+        }
 
-        case 10:
-            return ::get_byte_pool<10>().new_bytes();
+        magazine_t& magazine = cache->magazines[index];
+        if (!magazine.count)
+        {
+            cache->refill(index);
+        }
 
-        default:
-            return std::malloc(size);
+        return magazine.items[--magazine.count];
     }
+
+    ::count_alloc(cache, ::size_class_count, size);
+    return std::malloc(size);
 }
 
 void ff::internal::value_allocator::delete_bytes(void* value, size_t size)
 {
-    size_t count = ::get_pool_size_count(size);
+    if (!value)
+    {
+        return;
+    }
 
-    switch (count)
+    const size_t count = ::get_pool_size_count(size);
+    thread_cache_t* cache = ::get_thread_cache();
+
+    if (count && count <= ::size_class_count)
     {
-        case 1:
-            ::get_byte_pool<1>().delete_bytes(value);
-            break;
+        const size_t index = count - 1;
+        ::count_free(cache, index, count * sizeof(size_t));
 
-        case 2:
-            ::get_byte_pool<2>().delete_bytes(value);
-            break;
+        if (!cache)
+        {
+            ::pool_funcs[index].delete_bytes(value);
+            return;
+        }
 
-        case 3:
-            ::get_byte_pool<3>().delete_bytes(value);
-            break;
+        magazine_t& magazine = cache->magazines[index];
+        if (magazine.count == ::magazine_size)
+        {
+            cache->flush_batch(index);
+        }
 
-        case 4:
-            ::get_byte_pool<4>().delete_bytes(value);
-            break;
+        magazine.items[magazine.count++] = value;
+        return;
+    }
 
-        case 5:
-            ::get_byte_pool<5>().delete_bytes(value);
-            break;
+    ::count_free(cache, ::size_class_count, size);
+    std::free(value);
+}
 
-        case 6:
-            ::get_byte_pool<6>().delete_bytes(value);
-            break;
+std::array<ff::internal::value_allocator::stats_t, ff::internal::value_allocator::size_class_count + 1> ff::internal::value_allocator::stats()
+{
+    std::array<size_t, ::stats_count> bytes_allocated{};
+    std::array<size_t, ::stats_count> bytes_freed{};
+    std::array<stats_t, ::stats_count> stats{};
+    globals_t& globals = ::get_globals();
+    std::scoped_lock lock(globals.threads_mutex);
 
-        case 7:
-            ::get_byte_pool<7>().delete_bytes(value);
-            break;
+    for (size_t i = 0; i < ::stats_count; i++)
+    {
+        stats[i].size = (i < ::size_class_count) ? (i + 1) * sizeof(size_t) : 0;
+        stats[i].allocs = globals.retired_allocs[i].load();
+        stats[i].frees = globals.retired_frees[i].load();
+        stats[i].remote_frees = globals.retired_remote_frees[i].load();
+        bytes_allocated[i] = globals.retired_bytes_allocated[i].load();
+        bytes_freed[i] = globals.retired_bytes_freed[i].load();
 
-        case 8:
-            ::get_byte_pool<8>().delete_bytes(value);
-            break;
+        for (thread_cache_t* cache : globals.threads)
+        {
+            const counters_t& counters = cache->counters[i];
+            stats[i].allocs += counters.allocs.load(std::memory_order_relaxed);
+            stats[i].frees += counters.frees.load(std::memory_order_relaxed);
+            stats[i].remote_frees += counters.remote_frees.load(std::memory_order_relaxed);
+            bytes_allocated[i] += counters.bytes_allocated.load(std::memory_order_relaxed);
+            bytes_freed[i] += counters.bytes_freed.load(std::memory_order_relaxed);
+        }
 
-        case 9:
-            ::get_byte_pool<9>().delete_bytes(value);
-            break;
+        // Other threads may still be counting, so don't let live bytes go negative
+        stats[i].bytes_live = (bytes_allocated[i] > bytes_freed[i]) ? bytes_allocated[i] - bytes_freed[i] : 0;
+    }
 
-        case 10:
-            ::get_byte_pool<10>().delete_bytes(value);
-            break;
+    return stats;
+}
 
-        default:
-            std::free(value);
-            break;
+void ff::internal::value_allocator::flush_thread_cache()
+{
+    thread_cache_t* cache = ::get_thread_cache();
+    if (cache)
+    {
+        cache->flush();
     }
 }
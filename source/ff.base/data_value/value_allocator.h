@@ -2,10 +2,35 @@
 
 namespace ff::internal
 {
+    /// <summary>
+    /// Allocates memory for values from pools of fixed size classes
+    /// </summary>
+    /// <remarks>
+    /// Each thread keeps a small magazine of free blocks per size class in front of the shared pools, so
+    /// most allocations and frees never touch shared memory. Magazines refill from and flush to a shared
+    /// depot in batches, and are returned to the depot when their thread exits.
+    /// </remarks>
     class value_allocator
     {
     public:
+        // Size classes are multiples of sizeof(size_t), larger allocations use malloc
+        static constexpr size_t size_class_count = 10;
+        static constexpr size_t max_pooled_size = size_class_count * sizeof(size_t);
+
+        struct stats_t
+        {
+            size_t size; // bytes per block, zero for the malloc class
+            size_t allocs;
+            size_t frees;
+            size_t bytes_live;
+            size_t remote_frees; // frees beyond what the freeing thread allocated itself
+        };
+
         static void* new_bytes(size_t size);
         static void delete_bytes(void* value, size_t size);
+
+        // The last entry is for allocations too big for any size class
+        static std::array<stats_t, size_class_count + 1> stats();
+        static void flush_thread_cache();
     };
 }
@@ -4,12 +4,14 @@
 // C++
 #include <array>
 #include <atomic>
+#include <bit>
 #include <charconv>
 #include <coroutine>
 #include <cmath>
 #include <cstdarg>
 #include <cstdint>
 #include <cstdio>
+#include <deque>
 #include <exception>
 #include <filesystem>
 #include <forward_list>
@@ -18,6 +20,7 @@
 #include <memory>
 #include <mutex>
 #include <numbers>
+#include <optional>
 #include <ostream>
 #include <random>
 #include <shared_mutex>
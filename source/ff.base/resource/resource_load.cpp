@@ -1,5 +1,7 @@
 #include "pch.h"
 #include "base/stable_hash.h"
+#include "data_value/dict_v.h"
+#include "data_value/size_v.h"
 #include "data_value/string_v.h"
 #include "data_persist/file.h"
 #include "data_persist/filesystem.h"
@@ -15,11 +17,22 @@ static std::filesystem::path get_cache_path(const std::filesystem::path& source_
     std::filesystem::path name = path_canon.filename().replace_extension();
 
     std::ostringstream str;
-    str << ff::filesystem::to_string(name) << "." << ff::stable_hash_func(path_canon_lower) << (debug ? ".debug" : "") << ".pack";
+    str << ff::filesystem::to_string(name) << "." << ff::stable_hash_func<ff::stable_hash_version::lookup3>(path_canon_lower) << (debug ? ".debug" : "") << ".pack";
     std::filesystem::path cache_path = ff::filesystem::user_local_path();
     return (cache_path /= "ff.cache") /= str.str();
 }
 
+static std::shared_ptr<ff::resource_objects> load_resource_pack(const std::filesystem::path& path, bool mem_map_file)
+{
+    auto data = mem_map_file ? ff::filesystem::map_binary_file(path) : ff::filesystem::read_binary_file(path);
+    assert_ret_val(data, std::shared_ptr<ff::resource_objects>());
+
+    auto resource_objects = std::make_shared<ff::resource_objects>();
+    assert_ret_val(resource_objects->add_resources(data), std::shared_ptr<ff::resource_objects>());
+
+    return resource_objects;
+}
+
 // mem-mapping the file will lock it on disk, not allowing the cache to be updated
 static std::shared_ptr<ff::resource_objects> load_cached_resources(const std::filesystem::path& path, bool mem_map_file)
 {
@@ -29,33 +42,57 @@ static std::shared_ptr<ff::resource_objects> load_cached_resources(const std::fi
         return {};
     }
 
-    auto data = mem_map_file ? ff::filesystem::map_binary_file(path) : ff::filesystem::read_binary_file(path);
-    assert_ret_val(data, std::shared_ptr<ff::resource_objects>());
-
-    ff::data_reader reader(data);
-    auto resource_objects = std::make_shared<ff::resource_objects>();
-    assert_ret_val(resource_objects->add_resources(reader), std::shared_ptr<ff::resource_objects>());
+    auto resource_objects = ::load_resource_pack(path, mem_map_file);
+    check_ret_val(resource_objects, std::shared_ptr<ff::resource_objects>());
 
     std::vector<std::string> input_files = resource_objects->input_files();
     check_ret_val(input_files.size(), std::shared_ptr<ff::resource_objects>());
 
+    ff::dict file_hashes = resource_objects->file_hashes();
+
     for (const std::string& file_ref : input_files)
     {
         std::filesystem::path path_ref = ff::filesystem::to_path(file_ref);
         std::filesystem::file_time_type file_ref_time = ff::filesystem::last_write_time(path_ref);
-        if (file_ref_time == std::filesystem::file_time_type::min() || time < file_ref_time)
+        if (file_ref_time == std::filesystem::file_time_type::min())
         {
-            // cache is out of data
             return {};
         }
+
+        if (time < file_ref_time)
+        {
+            // Touched files (like after a fresh checkout) are still fine if their contents didn't change
+            ff::value_ptr hash_value = file_hashes.get(file_ref);
+            if (!hash_value || hash_value->get<size_t>() != ff::internal::resource_file_hash(path_ref))
+            {
+                // cache is out of date
+                return {};
+            }
+        }
     }
 
     return resource_objects;
 }
 
+static bool parse_json(std::string_view json_text, ff::dict& dict, std::vector<std::string>& errors)
+{
+    const char* error_pos;
+    if (!ff::json_parse(json_text, dict, &error_pos))
+    {
+        std::ostringstream str;
+        size_t i = error_pos - json_text.data();
+        str << "Failed parsing JSON at pos: " << i << "\r\n  -->" << json_text.substr(i, std::min<size_t>(32, json_text.size() - i));
+        errors.push_back(str.str());
+        return false;
+    }
+
+    return true;
+}
+
 ff::load_resources_result ff::load_resources_from_file(const std::filesystem::path& path, ff::resource_cache_t cache_type, bool debug)
 {
     ff::load_resources_result result{};
+    std::shared_ptr<ff::resource_objects> previous_resources;
 
     if (cache_type != ff::resource_cache_t::none && cache_type != ff::resource_cache_t::rebuild_cache)
     {
@@ -66,13 +103,30 @@ ff::load_resources_result ff::load_resources_from_file(const std::filesystem::pa
             result.loaded_from_cache = true;
             return result;
         }
+
+        // An out of date cache still has the saved data for every resource that didn't change.
+        // Read it into memory since the cache file will be overwritten.
+        if (ff::filesystem::exists(result.cache_path))
+        {
+            previous_resources = ::load_resource_pack(result.cache_path, false);
+        }
     }
 
     std::string text;
+    ff::dict dict;
     if (ff::filesystem::read_text_file(path, text))
     {
+        if (!::parse_json(text, dict, result.errors))
+        {
+            result.cache_path.clear();
+            return result;
+        }
+
         std::filesystem::path base_path = path.parent_path();
-        result = ff::load_resources_from_json(text, base_path, debug);
+        result = (cache_type != ff::resource_cache_t::none)
+            ? ff::load_resources_from_json(dict, base_path, debug, previous_resources)
+            : ff::load_resources_from_json(dict, base_path, debug);
+
         if (result.resources)
         {
             if (debug)
@@ -84,6 +138,14 @@ ff::load_resources_result ff::load_resources_from_file(const std::filesystem::pa
                 ff::dict resource_metadata;
                 resource_metadata.set<std::vector<std::string>>(ff::internal::RES_SOURCES, std::vector<std::string>(files));
                 resource_metadata.set<std::vector<std::string>>(ff::internal::RES_FILES, std::vector<std::string>(files));
+
+                if (cache_type != ff::resource_cache_t::none)
+                {
+                    ff::dict file_hashes;
+                    file_hashes.set<size_t>(files.front(), ff::internal::resource_file_hash(path));
+                    resource_metadata.set<ff::dict>(ff::internal::RES_FILE_HASHES, std::move(file_hashes));
+                }
+
                 result.resources->add_resources(resource_metadata);
             }
 
@@ -107,16 +169,10 @@ ff::load_resources_result ff::load_resources_from_file(const std::filesystem::pa
 
 ff::load_resources_result ff::load_resources_from_json(std::string_view json_text, const std::filesystem::path& base_path, bool debug)
 {
-    const char* error_pos;
+    ff::load_resources_result result{};
     ff::dict dict;
-    if (!ff::json_parse(json_text, dict, &error_pos))
+    if (!::parse_json(json_text, dict, result.errors))
     {
-        std::ostringstream str;
-        size_t i = error_pos - json_text.data();
-        str << "Failed parsing JSON at pos: " << i << "\r\n  -->" << json_text.substr(i, std::min<size_t>(32, json_text.size() - i));
-
-        ff::load_resources_result result{};
-        result.errors.push_back(str.str());
         return result;
     }
 
@@ -153,3 +209,10 @@ bool ff::is_resource_cache_updated(const std::vector<std::filesystem::path>& sou
 
     return true;
 }
+
+size_t ff::internal::resource_file_hash(const std::filesystem::path& path)
+{
+    // Stored in cache files, so pin the hash version
+    std::shared_ptr<ff::data_base> data = ff::filesystem::read_binary_file(path);
+    return data ? ff::stable_hash_bytes(data->data(), data->size(), ff::stable_hash_version::wyhash) : 0;
+}
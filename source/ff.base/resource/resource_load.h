@@ -2,10 +2,13 @@
 
 namespace ff::internal
 {
+    inline constexpr std::string_view RES_FILE_HASHES = "res:file_hashes";
     inline constexpr std::string_view RES_FILES = "res:files";
+    inline constexpr std::string_view RES_HASHES = "res:hashes";
     inline constexpr std::string_view RES_ID_SYMBOLS = "res:id_symbols";
     inline constexpr std::string_view RES_IMPORT = "res:import";
     inline constexpr std::string_view RES_OUTPUT_FILES = "res:output_files";
+    inline constexpr std::string_view RES_SIBLINGS = "res:siblings";
     inline constexpr std::string_view RES_METADATA = "res:metadata";
     inline constexpr std::string_view RES_NAMESPACE = "res:namespace";
     inline constexpr std::string_view RES_NAMESPACES = "res:namespaces";
@@ -33,6 +36,8 @@ namespace ff
         std::vector<std::string> errors;
         std::filesystem::path cache_path;
         bool loaded_from_cache{};
+        size_t rebuilt_count{}; // resources that went through their factory
+        size_t reused_count{}; // resources copied from the previous cache because their content hash didn't change
     };
 
     enum class resource_cache_t
@@ -47,4 +52,20 @@ namespace ff
     ff::load_resources_result load_resources_from_json(std::string_view json_text, const std::filesystem::path& base_path, bool debug);
     ff::load_resources_result load_resources_from_json(const ff::dict& json_dict, const std::filesystem::path& base_path, bool debug);
     bool is_resource_cache_updated(const std::vector<std::filesystem::path>& source_files, const std::filesystem::path& cache_path);
+
+    /// <summary>
+    /// Incremental build, only resources whose content hash changed go through their factory
+    /// </summary>
+    /// <remarks>
+    /// A resource's hash covers its source after values and templates are expanded, the contents of its "file:" paths,
+    /// and the hashes of its "ref:" targets. Unchanged resources have their saved data copied from previous_resources,
+    /// which can be null for a full build. Either way the hashes are stored in the new metadata for next time.
+    /// </remarks>
+    ff::load_resources_result load_resources_from_json(const ff::dict& json_dict, const std::filesystem::path& base_path, bool debug, const std::shared_ptr<ff::resource_objects>& previous_resources);
+}
+
+namespace ff::internal
+{
+    // Content hash of a file, as stored in the RES_FILE_HASHES metadata. Zero if the file can't be read.
+    size_t resource_file_hash(const std::filesystem::path& path);
 }
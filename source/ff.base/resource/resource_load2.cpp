@@ -5,19 +5,30 @@
 #include "data_persist/dict_visitor.h"
 #include "data_persist/filesystem.h"
 #include "data_persist/json_persist.h"
+#include "data_persist/stream.h"
 #include "data_value/data_v.h"
 #include "data_value/dict_v.h"
 #include "data_value/resource_v.h"
 #include "data_value/resource_object_v.h"
+#include "data_value/size_v.h"
 #include "data_value/string_v.h"
+#include "data_value/value_vector_v.h"
 #include "resource/resource.h"
 #include "resource/resource_load.h"
 #include "resource/resource_load_context.h"
 #include "resource/resource_object_base.h"
 #include "resource/resource_object_factory_base.h"
 #include "resource/resource_objects.h"
+#include "thread/thread_pool.h"
 #include "types/scope_exit.h"
 
+// Looked up in every dict that gets transformed
+static const ff::interned_key res_import_key(ff::internal::RES_IMPORT);
+static const ff::interned_key res_symbol_key(ff::internal::RES_SYMBOL);
+static const ff::interned_key res_template_key(ff::internal::RES_TEMPLATE);
+static const ff::interned_key res_type_key(ff::internal::RES_TYPE);
+static const ff::interned_key res_values_key(ff::internal::RES_VALUES);
+
 static std::string make_symbol_from_name(std::string_view name)
 {
     std::ostringstream id;
@@ -265,6 +276,32 @@ public:
         return id_to_name_copy;
     }
 
+    void add_sibling(std::string_view name, std::string_view sibling_name)
+    {
+        std::scoped_lock lock(this->mutex);
+        this->name_to_siblings[std::string(name)].emplace_back(sibling_name);
+    }
+
+    std::vector<std::string> siblings(std::string_view name) const
+    {
+        std::scoped_lock lock(this->mutex);
+        auto i = this->name_to_siblings.find(std::string(name));
+        return (i != this->name_to_siblings.cend()) ? i->second : std::vector<std::string>();
+    }
+
+    // Objects that came from a previous build are already loaded
+    void add_reused_object(const ff::resource_object_base* obj)
+    {
+        std::scoped_lock lock(this->mutex);
+        this->reused_objects.insert(obj);
+    }
+
+    bool is_reused_object(const ff::resource_object_base* obj) const
+    {
+        std::scoped_lock lock(this->mutex);
+        return this->reused_objects.contains(obj);
+    }
+
 private:
     mutable std::recursive_mutex mutex;
     std::filesystem::path base_path_;
@@ -275,6 +312,8 @@ private:
     std::unordered_map<std::string, std::unordered_set<std::filesystem::path>> name_to_paths;
     std::unordered_set<std::filesystem::path, ff::stable_hash<std::filesystem::path>> paths_;
     std::unordered_map<std::string, std::string> id_to_name_;
+    std::unordered_map<std::string, std::vector<std::string>> name_to_siblings;
+    std::unordered_set<const ff::resource_object_base*> reused_objects;
     bool debug_;
 };
 
@@ -351,10 +390,10 @@ protected:
         std::string template_name;
         bool values_pushed = false;
 
-        ff::value_ptr values_value = input_dict.get(ff::internal::RES_VALUES);
+        ff::value_ptr values_value = input_dict.get(::res_values_key);
         if (values_value)
         {
-            input_dict.set(ff::internal::RES_VALUES, nullptr);
+            input_dict.set(::res_values_key, nullptr);
 
             ff::value_ptr values_dict = values_value->convert_or_default<ff::dict>();
             this->context().push_values().set(values_dict->get<ff::dict>(), false);
@@ -369,10 +408,10 @@ protected:
                 }
             });
 
-        ff::value_ptr template_name_value = input_dict.get(ff::internal::RES_TEMPLATE);
+        ff::value_ptr template_name_value = input_dict.get(::res_template_key);
         if (template_name_value)
         {
-            input_dict.set(ff::internal::RES_TEMPLATE, nullptr);
+            input_dict.set(::res_template_key, nullptr);
 
             if (template_name_value->is_type<std::string>())
             {
@@ -380,10 +419,10 @@ protected:
             }
         }
 
-        ff::value_ptr import_value = input_dict.get(ff::internal::RES_IMPORT);
+        ff::value_ptr import_value = input_dict.get(::res_import_key);
         if (import_value)
         {
-            input_dict.set(ff::internal::RES_IMPORT, nullptr);
+            input_dict.set(::res_import_key, nullptr);
 
             if (import_value->is_type<std::string>())
             {
@@ -554,8 +593,8 @@ protected:
             if (output_dict_value)
             {
                 const ff::dict& output_dict = output_dict_value->get<ff::dict>();
-                ff::value_ptr type_value = output_dict.get(ff::internal::RES_TYPE);
-                ff::value_ptr symbol_value = output_dict.get(ff::internal::RES_SYMBOL);
+                ff::value_ptr type_value = output_dict.get(::res_type_key);
+                ff::value_ptr symbol_value = output_dict.get(::res_symbol_key);
 
                 if (this->path_depth() == 1)
                 {
@@ -618,6 +657,11 @@ protected:
 private:
     bool finish_loading_object(ff::resource_object_base* obj)
     {
+        if (this->context().is_reused_object(obj))
+        {
+            return true;
+        }
+
         // See if it's already loading
         {
             std::unique_lock lock(this->mutex);
@@ -731,6 +775,7 @@ protected:
                                 std::string id = ::make_symbol_from_name(pair.first);
                                 this->context().set_id_to_name(id, pair.first);
                                 this->context().set_reference(pair.first, pair.second);
+                                this->context().add_sibling(name, pair.first);
                             }
                         }
                     }
@@ -778,7 +823,232 @@ protected:
     }
 };
 
-ff::load_resources_result ff::load_resources_from_json(const ff::dict& json_dict, const std::filesystem::path& base_path, bool debug)
+// Bump when the same source should produce different saved data, so that nothing from an older cache gets reused
+static constexpr size_t resource_hash_version = 1;
+
+// Hashes are stored in cache files, so pin the hash version
+static size_t hash_bytes(const void* data, size_t size)
+{
+    return ff::stable_hash_bytes(data, size, ff::stable_hash_version::wyhash);
+}
+
+static size_t hash_string(std::string_view value)
+{
+    return ::hash_bytes(value.data(), value.size());
+}
+
+static size_t hash_vector(const std::vector<size_t>& hashes)
+{
+    return ::hash_bytes(hashes.data(), ff::vector_byte_size(hashes));
+}
+
+using file_hashes_t = typename std::unordered_map<std::string_view, size_t>;
+
+// Hashes a resource's source after file paths, values, and templates were expanded, and collects the names it refers to
+static void hash_source_value(const ff::value* value, const ::file_hashes_t& file_hashes, std::vector<size_t>& hashes, std::vector<std::string>& references)
+{
+    if (!value)
+    {
+        hashes.push_back(0);
+        return;
+    }
+
+    ff::value_ptr dict_value = ff::type::try_get_dict_from_data(value);
+    if (dict_value)
+    {
+        const ff::dict& dict = dict_value->get<ff::dict>();
+        hashes.push_back(dict.size());
+
+        for (std::string_view name : dict.child_names(true))
+        {
+            hashes.push_back(::hash_string(name));
+            ::hash_source_value(dict.get(name), file_hashes, hashes, references);
+        }
+    }
+    else if (value->is_type<ff::value_vector>())
+    {
+        const ff::value_vector& values = value->get<ff::value_vector>();
+        hashes.push_back(values.size());
+
+        for (const ff::value_ptr& child_value : values)
+        {
+            ::hash_source_value(child_value, file_hashes, hashes, references);
+        }
+    }
+    else if (value->is_type<ff::resource>())
+    {
+        std::shared_ptr<ff::resource> res = value->get<ff::resource>();
+        std::string_view name = res ? res->name() : std::string_view();
+        hashes.push_back(::hash_string(ff::internal::REF_PREFIX));
+        hashes.push_back(::hash_string(name));
+        references.emplace_back(name);
+    }
+    else if (value->is_type<std::string>())
+    {
+        const std::string& string_value = value->get<std::string>();
+        hashes.push_back(::hash_string(string_value));
+
+        // Expanded "file:" paths also depend on the file contents
+        auto i = file_hashes.find(string_value);
+        if (i != file_hashes.cend())
+        {
+            hashes.push_back(i->second);
+        }
+    }
+    else
+    {
+        auto data_vector = std::make_shared<std::vector<uint8_t>>();
+        ff::data_writer writer(data_vector);
+        hashes.push_back(value->save_typed(writer) ? ::hash_bytes(data_vector->data(), data_vector->size()) : 0);
+    }
+}
+
+// Content hash of each root resource, which includes the hashes of the resources that it refers to
+class resource_hash_graph
+{
+public:
+    resource_hash_graph(const ff::dict& dict, const ::file_hashes_t& file_hashes, const ff::dict& old_siblings, bool debug)
+    {
+        std::vector<size_t> global_hashes{ ::resource_hash_version, debug ? size_t(1) : size_t(0) };
+        std::vector<std::string> global_references;
+
+        for (std::string_view name : dict.child_names(true))
+        {
+            if (name.starts_with(ff::internal::RES_PREFIX))
+            {
+                // Root metadata (like the C++ namespace) affects every resource
+                global_hashes.push_back(::hash_string(name));
+                ::hash_source_value(dict.get(name), file_hashes, global_hashes, global_references);
+            }
+            else
+            {
+                this->nodes.push_back(node_t{ std::string(name) });
+            }
+        }
+
+        const size_t global_hash = ::hash_vector(global_hashes);
+
+        ff::thread_pool::parallel_for(0, this->nodes.size(), [this, global_hash, &dict, &file_hashes](size_t begin, size_t end)
+            {
+                std::vector<size_t> hashes;
+
+                for (size_t i = begin; i < end; i++)
+                {
+                    node_t& node = this->nodes[i];
+                    hashes.clear();
+                    hashes.push_back(global_hash);
+                    ::hash_source_value(dict.get(node.name), file_hashes, hashes, node.references);
+                    node.own_hash = ::hash_vector(hashes);
+                }
+            }, 16);
+
+        for (size_t i = 0; i < this->nodes.size(); i++)
+        {
+            this->name_to_node.try_emplace(this->nodes[i].name, i);
+        }
+
+        // Siblings don't exist until their owner is loaded, so the last build's siblings are the best guess
+        for (auto& [name, siblings_value] : old_siblings)
+        {
+            if (this->name_to_node.contains(name))
+            {
+                for (const std::string& sibling : siblings_value->get<std::vector<std::string>>())
+                {
+                    this->sibling_to_owner.try_emplace(sibling, std::string(name));
+                }
+            }
+        }
+    }
+
+    std::vector<std::string_view> names() const
+    {
+        std::vector<std::string_view> names;
+        names.reserve(this->nodes.size());
+
+        for (const node_t& node : this->nodes)
+        {
+            names.push_back(node.name);
+        }
+
+        return names;
+    }
+
+    const std::vector<std::string>& references(std::string_view name) const
+    {
+        static const std::vector<std::string> empty_references;
+        auto i = this->name_to_node.find(name);
+        return (i != this->name_to_node.cend()) ? this->nodes[i->second].references : empty_references;
+    }
+
+    size_t hash(std::string_view name)
+    {
+        auto i = this->name_to_node.find(name);
+        if (i == this->name_to_node.cend())
+        {
+            auto owner = this->sibling_to_owner.find(std::string(name));
+            return (owner != this->sibling_to_owner.cend()) ? this->hash(owner->second) : ::hash_string(name);
+        }
+
+        node_t& node = this->nodes[i->second];
+        if (node.state == node_state::done)
+        {
+            return node.full_hash;
+        }
+        else if (node.state == node_state::visiting)
+        {
+            // Circular references fail later when the resources finish loading
+            return node.own_hash;
+        }
+
+        node.state = node_state::visiting;
+
+        std::vector<size_t> hashes{ node.own_hash };
+        for (const std::string& reference : node.references)
+        {
+            hashes.push_back(this->hash(reference));
+        }
+
+        node.full_hash = ::hash_vector(hashes);
+        node.state = node_state::done;
+
+        return node.full_hash;
+    }
+
+private:
+    enum class node_state
+    {
+        none,
+        visiting,
+        done,
+    };
+
+    struct node_t
+    {
+        std::string name;
+        std::vector<std::string> references;
+        size_t own_hash{};
+        size_t full_hash{};
+        node_state state{};
+    };
+
+    std::vector<node_t> nodes;
+    std::unordered_map<std::string_view, size_t> name_to_node;
+    std::unordered_map<std::string, std::string> sibling_to_owner;
+};
+
+static bool has_resource_data(ff::resource_objects* resources, std::string_view name, const std::vector<std::string>& siblings)
+{
+    check_ret_val(resources && resources->resource_data(name), false);
+
+    for (const std::string& sibling : siblings)
+    {
+        check_ret_val(resources->resource_data(sibling), false);
+    }
+
+    return true;
+}
+
+static ff::load_resources_result load_resources(const ff::dict& json_dict, const std::filesystem::path& base_path, bool debug, bool incremental, ff::resource_objects* previous_resources)
 {
     ff::dict dict = json_dict;
 
@@ -789,27 +1059,146 @@ ff::load_resources_result ff::load_resources_from_json(const ff::dict& json_dict
     ::extract_resource_siblings_transformer t4(context);
     ::finish_load_objects_from_dict_transformer t5(context);
     ::save_objects_to_dict_transformer t6(context);
-    std::array<transformer_base*, 6> transformers = { &t1, &t2, &t3, &t4, &t5, &t6 };
+    std::array<transformer_base*, 2> expand_transformers = { &t1, &t2 };
+    std::array<transformer_base*, 4> load_transformers = { &t3, &t4, &t5, &t6 };
+    std::vector<std::string> errors;
+
+    auto transform = [&dict, &context, &errors](const auto& transformers)
+        {
+            for (transformer_base* transformer : transformers)
+            {
+                ff::value_ptr new_dict_value = ff::type::try_get_dict_from_data(transformer->visit_dict(dict, errors));
+
+                if (!new_dict_value || !errors.empty() || !context.errors().empty())
+                {
+                    std::copy(context.errors().cbegin(), context.errors().cend(), std::back_inserter(errors));
+
+                    for (const std::string& error : errors)
+                    {
+                        ff::log::write(ff::log::type::resource_load, "Load resource error: ", error, "\r\n");
+                    }
 
-    for (transformer_base* transformer : transformers)
+                    return false;
+                }
+
+                dict = new_dict_value->get<ff::dict>();
+            }
+
+            return true;
+        };
+
+    if (!transform(expand_transformers))
     {
-        std::vector<std::string> errors;
-        ff::value_ptr new_dict_value = ff::type::try_get_dict_from_data(transformer->visit_dict(dict, errors));
+        return ff::load_resources_result{ nullptr, std::move(errors) };
+    }
+
+    // Everything is expanded, so now the content hashes can decide which resources need to be loaded again
+    ff::dict hashes_dict;
+    ff::dict siblings_dict;
+    ff::dict file_hashes_dict;
+    std::vector<std::string> rebuilt_names;
+    std::vector<std::string> reused_names;
+    std::unordered_set<std::string> reused_all_names; // includes siblings
+
+    if (incremental)
+    {
+        std::vector<std::filesystem::path> paths = context.paths();
+        std::vector<std::string> path_strings(paths.size());
+        std::vector<size_t> path_hashes(paths.size());
+
+        ff::thread_pool::parallel_for(0, paths.size(), [&paths, &path_strings, &path_hashes](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; i++)
+                {
+                    path_strings[i] = ff::filesystem::to_string(paths[i]);
+                    path_hashes[i] = ff::internal::resource_file_hash(paths[i]);
+                }
+            }, 1);
+
+        ::file_hashes_t file_hashes;
+        file_hashes.reserve(paths.size());
 
-        if (!new_dict_value || !errors.empty() || !context.errors().empty())
+        for (size_t i = 0; i < paths.size(); i++)
         {
-            ff::load_resources_result result{ nullptr, std::move(errors)};
-            std::copy(context.errors().cbegin(), context.errors().cend(), std::back_inserter(result.errors));
+            file_hashes.try_emplace(path_strings[i], path_hashes[i]);
+            file_hashes_dict.set<size_t>(path_strings[i], path_hashes[i]);
+        }
+
+        const ff::dict old_hashes = previous_resources ? previous_resources->resource_hashes() : ff::dict();
+        const ff::dict old_siblings = previous_resources ? previous_resources->resource_siblings() : ff::dict();
+        ::resource_hash_graph graph(dict, file_hashes, old_siblings, debug);
+
+        for (std::string_view name : graph.names())
+        {
+            const size_t hash = graph.hash(name);
+            hashes_dict.set<size_t>(name, hash);
+
+            ff::value_ptr old_hash = old_hashes.get(name);
+            std::vector<std::string> siblings = old_siblings.get<std::vector<std::string>>(name);
+
+            if (old_hash && old_hash->get<size_t>() == hash && ::has_resource_data(previous_resources, name, siblings))
+            {
+                dict.set(name, nullptr);
+                reused_names.emplace_back(name);
+                reused_all_names.emplace(name);
+                reused_all_names.insert(siblings.cbegin(), siblings.cend());
+
+                if (!siblings.empty())
+                {
+                    siblings_dict.set<std::vector<std::string>>(name, std::move(siblings));
+                }
+            }
+            else
+            {
+                rebuilt_names.emplace_back(name);
+            }
+        }
+
+        // Rebuilt resources still need the objects that they refer to, even when those are reused
+        std::vector<std::shared_ptr<ff::resource>> reused_references;
+        std::unordered_set<std::string_view> reused_reference_names;
 
-            for (const std::string& error : result.errors)
+        for (const std::string& name : rebuilt_names)
+        {
+            for (const std::string& reference : graph.references(name))
             {
-                ff::log::write(ff::log::type::resource_load, "Load resource error: ", error, "\r\n");
+                if (reused_all_names.contains(reference) && reused_reference_names.insert(reference).second)
+                {
+                    reused_references.push_back(previous_resources->get_resource_object(reference));
+                }
             }
+        }
+
+        if (!reused_references.empty())
+        {
+            previous_resources->flush_all_resources();
+
+            for (const std::shared_ptr<ff::resource>& res : reused_references)
+            {
+                ff::value_ptr value = res->value();
+                if (value->is_type<ff::resource_object_base>())
+                {
+                    context.add_reused_object(value->get<ff::resource_object_base>().get());
+                }
 
-            return result;
+                context.set_reference(res->name(), value);
+            }
+        }
+    }
+    else
+    {
+        for (std::string_view name : dict.child_names())
+        {
+            if (!name.starts_with(ff::internal::RES_PREFIX))
+            {
+                rebuilt_names.emplace_back(name);
+            }
         }
+    }
 
-        dict = new_dict_value->get<ff::dict>();
+    if (!transform(load_transformers))
+    {
+        return ff::load_resources_result{ nullptr, std::move(errors) };
     }
 
     // All input files for every single resource
@@ -857,6 +1246,18 @@ ff::load_resources_result ff::load_resources_from_json(const ff::dict& json_dict
             output_files_dict.set<ff::data_base>(i.first, i.second, ff::saved_data_type::none);
         }
 
+        if (!reused_names.empty())
+        {
+            // Output files aren't tracked per resource, so keep all the old ones that weren't replaced
+            for (auto& i : previous_resources->output_files())
+            {
+                if (!output_files_dict.get(i.first))
+                {
+                    output_files_dict.set<ff::data_base>(i.first, i.second, ff::saved_data_type::none);
+                }
+            }
+        }
+
         dict.set<ff::dict>(ff::internal::RES_OUTPUT_FILES, std::move(output_files_dict));
     }
 
@@ -868,18 +1269,67 @@ ff::load_resources_result ff::load_resources_from_json(const ff::dict& json_dict
 
     // C++ IDs
     {
+        std::string asset_namespace = dict.get<std::string>(ff::internal::RES_NAMESPACE);
         ff::dict id_dict = dict.get<ff::dict>(ff::internal::RES_ID_SYMBOLS);
         for (auto& i : context.id_to_name())
         {
             id_dict.set<std::string>(i.first, i.second);
         }
 
+        if (!reused_names.empty())
+        {
+            // The namespace is part of every hash, so reused IDs are still in the same namespace
+            for (auto& i : previous_resources->id_to_names(asset_namespace))
+            {
+                if (reused_all_names.contains(i.second) && !id_dict.get(i.first))
+                {
+                    id_dict.set<std::string>(i.first, i.second);
+                }
+            }
+        }
+
         ff::dict namespace_dict;
-        std::string asset_namespace = dict.get<std::string>(ff::internal::RES_NAMESPACE);
         namespace_dict.set<ff::dict>(asset_namespace, std::move(id_dict));
 
         dict.set<ff::dict>(ff::internal::RES_ID_SYMBOLS, std::move(namespace_dict));
     }
 
-    return ff::load_resources_result{ std::make_shared<ff::resource_objects>(dict) };
+    // Content hashes for the next incremental build
+    if (incremental)
+    {
+        for (const std::string& name : rebuilt_names)
+        {
+            std::vector<std::string> siblings = context.siblings(name);
+            if (!siblings.empty())
+            {
+                siblings_dict.set<std::vector<std::string>>(name, std::move(siblings));
+            }
+        }
+
+        dict.set<ff::dict>(ff::internal::RES_HASHES, std::move(hashes_dict));
+        dict.set<ff::dict>(ff::internal::RES_SIBLINGS, std::move(siblings_dict));
+        dict.set<ff::dict>(ff::internal::RES_FILE_HASHES, std::move(file_hashes_dict));
+    }
+
+    ff::load_resources_result result{ std::make_shared<ff::resource_objects>(dict) };
+    result.rebuilt_count = rebuilt_names.size();
+    result.reused_count = reused_names.size();
+
+    // Splice in the saved data of unchanged resources as is
+    for (const std::string& name : reused_all_names)
+    {
+        verify(result.resources->add_resource_data(name, previous_resources->resource_data(name)));
+    }
+
+    return result;
+}
+
+ff::load_resources_result ff::load_resources_from_json(const ff::dict& json_dict, const std::filesystem::path& base_path, bool debug)
+{
+    return ::load_resources(json_dict, base_path, debug, false, nullptr);
+}
+
+ff::load_resources_result ff::load_resources_from_json(const ff::dict& json_dict, const std::filesystem::path& base_path, bool debug, const std::shared_ptr<ff::resource_objects>& previous_resources)
+{
+    return ::load_resources(json_dict, base_path, debug, true, previous_resources.get());
 }
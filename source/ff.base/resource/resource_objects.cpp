@@ -2,6 +2,7 @@
 #include "base/log.h"
 #include "base/stable_hash.h"
 #include "data_persist/filesystem.h"
+#include "data_persist/persist.h"
 #include "data_persist/stream.h"
 #include "data_value/data_v.h"
 #include "data_value/dict_v.h"
@@ -22,10 +23,12 @@
 
 using namespace std::string_view_literals;
 
-static const size_t RESOURCE_PERSIST_COOKIE = ff::stable_hash_func("ff::resource_objects@0"sv);
-static const size_t RESOURCE_PERSIST_HEADER = ff::stable_hash_func("ff::resource_objects::header@0"sv);
-static const size_t RESOURCE_PERSIST_METADATA = ff::stable_hash_func("ff::resource_objects::metadata@0"sv);
-static const size_t RESOURCE_PERSIST_DATA = ff::stable_hash_func("ff::resource_objects::data@0"sv);
+static constexpr size_t RESOURCE_PERSIST_COOKIE = ff::stable_hash_func<ff::stable_hash_version::lookup3>("ff::resource_objects@0"sv);
+static constexpr size_t RESOURCE_PERSIST_COOKIE_INDEXED = ff::stable_hash_func<ff::stable_hash_version::lookup3>("ff::resource_objects@1"sv);
+static constexpr size_t RESOURCE_PERSIST_HEADER = ff::stable_hash_func<ff::stable_hash_version::lookup3>("ff::resource_objects::header@0"sv);
+static constexpr size_t RESOURCE_PERSIST_HEADER_INDEXED = ff::stable_hash_func<ff::stable_hash_version::lookup3>("ff::resource_objects::header@1"sv);
+static constexpr size_t RESOURCE_PERSIST_METADATA = ff::stable_hash_func<ff::stable_hash_version::lookup3>("ff::resource_objects::metadata@0"sv);
+static constexpr size_t RESOURCE_PERSIST_DATA = ff::stable_hash_func<ff::stable_hash_version::lookup3>("ff::resource_objects::data@0"sv);
 
 static ff::value_ptr load_typed_value(std::shared_ptr<ff::saved_data_base> saved_data)
 {
@@ -40,6 +43,29 @@ static ff::value_ptr load_typed_value(std::shared_ptr<ff::saved_data_base> saved
     return value;
 }
 
+// Reads the metadata and leaves the reader at the start of the resource data
+static bool load_metadata(ff::reader_base& reader, std::shared_ptr<ff::saved_data_base>& metadata_saved, size_t& data_start)
+{
+    size_t cookie, data_saved_size, data_loaded_size, data_flags;
+    assert_ret_val(
+        ff::load(reader, cookie) && cookie == ::RESOURCE_PERSIST_METADATA &&
+        ff::load(reader, data_saved_size) &&
+        ff::load(reader, data_loaded_size) &&
+        ff::load(reader, data_flags) &&
+        data_saved_size <= reader.size() - std::min(reader.pos(), reader.size()), false);
+
+    ff::saved_data_type data_type = static_cast<ff::saved_data_type>(data_flags & 0xFF);
+    metadata_saved = reader.saved_data(reader.pos(), data_saved_size, data_loaded_size, data_type);
+
+    const size_t data_cookie_pos = reader.pos() + data_saved_size + ff::save_padding_size(data_saved_size);
+    reader.pos(data_cookie_pos);
+
+    assert_ret_val(ff::load(reader, cookie) && cookie == ::RESOURCE_PERSIST_DATA, false);
+    data_start = reader.pos();
+
+    return true;
+}
+
 ff::resource_objects::resource_objects()
     : loading_count(0)
     , done_loading_event(true)
@@ -89,67 +115,145 @@ void ff::resource_objects::add_resources(const ff::resource_objects& other)
         this->resource_metadata_saved->push_back(metadata_saved);
     }
 
-    for (auto& [name, other_info] : other.resource_infos)
+    for (auto& [name, saved_value] : other.resource_datas())
     {
-        this->try_add_resource(name, other_info.saved_value);
+        this->try_add_resource(name, saved_value);
     }
 }
 
 bool ff::resource_objects::add_resources(ff::reader_base& reader)
 {
-    std::vector<std::tuple<std::string, size_t, size_t, size_t, size_t>> resource_datas;
+    std::vector<ff::resource_objects::pack_entry> entries;
+    std::string names;
     std::shared_ptr<ff::saved_data_base> metadata_saved;
+    size_t cookie, size, data_start;
 
-    size_t cookie;
-    assert_ret_val(ff::load(reader, cookie) && cookie == ::RESOURCE_PERSIST_COOKIE, false);
+    assert_ret_val(ff::load(reader, cookie), false);
 
     // Read header and metadata
+    if (cookie == ::RESOURCE_PERSIST_COOKIE)
     {
-        size_t size, data_offset, data_saved_size, data_loaded_size, data_flags;
         assert_ret_val(ff::load(reader, cookie) && cookie == ::RESOURCE_PERSIST_HEADER && ff::load(reader, size), false);
-        resource_datas.reserve(size);
+        entries.reserve(std::min(size, reader.size() - std::min(reader.pos(), reader.size())));
 
         for (size_t i = 0; i < size; i++)
         {
             std::string name;
+            ff::resource_objects::pack_entry entry{};
             assert_ret_val(
                 ff::load(reader, name) &&
-                ff::load(reader, data_offset) &&
-                ff::load(reader, data_saved_size) &&
-                ff::load(reader, data_loaded_size) &&
-                ff::load(reader, data_flags), false);
-            resource_datas.push_back(std::make_tuple(std::move(name), data_offset, data_saved_size, data_loaded_size, data_flags));
+                ff::load(reader, entry.data_offset) &&
+                ff::load(reader, entry.data_saved_size) &&
+                ff::load(reader, entry.data_loaded_size) &&
+                ff::load(reader, entry.data_flags), false);
+
+            entry.name_offset = static_cast<uint32_t>(names.size());
+            entry.name_size = static_cast<uint32_t>(name.size());
+            names += name;
+            entries.push_back(entry);
         }
-
+    }
+    else
+    {
+        size_t names_size;
+        assert_ret_val(cookie == ::RESOURCE_PERSIST_COOKIE_INDEXED &&
+            ff::load(reader, cookie) && cookie == ::RESOURCE_PERSIST_HEADER_INDEXED &&
+            ff::load(reader, size) &&
+            ff::load(reader, names_size), false);
+
+        // Both sizes come from the stream, so make sure they fit in it before allocating
+        const size_t remaining_size = reader.size() - std::min(reader.pos(), reader.size());
+        assert_ret_val(size <= remaining_size / sizeof(ff::resource_objects::pack_entry) &&
+            names_size <= remaining_size - size * sizeof(ff::resource_objects::pack_entry), false);
+
+        entries.resize(size);
+        names.resize(names_size);
         assert_ret_val(
-            ff::load(reader, cookie) && cookie == ::RESOURCE_PERSIST_METADATA &&
-            ff::load(reader, data_saved_size) &&
-            ff::load(reader, data_loaded_size) &&
-            ff::load(reader, data_flags), false);
-
-        ff::saved_data_type data_type = static_cast<ff::saved_data_type>(data_flags & 0xFF);
-        metadata_saved = reader.saved_data(reader.pos(), data_saved_size, data_loaded_size, data_type);
-
-        const size_t data_cookie_pos = reader.pos() + data_saved_size + ff::save_padding_size(data_saved_size);
-        reader.pos(data_cookie_pos);
+            ff::load_bytes(reader, entries.data(), ff::vector_byte_size(entries)) &&
+            ff::load_bytes(reader, names.data(), names.size()), false);
     }
 
+    assert_ret_val(::load_metadata(reader, metadata_saved, data_start), false);
+
     std::scoped_lock lock(this->resource_mutex);
     this->resource_metadata_saved->push_back(metadata_saved);
 
-    assert_ret_val(ff::load(reader, cookie) && cookie == ::RESOURCE_PERSIST_DATA, false);
-    const size_t data_start = reader.pos();
-
-    for (auto& [name, data_offset, data_saved_size, data_loaded_size, data_flags] : resource_datas)
+    for (const ff::resource_objects::pack_entry& entry : entries)
     {
-        ff::saved_data_type data_type = static_cast<ff::saved_data_type>(data_flags & 0xFF);
-        auto data = reader.saved_data(data_start + data_offset, data_saved_size, data_loaded_size, data_type);
+        assert_ret_val(static_cast<size_t>(entry.name_offset) + entry.name_size <= names.size(), false);
+        std::string_view name(names.data() + entry.name_offset, entry.name_size);
+        ff::saved_data_type data_type = static_cast<ff::saved_data_type>(entry.data_flags & 0xFF);
+        auto data = reader.saved_data(data_start + entry.data_offset, entry.data_saved_size, entry.data_loaded_size, data_type);
         this->try_add_resource(name, data);
     }
 
     return true;
 }
 
+bool ff::resource_objects::add_resources(const std::shared_ptr<ff::data_base>& data)
+{
+    assert_ret_val(data, false);
+    ff::data_reader reader(data);
+
+    size_t cookie, size, names_size;
+    if (!ff::load(reader, cookie) || cookie != ::RESOURCE_PERSIST_COOKIE_INDEXED)
+    {
+        // Older packs have no index to search in place
+        reader.pos(0);
+        return this->add_resources(reader);
+    }
+
+    assert_ret_val(
+        ff::load(reader, cookie) && cookie == ::RESOURCE_PERSIST_HEADER_INDEXED &&
+        ff::load(reader, size) &&
+        ff::load(reader, names_size), false);
+
+    // Sizes come from the data, so check them with divides and subtracts that can't overflow
+    const size_t index_pos = reader.pos();
+    const size_t remaining_size = data->size() - std::min(index_pos, data->size());
+    assert_ret_val(size <= remaining_size / sizeof(ff::resource_objects::pack_entry), false);
+    const size_t entries_size = size * sizeof(ff::resource_objects::pack_entry);
+    assert_ret_val(names_size <= remaining_size - entries_size, false);
+
+    auto pack = std::make_shared<ff::resource_objects::resource_pack>();
+    pack->data = data;
+    pack->index_data = data->subdata(index_pos, entries_size + names_size);
+
+    if (reinterpret_cast<uintptr_t>(pack->index_data->data()) % alignof(ff::resource_objects::pack_entry))
+    {
+        // The entries are used in place, so they must be aligned
+        const uint8_t* index_bytes = pack->index_data->data();
+        pack->index_data = std::make_shared<ff::data_vector>(std::vector<uint8_t>(index_bytes, index_bytes + pack->index_data->size()));
+    }
+
+    pack->entries = reinterpret_cast<const ff::resource_objects::pack_entry*>(pack->index_data->data());
+    pack->entry_count = size;
+    pack->names = std::string_view(reinterpret_cast<const char*>(pack->index_data->data() + entries_size), names_size);
+
+    reader.pos(index_pos + entries_size + names_size + ff::save_padding_size(names_size));
+
+    std::shared_ptr<ff::saved_data_base> metadata_saved;
+    assert_ret_val(::load_metadata(reader, metadata_saved, pack->data_start), false);
+
+    // Validate once so that lookups don't need to
+    assert_ret_val(pack->data_start <= data->size(), false);
+    const size_t data_size = data->size() - pack->data_start;
+
+    for (size_t i = 0; i < pack->entry_count; i++)
+    {
+        const ff::resource_objects::pack_entry& entry = pack->entries[i];
+        assert_ret_val(static_cast<size_t>(entry.name_offset) + entry.name_size <= pack->names.size() &&
+            entry.data_offset <= data_size && entry.data_saved_size <= data_size - entry.data_offset &&
+            (!i || pack->entries[i - 1].name_hash <= entry.name_hash), false);
+    }
+
+    std::scoped_lock lock(this->resource_mutex);
+    this->resource_metadata_saved->push_back(metadata_saved);
+    this->resource_packs.push_back(std::move(pack));
+
+    return true;
+}
+
 bool ff::resource_objects::add_files(const std::filesystem::path& path)
 {
     std::vector<std::filesystem::path> files;
@@ -171,8 +275,8 @@ bool ff::resource_objects::add_files(const std::filesystem::path& path)
 
     for (const auto& file : files)
     {
-        ff::file_reader reader(file);
-        assert_ret_val(reader && this->add_resources(reader), false);
+        std::shared_ptr<ff::data_base> data = ff::filesystem::map_binary_file(file);
+        assert_ret_val(data && this->add_resources(data), false);
     }
 
     return true;
@@ -252,7 +356,8 @@ void ff::resource_objects::add_metadata_only(const ff::dict& dict) const
                 this->resource_metadata_dict->set<std::vector<std::string>>(multi_child_name, std::move(strings));
             }
         }
-        else if (child_name == ff::internal::RES_ID_SYMBOLS || child_name == ff::internal::RES_OUTPUT_FILES)
+        else if (child_name == ff::internal::RES_ID_SYMBOLS || child_name == ff::internal::RES_OUTPUT_FILES ||
+            child_name == ff::internal::RES_HASHES || child_name == ff::internal::RES_SIBLINGS || child_name == ff::internal::RES_FILE_HASHES)
         {
             ff::dict add_dict = child_value->get<ff::dict>();
             ff::dict old_dict = this->resource_metadata_dict->get<ff::dict>(child_name);
@@ -275,6 +380,48 @@ bool ff::resource_objects::try_add_resource(std::string_view name, std::shared_p
     return true;
 }
 
+// caller must own resource_mutex
+std::vector<std::pair<std::string_view, std::shared_ptr<ff::saved_data_base>>> ff::resource_objects::resource_datas() const
+{
+    std::vector<std::pair<std::string_view, std::shared_ptr<ff::saved_data_base>>> result;
+    result.reserve(this->resource_infos.size());
+
+    for (auto& [name, info] : this->resource_infos)
+    {
+        result.emplace_back(name, info.saved_value);
+    }
+
+    if (!this->resource_packs.empty())
+    {
+        // Names already created, or in an earlier pack, hide the same name in later packs
+        std::unordered_set<std::string_view> used_names;
+        used_names.reserve(this->resource_infos.size());
+
+        for (auto& [name, info] : this->resource_infos)
+        {
+            used_names.insert(name);
+        }
+
+        for (auto& pack : this->resource_packs)
+        {
+            for (size_t i = 0; i < pack->entry_count; i++)
+            {
+                const ff::resource_objects::pack_entry& entry = pack->entries[i];
+                std::string_view name = pack->names.substr(entry.name_offset, entry.name_size);
+
+                if (used_names.insert(name).second)
+                {
+                    ff::saved_data_type data_type = static_cast<ff::saved_data_type>(entry.data_flags & 0xFF);
+                    auto data = pack->data->subdata(pack->data_start + entry.data_offset, entry.data_saved_size);
+                    result.emplace_back(name, std::make_shared<ff::saved_data_static>(data, entry.data_loaded_size, data_type));
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
 // caller must own resource_mutex
 ff::dict& ff::resource_objects::resource_metadata() const
 {
@@ -300,12 +447,12 @@ ff::dict& ff::resource_objects::resource_metadata() const
 bool ff::resource_objects::save(ff::writer_base& writer) const
 {
     // Collect the memory for each resource
-    std::vector<std::tuple<std::string_view, std::shared_ptr<ff::saved_data_base>>> resource_datas;
+    std::vector<std::pair<std::string_view, std::shared_ptr<ff::saved_data_base>>> resource_datas;
     std::shared_ptr<ff::data_base> metadata_data;
     size_t full_size_guess = sizeof(size_t) * 8; // cookies and sizes
     {
         std::scoped_lock lock(this->resource_mutex);
-        resource_datas.reserve(this->resource_infos.size());
+        resource_datas = this->resource_datas();
 
         // Save metadata, and reuse old saved metadata if possible
         if (this->resource_metadata_dict->empty() && this->resource_metadata_saved->size() == 1)
@@ -324,35 +471,62 @@ bool ff::resource_objects::save(ff::writer_base& writer) const
 
         full_size_guess += metadata_data->size();
 
-        for (auto& [name, info] : this->resource_infos)
+        for (auto& [name, saved_data] : resource_datas)
         {
-            resource_datas.push_back(std::make_tuple(name, info.saved_value));
-            full_size_guess += name.size() + info.saved_value->saved_size() + sizeof(size_t) * 6;
+            full_size_guess += name.size() + saved_data->saved_size() + sizeof(ff::resource_objects::pack_entry);
         }
     }
 
-    writer.reserve(full_size_guess);
-    assert_ret_val(ff::save(writer, ::RESOURCE_PERSIST_COOKIE), false);
+    // The index is sorted by name hash so that it can be searched in place after loading
+    std::vector<std::pair<size_t, size_t>> sorted_indexes; // name hash, index into resource_datas
+    sorted_indexes.reserve(resource_datas.size());
 
-    // Write header
+    for (size_t i = 0; i < resource_datas.size(); i++)
     {
-        const size_t size = resource_datas.size();
-        assert_ret_val(ff::save(writer, ::RESOURCE_PERSIST_HEADER) && ff::save(writer, size), false);
+        sorted_indexes.emplace_back(ff::stable_hash_func<ff::stable_hash_version::lookup3>(resource_datas[i].first), i);
+    }
 
-        size_t data_offset = 0;
-        for (auto& [name, saved_data] : resource_datas)
+    std::sort(sorted_indexes.begin(), sorted_indexes.end(), [&resource_datas](const auto& lhs, const auto& rhs)
         {
-            const size_t saved_size = saved_data->saved_size();
-            const size_t loaded_size = saved_data->loaded_size();
-            const size_t saved_type = static_cast<size_t>(saved_data->type());
-            assert_ret_val(
-                ff::save(writer, name) &&
-                ff::save(writer, data_offset) &&
-                ff::save(writer, saved_size) &&
-                ff::save(writer, loaded_size) &&
-                ff::save(writer, saved_type), false);
-            data_offset += saved_size + ff::save_padding_size(saved_size);
-        }
+            return lhs.first < rhs.first || (lhs.first == rhs.first && resource_datas[lhs.second].first < resource_datas[rhs.second].first);
+        });
+
+    std::vector<ff::resource_objects::pack_entry> entries;
+    std::string names;
+    entries.reserve(sorted_indexes.size());
+
+    size_t data_offset = 0;
+    for (auto& [name_hash, i] : sorted_indexes)
+    {
+        auto& [name, saved_data] = resource_datas[i];
+        assert_ret_val(names.size() + name.size() <= std::numeric_limits<uint32_t>::max(), false);
+
+        ff::resource_objects::pack_entry entry{};
+        entry.name_hash = name_hash;
+        entry.name_offset = static_cast<uint32_t>(names.size());
+        entry.name_size = static_cast<uint32_t>(name.size());
+        entry.data_offset = data_offset;
+        entry.data_saved_size = saved_data->saved_size();
+        entry.data_loaded_size = saved_data->loaded_size();
+        entry.data_flags = static_cast<size_t>(saved_data->type());
+        entries.push_back(entry);
+
+        names += name;
+        data_offset += entry.data_saved_size + ff::save_padding_size(entry.data_saved_size);
+    }
+
+    writer.reserve(full_size_guess);
+    assert_ret_val(ff::save(writer, ::RESOURCE_PERSIST_COOKIE_INDEXED), false);
+
+    // Write header
+    {
+        const size_t size = entries.size(), names_size = names.size();
+        assert_ret_val(
+            ff::save(writer, ::RESOURCE_PERSIST_HEADER_INDEXED) &&
+            ff::save(writer, size) &&
+            ff::save(writer, names_size) &&
+            ff::save_bytes(writer, entries.data(), ff::vector_byte_size(entries)) &&
+            ff::save_bytes(writer, names.data(), names.size()), false);
     }
 
     // Write metadata
@@ -369,9 +543,9 @@ bool ff::resource_objects::save(ff::writer_base& writer) const
     {
         assert_ret_val(ff::save(writer, ::RESOURCE_PERSIST_DATA), false);
 
-        for (auto& [name, saved_data] : resource_datas)
+        for (auto& [name_hash, i] : sorted_indexes)
         {
-            auto data = saved_data->saved_data();
+            auto data = resource_datas[i].second->saved_data();
             assert_ret_val(data && ff::save_bytes(writer, *data), false);
         }
     }
@@ -384,9 +558,9 @@ bool ff::resource_objects::save(ff::dict& dict) const
     std::scoped_lock lock(this->resource_mutex);
     dict.set(this->resource_metadata(), false);
 
-    for (auto& [name, info] : this->resource_infos)
+    for (auto& [name, saved_value] : this->resource_datas())
     {
-        ff::value_ptr dict_value = ::load_typed_value(info.saved_value);
+        ff::value_ptr dict_value = ::load_typed_value(saved_value);
         assert_ret_val(dict_value, false);
         dict.set(name, dict_value);
     }
@@ -394,6 +568,21 @@ bool ff::resource_objects::save(ff::dict& dict) const
     return true;
 }
 
+std::shared_ptr<ff::saved_data_base> ff::resource_objects::resource_data(std::string_view name)
+{
+    std::scoped_lock lock(this->resource_mutex);
+    ff::resource_objects::resource_object_info* info = this->find_resource_object_info(name);
+    return info ? info->saved_value : nullptr;
+}
+
+bool ff::resource_objects::add_resource_data(std::string_view name, std::shared_ptr<ff::saved_data_base> data)
+{
+    assert_ret_val(data && !name.starts_with(ff::internal::RES_PREFIX), false);
+
+    std::scoped_lock lock(this->resource_mutex);
+    return this->try_add_resource(name, std::move(data));
+}
+
 std::vector<std::string> ff::resource_objects::input_files() const
 {
     std::scoped_lock lock(this->resource_mutex);
@@ -447,6 +636,24 @@ std::vector<std::pair<std::string, std::shared_ptr<ff::data_base>>> ff::resource
     return result;
 }
 
+ff::dict ff::resource_objects::resource_hashes() const
+{
+    std::scoped_lock lock(this->resource_mutex);
+    return this->resource_metadata().get<ff::dict>(ff::internal::RES_HASHES);
+}
+
+ff::dict ff::resource_objects::resource_siblings() const
+{
+    std::scoped_lock lock(this->resource_mutex);
+    return this->resource_metadata().get<ff::dict>(ff::internal::RES_SIBLINGS);
+}
+
+ff::dict ff::resource_objects::file_hashes() const
+{
+    std::scoped_lock lock(this->resource_mutex);
+    return this->resource_metadata().get<ff::dict>(ff::internal::RES_FILE_HASHES);
+}
+
 std::shared_ptr<ff::resource> ff::resource_objects::get_resource_object(std::string_view name)
 {
     std::shared_ptr<ff::resource> value;
@@ -468,10 +675,10 @@ std::shared_ptr<ff::resource> ff::resource_objects::get_resource_object_here(std
 {
     std::shared_ptr<ff::resource> resource_result;
 
-    auto iter = this->resource_infos.find(name);
-    if (iter != this->resource_infos.cend())
+    ff::resource_objects::resource_object_info* info_ptr = this->find_resource_object_info(name);
+    if (info_ptr)
     {
-        ff::resource_objects::resource_object_info& info = iter->second;
+        ff::resource_objects::resource_object_info& info = *info_ptr;
         resource_result = info.weak_value.lock();
 
         if (!resource_result)
@@ -508,15 +715,65 @@ std::shared_ptr<ff::resource> ff::resource_objects::get_resource_object_here(std
     return resource_result;
 }
 
+// caller must own resource_mutex
+ff::resource_objects::resource_object_info* ff::resource_objects::find_resource_object_info(std::string_view name)
+{
+    auto iter = this->resource_infos.find(name);
+    if (iter != this->resource_infos.end())
+    {
+        return &iter->second;
+    }
+
+    if (!this->resource_packs.empty())
+    {
+        const size_t name_hash = ff::stable_hash_func<ff::stable_hash_version::lookup3>(name);
+
+        for (auto& pack : this->resource_packs)
+        {
+            const ff::resource_objects::pack_entry* entries_end = pack->entries + pack->entry_count;
+            const ff::resource_objects::pack_entry* entry = std::lower_bound(pack->entries, entries_end, name_hash,
+                [](const ff::resource_objects::pack_entry& lhs, size_t hash)
+                {
+                    return lhs.name_hash < hash;
+                });
+
+            for (; entry != entries_end && entry->name_hash == name_hash; entry++)
+            {
+                if (pack->names.substr(entry->name_offset, entry->name_size) == name)
+                {
+                    // First request for this resource, so create its info now
+                    ff::saved_data_type data_type = static_cast<ff::saved_data_type>(entry->data_flags & 0xFF);
+                    auto data = pack->data->subdata(pack->data_start + entry->data_offset, entry->data_saved_size);
+                    ff::resource_objects::resource_object_info info{ std::make_unique<std::string>(name), std::make_shared<ff::saved_data_static>(data, entry->data_loaded_size, data_type) };
+                    return &this->resource_infos.try_emplace(*info.name, std::move(info)).first->second;
+                }
+            }
+        }
+    }
+
+    return nullptr;
+}
+
 std::vector<std::string_view> ff::resource_objects::resource_object_names() const
 {
     std::scoped_lock lock(this->resource_mutex);
     std::vector<std::string_view> names;
-    names.reserve(this->resource_infos.size());
 
-    for (auto& i : this->resource_infos)
+    if (this->resource_packs.empty())
     {
-        names.push_back(i.first);
+        names.reserve(this->resource_infos.size());
+
+        for (auto& i : this->resource_infos)
+        {
+            names.push_back(i.first);
+        }
+    }
+    else
+    {
+        for (auto& [name, saved_value] : this->resource_datas())
+        {
+            names.push_back(name);
+        }
     }
 
     return names;
@@ -711,7 +968,7 @@ ff::co_task<> ff::resource_objects::rebuild_async()
         ff::load_resources_result result = ff::load_resources_from_file(source_path, ff::resource_cache_t::use_cache_in_memory, ff::constants::profile_build);
         if (result.resources)
         {
-            for (auto& [name, other_info] : result.resources->resource_infos)
+            for (std::string_view name : result.resources->resource_object_names())
             {
                 this->resource_infos.erase(name);
             }
@@ -756,10 +1013,11 @@ std::shared_ptr<ff::resource_object_base> ff::internal::resource_objects_factory
     std::shared_ptr<ff::saved_data_base> saved_data = dict.get<ff::saved_data_base>("resources");
     assert_ret_val(saved_data, nullptr);
 
-    auto reader = saved_data->loaded_reader();
-    assert_ret_val(reader, nullptr);
+    auto data = saved_data->loaded_data();
+    auto resource_objects = std::make_shared<ff::resource_objects>();
+    assert_ret_val(data && resource_objects->add_resources(data), nullptr);
 
-    return std::make_shared<ff::resource_objects>(*reader);
+    return resource_objects;
 }
 
 bool ff::resource_objects::save_to_cache(ff::dict& dict) const
@@ -35,9 +35,12 @@ namespace ff
         void add_resources(const ff::dict& dict);
         void add_resources(const ff::resource_objects& other);
         bool add_resources(ff::reader_base& reader);
+        bool add_resources(const std::shared_ptr<ff::data_base>& data); // indexes the pack in place, resources are only created when first requested
         bool add_files(const std::filesystem::path& path);
         bool save(ff::writer_base& writer) const;
         bool save(ff::dict& dict) const;
+        std::shared_ptr<ff::saved_data_base> resource_data(std::string_view name); // without creating the resource
+        bool add_resource_data(std::string_view name, std::shared_ptr<ff::saved_data_base> data);
 
         // Metadata
         std::vector<std::string> input_files() const;
@@ -45,6 +48,9 @@ namespace ff
         std::vector<std::string> source_namespaces() const;
         std::vector<std::pair<std::string, std::string>> id_to_names(std::string_view source_namespace) const;
         std::vector<std::pair<std::string, std::shared_ptr<ff::data_base>>> output_files() const;
+        ff::dict resource_hashes() const; // resource name -> content hash
+        ff::dict resource_siblings() const; // resource name -> names of its siblings
+        ff::dict file_hashes() const; // input file -> content hash
 
         // ff::resource_object_loader
         virtual std::shared_ptr<ff::resource> get_resource_object(std::string_view name) override;
@@ -59,12 +65,35 @@ namespace ff
         void add_resources_only(const ff::dict& dict);
         void add_metadata_only(const ff::dict& dict) const;
         bool try_add_resource(std::string_view name, std::shared_ptr<ff::saved_data_base> data);
+        std::vector<std::pair<std::string_view, std::shared_ptr<ff::saved_data_base>>> resource_datas() const; // must be holding resource_mutex
         ff::dict& resource_metadata() const; // must be holding resource_mutex
         void rebuild(ff::push_base<ff::co_task<>>& tasks);
         ff::co_task<> rebuild_async();
 
         struct resource_object_info;
 
+        // Fixed size entry in the pack's name index, sorted by name_hash and then name
+        struct pack_entry
+        {
+            size_t name_hash;
+            uint32_t name_offset; // into the name table
+            uint32_t name_size;
+            size_t data_offset;
+            size_t data_saved_size;
+            size_t data_loaded_size;
+            size_t data_flags;
+        };
+
+        struct resource_pack
+        {
+            std::shared_ptr<ff::data_base> data;
+            std::shared_ptr<ff::data_base> index_data; // pack entries followed by the name table
+            const ff::resource_objects::pack_entry* entries;
+            size_t entry_count;
+            std::string_view names;
+            size_t data_start;
+        };
+
         struct resource_object_loading_info
         {
             std::recursive_mutex mutex;
@@ -88,11 +117,13 @@ namespace ff
         void update_resource_object_info(std::shared_ptr<ff::resource_objects::resource_object_loading_info> loading_info, ff::value_ptr new_value);
         ff::value_ptr create_resource_objects(std::shared_ptr<ff::resource_objects::resource_object_loading_info> loading_info, ff::value_ptr value);
         std::shared_ptr<ff::resource> get_resource_object_here(std::string_view name);
+        ff::resource_objects::resource_object_info* find_resource_object_info(std::string_view name); // must be holding resource_mutex
 
         mutable std::recursive_mutex resource_mutex;
         std::unique_ptr<std::vector<std::shared_ptr<ff::saved_data_base>>> resource_metadata_saved;
         std::unique_ptr<ff::dict> resource_metadata_dict;
         std::unordered_map<std::string_view, ff::resource_objects::resource_object_info> resource_infos;
+        std::vector<std::shared_ptr<const ff::resource_objects::resource_pack>> resource_packs; // only searched for names missing from resource_infos
 
         std::atomic<int> loading_count;
         ff::win_event done_loading_event;
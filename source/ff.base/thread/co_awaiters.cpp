@@ -68,7 +68,14 @@ void ff::internal::co_thread_awaiter::post(std::function<void()>&& func, ff::thr
         }
     }
 
-    ff::thread_pool::add_timer(std::move(func), delay_ms, stop);
+    if (!delay_ms && !stop.stop_possible())
+    {
+        ff::thread_pool::add_task(std::move(func));
+    }
+    else
+    {
+        ff::thread_pool::add_timer(std::move(func), delay_ms, stop);
+    }
 }
 
 bool ff::internal::co_thread_awaiter::await_ready() const
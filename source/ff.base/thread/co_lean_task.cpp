@@ -0,0 +1,307 @@
+#include "pch.h"
+#include "thread/co_lean_task.h"
+#include "windows/win_handle.h"
+
+namespace
+{
+    // Coroutine frames are recycled per thread in size classes of 64 bytes, bigger frames use the heap
+    constexpr size_t frame_size_class_bytes = 64;
+    constexpr size_t frame_size_class_count = 16;
+    constexpr size_t frame_cache_max_count = 64;
+
+    struct frame_node
+    {
+        frame_node* next;
+    };
+
+    struct frame_cache
+    {
+        ~frame_cache()
+        {
+            for (frame_node*& list : this->lists)
+            {
+                while (list)
+                {
+                    frame_node* node = list;
+                    list = node->next;
+                    ::operator delete(node);
+                }
+            }
+        }
+
+        std::array<frame_node*, frame_size_class_count> lists{};
+        std::array<size_t, frame_size_class_count> counts{};
+    };
+
+    class blocking_waiter : public ff::internal::co_lean_waiter
+    {
+    public:
+        virtual std::coroutine_handle<> complete() override
+        {
+            this->event.set();
+            return std::noop_coroutine();
+        }
+
+        ff::win_event event;
+    };
+}
+
+static thread_local ::frame_cache frame_cache;
+
+static size_t frame_size_class(size_t size)
+{
+    return (size + ::frame_size_class_bytes - 1) / ::frame_size_class_bytes - 1;
+}
+
+void* ff::internal::co_lean_promise_base::operator new(size_t size)
+{
+    const size_t size_class = ::frame_size_class(size);
+    if (size_class < ::frame_size_class_count)
+    {
+        frame_node*& list = ::frame_cache.lists[size_class];
+        if (list)
+        {
+            frame_node* node = list;
+            list = node->next;
+            ::frame_cache.counts[size_class]--;
+            return node;
+        }
+
+        return ::operator new((size_class + 1) * ::frame_size_class_bytes);
+    }
+
+    return ::operator new(size);
+}
+
+void ff::internal::co_lean_promise_base::operator delete(void* frame, size_t size)
+{
+    const size_t size_class = ::frame_size_class(size);
+    if (size_class < ::frame_size_class_count && ::frame_cache.counts[size_class] < ::frame_cache_max_count)
+    {
+        // Frames freed on another thread just move to that thread's cache
+        frame_node* node = static_cast<frame_node*>(frame);
+        node->next = ::frame_cache.lists[size_class];
+        ::frame_cache.lists[size_class] = node;
+        ::frame_cache.counts[size_class]++;
+        return;
+    }
+
+    ::operator delete(frame);
+}
+
+bool ff::internal::co_lean_promise_base::done() const
+{
+    return this->state.load(std::memory_order_acquire) == state_done;
+}
+
+bool ff::internal::co_lean_promise_base::wait(size_t timeout_ms)
+{
+    if (!this->done())
+    {
+        // The only time a lean task needs a kernel event
+        ::blocking_waiter waiter;
+        if (this->set_waiter(&waiter) && !waiter.event.wait(timeout_ms))
+        {
+            if (this->remove_waiter(&waiter))
+            {
+                return false;
+            }
+
+            // Too late, the task is finishing and will set the event
+            waiter.event.wait();
+        }
+    }
+
+    this->rethrow_exception();
+    return true;
+}
+
+bool ff::internal::co_lean_promise_base::set_waiter(ff::internal::co_lean_waiter* waiter)
+{
+    uintptr_t expected = state_running;
+    if (this->state.compare_exchange_strong(expected, reinterpret_cast<uintptr_t>(waiter), std::memory_order_acq_rel))
+    {
+        return true;
+    }
+
+    assert_msg(expected == state_done, "ff::co_lean_task can only have one waiter");
+    return false;
+}
+
+bool ff::internal::co_lean_promise_base::remove_waiter(ff::internal::co_lean_waiter* waiter)
+{
+    uintptr_t expected = reinterpret_cast<uintptr_t>(waiter);
+    return this->state.compare_exchange_strong(expected, state_running, std::memory_order_acq_rel);
+}
+
+void ff::internal::co_lean_promise_base::release(std::coroutine_handle<> coroutine)
+{
+    if (this->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        coroutine.destroy();
+    }
+}
+
+void ff::internal::co_lean_promise_base::rethrow_exception() const
+{
+    if (this->exception)
+    {
+        std::rethrow_exception(this->exception);
+    }
+}
+
+std::coroutine_handle<> ff::internal::co_lean_promise_base::finish(std::coroutine_handle<> coroutine)
+{
+    const uintptr_t old_state = this->state.exchange(state_done, std::memory_order_acq_rel);
+    assert(old_state != state_done);
+
+    std::coroutine_handle<> next = (old_state != state_running)
+        ? reinterpret_cast<ff::internal::co_lean_waiter*>(old_state)->complete()
+        : std::noop_coroutine();
+
+    // Nothing in this frame can be touched after this
+    this->release(coroutine);
+    return next;
+}
+
+struct ff::internal::co_lean_when_any_awaiter::state_t
+{
+    struct entry_t : public ff::internal::co_lean_waiter
+    {
+        virtual std::coroutine_handle<> complete() override
+        {
+            std::shared_ptr<state_t> state = std::move(this->state);
+            return state->complete(this->index);
+        }
+
+        std::shared_ptr<state_t> state; // kept alive while registered
+        size_t index{};
+        bool registered{};
+    };
+
+    std::coroutine_handle<> complete(size_t index)
+    {
+        size_t expected = ff::constants::invalid_unsigned<size_t>();
+        if (this->winner.compare_exchange_strong(expected, index) && this->pending.fetch_sub(1) == 1)
+        {
+            return this->resume();
+        }
+
+        return std::noop_coroutine();
+    }
+
+    // Called once after registration is done and a winner is known
+    std::coroutine_handle<> resume()
+    {
+        for (size_t i = 0; i < this->entries.size(); i++)
+        {
+            entry_t& entry = this->entries[i];
+            if (i != this->winner && entry.registered && this->promises[i]->remove_waiter(&entry))
+            {
+                // It won't call back now
+                entry.state.reset();
+            }
+        }
+
+        if (ff::internal::co_thread_awaiter::ready(this->thread_type))
+        {
+            return this->coroutine;
+        }
+
+        ff::internal::co_thread_awaiter::post([coroutine = this->coroutine]()
+            {
+                coroutine.resume();
+            }, this->thread_type);
+
+        return std::noop_coroutine();
+    }
+
+    std::vector<ff::internal::co_lean_promise_base*> promises;
+    std::vector<entry_t> entries;
+    std::coroutine_handle<> coroutine;
+    ff::thread_dispatch_type thread_type{};
+    std::atomic_size_t winner{ ff::constants::invalid_unsigned<size_t>() };
+    std::atomic_int pending{ 2 }; // the winner and the end of registration
+};
+
+ff::internal::co_lean_when_any_awaiter::co_lean_when_any_awaiter(std::vector<ff::internal::co_lean_promise_base*>&& promises)
+    : promises(std::move(promises))
+{}
+
+bool ff::internal::co_lean_when_any_awaiter::await_ready() const
+{
+    if (this->promises.empty())
+    {
+        return true;
+    }
+
+    for (ff::internal::co_lean_promise_base* promise : this->promises)
+    {
+        if (promise->done())
+        {
+            return ff::internal::co_thread_awaiter::ready(ff::thread_dispatch::get_type());
+        }
+    }
+
+    return false;
+}
+
+std::coroutine_handle<> ff::internal::co_lean_when_any_awaiter::await_suspend(std::coroutine_handle<> coroutine)
+{
+    this->state = std::make_shared<state_t>();
+    this->state->promises = this->promises;
+    this->state->entries.resize(this->promises.size());
+    this->state->coroutine = coroutine;
+    this->state->thread_type = ff::thread_dispatch::get_type();
+
+    for (size_t i = 0; i < this->promises.size() && this->state->winner == ff::constants::invalid_unsigned<size_t>(); i++)
+    {
+        state_t::entry_t& entry = this->state->entries[i];
+        entry.state = this->state;
+        entry.index = i;
+
+        if (this->promises[i]->set_waiter(&entry))
+        {
+            entry.registered = true;
+        }
+        else
+        {
+            // Already done, so it won't call back
+            entry.state.reset();
+            this->state->complete(i);
+        }
+    }
+
+    if (this->state->pending.fetch_sub(1) == 1)
+    {
+        return this->state->resume();
+    }
+
+    return std::noop_coroutine();
+}
+
+size_t ff::internal::co_lean_when_any_awaiter::await_resume() const
+{
+    if (this->state)
+    {
+        return this->state->winner;
+    }
+
+    for (size_t i = 0; i < this->promises.size(); i++)
+    {
+        if (this->promises[i]->done())
+        {
+            return i;
+        }
+    }
+
+    return ff::constants::invalid_unsigned<size_t>();
+}
+
+ff::co_lean_task<> ff::task::when_all(std::vector<ff::co_lean_task<>> tasks)
+{
+    for (ff::co_lean_task<>& task : tasks)
+    {
+        co_await task;
+    }
+}
@@ -0,0 +1,335 @@
+#pragma once
+
+#include "../base/assert.h"
+#include "../base/constants.h"
+#include "../thread/co_awaiters.h"
+#include "../thread/thread_dispatch.h"
+
+namespace ff::internal
+{
+    /// <summary>
+    /// Gets notified once when a lean task finishes
+    /// </summary>
+    class co_lean_waiter
+    {
+    public:
+        virtual ~co_lean_waiter() = default;
+
+        // Called on the thread that finished the task, returns the coroutine to transfer to (or std::noop_coroutine)
+        virtual std::coroutine_handle<> complete() = 0;
+    };
+
+    /// <summary>
+    /// Everything a lean task needs that doesn't depend on the result type
+    /// </summary>
+    /// <remarks>
+    /// The state word is zero while running, one when done, or else it points to the only waiter.
+    /// The frame is shared by the task object and the running coroutine and is destroyed when both let go.
+    /// </remarks>
+    class co_lean_promise_base
+    {
+    public:
+        static void* operator new(size_t size);
+        static void operator delete(void* frame, size_t size);
+
+        std::suspend_never initial_suspend() const noexcept
+        {
+            return {};
+        }
+
+        auto final_suspend() noexcept
+        {
+            struct final_awaiter
+            {
+                bool await_ready() const noexcept
+                {
+                    return false;
+                }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> coroutine) noexcept
+                {
+                    return this->promise->finish(coroutine);
+                }
+
+                void await_resume() const noexcept
+                {}
+
+                ff::internal::co_lean_promise_base* promise;
+            };
+
+            return final_awaiter{ this };
+        }
+
+        void unhandled_exception() noexcept
+        {
+            this->exception = std::current_exception();
+        }
+
+        bool done() const;
+        bool wait(size_t timeout_ms);
+        bool set_waiter(ff::internal::co_lean_waiter* waiter); // false when already done, so the waiter won't be called
+        bool remove_waiter(ff::internal::co_lean_waiter* waiter); // false when the waiter is already being called
+        void release(std::coroutine_handle<> coroutine);
+        void rethrow_exception() const;
+
+    private:
+        std::coroutine_handle<> finish(std::coroutine_handle<> coroutine);
+
+        static constexpr uintptr_t state_running = 0;
+        static constexpr uintptr_t state_done = 1;
+
+        std::atomic<uintptr_t> state{ state_running };
+        std::atomic<uint32_t> refs{ 2 }; // task and coroutine
+        std::exception_ptr exception{};
+    };
+
+    template<class Task, class T = typename Task::result_type>
+    class co_lean_promise : public ff::internal::co_lean_promise_base
+    {
+    public:
+        Task get_return_object()
+        {
+            return Task(std::coroutine_handle<co_lean_promise<Task, T>>::from_promise(*this));
+        }
+
+        void return_value(const T& value)
+        {
+            this->result_ = value;
+        }
+
+        void return_value(T&& value)
+        {
+            this->result_ = std::move(value);
+        }
+
+        const T& result() const
+        {
+            this->rethrow_exception();
+            assert(this->result_.has_value());
+            return this->result_.value();
+        }
+
+    private:
+        std::optional<T> result_;
+    };
+
+    template<class Task>
+    class co_lean_promise<Task, void> : public ff::internal::co_lean_promise_base
+    {
+    public:
+        Task get_return_object()
+        {
+            return Task(std::coroutine_handle<co_lean_promise<Task, void>>::from_promise(*this));
+        }
+
+        void return_void() const
+        {}
+
+        void result() const
+        {
+            this->rethrow_exception();
+        }
+    };
+
+    template<class Promise>
+    class co_lean_awaiter : public ff::internal::co_lean_waiter
+    {
+    public:
+        co_lean_awaiter(Promise& promise, ff::thread_dispatch_type thread_type = ff::thread_dispatch_type::none)
+            : promise(promise)
+            , thread_type((thread_type == ff::thread_dispatch_type::none) ? ff::thread_dispatch::get_type() : thread_type)
+        {}
+
+        bool await_ready() const
+        {
+            return this->promise.done() && ff::internal::co_thread_awaiter::ready(this->thread_type);
+        }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> coroutine)
+        {
+            this->coroutine = coroutine;
+            return this->promise.set_waiter(this) ? std::noop_coroutine() : this->complete();
+        }
+
+        auto await_resume() const
+        {
+            return this->promise.result();
+        }
+
+        virtual std::coroutine_handle<> complete() override
+        {
+            if (ff::internal::co_thread_awaiter::ready(this->thread_type))
+            {
+                // Symmetric transfer, no trip through the dispatch queue
+                return this->coroutine;
+            }
+
+            ff::internal::co_thread_awaiter::post([coroutine = this->coroutine]()
+                {
+                    coroutine.resume();
+                }, this->thread_type);
+
+            return std::noop_coroutine();
+        }
+
+    private:
+        Promise& promise;
+        std::coroutine_handle<> coroutine;
+        ff::thread_dispatch_type thread_type;
+    };
+
+    /// <summary>
+    /// Resumes with the index of the first task to finish
+    /// </summary>
+    class co_lean_when_any_awaiter
+    {
+    public:
+        co_lean_when_any_awaiter(std::vector<ff::internal::co_lean_promise_base*>&& promises);
+        co_lean_when_any_awaiter(co_lean_when_any_awaiter&& other) noexcept = default;
+        co_lean_when_any_awaiter(const co_lean_when_any_awaiter& other) = delete;
+
+        bool await_ready() const;
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> coroutine);
+        size_t await_resume() const;
+
+    private:
+        struct state_t;
+
+        std::vector<ff::internal::co_lean_promise_base*> promises;
+        std::shared_ptr<state_t> state;
+    };
+}
+
+namespace ff
+{
+    /// <summary>
+    /// Eager coroutine task with less overhead than ff::co_task
+    /// </summary>
+    /// <remarks>
+    /// Differences from ff::co_task: it can only be moved, only one coroutine (or one call to wait) can wait
+    /// for it at a time, there is no continue_with, and awaiting coroutines resume directly on the finishing
+    /// thread when that thread matches their dispatch type. No kernel event exists unless wait() blocks.
+    /// </remarks>
+    template<class T = void>
+    class co_lean_task
+    {
+    public:
+        using this_type = typename ff::co_lean_task<T>;
+        using result_type = typename T;
+        using promise_type = typename ff::internal::co_lean_promise<this_type>;
+        using handle_type = typename std::coroutine_handle<promise_type>;
+
+        co_lean_task() = default;
+
+        explicit co_lean_task(handle_type handle)
+            : handle(handle)
+        {}
+
+        co_lean_task(this_type&& other) noexcept
+            : handle(std::exchange(other.handle, nullptr))
+        {}
+
+        co_lean_task(const this_type& other) = delete;
+
+        ~co_lean_task()
+        {
+            this->reset();
+        }
+
+        this_type& operator=(this_type&& other) noexcept
+        {
+            if (this != &other)
+            {
+                this->reset();
+                this->handle = std::exchange(other.handle, nullptr);
+            }
+
+            return *this;
+        }
+
+        this_type& operator=(const this_type& other) = delete;
+
+        auto operator co_await() const
+        {
+            assert(this->valid());
+            return ff::internal::co_lean_awaiter<promise_type>(this->handle.promise());
+        }
+
+        operator bool() const
+        {
+            return this->valid();
+        }
+
+        bool valid() const
+        {
+            return this->handle != nullptr;
+        }
+
+        bool done() const
+        {
+            return this->valid() && this->handle.promise().done();
+        }
+
+        bool wait(size_t timeout_ms = INFINITE) const
+        {
+            return this->valid() && this->handle.promise().wait(timeout_ms);
+        }
+
+        decltype(auto) result() const
+        {
+            assert(this->done());
+            return this->handle.promise().result();
+        }
+
+        ff::internal::co_lean_promise_base& promise() const
+        {
+            assert(this->valid());
+            return this->handle.promise();
+        }
+
+        void reset()
+        {
+            if (this->handle)
+            {
+                this->handle.promise().release(std::exchange(this->handle, nullptr));
+            }
+        }
+
+    private:
+        handle_type handle;
+    };
+}
+
+namespace ff::task
+{
+    ff::co_lean_task<> when_all(std::vector<ff::co_lean_task<>> tasks);
+
+    template<class T>
+    ff::co_lean_task<std::vector<T>> when_all(std::vector<ff::co_lean_task<T>> tasks)
+    {
+        std::vector<T> results;
+        results.reserve(tasks.size());
+
+        for (ff::co_lean_task<T>& task : tasks)
+        {
+            results.push_back(co_await task);
+        }
+
+        co_return results;
+    }
+
+    // The tasks must stay alive until the returned task is done. Returns an invalid index if there are no tasks.
+    template<class T>
+    ff::co_lean_task<size_t> when_any(const std::vector<ff::co_lean_task<T>>& tasks)
+    {
+        std::vector<ff::internal::co_lean_promise_base*> promises;
+        promises.reserve(tasks.size());
+
+        for (const ff::co_lean_task<T>& task : tasks)
+        {
+            promises.push_back(&task.promise());
+        }
+
+        co_return co_await ff::internal::co_lean_when_any_awaiter(std::move(promises));
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+namespace ff::internal
+{
+    /// <summary>
+    /// Intrusive lock free queue with many producers and a single consumer
+    /// </summary>
+    /// <remarks>
+    /// Items are popped in the order that they were pushed, and the queue never allocates since the link
+    /// lives in each item. Any thread may push. Only one thread at a time may pop, and pop can return null
+    /// while another thread is in the middle of a push, so the pusher must wake the consumer after pushing.
+    /// </remarks>
+    /// <typeparam name="T">Item type with a std::atomic&lt;T*&gt; next member, and default constructible for the stub</typeparam>
+    template<class T>
+    class mpsc_queue
+    {
+    public:
+        mpsc_queue()
+            : head(&this->stub)
+            , tail(&this->stub)
+        {}
+
+        mpsc_queue(mpsc_queue&& other) noexcept = delete;
+        mpsc_queue(const mpsc_queue& other) = delete;
+        mpsc_queue& operator=(mpsc_queue&& other) noexcept = delete;
+        mpsc_queue& operator=(const mpsc_queue& other) = delete;
+
+        // Any thread
+        void push(T* item)
+        {
+            item->next.store(nullptr, std::memory_order_relaxed);
+            T* prev = this->tail.exchange(item, std::memory_order_acq_rel);
+            prev->next.store(item, std::memory_order_release);
+        }
+
+        // Consumer thread only
+        T* pop()
+        {
+            T* head = this->head;
+            T* next = head->next.load(std::memory_order_acquire);
+
+            if (head == &this->stub)
+            {
+                if (!next)
+                {
+                    return nullptr;
+                }
+
+                this->head = next;
+                head = next;
+                next = next->next.load(std::memory_order_acquire);
+            }
+
+            if (next)
+            {
+                this->head = next;
+                return head;
+            }
+
+            if (head != this->tail.load(std::memory_order_acquire))
+            {
+                // A push is between its two steps
+                return nullptr;
+            }
+
+            // The last item can't be popped until something is behind it
+            this->push(&this->stub);
+            next = head->next.load(std::memory_order_acquire);
+
+            if (next)
+            {
+                this->head = next;
+                return head;
+            }
+
+            return nullptr;
+        }
+
+        // Consumer thread only
+        bool empty() const
+        {
+            return this->head == &this->stub && !this->stub.next.load(std::memory_order_acquire);
+        }
+
+    private:
+        T stub;
+        alignas(64) T* head;
+        alignas(64) std::atomic<T*> tail;
+    };
+}
@@ -0,0 +1,252 @@
+#include "pch.h"
+#include "base/assert.h"
+#include "thread/task_scheduler.h"
+
+static thread_local ff::internal::task_scheduler* current_scheduler{};
+static thread_local size_t current_worker_index{};
+
+static constexpr size_t priority_count = static_cast<size_t>(ff::thread_pool::task_priority::count);
+static constexpr size_t spin_count = 64;
+
+ff::internal::task_scheduler::task_scheduler(size_t thread_count)
+    : pending_count(0)
+    , sleeping_count(0)
+    , wake_epoch(0)
+{
+    if (!thread_count)
+    {
+        thread_count = std::max<size_t>(std::thread::hardware_concurrency(), 2) - 1;
+    }
+
+    for (injection_t& injection : this->injection)
+    {
+        injection.size = 0;
+    }
+
+    this->workers.reserve(thread_count);
+
+    for (size_t i = 0; i < thread_count; i++)
+    {
+        this->workers.push_back(std::make_unique<worker_t>());
+        this->workers.back()->index = i;
+        this->workers.back()->random = static_cast<uint32_t>(i * 2654435761u + 1);
+    }
+
+    // Start threads after all workers exist since they steal from each other
+    for (std::unique_ptr<worker_t>& worker : this->workers)
+    {
+        worker->thread = std::jthread([this, &worker = *worker](std::stop_token stop)
+            {
+                this->worker_thread(worker, stop);
+            });
+    }
+}
+
+ff::internal::task_scheduler::~task_scheduler()
+{
+    for (std::unique_ptr<worker_t>& worker : this->workers)
+    {
+        worker->thread.request_stop();
+    }
+
+    this->wake_epoch.fetch_add(1);
+    this->wake_epoch.notify_all();
+
+    for (std::unique_ptr<worker_t>& worker : this->workers)
+    {
+        worker->thread.join();
+    }
+
+    // Anything left over was added during shutdown, so just run it here
+    while (this->try_run_task());
+
+    assert(!this->pending_count);
+    this->workers.clear();
+}
+
+void ff::internal::task_scheduler::add_task(std::function<void()>&& func, ff::thread_pool::task_priority priority)
+{
+    size_t priority_index = static_cast<size_t>(priority);
+    assert_ret(priority_index < ::priority_count);
+
+    task_t* task = this->task_allocator.new_obj(task_t{ std::move(func) });
+    this->pending_count.fetch_add(1);
+
+    if (::current_scheduler == this)
+    {
+        this->workers[::current_worker_index]->deques[priority_index].push(task);
+    }
+    else
+    {
+        injection_t& injection = this->injection[priority_index];
+        std::scoped_lock lock(injection.mutex);
+        injection.tasks.push_back(task);
+        injection.size.fetch_add(1);
+    }
+
+    this->wake_worker();
+}
+
+bool ff::internal::task_scheduler::try_run_task()
+{
+    task_t* task = this->find_task(::current_scheduler == this ? this->workers[::current_worker_index].get() : nullptr);
+    if (task)
+    {
+        this->run_task(task);
+        return true;
+    }
+
+    return false;
+}
+
+void ff::internal::task_scheduler::wait_for_idle()
+{
+    for (size_t pending = this->pending_count.load(); pending; pending = this->pending_count.load())
+    {
+        if (!this->try_run_task())
+        {
+            // Tasks are running on other threads
+            this->pending_count.wait(pending);
+        }
+    }
+}
+
+size_t ff::internal::task_scheduler::thread_count() const
+{
+    return this->workers.size();
+}
+
+bool ff::internal::task_scheduler::current_thread() const
+{
+    return ::current_scheduler == this;
+}
+
+void ff::internal::task_scheduler::worker_thread(worker_t& worker, std::stop_token stop)
+{
+    ff::set_thread_name("ff::thread_pool::worker");
+    ::current_scheduler = this;
+    ::current_worker_index = worker.index;
+
+    while (!stop.stop_requested())
+    {
+        task_t* task = nullptr;
+        for (size_t i = 0; !task && i < ::spin_count; i++)
+        {
+            task = this->find_task(&worker);
+            if (!task)
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        if (!task)
+        {
+            // Anyone adding a task after this will see the sleeping count and bump the epoch
+            this->sleeping_count.fetch_add(1);
+            uint32_t epoch = this->wake_epoch.load();
+
+            task = this->find_task(&worker);
+            if (!task && !stop.stop_requested())
+            {
+                this->wake_epoch.wait(epoch);
+            }
+
+            this->sleeping_count.fetch_sub(1);
+        }
+
+        if (task)
+        {
+            this->run_task(task);
+        }
+    }
+
+    ::current_scheduler = nullptr;
+}
+
+ff::internal::task_scheduler::task_t* ff::internal::task_scheduler::find_task(worker_t* worker)
+{
+    for (size_t priority = 0; priority < ::priority_count; priority++)
+    {
+        if (worker)
+        {
+            task_t* task = worker->deques[priority].pop();
+            if (task)
+            {
+                return task;
+            }
+        }
+
+        injection_t& injection = this->injection[priority];
+        if (injection.size.load(std::memory_order_relaxed))
+        {
+            std::scoped_lock lock(injection.mutex);
+            if (!injection.tasks.empty())
+            {
+                task_t* task = injection.tasks.front();
+                injection.tasks.pop_front();
+                injection.size.fetch_sub(1);
+                return task;
+            }
+        }
+
+        task_t* task = this->steal_task(worker, priority);
+        if (task)
+        {
+            return task;
+        }
+    }
+
+    return nullptr;
+}
+
+ff::internal::task_scheduler::task_t* ff::internal::task_scheduler::steal_task(worker_t* worker, size_t priority)
+{
+    const size_t count = this->workers.size();
+    size_t start = 0;
+
+    if (worker)
+    {
+        // xorshift to pick a random victim, so thieves don't all pile onto the same worker
+        worker->random ^= worker->random << 13;
+        worker->random ^= worker->random >> 17;
+        worker->random ^= worker->random << 5;
+        start = worker->random % count;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        worker_t& victim = *this->workers[(start + i) % count];
+        if (&victim != worker && !victim.deques[priority].empty())
+        {
+            task_t* task = victim.deques[priority].steal();
+            if (task)
+            {
+                return task;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+void ff::internal::task_scheduler::run_task(task_t* task)
+{
+    task->func();
+    this->task_allocator.delete_obj(task);
+
+    if (this->pending_count.fetch_sub(1) == 1)
+    {
+        this->pending_count.notify_all();
+    }
+}
+
+void ff::internal::task_scheduler::wake_worker()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (this->sleeping_count.load())
+    {
+        this->wake_epoch.fetch_add(1);
+        this->wake_epoch.notify_one();
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "../thread/thread_pool.h"
+#include "../thread/work_stealing_deque.h"
+#include "../types/pool_allocator.h"
+
+namespace ff::internal
+{
+    /// <summary>
+    /// Work stealing scheduler that runs tasks on its own worker threads
+    /// </summary>
+    /// <remarks>
+    /// Each worker owns one deque per priority. Tasks added from a worker go to that worker's deque,
+    /// tasks added from any other thread go into a shared injection queue. Idle workers steal from each
+    /// other, always preferring higher priority work. Only the standard library is used, so the worker loop
+    /// doesn't depend on the OS thread pool.
+    /// </remarks>
+    class task_scheduler
+    {
+    public:
+        task_scheduler(size_t thread_count = 0);
+        task_scheduler(task_scheduler&& other) noexcept = delete;
+        task_scheduler(const task_scheduler& other) = delete;
+        ~task_scheduler();
+
+        task_scheduler& operator=(task_scheduler&& other) noexcept = delete;
+        task_scheduler& operator=(const task_scheduler& other) = delete;
+
+        void add_task(std::function<void()>&& func, ff::thread_pool::task_priority priority = ff::thread_pool::task_priority::normal);
+        bool try_run_task();
+        void wait_for_idle();
+        size_t thread_count() const;
+        bool current_thread() const;
+
+    private:
+        struct task_t
+        {
+            std::function<void()> func;
+        };
+
+        struct worker_t
+        {
+            std::array<ff::internal::work_stealing_deque<task_t*>, static_cast<size_t>(ff::thread_pool::task_priority::count)> deques;
+            std::jthread thread;
+            size_t index{};
+            uint32_t random{};
+        };
+
+        struct injection_t
+        {
+            std::mutex mutex;
+            std::deque<task_t*> tasks;
+            std::atomic_size_t size;
+        };
+
+        void worker_thread(worker_t& worker, std::stop_token stop);
+        task_t* find_task(worker_t* worker);
+        task_t* steal_task(worker_t* worker, size_t priority);
+        void run_task(task_t* task);
+        void wake_worker();
+
+        ff::pool_allocator<task_t> task_allocator;
+        std::vector<std::unique_ptr<worker_t>> workers;
+        std::array<injection_t, static_cast<size_t>(ff::thread_pool::task_priority::count)> injection;
+        std::atomic_size_t pending_count;
+        std::atomic_size_t sleeping_count;
+        std::atomic_uint32_t wake_epoch;
+    };
+}
@@ -14,9 +14,13 @@ namespace ff
     void set_thread_name(std::string_view name);
 }
 
-ff::thread_dispatch::thread_dispatch(thread_dispatch_type type)
-    : thread_id(::GetCurrentThreadId())
+ff::thread_dispatch::thread_dispatch(thread_dispatch_type type, size_t max_pending)
+    : pending_count(0)
+    , posting_count(0)
+    , wake_pending(false)
     , destroyed(false)
+    , max_pending(max_pending)
+    , thread_id(::GetCurrentThreadId())
     , message_window(ff::window::create_message_window())
     , message_window_connection(this->message_window.message_sink().connect(std::bind(&thread_dispatch::handle_message, this, std::placeholders::_1, std::placeholders::_2)))
 {
@@ -46,13 +50,17 @@ ff::thread_dispatch::thread_dispatch(thread_dispatch_type type)
 
 ff::thread_dispatch::~thread_dispatch()
 {
-    // Don't allow new dispatches
+    // Don't allow new dispatches, but run the ones that other threads are still adding
+    this->destroyed = true;
+
+    while (this->posting_count)
     {
-        std::scoped_lock lock(this->mutex);
-        this->destroyed = true;
+        this->flush(true);
+        std::this_thread::yield();
     }
 
     this->flush(true);
+    assert(this->queue.empty());
 
     if (::main_thread_dispatch == this)
     {
@@ -139,37 +147,6 @@ ff::thread_dispatch_type ff::thread_dispatch::get_type()
     return ff::thread_dispatch_type::task;
 }
 
-void ff::thread_dispatch::post(std::function<void()>&& func, bool run_if_current_thread)
-{
-    if (!this || (run_if_current_thread && this->current_thread()))
-    {
-        func();
-        return;
-    }
-
-    std::scoped_lock lock(this->mutex);
-
-    if (this->destroyed)
-    {
-        func();
-        return;
-    }
-
-    bool was_empty = this->funcs.empty();
-    this->funcs.push_front(std::move(func));
-
-    if (was_empty)
-    {
-        this->flushed_event.reset();
-
-        if (!this->pending_event.is_set())
-        {
-            this->pending_event.set();
-            this->post_flush();
-        }
-    }
-}
-
 bool ff::thread_dispatch::send(std::function<void()>&& func, size_t timeout_ms, bool allow_dispatch)
 {
     if (this->current_thread())
@@ -311,27 +288,29 @@ void ff::thread_dispatch::flush(bool force)
 
     if (force || this->current_thread())
     {
-        std::forward_list<std::function<void()>> funcs;
+        while (true)
         {
-            std::scoped_lock lock(this->mutex);
-            funcs = std::move(this->funcs);
-        }
+            // Any post from now on needs a new wakeup, unless this loop sees it
+            this->wake_pending = false;
+            this->pending_event.reset();
 
-        while (!funcs.empty())
-        {
-            funcs.reverse();
-            for (auto& func : funcs)
+            while (ff::internal::dispatch_node* node = this->queue.pop())
             {
-                func();
-            }
+                node->invoke();
+                node->~dispatch_node();
+                this->node_pool.delete_bytes(node);
 
-            std::scoped_lock lock(this->mutex);
-            funcs = std::move(this->funcs);
+                if (this->max_pending && this->pending_count.fetch_sub(1) == this->max_pending)
+                {
+                    this->pending_count.notify_all();
+                }
+            }
 
-            if (funcs.empty())
+            std::scoped_lock lock(this->wake_mutex);
+            if (!this->wake_pending)
             {
                 this->flushed_event.set();
-                this->pending_event.reset();
+                break;
             }
         }
     }
@@ -341,6 +320,58 @@ void ff::thread_dispatch::flush(bool force)
     }
 }
 
+void* ff::thread_dispatch::begin_post()
+{
+    this->posting_count.fetch_add(1);
+
+    if (this->destroyed)
+    {
+        this->posting_count.fetch_sub(1);
+        return nullptr;
+    }
+
+    if (this->max_pending)
+    {
+        if (this->current_thread())
+        {
+            // The owner thread can't wait for itself
+            this->pending_count.fetch_add(1);
+        }
+        else
+        {
+            // Back pressure, wait for the owner thread to make room
+            size_t count = this->pending_count.load();
+            do
+            {
+                while (count >= this->max_pending)
+                {
+                    this->pending_count.wait(count);
+                    count = this->pending_count.load();
+                }
+            }
+            while (!this->pending_count.compare_exchange_weak(count, count + 1));
+        }
+    }
+
+    return this->node_pool.new_bytes();
+}
+
+void ff::thread_dispatch::end_post(ff::internal::dispatch_node* node)
+{
+    this->queue.push(node);
+
+    if (!this->wake_pending.exchange(true))
+    {
+        // First post since the owner thread started flushing, later posts share this wakeup
+        std::scoped_lock lock(this->wake_mutex);
+        this->flushed_event.reset();
+        this->pending_event.set();
+        this->post_flush();
+    }
+
+    this->posting_count.fetch_sub(1);
+}
+
 void ff::thread_dispatch::post_flush()
 {
     ::PostMessage(this->message_window, WM_USER, 0, 0);
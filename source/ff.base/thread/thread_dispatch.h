@@ -1,9 +1,92 @@
 #pragma once
 
+#include "../thread/mpsc_queue.h"
+#include "../types/pool_allocator.h"
 #include "../types/signal.h"
 #include "../windows/win_handle.h"
 #include "../windows/window.h"
 
+namespace ff::internal
+{
+    /// <summary>
+    /// One posted function waiting in a thread_dispatch queue
+    /// </summary>
+    /// <remarks>
+    /// Functions up to inline_size bytes (a std::function, or a lambda capturing a few pointers) are stored
+    /// in the node itself, so posting them doesn't allocate. Bigger functions are moved to the heap.
+    /// </remarks>
+    class dispatch_node
+    {
+    public:
+        static constexpr size_t inline_size = 8 * sizeof(void*);
+
+        dispatch_node() = default;
+
+        template<class Func>
+        explicit dispatch_node(Func&& func)
+        {
+            using func_type = typename std::decay_t<Func>;
+
+            if constexpr (sizeof(func_type) <= inline_size && alignof(func_type) <= alignof(std::max_align_t))
+            {
+                ::new(this->storage.data()) func_type(std::forward<Func>(func));
+
+                this->call_func = [](void* data, bool invoke)
+                    {
+                        func_type& stored_func = *static_cast<func_type*>(data);
+                        if (invoke)
+                        {
+                            stored_func();
+                        }
+
+                        stored_func.~func_type();
+                    };
+            }
+            else
+            {
+                *reinterpret_cast<func_type**>(this->storage.data()) = new func_type(std::forward<Func>(func));
+
+                this->call_func = [](void* data, bool invoke)
+                    {
+                        std::unique_ptr<func_type> stored_func(*static_cast<func_type**>(data));
+                        if (invoke)
+                        {
+                            (*stored_func)();
+                        }
+                    };
+            }
+        }
+
+        dispatch_node(dispatch_node&& other) noexcept = delete;
+        dispatch_node(const dispatch_node& other) = delete;
+        dispatch_node& operator=(dispatch_node&& other) noexcept = delete;
+        dispatch_node& operator=(const dispatch_node& other) = delete;
+
+        ~dispatch_node()
+        {
+            if (this->call_func)
+            {
+                this->call_func(this->storage.data(), false);
+            }
+        }
+
+        // Calls the function once and then destroys it
+        void invoke()
+        {
+            if (this->call_func)
+            {
+                std::exchange(this->call_func, nullptr)(this->storage.data(), true);
+            }
+        }
+
+        std::atomic<dispatch_node*> next{};
+
+    private:
+        void (*call_func)(void* data, bool invoke){};
+        alignas(std::max_align_t) std::array<uint8_t, inline_size> storage;
+    };
+}
+
 namespace ff
 {
     enum class thread_dispatch_type
@@ -15,10 +98,18 @@ namespace ff
         task, // background thread, not related to game or UI
     };
 
+    /// <summary>
+    /// Queues functions to run later on the thread that created this object
+    /// </summary>
+    /// <remarks>
+    /// Posting is lock free and functions run in the order they were posted. Only the first post after a flush
+    /// wakes up the owner thread, later posts are handled by that same flush. When max_pending isn't zero,
+    /// other threads that post wait until the owner thread has run enough functions to make room.
+    /// </remarks>
     class thread_dispatch
     {
     public:
-        thread_dispatch(thread_dispatch_type type = thread_dispatch_type::none);
+        thread_dispatch(thread_dispatch_type type = thread_dispatch_type::none, size_t max_pending = 0);
         thread_dispatch(thread_dispatch&& other) noexcept = delete;
         thread_dispatch(const thread_dispatch& other) = delete;
         ~thread_dispatch();
@@ -32,7 +123,20 @@ namespace ff
         static thread_dispatch* get_frame();
         static ff::thread_dispatch_type get_type();
 
-        void post(std::function<void()>&& func, bool run_if_current_thread = false);
+        template<class Func>
+        void post(Func&& func, bool run_if_current_thread = false)
+        {
+            void* node_bytes = (!this || (run_if_current_thread && this->current_thread())) ? nullptr : this->begin_post();
+            if (node_bytes)
+            {
+                this->end_post(::new(node_bytes) ff::internal::dispatch_node(std::forward<Func>(func)));
+            }
+            else
+            {
+                func();
+            }
+        }
+
         bool send(std::function<void()>&& func, size_t timeout_ms = INFINITE, bool allow_dispatch = true);
         void flush();
         bool current_thread() const;
@@ -44,16 +148,23 @@ namespace ff
         static constexpr size_t maximum_wait_objects = MAXIMUM_WAIT_OBJECTS - 2;
 
     private:
+        void* begin_post(); // returns null when functions must run right away
+        void end_post(ff::internal::dispatch_node* node);
         void flush(bool force);
         void post_flush();
+        void handle_message(ff::window* window, ff::window_message& msg);
 
-        std::recursive_mutex mutex;
-        std::forward_list<std::function<void()>> funcs;
+        ff::internal::mpsc_queue<ff::internal::dispatch_node> queue;
+        ff::byte_pool_allocator<ff::internal::dispatch_node> node_pool;
+        std::atomic_size_t pending_count; // only counted when max_pending is set
+        std::atomic_size_t posting_count; // posts in progress, destruction waits for them
+        std::atomic_bool wake_pending; // true from the first post until the owner thread starts flushing
+        std::atomic_bool destroyed;
+        std::mutex wake_mutex;
         ff::win_event flushed_event;
         ff::win_event pending_event;
+        size_t max_pending;
         DWORD thread_id;
-        bool destroyed;
-        void handle_message(ff::window* window, ff::window_message& msg);
 
         ff::window message_window;
         ff::signal_connection message_window_connection;
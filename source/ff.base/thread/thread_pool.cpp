@@ -2,6 +2,7 @@
 #include "base/assert.h"
 #include "base/stable_hash.h"
 #include "base/string.h"
+#include "thread/task_scheduler.h"
 #include "thread/thread_pool.h"
 #include "windows/win_handle.h"
 
@@ -33,14 +34,88 @@ namespace
         std::stop_token stop;
         std::stop_callback<std::function<void()>> stop_callback;
     };
+
+    class parallel_for_data
+    {
+    public:
+        parallel_for_data(size_t begin, size_t end, size_t grain, size_t participants, const std::function<void(size_t, size_t, size_t)>& func)
+            : func(func)
+            , end(end)
+            , grain(grain)
+            , participants(participants)
+            , next(begin)
+            , next_participant(1)
+            , active(0)
+            , closed(false)
+        {}
+
+        // Called by helper tasks, which might not start until the caller has already finished all the work
+        void run_helper()
+        {
+            this->active.fetch_add(1);
+
+            if (!this->closed.load())
+            {
+                this->run(this->next_participant.fetch_add(1));
+            }
+
+            if (this->active.fetch_sub(1) == 1)
+            {
+                this->active.notify_all();
+            }
+        }
+
+        // Called by the thread that started the loop, returns after all helpers are done with func
+        void run_caller()
+        {
+            this->run(0);
+            this->closed.store(true);
+
+            for (size_t active = this->active.load(); active; active = this->active.load())
+            {
+                this->active.wait(active);
+            }
+        }
+
+    private:
+        void run(size_t participant)
+        {
+            assert_ret(participant < this->participants);
+
+            for (size_t chunk_begin = this->next.load(std::memory_order_relaxed); chunk_begin < this->end; )
+            {
+                // Guided chunk size: big chunks while there is a lot left, down to the grain size near the end
+                size_t remaining = this->end - chunk_begin;
+                size_t chunk_size = std::min(remaining, std::max(this->grain, remaining / (this->participants * 2)));
+
+                if (this->next.compare_exchange_weak(chunk_begin, chunk_begin + chunk_size, std::memory_order_relaxed))
+                {
+                    this->func(participant, chunk_begin, chunk_begin + chunk_size);
+                    chunk_begin = this->next.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        const std::function<void(size_t, size_t, size_t)>& func;
+        const size_t end;
+        const size_t grain;
+        const size_t participants;
+        std::atomic_size_t next;
+        std::atomic_size_t next_participant;
+        std::atomic_size_t active;
+        std::atomic_bool closed;
+    };
 }
 
 static std::mutex mutex;
 static bool pool_valid{};
 static TP_CALLBACK_ENVIRON pool_env{};
 static PTP_CLEANUP_GROUP pool_cleanup{};
-static size_t next_data_handle{ 1 }; // odd numbers are for data_map lookups, otherwise it's a ::task_data_t*
+static size_t next_data_handle{}; // key for data_map lookups from timer and wait callbacks
 static std::unordered_map<size_t, std::unique_ptr<::task_data_t>, ff::no_hash<size_t>> data_map;
+static std::shared_mutex scheduler_mutex; // shared while using the scheduler, exclusive to create or remove it
+static std::unique_ptr<ff::internal::task_scheduler> scheduler;
+static std::atomic_bool scheduler_valid;
 
 static std::tuple<FILETIME, bool> delay_to_filetime(size_t delay_ms)
 {
@@ -56,25 +131,17 @@ static std::tuple<FILETIME, bool> delay_to_filetime(size_t delay_ms)
     }
 }
 
-static void task_callback(PTP_CALLBACK_INSTANCE instance, void* context)
+static void wait_callback(PTP_CALLBACK_INSTANCE instance, void* context, PTP_WAIT wait, TP_WAIT_RESULT result)
 {
-    ff::set_thread_name("ff::thread_pool::task");
+    ff::set_thread_name("ff::thread_pool::wait");
     std::unique_ptr<task_data_t> data;
     {
-        size_t context_size = reinterpret_cast<size_t>(context);
-        if (context_size & 1)
-        {
-            std::scoped_lock lock(::mutex);
-            auto i = ::data_map.find(reinterpret_cast<size_t>(context));
-            if (i != ::data_map.end())
-            {
-                data = std::move(i->second);
-                ::data_map.erase(i);
-            }
-        }
-        else
+        std::scoped_lock lock(::mutex);
+        auto i = ::data_map.find(reinterpret_cast<size_t>(context));
+        if (i != ::data_map.end())
         {
-            data = std::unique_ptr<::task_data_t>(reinterpret_cast<::task_data_t*>(context));
+            data = std::move(i->second);
+            ::data_map.erase(i);
         }
     }
 
@@ -82,15 +149,11 @@ static void task_callback(PTP_CALLBACK_INSTANCE instance, void* context)
     {
         data->func();
     }
-}
 
-static void wait_callback(PTP_CALLBACK_INSTANCE instance, void* context, PTP_WAIT wait, TP_WAIT_RESULT result)
-{
-    ::task_callback(instance, context);
     ::CloseThreadpoolWait(wait);
 }
 
-static std::tuple<size_t, HANDLE, bool> create_data(std::function<void()>&& func, bool add_to_data_map = false, std::stop_token stop = {})
+static std::tuple<size_t, HANDLE, bool> create_data(std::function<void()>&& func, std::stop_token stop = {})
 {
     std::unique_ptr<::task_data_t> data;
 
@@ -116,15 +179,8 @@ static std::tuple<size_t, HANDLE, bool> create_data(std::function<void()>&& func
         std::scoped_lock lock(::mutex);
         if (::pool_valid)
         {
-            if (add_to_data_map)
-            {
-                ::data_map.try_emplace(::next_data_handle += 2, std::move(data));
-                return std::make_tuple(::next_data_handle, return_handle, true);
-            }
-            else
-            {
-                return { {}, {}, ::TrySubmitThreadpoolCallback(&::task_callback, data.release(), &::pool_env) != FALSE };
-            }
+            ::data_map.try_emplace(++::next_data_handle, std::move(data));
+            return std::make_tuple(::next_data_handle, return_handle, true);
         }
     }
 
@@ -150,6 +206,7 @@ static void flush(bool destroying)
         old_pool_valid = ::pool_valid;
         data_map = std::move(::data_map);
         ::pool_valid = false;
+        ::scheduler_valid = false;
     }
 
     std::jthread([&data_map]()
@@ -161,12 +218,25 @@ static void flush(bool destroying)
             }
 
             ::CloseThreadpoolCleanupGroupMembers(::pool_cleanup, FALSE, nullptr);
+
+            // Only destroy() removes the scheduler, and it flushes first on this same thread
+            ff::internal::task_scheduler* scheduler;
+            {
+                std::shared_lock lock(::scheduler_mutex);
+                scheduler = ::scheduler.get();
+            }
+
+            if (scheduler)
+            {
+                scheduler->wait_for_idle();
+            }
         });
 
     if (!destroying)
     {
         std::scoped_lock lock(::mutex);
         ::pool_valid = old_pool_valid;
+        ::scheduler_valid = old_pool_valid;
     }
 }
 
@@ -178,7 +248,13 @@ void ff::internal::thread_pool::init()
     ::InitializeThreadpoolEnvironment(&::pool_env);
     ::pool_cleanup = ::CreateThreadpoolCleanupGroup();
     ::SetThreadpoolCallbackCleanupGroup(&::pool_env, ::pool_cleanup, nullptr);
+    {
+        std::unique_lock scheduler_lock(::scheduler_mutex);
+        ::scheduler = std::make_unique<ff::internal::task_scheduler>();
+    }
+
     ::pool_valid = true;
+    ::scheduler_valid = true;
 }
 
 void ff::internal::thread_pool::destroy()
@@ -187,6 +263,16 @@ void ff::internal::thread_pool::destroy()
 
     ::flush(true);
 
+    // Once it's taken out, add_task() runs inline. Worker threads are joined outside of the lock
+    // because the tasks they are still running might call add_task().
+    std::unique_ptr<ff::internal::task_scheduler> scheduler;
+    {
+        std::unique_lock scheduler_lock(::scheduler_mutex);
+        scheduler = std::move(::scheduler);
+    }
+
+    scheduler.reset();
+
     std::scoped_lock lock(::mutex);
     ::CloseThreadpoolCleanupGroup(::pool_cleanup);
     ::pool_cleanup = nullptr;
@@ -199,14 +285,67 @@ void ff::thread_pool::flush()
     ::flush(false);
 }
 
-void ff::thread_pool::add_task(std::function<void()>&& func)
+void ff::thread_pool::add_task(std::function<void()>&& func, ff::thread_pool::task_priority priority)
 {
-    ::create_data(std::move(func));
+    if (::scheduler_valid)
+    {
+        std::shared_lock lock(::scheduler_mutex);
+        if (::scheduler)
+        {
+            ::scheduler->add_task(std::move(func), priority);
+            return;
+        }
+    }
+
+    func();
+}
+
+size_t ff::thread_pool::thread_count()
+{
+    std::shared_lock lock(::scheduler_mutex);
+    return ::scheduler ? ::scheduler->thread_count() : 0;
+}
+
+size_t ff::internal::thread_pool::max_parallelism()
+{
+    return ff::thread_pool::thread_count() + 1;
+}
+
+void ff::internal::thread_pool::parallel_for(size_t begin, size_t end, size_t grain, const std::function<void(size_t participant, size_t begin, size_t end)>& func)
+{
+    if (begin >= end)
+    {
+        return;
+    }
+
+    const size_t count = end - begin;
+    const size_t participants = ff::internal::thread_pool::max_parallelism();
+    grain = grain ? grain : std::max<size_t>(count / (participants * 16), 1);
+
+    const size_t helper_count = std::min((count + grain - 1) / grain, participants) - 1;
+    if (!helper_count || !::scheduler_valid)
+    {
+        func(0, begin, end);
+        return;
+    }
+
+    // Shared with helper tasks that might outlive this call, they won't touch func once closed
+    auto data = std::make_shared<::parallel_for_data>(begin, end, grain, participants, func);
+
+    for (size_t i = 0; i < helper_count; i++)
+    {
+        ff::thread_pool::add_task([data]()
+            {
+                data->run_helper();
+            }, ff::thread_pool::task_priority::high);
+    }
+
+    data->run_caller();
 }
 
 void ff::thread_pool::add_timer(std::function<void()>&& func, size_t delay_ms, std::stop_token stop)
 {
-    auto [context, stop_handle, added] = ::create_data(std::move(func), true, stop);
+    auto [context, stop_handle, added] = ::create_data(std::move(func), stop);
     if (added)
     {
         auto [delay_ft, delay_valid] = ::delay_to_filetime(delay_ms);
@@ -217,7 +356,7 @@ void ff::thread_pool::add_timer(std::function<void()>&& func, size_t delay_ms, s
 
 void ff::thread_pool::add_wait(std::function<void()>&& func, HANDLE handle, size_t timeout_ms)
 {
-    auto [context, stop_handle, added] = ::create_data(std::move(func), true);
+    auto [context, stop_handle, added] = ::create_data(std::move(func));
     if (added)
     {
         auto [delay_ft, delay_valid] = ::delay_to_filetime(timeout_ms);
@@ -5,16 +5,75 @@ namespace ff
     void set_thread_name(std::string_view name);
 }
 
+namespace ff::internal::thread_pool
+{
+    void init();
+    void destroy();
+
+    size_t max_parallelism();
+    void parallel_for(size_t begin, size_t end, size_t grain, const std::function<void(size_t participant, size_t begin, size_t end)>& func);
+}
+
 namespace ff::thread_pool
 {
-    void add_task(std::function<void()>&& func);
+    enum class task_priority
+    {
+        high,
+        normal,
+        low,
+
+        count
+    };
+
+    void add_task(std::function<void()>&& func, ff::thread_pool::task_priority priority = ff::thread_pool::task_priority::normal);
     void add_timer(std::function<void()>&& func, size_t delay_ms, std::stop_token stop = {});
     void add_wait(std::function<void()>&& func, HANDLE handle, size_t timeout_ms = INFINITE);
     void flush();
-}
+    size_t thread_count();
 
-namespace ff::internal::thread_pool
-{
-    void init();
-    void destroy();
+    /// <summary>
+    /// Calls func(chunk_begin, chunk_end) for chunks of [begin, end) across all worker threads and the calling thread
+    /// </summary>
+    /// <remarks>
+    /// When grain is zero, chunk sizes adapt to the amount of remaining work. Returns after every chunk is done.
+    /// </remarks>
+    template<class Func>
+    void parallel_for(size_t begin, size_t end, Func&& func, size_t grain = 0)
+    {
+        ff::internal::thread_pool::parallel_for(begin, end, grain, [&func](size_t participant, size_t chunk_begin, size_t chunk_end)
+            {
+                func(chunk_begin, chunk_end);
+            });
+    }
+
+    /// <summary>
+    /// Maps chunks of [begin, end) to values of T using map_func(chunk_begin, chunk_end), then combines them with reduce_func(T, T)
+    /// </summary>
+    /// <remarks>
+    /// reduce_func must be associative and commutative since chunks finish in any order.
+    /// </remarks>
+    template<class T, class MapFunc, class ReduceFunc>
+    T parallel_reduce(size_t begin, size_t end, T identity, MapFunc&& map_func, ReduceFunc&& reduce_func, size_t grain = 0)
+    {
+        std::vector<std::optional<T>> results(ff::internal::thread_pool::max_parallelism());
+
+        ff::internal::thread_pool::parallel_for(begin, end, grain, [&results, &map_func, &reduce_func](size_t participant, size_t chunk_begin, size_t chunk_end)
+            {
+                std::optional<T>& result = results[participant];
+                result = result.has_value()
+                    ? reduce_func(std::move(*result), map_func(chunk_begin, chunk_end))
+                    : map_func(chunk_begin, chunk_end);
+            });
+
+        T result = std::move(identity);
+        for (std::optional<T>& i : results)
+        {
+            if (i.has_value())
+            {
+                result = reduce_func(std::move(result), std::move(*i));
+            }
+        }
+
+        return result;
+    }
 }
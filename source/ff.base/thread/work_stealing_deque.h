@@ -0,0 +1,150 @@
+#pragma once
+
+#include "../base/math.h"
+
+namespace ff::internal
+{
+    /// <summary>
+    /// Chase-Lev work stealing deque of pointers
+    /// </summary>
+    /// <remarks>
+    /// Only the owning thread may call push and pop, which work on the bottom of the deque.
+    /// Any thread may call steal, which takes from the top. Growing the buffer keeps old buffers
+    /// alive until the deque is destroyed, since a stealing thread might still be reading them.
+    /// </remarks>
+    /// <typeparam name="T">Pointer type to store, nullptr means empty</typeparam>
+    template<class T>
+    class work_stealing_deque
+    {
+        static_assert(std::is_pointer_v<T>);
+
+    public:
+        work_stealing_deque(size_t capacity = 256)
+            : top(0)
+            , bottom(0)
+        {
+            this->buffers.push_back(std::make_unique<buffer_t>(std::max<size_t>(ff::math::nearest_power_of_two(capacity), 16)));
+            this->buffer.store(this->buffers.back().get(), std::memory_order_relaxed);
+        }
+
+        work_stealing_deque(work_stealing_deque&& other) noexcept = delete;
+        work_stealing_deque(const work_stealing_deque& other) = delete;
+        work_stealing_deque& operator=(work_stealing_deque&& other) noexcept = delete;
+        work_stealing_deque& operator=(const work_stealing_deque& other) = delete;
+
+        // Owner thread only
+        void push(T item)
+        {
+            int64_t b = this->bottom.load(std::memory_order_relaxed);
+            int64_t t = this->top.load(std::memory_order_acquire);
+            buffer_t* buffer = this->buffer.load(std::memory_order_relaxed);
+
+            if (b - t > static_cast<int64_t>(buffer->mask))
+            {
+                buffer = this->grow(buffer, t, b);
+            }
+
+            buffer->put(b, item);
+            std::atomic_thread_fence(std::memory_order_release);
+            this->bottom.store(b + 1, std::memory_order_relaxed);
+        }
+
+        // Owner thread only
+        T pop()
+        {
+            int64_t b = this->bottom.load(std::memory_order_relaxed) - 1;
+            buffer_t* buffer = this->buffer.load(std::memory_order_relaxed);
+            this->bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = this->top.load(std::memory_order_relaxed);
+
+            if (t > b)
+            {
+                this->bottom.store(b + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            T item = buffer->get(b);
+            if (t == b)
+            {
+                // Racing with thieves for the last item
+                if (!this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                {
+                    item = nullptr;
+                }
+
+                this->bottom.store(b + 1, std::memory_order_relaxed);
+            }
+
+            return item;
+        }
+
+        // Any thread
+        T steal()
+        {
+            int64_t t = this->top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = this->bottom.load(std::memory_order_acquire);
+
+            if (t < b)
+            {
+                T item = this->buffer.load(std::memory_order_acquire)->get(t);
+                if (this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                {
+                    return item;
+                }
+            }
+
+            return nullptr;
+        }
+
+        // Only a hint when called from a thread that isn't the owner
+        bool empty() const
+        {
+            int64_t b = this->bottom.load(std::memory_order_relaxed);
+            int64_t t = this->top.load(std::memory_order_relaxed);
+            return b <= t;
+        }
+
+    private:
+        struct buffer_t
+        {
+            buffer_t(size_t capacity)
+                : mask(capacity - 1)
+                , items(std::make_unique<std::atomic<T>[]>(capacity))
+            {}
+
+            T get(int64_t index) const
+            {
+                return this->items[static_cast<size_t>(index) & this->mask].load(std::memory_order_relaxed);
+            }
+
+            void put(int64_t index, T item)
+            {
+                this->items[static_cast<size_t>(index) & this->mask].store(item, std::memory_order_relaxed);
+            }
+
+            size_t mask;
+            std::unique_ptr<std::atomic<T>[]> items;
+        };
+
+        buffer_t* grow(buffer_t* old_buffer, int64_t t, int64_t b)
+        {
+            this->buffers.push_back(std::make_unique<buffer_t>((old_buffer->mask + 1) * 2));
+            buffer_t* new_buffer = this->buffers.back().get();
+
+            for (int64_t i = t; i < b; i++)
+            {
+                new_buffer->put(i, old_buffer->get(i));
+            }
+
+            this->buffer.store(new_buffer, std::memory_order_release);
+            return new_buffer;
+        }
+
+        alignas(64) std::atomic<int64_t> top;
+        alignas(64) std::atomic<int64_t> bottom;
+        std::atomic<buffer_t*> buffer;
+        std::vector<std::unique_ptr<buffer_t>> buffers; // owner thread only
+    };
+}
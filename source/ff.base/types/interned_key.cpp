@@ -0,0 +1,192 @@
+#include "pch.h"
+#include "base/assert.h"
+#include "base/math.h"
+#include "base/stable_hash.h"
+#include "types/interned_key.h"
+
+namespace
+{
+    using entry_t = typename ff::interned_key::entry_t;
+
+    // Open addressing, readers probe without locking so slots are only ever filled in
+    struct table_t
+    {
+        table_t(size_t size)
+            : slots(std::make_unique<std::atomic<const entry_t*>[]>(size))
+            , mask(size - 1)
+        {}
+
+        std::unique_ptr<std::atomic<const entry_t*>[]> slots;
+        size_t mask;
+        size_t count{};
+    };
+
+    class shard_t
+    {
+    public:
+        shard_t()
+            : table(this->tables.emplace_back(std::make_unique<table_t>(shard_t::initial_size)).get())
+        {}
+
+        const entry_t* find(std::string_view name, size_t hash) const
+        {
+            return shard_t::find(*this->table.load(std::memory_order_acquire), name, hash);
+        }
+
+        const entry_t* add(std::string_view name, size_t hash, std::atomic<uint32_t>& next_id)
+        {
+            std::scoped_lock lock(this->mutex);
+
+            // Another thread may have added it since the lock-free find
+            table_t* table = this->table.load(std::memory_order_relaxed);
+            const entry_t* entry = shard_t::find(*table, name, hash);
+            if (entry)
+            {
+                return entry;
+            }
+
+            if ((table->count + 1) * 2 > table->mask + 1)
+            {
+                // Readers may still be using the old table, so it stays alive
+                table_t* new_table = this->tables.emplace_back(std::make_unique<table_t>((table->mask + 1) * 2)).get();
+                for (size_t i = 0; i <= table->mask; i++)
+                {
+                    const entry_t* old_entry = table->slots[i].load(std::memory_order_relaxed);
+                    if (old_entry)
+                    {
+                        shard_t::insert(*new_table, old_entry);
+                    }
+                }
+
+                this->table.store(new_table, std::memory_order_release);
+                table = new_table;
+            }
+
+            entry = this->new_entry(name, hash, next_id.fetch_add(1, std::memory_order_relaxed));
+            shard_t::insert(*table, entry);
+            return entry;
+        }
+
+    private:
+        static constexpr size_t initial_size = 64;
+        static constexpr size_t block_size = 16384;
+
+        static const entry_t* find(const table_t& table, std::string_view name, size_t hash)
+        {
+            for (size_t i = hash & table.mask; ; i = (i + 1) & table.mask)
+            {
+                const entry_t* entry = table.slots[i].load(std::memory_order_acquire);
+                if (!entry)
+                {
+                    return nullptr;
+                }
+
+                if (entry->hash == hash && entry->size == name.size() && !std::memcmp(entry + 1, name.data(), name.size()))
+                {
+                    return entry;
+                }
+            }
+        }
+
+        // caller must own mutex
+        static void insert(table_t& table, const entry_t* entry)
+        {
+            size_t i = entry->hash & table.mask;
+            while (table.slots[i].load(std::memory_order_relaxed))
+            {
+                i = (i + 1) & table.mask;
+            }
+
+            table.slots[i].store(entry, std::memory_order_release);
+            table.count++;
+        }
+
+        // caller must own mutex
+        const entry_t* new_entry(std::string_view name, size_t hash, uint32_t id)
+        {
+            // The characters are null terminated for anyone that needs a C string
+            const size_t size = ff::math::align_up(sizeof(entry_t) + name.size() + 1, alignof(entry_t));
+            uint8_t* bytes;
+
+            if (size > shard_t::block_size / 4)
+            {
+                bytes = this->large_blocks.emplace_back(std::make_unique<uint8_t[]>(size)).get();
+            }
+            else
+            {
+                if (this->blocks.empty() || this->block_used + size > shard_t::block_size)
+                {
+                    this->blocks.push_back(std::make_unique<uint8_t[]>(shard_t::block_size));
+                    this->block_used = 0;
+                }
+
+                bytes = this->blocks.back().get() + this->block_used;
+                this->block_used += size;
+            }
+
+            entry_t* entry = ::new(bytes) entry_t{ hash, id, static_cast<uint32_t>(name.size()) };
+            char* chars = reinterpret_cast<char*>(entry + 1);
+            std::memcpy(chars, name.data(), name.size());
+            chars[name.size()] = 0;
+
+            return entry;
+        }
+
+        std::mutex mutex;
+        std::vector<std::unique_ptr<table_t>> tables;
+        std::atomic<table_t*> table;
+        std::vector<std::unique_ptr<uint8_t[]>> blocks;
+        std::vector<std::unique_ptr<uint8_t[]>> large_blocks;
+        size_t block_used{};
+    };
+
+    struct interner_t
+    {
+        // The top bits of the hash pick a shard, and the low bits pick a slot within it
+        static constexpr size_t shard_bits = 6;
+
+        shard_t& shard(size_t hash)
+        {
+            return this->shards[hash >> (sizeof(size_t) * 8 - interner_t::shard_bits)];
+        }
+
+        std::array<shard_t, size_t(1) << shard_bits> shards;
+        std::atomic<uint32_t> next_id{ 1 };
+    };
+}
+
+static ::interner_t& interner()
+{
+    static ::interner_t interner;
+    return interner;
+}
+
+static size_t hash_name(std::string_view name)
+{
+    return ff::stable_hash_bytes(name.data(), name.size());
+}
+
+ff::interned_key::interned_key(std::string_view name)
+{
+    const size_t hash = ::hash_name(name);
+    ::shard_t& shard = ::interner().shard(hash);
+    const entry_t* entry = shard.find(name, hash);
+
+    *this = interned_key(entry ? entry : shard.add(name, hash, ::interner().next_id));
+}
+
+ff::interned_key::interned_key(const entry_t* entry)
+    : std::string_view(reinterpret_cast<const char*>(entry + 1), entry->size)
+{}
+
+ff::interned_key ff::interned_key::find(std::string_view name)
+{
+    const size_t hash = ::hash_name(name);
+    const entry_t* entry = ::interner().shard(hash).find(name, hash);
+    return entry ? interned_key(entry) : interned_key();
+}
+
+size_t ff::interned_key::count()
+{
+    return ::interner().next_id.load(std::memory_order_relaxed) - 1;
+}
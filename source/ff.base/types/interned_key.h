@@ -0,0 +1,71 @@
+#pragma once
+
+namespace ff
+{
+    /// <summary>
+    /// A string_view into a process-wide table of unique strings, which also knows its hash and a small integer ID
+    /// </summary>
+    /// <remarks>
+    /// Equal strings always intern to the same memory, so comparing keys is just comparing pointers, and the hash is never computed twice.
+    /// Interned strings are never freed. Looking up a string doesn't lock, adding a new one only locks one of many shards of the table.
+    /// </remarks>
+    class interned_key : public std::string_view
+    {
+    public:
+        interned_key() = default;
+        explicit interned_key(std::string_view name); // adds the name when needed
+        interned_key(const interned_key& other) = default;
+
+        interned_key& operator=(const interned_key& other) = default;
+
+        static interned_key find(std::string_view name); // never adds, so the key is invalid when the name was never interned
+        static size_t count();
+
+        bool valid() const
+        {
+            return this->data() != nullptr;
+        }
+
+        size_t hash() const
+        {
+            return this->valid() ? this->entry()->hash : 0;
+        }
+
+        uint32_t id() const // dense and starts at one, zero is invalid
+        {
+            return this->valid() ? this->entry()->id : 0;
+        }
+
+        struct hasher
+        {
+            size_t operator()(const ff::interned_key& key) const noexcept
+            {
+                return key.hash();
+            }
+        };
+
+        struct equal_to
+        {
+            bool operator()(const ff::interned_key& lhs, const ff::interned_key& rhs) const noexcept
+            {
+                return lhs.data() == rhs.data();
+            }
+        };
+
+        // Header right before the characters of every interned string
+        struct entry_t
+        {
+            size_t hash;
+            uint32_t id;
+            uint32_t size;
+        };
+
+    private:
+        explicit interned_key(const entry_t* entry);
+
+        const entry_t* entry() const
+        {
+            return reinterpret_cast<const entry_t*>(this->data()) - 1;
+        }
+    };
+}
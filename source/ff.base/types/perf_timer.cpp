@@ -2,6 +2,7 @@
 #include "base/assert.h"
 #include "base/constants.h"
 #include "types/perf_timer.h"
+#include "types/perf_trace.h"
 
 static ff::perf_measures perf_measures_game;
 
@@ -27,6 +28,12 @@ int64_t ff::perf_measures::now_ticks()
     return __rdtsc();
 }
 
+bool ff::perf_measures::current_thread() const
+{
+    const DWORD id = this->thread_id.load(std::memory_order_relaxed);
+    return !id || id == ::GetCurrentThreadId();
+}
+
 size_t ff::perf_measures::create()
 {
     assert_msg(this->counters < ff::perf_counter::MAX_COUNT, "Too many perf_counters are registered!");
@@ -88,6 +95,12 @@ int64_t ff::perf_measures::reset(double absolute_seconds, ff::perf_results* resu
     const double delta_seconds = absolute_seconds - this->last_absolute_seconds;
     this->last_ticks = now_ticks;
     this->last_absolute_seconds = absolute_seconds;
+    this->thread_id.store(::GetCurrentThreadId(), std::memory_order_relaxed);
+
+    if (this == &::perf_measures_game && ff::perf_trace::enabled())
+    {
+        ff::perf_trace::add_frame(now_ticks);
+    }
 
     if (ff::constants::profile_build)
     {
@@ -164,19 +177,35 @@ ff::perf_timer::perf_timer(const ff::perf_counter& counter)
 ff::perf_timer::perf_timer(const ff::perf_counter& counter, int64_t start_ticks)
     : counter(counter)
     , start(start_ticks)
+    , measured(counter.measures.current_thread())
 {
-    counter.measures.start(counter);
+    if (this->measured)
+    {
+        counter.measures.start(counter);
+    }
 }
 
 ff::perf_timer::~perf_timer()
 {
     const int64_t end = ff::perf_measures::now_ticks();
-    this->counter.measures.end(this->counter, (end - this->start) * (end > this->start));
+
+    if (this->measured)
+    {
+        this->counter.measures.end(this->counter, (end - this->start) * (end > this->start));
+    }
+
+    if (ff::perf_trace::enabled())
+    {
+        ff::perf_trace::add_event(this->counter, this->start, end);
+    }
 }
 
 void ff::perf_timer::no_op(const ff::perf_counter& counter)
 {
-    counter.measures.no_op(counter);
+    if (counter.measures.current_thread())
+    {
+        counter.measures.no_op(counter);
+    }
 }
 
 #else
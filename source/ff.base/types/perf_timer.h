@@ -72,6 +72,9 @@ namespace ff
         static ff::perf_measures& game();
         static int64_t now_ticks();
 
+        // Only the thread that calls reset can collect measurements, perf_timer on other threads only traces
+        bool current_thread() const;
+
         size_t create();
         void start(const ff::perf_counter& counter);
         void end(const ff::perf_counter& counter, int64_t ticks);
@@ -113,9 +116,10 @@ namespace ff
         int64_t last_ticks{};
         size_t level{};
         size_t counters{};
+        std::atomic<DWORD> thread_id{};
     };
 
-    // Put in a method to measure the current block
+    // Put in a method to measure the current block, works on any thread when ff::perf_trace is enabled
     class perf_timer
     {
     public:
@@ -135,6 +139,7 @@ namespace ff
 #if PROFILE_APP
         const ff::perf_counter& counter;
         int64_t start;
+        bool measured;
 #endif
     };
 }
@@ -0,0 +1,288 @@
+#include "pch.h"
+#include "base/string.h"
+#include "data_persist/filesystem.h"
+#include "types/perf_timer.h"
+#include "types/perf_trace.h"
+#include "types/timer.h"
+#include "windows/win_handle.h"
+
+std::atomic_bool ff::internal::perf_trace::enabled;
+
+#if PROFILE_APP
+
+namespace
+{
+    constexpr size_t event_capacity = 1 << 15; // per thread
+    constexpr size_t frame_capacity = 1024;
+
+    // Fields are atomic since the collector can read while the owning thread overwrites
+    struct trace_event
+    {
+        std::atomic<int64_t> start;
+        std::atomic<int64_t> end;
+        std::atomic<const ff::perf_counter*> counter;
+    };
+
+    struct thread_trace
+    {
+        DWORD thread_id{ ::GetCurrentThreadId() };
+        std::atomic_uint64_t write_count{};
+        uint64_t cleared_count{}; // collector only
+        std::unique_ptr<trace_event[]> events{ std::make_unique<trace_event[]>(::event_capacity) };
+    };
+
+    struct copied_event
+    {
+        int64_t start;
+        int64_t end;
+        const ff::perf_counter* counter;
+    };
+}
+
+// Thread traces live until the process ends, since threads hold raw pointers to them
+static std::mutex thread_traces_mutex;
+static std::vector<std::unique_ptr<::thread_trace>> thread_traces;
+static thread_local ::thread_trace* current_thread_trace{};
+
+static std::array<std::atomic<int64_t>, ::frame_capacity> frame_ticks;
+static std::atomic_uint64_t frame_write_count;
+static uint64_t frame_cleared_count;
+
+static int64_t calibrate_ticks;
+static int64_t calibrate_raw_time;
+
+static ::thread_trace& get_thread_trace()
+{
+    if (!::current_thread_trace)
+    {
+        std::scoped_lock lock(::thread_traces_mutex);
+        ::current_thread_trace = ::thread_traces.emplace_back(std::make_unique<::thread_trace>()).get();
+    }
+
+    return *::current_thread_trace;
+}
+
+// Copies events that weren't overwritten during the copy, oldest first
+static std::vector<::copied_event> copy_events(const ::thread_trace& trace, int64_t start_ticks)
+{
+    std::vector<::copied_event> events;
+    const uint64_t end_count = trace.write_count.load(std::memory_order_acquire);
+    const uint64_t start_count = std::max(trace.cleared_count, (end_count > ::event_capacity) ? end_count - ::event_capacity : 0);
+    events.reserve(static_cast<size_t>(end_count - start_count));
+
+    for (uint64_t i = start_count; i < end_count; i++)
+    {
+        const ::trace_event& event = trace.events[static_cast<size_t>(i % ::event_capacity)];
+        events.push_back(::copied_event{ event.start.load(std::memory_order_relaxed), event.end.load(std::memory_order_relaxed), event.counter.load(std::memory_order_relaxed) });
+    }
+
+    // The owning thread kept writing, drop anything it might have touched
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t new_end_count = trace.write_count.load(std::memory_order_relaxed);
+    if (new_end_count >= start_count + ::event_capacity)
+    {
+        const size_t overwritten = static_cast<size_t>(std::min<uint64_t>(new_end_count - ::event_capacity - start_count + 1, events.size()));
+        events.erase(events.begin(), events.begin() + overwritten);
+    }
+
+    std::erase_if(events, [start_ticks](const ::copied_event& event)
+        {
+            return event.end < start_ticks || !event.counter;
+        });
+
+    return events;
+}
+
+static int64_t window_start_ticks(size_t frame_count)
+{
+    const uint64_t end_count = ::frame_write_count.load(std::memory_order_acquire);
+    const uint64_t available_count = std::min<uint64_t>(end_count - ::frame_cleared_count, ::frame_capacity);
+
+    return (frame_count && frame_count <= available_count)
+        ? ::frame_ticks[static_cast<size_t>((end_count - frame_count) % ::frame_capacity)].load(std::memory_order_relaxed)
+        : 0;
+}
+
+static double ticks_per_microsecond()
+{
+    int64_t raw_time = ff::timer::current_raw_time();
+    double seconds = ff::timer::seconds_between_raw(::calibrate_raw_time, raw_time);
+
+    // Need a long enough time to measure the CPU counter frequency
+    while (seconds < 0.05)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        raw_time = ff::timer::current_raw_time();
+        seconds = ff::timer::seconds_between_raw(::calibrate_raw_time, raw_time);
+    }
+
+    return (ff::perf_measures::now_ticks() - ::calibrate_ticks) / (seconds * 1000000.0);
+}
+
+static std::string thread_name(DWORD thread_id)
+{
+    std::string name;
+    ff::win_handle thread(::OpenThread(THREAD_QUERY_LIMITED_INFORMATION, FALSE, thread_id));
+    PWSTR description{};
+
+    if (thread && SUCCEEDED(::GetThreadDescription(thread, &description)) && description)
+    {
+        name = ff::string::to_string(description);
+        ::LocalFree(description);
+    }
+
+    return !name.empty() ? name : ff::string::concat("Thread ", thread_id);
+}
+
+static void write_json_string(std::ostringstream& output, std::string_view text)
+{
+    output << '\"';
+
+    for (char ch : text)
+    {
+        switch (ch)
+        {
+            case '\"': output << "\\\""; break;
+            case '\\': output << "\\\\"; break;
+            case '\n': output << "\\n"; break;
+            case '\r': output << "\\r"; break;
+            case '\t': output << "\\t"; break;
+
+            default:
+                if (static_cast<unsigned char>(ch) < 0x20)
+                {
+                    char hex[8];
+                    std::snprintf(hex, sizeof(hex), "\\u%04x", static_cast<unsigned int>(ch));
+                    output << hex;
+                }
+                else
+                {
+                    output << ch;
+                }
+                break;
+        }
+    }
+
+    output << '\"';
+}
+
+void ff::perf_trace::enable(bool value)
+{
+    if (value && !ff::internal::perf_trace::enabled)
+    {
+        ::calibrate_raw_time = ff::timer::current_raw_time();
+        ::calibrate_ticks = ff::perf_measures::now_ticks();
+    }
+
+    ff::internal::perf_trace::enabled = value;
+}
+
+void ff::perf_trace::clear()
+{
+    std::scoped_lock lock(::thread_traces_mutex);
+
+    for (std::unique_ptr<::thread_trace>& trace : ::thread_traces)
+    {
+        trace->cleared_count = trace->write_count.load(std::memory_order_acquire);
+    }
+
+    ::frame_cleared_count = ::frame_write_count.load(std::memory_order_acquire);
+}
+
+void ff::perf_trace::add_event(const ff::perf_counter& counter, int64_t start_ticks, int64_t end_ticks)
+{
+    ::thread_trace& trace = ::get_thread_trace();
+    const uint64_t count = trace.write_count.load(std::memory_order_relaxed);
+
+    // Pairs with the fence in copy_events, so a reader that sees these stores also sees the previous write_count
+    std::atomic_thread_fence(std::memory_order_release);
+
+    ::trace_event& event = trace.events[static_cast<size_t>(count % ::event_capacity)];
+    event.start.store(start_ticks, std::memory_order_relaxed);
+    event.end.store(end_ticks, std::memory_order_relaxed);
+    event.counter.store(&counter, std::memory_order_relaxed);
+
+    trace.write_count.store(count + 1, std::memory_order_release);
+}
+
+void ff::perf_trace::add_frame(int64_t start_ticks)
+{
+    // Only one thread should add frames
+    const uint64_t count = ::frame_write_count.load(std::memory_order_relaxed);
+    ::frame_ticks[static_cast<size_t>(count % ::frame_capacity)].store(start_ticks, std::memory_order_relaxed);
+    ::frame_write_count.store(count + 1, std::memory_order_release);
+}
+
+std::string ff::perf_trace::chrome_trace_json(size_t frame_count)
+{
+    std::scoped_lock lock(::thread_traces_mutex);
+    const int64_t start_ticks = ::window_start_ticks(frame_count);
+    const int64_t origin_ticks = start_ticks ? start_ticks : ::calibrate_ticks;
+    const double tick_scale = 1.0 / ::ticks_per_microsecond();
+    const DWORD process_id = ::GetCurrentProcessId();
+    bool first = true;
+
+    std::ostringstream output;
+    output.precision(3);
+    output << std::fixed << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    auto write_event_start = [&output, &first, process_id](std::string_view name, std::string_view phase, DWORD thread_id)
+        {
+            output << (first ? "\n" : ",\n") << "{\"name\":";
+            ::write_json_string(output, name);
+            output << ",\"ph\":\"" << phase << "\",\"pid\":" << process_id << ",\"tid\":" << thread_id;
+            first = false;
+        };
+
+    for (const std::unique_ptr<::thread_trace>& trace : ::thread_traces)
+    {
+        std::vector<::copied_event> events = ::copy_events(*trace, start_ticks);
+        if (events.empty())
+        {
+            continue;
+        }
+
+        write_event_start("thread_name", "M", trace->thread_id);
+        output << ",\"args\":{\"name\":";
+        ::write_json_string(output, ::thread_name(trace->thread_id));
+        output << "}}";
+
+        for (const ::copied_event& event : events)
+        {
+            write_event_start(event.counter->name, "X", trace->thread_id);
+            output << ",\"cat\":\"ff\",\"ts\":" << (event.start - origin_ticks) * tick_scale
+                << ",\"dur\":" << std::max<int64_t>(event.end - event.start, 0) * tick_scale << "}";
+        }
+    }
+
+    const uint64_t frame_end_count = ::frame_write_count.load(std::memory_order_acquire);
+    const uint64_t frame_start_count = frame_end_count - std::min<uint64_t>(frame_end_count - ::frame_cleared_count, ::frame_capacity);
+    for (uint64_t i = frame_start_count; i < frame_end_count; i++)
+    {
+        const int64_t ticks = ::frame_ticks[static_cast<size_t>(i % ::frame_capacity)].load(std::memory_order_relaxed);
+        if (ticks >= start_ticks)
+        {
+            write_event_start("Frame", "i", 0);
+            output << ",\"s\":\"g\",\"ts\":" << (ticks - origin_ticks) * tick_scale << "}";
+        }
+    }
+
+    output << "\n]}\n";
+    return output.str();
+}
+
+bool ff::perf_trace::write_chrome_trace(const std::filesystem::path& path, size_t frame_count)
+{
+    return ff::filesystem::write_text_file(path, ff::perf_trace::chrome_trace_json(frame_count));
+}
+
+#else
+
+void ff::perf_trace::enable(bool value) {}
+void ff::perf_trace::clear() {}
+void ff::perf_trace::add_event(const ff::perf_counter& counter, int64_t start_ticks, int64_t end_ticks) {}
+void ff::perf_trace::add_frame(int64_t start_ticks) {}
+std::string ff::perf_trace::chrome_trace_json(size_t frame_count) { return {}; }
+bool ff::perf_trace::write_chrome_trace(const std::filesystem::path& path, size_t frame_count) { return false; }
+
+#endif
@@ -0,0 +1,40 @@
+#pragma once
+
+namespace ff
+{
+    class perf_counter;
+}
+
+namespace ff::internal::perf_trace
+{
+    extern std::atomic_bool enabled;
+}
+
+/// <summary>
+/// Captures ff::perf_timer scopes from every thread, so they can be viewed as a Chrome or Perfetto trace
+/// </summary>
+/// <remarks>
+/// Each thread writes its events into its own ring buffer without locking, and the oldest events get
+/// overwritten when the ring is full. Nothing is captured until enable(true), and everything is a no-op
+/// when PROFILE_APP is zero.
+/// </remarks>
+namespace ff::perf_trace
+{
+    void enable(bool value);
+    void clear();
+    void add_event(const ff::perf_counter& counter, int64_t start_ticks, int64_t end_ticks);
+    void add_frame(int64_t start_ticks);
+
+    // A frame_count of zero writes everything that is still buffered
+    std::string chrome_trace_json(size_t frame_count = 0);
+    bool write_chrome_trace(const std::filesystem::path& path, size_t frame_count = 0);
+
+    inline bool enabled()
+    {
+#if PROFILE_APP
+        return ff::internal::perf_trace::enabled.load(std::memory_order_relaxed);
+#else
+        return false;
+#endif
+    }
+}
@@ -0,0 +1,279 @@
+#include "pch.h"
+#include "base/assert.h"
+#include "base/math.h"
+#include "types/tlsf_allocator.h"
+
+ff::tlsf_allocator::range_t::operator bool() const
+{
+    return this->size != 0;
+}
+
+double ff::tlsf_allocator::stats_t::fragmentation() const
+{
+    return this->free_size ? 1.0 - static_cast<double>(this->largest_free_size) / static_cast<double>(this->free_size) : 0.0;
+}
+
+ff::tlsf_allocator::tlsf_allocator(uint64_t size)
+    : size_(size)
+{
+    for (auto& heads : this->free_heads)
+    {
+        heads.fill(tlsf_allocator::invalid_index);
+    }
+
+    if (size)
+    {
+        this->insert_free(this->new_block(0, size));
+    }
+}
+
+ff::tlsf_allocator::range_t ff::tlsf_allocator::alloc(uint64_t size, uint64_t align)
+{
+    align = std::max<uint64_t>(align, 1);
+    assert_ret_val(ff::math::is_power_of_2(align), range_t{});
+    check_ret_val(size && size <= this->size_, range_t{});
+
+    // The first bucket that fits is usually aligned already, otherwise look for room to align within
+    uint32_t index = this->find_free(size);
+    if (index == tlsf_allocator::invalid_index || ff::math::align_up(this->blocks[index].start, align) + size > this->blocks[index].start + this->blocks[index].size)
+    {
+        index = this->find_free(size + align - 1);
+        check_ret_val(index != tlsf_allocator::invalid_index, range_t{});
+    }
+
+    this->remove_free(index);
+
+    const uint64_t allocated_start = this->blocks[index].start;
+    const uint64_t aligned_start = ff::math::align_up(allocated_start, align);
+    const uint64_t allocated_size = aligned_start - allocated_start + size;
+
+    if (this->blocks[index].size > allocated_size)
+    {
+        // Return the end of the block, new_block may move this->blocks
+        const uint32_t split_index = this->new_block(allocated_start + allocated_size, this->blocks[index].size - allocated_size);
+        block_t& block = this->blocks[index];
+        block_t& split = this->blocks[split_index];
+
+        split.prev_physical = index;
+        split.next_physical = block.next_physical;
+
+        if (block.next_physical != tlsf_allocator::invalid_index)
+        {
+            this->blocks[block.next_physical].prev_physical = split_index;
+        }
+
+        block.next_physical = split_index;
+        block.size = allocated_size;
+        this->insert_free(split_index);
+    }
+
+    this->blocks[index].free = false;
+    this->allocated_blocks.try_emplace(allocated_start, index);
+
+    return range_t{ aligned_start, size, allocated_start, allocated_size };
+}
+
+void ff::tlsf_allocator::free(uint64_t allocated_start)
+{
+    auto iter = this->allocated_blocks.find(allocated_start);
+    assert_msg_ret(iter != this->allocated_blocks.end(), "Freeing unknown TLSF allocation");
+
+    uint32_t index = iter->second;
+    this->allocated_blocks.erase(iter);
+    this->blocks[index].free = true;
+
+    const uint32_t next_index = this->blocks[index].next_physical;
+    if (next_index != tlsf_allocator::invalid_index && this->blocks[next_index].free)
+    {
+        block_t& block = this->blocks[index];
+        const block_t& next = this->blocks[next_index];
+
+        this->remove_free(next_index);
+        block.size += next.size;
+        block.next_physical = next.next_physical;
+
+        if (block.next_physical != tlsf_allocator::invalid_index)
+        {
+            this->blocks[block.next_physical].prev_physical = index;
+        }
+
+        this->delete_block(next_index);
+    }
+
+    const uint32_t prev_index = this->blocks[index].prev_physical;
+    if (prev_index != tlsf_allocator::invalid_index && this->blocks[prev_index].free)
+    {
+        block_t& prev = this->blocks[prev_index];
+        const block_t& block = this->blocks[index];
+
+        this->remove_free(prev_index);
+        prev.size += block.size;
+        prev.next_physical = block.next_physical;
+
+        if (prev.next_physical != tlsf_allocator::invalid_index)
+        {
+            this->blocks[prev.next_physical].prev_physical = prev_index;
+        }
+
+        this->delete_block(index);
+        index = prev_index;
+    }
+
+    this->insert_free(index);
+}
+
+uint64_t ff::tlsf_allocator::size() const
+{
+    return this->size_;
+}
+
+bool ff::tlsf_allocator::empty() const
+{
+    return this->allocated_blocks.empty();
+}
+
+ff::tlsf_allocator::stats_t ff::tlsf_allocator::stats() const
+{
+    stats_t stats{ this->size_, this->free_size, 0, this->free_block_count, this->allocated_blocks.size() };
+
+    if (this->fl_bitmap)
+    {
+        // The largest block is somewhere in the highest bucket
+        const size_t fl = 63 - std::countl_zero(this->fl_bitmap);
+        const size_t sl = 31 - std::countl_zero(this->sl_bitmaps[fl]);
+
+        for (uint32_t i = this->free_heads[fl][sl]; i != tlsf_allocator::invalid_index; i = this->blocks[i].next_free)
+        {
+            stats.largest_free_size = std::max(stats.largest_free_size, this->blocks[i].size);
+        }
+    }
+
+    return stats;
+}
+
+bool ff::tlsf_allocator::mapping(uint64_t size, size_t& fl, size_t& sl)
+{
+    if (size < tlsf_allocator::sl_count)
+    {
+        // Small sizes get one exact bucket each
+        fl = 0;
+        sl = static_cast<size_t>(size);
+    }
+    else
+    {
+        const size_t msb = 63 - std::countl_zero(size);
+        fl = msb - tlsf_allocator::sl_bits + 1;
+        sl = static_cast<size_t>(size >> (msb - tlsf_allocator::sl_bits)) - tlsf_allocator::sl_count;
+    }
+
+    return fl < tlsf_allocator::fl_count;
+}
+
+uint32_t ff::tlsf_allocator::find_free(uint64_t size) const
+{
+    if (size >= tlsf_allocator::sl_count)
+    {
+        // Round up to the next bucket so that any block found is big enough
+        const size_t msb = 63 - std::countl_zero(size);
+        const uint64_t round = (uint64_t(1) << (msb - tlsf_allocator::sl_bits)) - 1;
+        check_ret_val(size + round > size, tlsf_allocator::invalid_index);
+        size += round;
+    }
+
+    size_t fl, sl;
+    check_ret_val(tlsf_allocator::mapping(size, fl, sl), tlsf_allocator::invalid_index);
+
+    uint32_t sl_map = this->sl_bitmaps[fl] & (0xFFFFFFFF << sl);
+    if (!sl_map)
+    {
+        const uint64_t fl_map = this->fl_bitmap & (~uint64_t(0) << (fl + 1));
+        check_ret_val(fl_map, tlsf_allocator::invalid_index);
+
+        fl = std::countr_zero(fl_map);
+        sl_map = this->sl_bitmaps[fl];
+    }
+
+    sl = std::countr_zero(sl_map);
+    return this->free_heads[fl][sl];
+}
+
+void ff::tlsf_allocator::insert_free(uint32_t index)
+{
+    block_t& block = this->blocks[index];
+    size_t fl, sl;
+    verify(tlsf_allocator::mapping(block.size, fl, sl));
+
+    uint32_t& head = this->free_heads[fl][sl];
+    block.free = true;
+    block.prev_free = tlsf_allocator::invalid_index;
+    block.next_free = head;
+
+    if (head != tlsf_allocator::invalid_index)
+    {
+        this->blocks[head].prev_free = index;
+    }
+
+    head = index;
+    this->sl_bitmaps[fl] |= 1u << sl;
+    this->fl_bitmap |= uint64_t(1) << fl;
+    this->free_size += block.size;
+    this->free_block_count++;
+}
+
+void ff::tlsf_allocator::remove_free(uint32_t index)
+{
+    block_t& block = this->blocks[index];
+    size_t fl, sl;
+    verify(tlsf_allocator::mapping(block.size, fl, sl));
+
+    if (block.prev_free != tlsf_allocator::invalid_index)
+    {
+        this->blocks[block.prev_free].next_free = block.next_free;
+    }
+    else
+    {
+        assert(this->free_heads[fl][sl] == index);
+        this->free_heads[fl][sl] = block.next_free;
+
+        if (block.next_free == tlsf_allocator::invalid_index)
+        {
+            this->sl_bitmaps[fl] &= ~(1u << sl);
+
+            if (!this->sl_bitmaps[fl])
+            {
+                this->fl_bitmap &= ~(uint64_t(1) << fl);
+            }
+        }
+    }
+
+    if (block.next_free != tlsf_allocator::invalid_index)
+    {
+        this->blocks[block.next_free].prev_free = block.prev_free;
+    }
+
+    block.prev_free = tlsf_allocator::invalid_index;
+    block.next_free = tlsf_allocator::invalid_index;
+    this->free_size -= block.size;
+    this->free_block_count--;
+}
+
+uint32_t ff::tlsf_allocator::new_block(uint64_t start, uint64_t size)
+{
+    const block_t block{ start, size, tlsf_allocator::invalid_index, tlsf_allocator::invalid_index, tlsf_allocator::invalid_index, tlsf_allocator::invalid_index, false };
+
+    if (!this->unused_blocks.empty())
+    {
+        const uint32_t index = this->unused_blocks.back();
+        this->unused_blocks.pop_back();
+        this->blocks[index] = block;
+        return index;
+    }
+
+    this->blocks.push_back(block);
+    return static_cast<uint32_t>(this->blocks.size() - 1);
+}
+
+void ff::tlsf_allocator::delete_block(uint32_t index)
+{
+    this->unused_blocks.push_back(index);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+namespace ff
+{
+    /// <summary>
+    /// Two-level segregated fit allocator for ranges of offsets, it doesn't own or touch any memory
+    /// </summary>
+    /// <remarks>
+    /// Alloc and free are O(1). Free blocks are kept in lists bucketed by the high bits of their size, and
+    /// two levels of bitmaps find the smallest non-empty bucket that's big enough. Adjacent free blocks always merge.
+    /// This class is not thread safe, callers must lock.
+    /// </remarks>
+    class tlsf_allocator
+    {
+    public:
+        struct range_t
+        {
+            operator bool() const;
+
+            uint64_t start; // aligned
+            uint64_t size;
+            uint64_t allocated_start; // pass this to free()
+            uint64_t allocated_size;
+        };
+
+        struct stats_t
+        {
+            double fragmentation() const; // 0 when all free space is in one block, approaches 1 as it gets split up
+
+            uint64_t size;
+            uint64_t free_size;
+            uint64_t largest_free_size;
+            size_t free_block_count;
+            size_t allocation_count;
+        };
+
+        tlsf_allocator(uint64_t size);
+        tlsf_allocator(tlsf_allocator&& other) noexcept = default;
+        tlsf_allocator(const tlsf_allocator& other) = delete;
+
+        tlsf_allocator& operator=(tlsf_allocator&& other) noexcept = default;
+        tlsf_allocator& operator=(const tlsf_allocator& other) = delete;
+
+        range_t alloc(uint64_t size, uint64_t align = 1);
+        void free(uint64_t allocated_start);
+        uint64_t size() const;
+        bool empty() const; // nothing allocated
+        stats_t stats() const;
+
+    private:
+        static constexpr size_t sl_bits = 4;
+        static constexpr size_t sl_count = 1 << sl_bits;
+        static constexpr size_t fl_count = 64 - sl_bits + 1;
+        static constexpr uint32_t invalid_index = 0xFFFFFFFF;
+
+        struct block_t
+        {
+            uint64_t start;
+            uint64_t size;
+            uint32_t prev_physical;
+            uint32_t next_physical;
+            uint32_t prev_free;
+            uint32_t next_free;
+            bool free;
+        };
+
+        static bool mapping(uint64_t size, size_t& fl, size_t& sl);
+        uint32_t find_free(uint64_t size) const;
+        void insert_free(uint32_t index);
+        void remove_free(uint32_t index);
+        uint32_t new_block(uint64_t start, uint64_t size);
+        void delete_block(uint32_t index);
+
+        std::vector<block_t> blocks;
+        std::vector<uint32_t> unused_blocks;
+        std::unordered_map<uint64_t, uint32_t> allocated_blocks;
+        std::array<std::array<uint32_t, sl_count>, fl_count> free_heads;
+        std::array<uint32_t, fl_count> sl_bitmaps{};
+        uint64_t fl_bitmap{};
+        uint64_t size_;
+        uint64_t free_size{};
+        size_t free_block_count{};
+    };
+}
@@ -13,6 +13,7 @@ constexpr int EXIT_CODE_SAVE_DICT_FAILED = 9;
 constexpr int EXIT_CODE_VISIT_DICT_FAILED = 10;
 constexpr std::string_view PROGRAM_NAME = "ff.resource.build";
 constexpr std::string_view ASSETS_COMBINED_NAMESPACE = "assets_combined";
+constexpr uint64_t TEXTURE_CACHE_MAX_BYTES = 1024ull * 1024 * 1024;
 
 static int show_usage()
 {
@@ -341,6 +342,24 @@ static bool load_reference_files(const std::vector<std::filesystem::path>& refer
     return true;
 }
 
+// Stage times are summed over all threads, so they can add up to more than the wall clock time
+static void show_texture_stats()
+{
+    using stage_t = ff::internal::texture_processor::stage_t;
+    const ff::internal::texture_processor::stats_t stats = ff::internal::texture_processor::stats();
+    auto stage_seconds = [&stats](stage_t stage)
+    {
+        return stats.seconds[static_cast<size_t>(stage)];
+    };
+
+    std::cout << ::PROGRAM_NAME << ": Texture time: " << std::fixed << std::setprecision(3)
+        << "decode " << stage_seconds(stage_t::decode) << "s, "
+        << "mips " << stage_seconds(stage_t::mips) << "s, "
+        << "convert " << stage_seconds(stage_t::convert) << "s, "
+        << "cache " << stage_seconds(stage_t::cache) << "s ("
+        << stats.cache_hit_count << " hits, " << stats.cache_miss_count << " misses)\n";
+}
+
 static ff::init_dx_params get_dx_params()
 {
     ff::init_dx_params params;
@@ -381,12 +400,25 @@ static int do_compile(
         return ::EXIT_CODE_BAD_REFERENCE;
     }
 
+    // Processed textures are only cached while building, and the cache is trimmed afterwards since nothing else cleans it up
+    ff::internal::texture_processor::cache_enabled(true);
+    auto trim_texture_cache = ff::scope_exit([]()
+    {
+        ff::internal::texture_processor::cache_enabled(false);
+        ff::internal::texture_processor::cache_trim(::TEXTURE_CACHE_MAX_BYTES);
+    });
+
     if (!::compile_resource_pack(input_files, output_file, pdb_output, header_file, symbol_header_file, force, debug))
     {
         std::cerr << ::PROGRAM_NAME << ": Compile failed\n";
         return ::EXIT_CODE_COMPILE_FAILED;
     }
 
+    if (verbose)
+    {
+        ::show_texture_stats();
+    }
+
     return ::EXIT_CODE_SUCCESS;
 }
 
@@ -88,6 +88,80 @@ namespace ff::test::base
             Assert::AreEqual(10, i);
         }
 
+        TEST_METHOD(lean_task)
+        {
+            ff::co_lean_task<int> task = ff::test::base::co_task_tests::test_lean_return_int(10, 100);
+            Assert::IsTrue(task.wait(10000));
+            Assert::AreEqual(10, task.result());
+
+            ff::co_lean_task<int> chained = ff::test::base::co_task_tests::test_lean_add(ff::test::base::co_task_tests::test_lean_return_int(1, 100), 2);
+            Assert::IsTrue(chained.wait(10000));
+            Assert::AreEqual(3, chained.result());
+        }
+
+        TEST_METHOD(lean_task_timeout)
+        {
+            ff::co_lean_task<int> task = ff::test::base::co_task_tests::test_lean_return_int(10, 2000);
+            Assert::IsFalse(task.wait(100));
+            Assert::IsFalse(task.done());
+
+            // The timed out wait must not leave a waiter behind
+            Assert::IsTrue(task.wait(10000));
+            Assert::AreEqual(10, task.result());
+        }
+
+        TEST_METHOD(lean_task_exception)
+        {
+            ff::co_lean_task<> task = ff::test::base::co_task_tests::test_lean_throw();
+
+            Assert::ExpectException<std::runtime_error>([&task]()
+            {
+                task.wait(10000);
+            });
+        }
+
+        TEST_METHOD(lean_task_when_all_any)
+        {
+            std::vector<ff::co_lean_task<int>> tasks;
+            tasks.push_back(ff::test::base::co_task_tests::test_lean_return_int(1, 1000));
+            tasks.push_back(ff::test::base::co_task_tests::test_lean_return_int(2, 100));
+            tasks.push_back(ff::test::base::co_task_tests::test_lean_return_int(3, 500));
+
+            ff::co_lean_task<size_t> any = ff::task::when_any(tasks);
+            Assert::IsTrue(any.wait(10000));
+            Assert::AreEqual<size_t>(1, any.result());
+
+            // The other tasks can still be awaited after when_any
+            ff::co_lean_task<std::vector<int>> all = ff::task::when_all(std::move(tasks));
+            Assert::IsTrue(all.wait(10000));
+            Assert::IsTrue(all.result() == std::vector<int>{ 1, 2, 3 });
+
+            std::vector<ff::co_lean_task<int>> no_tasks;
+            ff::co_lean_task<size_t> none = ff::task::when_any(no_tasks);
+            Assert::IsTrue(none.done());
+            Assert::AreEqual(ff::constants::invalid_unsigned<size_t>(), none.result());
+        }
+
+        TEST_METHOD(perf_lean_task)
+        {
+            const int count = 1000000;
+            ff::timer timer;
+
+            ff::co_task<int> task = ff::test::base::co_task_tests::test_sum_tasks(count);
+            Assert::IsTrue(task.wait(60000));
+            Assert::AreEqual(count, task.result());
+            double task_seconds = timer.tick();
+
+            ff::co_lean_task<int> lean_task = ff::test::base::co_task_tests::test_sum_lean_tasks(count);
+            Assert::IsTrue(lean_task.wait(60000));
+            Assert::AreEqual(count, lean_task.result());
+            double lean_task_seconds = timer.tick();
+
+            ff::log::write(ff::log::type::test, "Tasks: ", count,
+                ", co_task: ", count / task_seconds, "/s",
+                ", co_lean_task: ", count / lean_task_seconds, "/s");
+        }
+
     private:
         ff::co_task<> delay_for(size_t delay_ms, std::stop_token stop)
         {
@@ -151,5 +225,54 @@ namespace ff::test::base
             co_await ff::task::delay(100);
             co_return result;
         }
+
+        ff::co_lean_task<int> test_lean_return_int(int result, size_t delay_ms)
+        {
+            co_await ff::task::delay(delay_ms, {}, ff::thread_dispatch_type::task);
+            co_return result;
+        }
+
+        ff::co_lean_task<int> test_lean_add(ff::co_lean_task<int> task, int value)
+        {
+            co_return co_await task + value;
+        }
+
+        ff::co_lean_task<> test_lean_throw()
+        {
+            co_await ff::task::yield(ff::thread_dispatch_type::task);
+            throw std::runtime_error("test");
+        }
+
+        ff::co_task<int> test_one_task()
+        {
+            co_return 1;
+        }
+
+        ff::co_task<int> test_sum_tasks(int count)
+        {
+            int sum = 0;
+            for (int i = 0; i < count; i++)
+            {
+                sum += co_await ff::test::base::co_task_tests::test_one_task();
+            }
+
+            co_return sum;
+        }
+
+        ff::co_lean_task<int> test_one_lean_task()
+        {
+            co_return 1;
+        }
+
+        ff::co_lean_task<int> test_sum_lean_tasks(int count)
+        {
+            int sum = 0;
+            for (int i = 0; i < count; i++)
+            {
+                sum += co_await ff::test::base::co_task_tests::test_one_lean_task();
+            }
+
+            co_return sum;
+        }
     };
 }
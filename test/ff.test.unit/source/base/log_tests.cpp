@@ -0,0 +1,99 @@
+#include "pch.h"
+
+namespace ff::test::base
+{
+    TEST_CLASS(log_tests)
+    {
+    public:
+        TEST_METHOD(async_output)
+        {
+            constexpr size_t thread_count = 4;
+            constexpr size_t write_count = 250;
+            std::ostringstream output;
+
+            ff::log::file(&output);
+            ff::log::async(true);
+            {
+                std::vector<std::jthread> threads;
+                for (size_t i = 0; i < thread_count; i++)
+                {
+                    threads.emplace_back([i]()
+                        {
+                            for (size_t value = 0; value < write_count; value++)
+                            {
+                                ff::log::write(log_tests::log_type(), "Thread:", i, ", value:", value, ", ", &std::fixed, std::setprecision(2), 1.23456, ", ", std::string("text"));
+                            }
+                        });
+                }
+            }
+            ff::log::write(log_tests::log_type(), "Path:", std::filesystem::path("dir"));
+            ff::log::async(false);
+            ff::log::file(nullptr);
+
+            std::array<size_t, thread_count> next_values{};
+            std::istringstream input(output.str());
+            std::string line;
+            size_t line_count = 0;
+
+            while (std::getline(input, line))
+            {
+                if (line.find("[ff/test_log,") != 0)
+                {
+                    continue;
+                }
+
+                size_t thread, value;
+                size_t pos = line.find("Thread:");
+                line_count++;
+
+                if (pos != std::string::npos && ::sscanf_s(line.c_str() + pos, "Thread:%zu, value:%zu", &thread, &value) == 2)
+                {
+                    Assert::IsTrue(thread < thread_count);
+                    Assert::AreEqual(next_values[thread]++, value);
+                    Assert::IsTrue(line.find(", 1.23, text\r") != std::string::npos);
+                }
+                else
+                {
+                    Assert::IsTrue(line.find("Path:\"dir\"") != std::string::npos);
+                }
+            }
+
+            Assert::AreEqual<size_t>(thread_count * write_count + 1, line_count);
+        }
+
+        TEST_METHOD(perf_caller_latency)
+        {
+            constexpr size_t write_count = 2000;
+            std::ostringstream output;
+            ff::log::file(&output);
+
+            auto write_all = []()
+                {
+                    ff::timer timer;
+
+                    for (size_t i = 0; i < write_count; i++)
+                    {
+                        ff::log::write(log_tests::log_type(), "Fence:", &i, ", value:", i, ", waited ", &std::fixed, std::setprecision(2), i * 0.01, "ms");
+                    }
+
+                    return timer.tick() * 1000000000.0 / write_count;
+                };
+
+            double sync_ns = write_all();
+
+            ff::log::async(true);
+            double async_ns = write_all();
+            ff::log::async(false);
+            ff::log::file(nullptr);
+
+            ff::log::write(ff::log::type::test, "Log call latency, sync: ", &std::fixed, std::setprecision(1), sync_ns, "ns, async: ", async_ns, "ns");
+        }
+
+    private:
+        static ff::log::type log_type()
+        {
+            static ff::log::type type = ff::log::register_type("ff/test_log", true);
+            return type;
+        }
+    };
+}
@@ -61,5 +61,67 @@ namespace ff::test::base
                 }
             }
         }
+
+        TEST_METHOD(trace_threads)
+        {
+            ff::perf_measures measures;
+            ff::perf_counter c1(measures, "Trace \"1\"");
+            ff::perf_counter c2(measures, "Trace 2");
+            ff::perf_results results{};
+
+            ff::perf_trace::enable(true);
+            ff::perf_trace::clear();
+            measures.reset(1.0);
+
+            for (size_t frame = 0; frame < 4; frame++)
+            {
+                ff::perf_trace::add_frame(ff::perf_measures::now_ticks());
+                ff::perf_timer t1(c1);
+
+                std::vector<std::jthread> threads;
+                for (size_t i = 0; i < 4; i++)
+                {
+                    threads.emplace_back([&c2]()
+                        {
+                            ff::perf_timer t2(c2);
+                            std::this_thread::sleep_for(5ms);
+                        });
+                }
+            }
+
+            // Worker threads only trace, they don't touch the measures of this thread
+            measures.reset(2.0, &results, true);
+            ff::perf_trace::enable(false);
+
+            std::string json = ff::perf_trace::chrome_trace_json(2);
+            ff::dict dict;
+            Assert::IsTrue(ff::json_parse(json, dict));
+
+            if constexpr (ff::constants::profile_build)
+            {
+                Assert::AreEqual<size_t>(1, results.counter_infos.size());
+                Assert::AreEqual<size_t>(4, results.counter_infos[0].hit_last_frame);
+
+                std::vector<ff::value_ptr> events = dict.get<std::vector<ff::value_ptr>>("traceEvents");
+                size_t c1_count = 0, c2_count = 0, frame_count = 0;
+
+                for (const ff::value_ptr& event : events)
+                {
+                    const ff::dict& event_dict = event->get<ff::dict>();
+                    std::string name = event_dict.get<std::string>("name");
+                    c1_count += (name == c1.name);
+                    c2_count += (name == c2.name);
+                    frame_count += (name == "Frame");
+                }
+
+                Assert::AreEqual<size_t>(2, c1_count);
+                Assert::AreEqual<size_t>(8, c2_count);
+                Assert::AreEqual<size_t>(2, frame_count);
+            }
+            else
+            {
+                Assert::IsTrue(json.empty());
+            }
+        }
     };
 }
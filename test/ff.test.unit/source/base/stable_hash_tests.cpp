@@ -0,0 +1,106 @@
+﻿#include "pch.h"
+
+using namespace std::string_view_literals;
+
+namespace ff::test::base
+{
+    TEST_CLASS(stable_hash_tests)
+    {
+    public:
+        TEST_METHOD(persisted_values)
+        {
+            // These must never change, they are saved in files
+            static_assert(ff::stable_hash_func<ff::stable_hash_version::lookup3>("ff::dict@0"sv) == 0x87dfc076b3668a13);
+            static_assert(ff::stable_hash_func<ff::stable_hash_version::wyhash>("ff::dict@0"sv) == 0x4a4996e1ff1b696d);
+
+            Assert::AreEqual<size_t>(0x87dfc076b3668a13, ff::stable_hash_bytes("ff::dict@0", 10, ff::stable_hash_version::lookup3));
+            Assert::AreEqual<size_t>(0x4a4996e1ff1b696d, ff::stable_hash_bytes("ff::dict@0", 10, ff::stable_hash_version::wyhash));
+        }
+
+        TEST_METHOD(compile_time_matches_runtime)
+        {
+            constexpr std::string_view text = "The quick brown fox jumps over the lazy dog"sv;
+            constexpr std::wstring_view wide_text = L"The quick brown fox jumps over the lazy dog"sv;
+
+            std::string long_text;
+            for (size_t i = 0; i < 1000; i++)
+            {
+                long_text += static_cast<char>('a' + i % 26);
+            }
+
+            constexpr size_t text_hash = ff::stable_hash_func(text);
+            constexpr size_t wide_text_hash = ff::stable_hash_func(wide_text);
+            constexpr size_t text_lookup3_hash = ff::stable_hash_func<ff::stable_hash_version::lookup3>(text);
+
+            Assert::AreEqual(text_hash, ff::stable_hash_bytes(text.data(), text.size()));
+            Assert::AreEqual(wide_text_hash, ff::stable_hash_bytes(wide_text.data(), wide_text.size() * sizeof(wchar_t)));
+            Assert::AreEqual(text_lookup3_hash, ff::stable_hash_bytes(text.data(), text.size(), ff::stable_hash_version::lookup3));
+            Assert::AreEqual<size_t>(0xa9eda2ab6be2bd89, ff::stable_hash_func(long_text)); // same as the compile time value
+        }
+
+        TEST_METHOD(all_sizes_and_alignments)
+        {
+            std::mt19937 random(1);
+            std::vector<uint8_t> bytes(4096 + 8);
+            for (uint8_t& value : bytes)
+            {
+                value = static_cast<uint8_t>(random());
+            }
+
+            for (size_t size = 0; size < 4096; size = (size < 300) ? size + 1 : size * 3 / 2)
+            {
+                for (ff::stable_hash_version version : { ff::stable_hash_version::lookup3, ff::stable_hash_version::wyhash })
+                {
+                    size_t hash = ff::stable_hash_bytes(bytes.data(), size, version);
+                    std::vector<uint8_t> copy(bytes.data(), bytes.data() + size);
+
+                    for (size_t offset = 1; offset < 8; offset++)
+                    {
+                        std::vector<uint8_t> shifted(size + offset);
+                        std::memcpy(shifted.data() + offset, copy.data(), size);
+                        Assert::AreEqual(hash, ff::stable_hash_bytes(shifted.data() + offset, size, version));
+                    }
+
+                    if (size)
+                    {
+                        copy[size / 2] ^= 1;
+                        Assert::AreNotEqual(hash, ff::stable_hash_bytes(copy.data(), size, version));
+                    }
+                }
+            }
+        }
+
+        TEST_METHOD(perf_stable_hash)
+        {
+            const size_t max_size = 1024 * 1024;
+            std::vector<uint8_t> bytes(max_size + 8);
+            for (size_t i = 0; i < bytes.size(); i++)
+            {
+                bytes[i] = static_cast<uint8_t>(i * 31);
+            }
+
+            for (size_t size = 8; size <= max_size; size *= 2)
+            {
+                const size_t count = std::max<size_t>(64 * 1024 * 1024 / size, 16);
+                std::array<double, 2> bytes_per_second{};
+                size_t combined = 0;
+
+                for (size_t i = 0; i < bytes_per_second.size(); i++)
+                {
+                    ff::stable_hash_version version = i ? ff::stable_hash_version::wyhash : ff::stable_hash_version::lookup3;
+                    ff::timer timer;
+
+                    for (size_t j = 0; j < count; j++)
+                    {
+                        combined += ff::stable_hash_bytes(bytes.data() + (j & 7), size, version);
+                    }
+
+                    bytes_per_second[i] = count * size / timer.tick();
+                }
+
+                ff::log::write(ff::log::type::test, "Hash ", size, " bytes, lookup3: ", bytes_per_second[0] / (1024 * 1024),
+                    " MB/s, wyhash: ", bytes_per_second[1] / (1024 * 1024), " MB/s (", combined & 1, ")");
+            }
+        }
+    };
+}
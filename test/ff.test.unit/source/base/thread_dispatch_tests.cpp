@@ -39,5 +39,117 @@ namespace ff::test::base
                     Assert::AreEqual(20, i2);
                 });
         }
+
+        TEST_METHOD(fifo_order)
+        {
+            std::jthread([]()
+                {
+                    ff::thread_dispatch td(ff::thread_dispatch_type::task);
+                    constexpr size_t producer_count = 4;
+                    constexpr size_t post_count = 10000;
+                    std::array<size_t, producer_count> next_values{};
+                    size_t total = 0;
+                    bool in_order = true;
+
+                    {
+                        std::vector<std::jthread> producers;
+                        for (size_t i = 0; i < producer_count; i++)
+                        {
+                            producers.emplace_back([&td, &next_values, &total, &in_order, i]()
+                                {
+                                    for (size_t value = 0; value < post_count; value++)
+                                    {
+                                        td.post([&next_values, &total, &in_order, i, value]()
+                                            {
+                                                in_order = in_order && next_values[i]++ == value;
+                                                total++;
+                                            });
+                                    }
+                                });
+                        }
+                    }
+
+                    while (total < producer_count * post_count)
+                    {
+                        Assert::IsTrue(td.wait_for_dispatch(4000));
+                    }
+
+                    Assert::IsTrue(in_order);
+                });
+        }
+
+        TEST_METHOD(bounded_post)
+        {
+            std::jthread([]()
+                {
+                    constexpr size_t max_pending = 16;
+                    constexpr size_t post_count = 1000;
+                    ff::thread_dispatch td(ff::thread_dispatch_type::task, max_pending);
+                    std::atomic_size_t posted = 0;
+                    size_t total = 0;
+
+                    std::jthread producer([&td, &posted, &total]()
+                        {
+                            for (size_t i = 0; i < post_count; i++)
+                            {
+                                td.post([&total]()
+                                    {
+                                        total++;
+                                    });
+
+                                posted++;
+                            }
+                        });
+
+                    // The producer must wait for this thread to flush
+                    ::Sleep(250);
+                    Assert::IsTrue(posted <= max_pending);
+
+                    while (total < post_count)
+                    {
+                        Assert::IsTrue(td.wait_for_dispatch(4000));
+                    }
+
+                    Assert::AreEqual(post_count, posted.load());
+                });
+        }
+
+        TEST_METHOD(perf_post_throughput)
+        {
+            std::jthread([]()
+                {
+                    ff::thread_dispatch td(ff::thread_dispatch_type::task);
+                    constexpr size_t producer_count = 4;
+                    constexpr size_t post_count = 250000;
+                    size_t total = 0;
+                    ff::timer timer;
+
+                    std::vector<std::jthread> producers;
+                    for (size_t i = 0; i < producer_count; i++)
+                    {
+                        producers.emplace_back([&td, &total]()
+                            {
+                                for (size_t value = 0; value < post_count; value++)
+                                {
+                                    td.post([&total]()
+                                        {
+                                            total++;
+                                        });
+                                }
+                            });
+                    }
+
+                    while (total < producer_count * post_count)
+                    {
+                        Assert::IsTrue(td.wait_for_dispatch(4000));
+                    }
+
+                    double seconds = timer.tick();
+                    producers.clear();
+
+                    ff::log::write(ff::log::type::test, "Posts: ", producer_count * post_count,
+                        " from ", producer_count, " threads, ", producer_count * post_count / seconds, "/s");
+                });
+        }
     };
 }
@@ -152,5 +152,224 @@ namespace ff::test::base
             bool success = wait_done.wait(2000);
             Assert::IsTrue(success);
         }
+
+        TEST_METHOD(parallel_for)
+        {
+            std::vector<std::atomic_int> hits(100000);
+
+            ff::thread_pool::parallel_for(0, hits.size(), [&hits](size_t begin, size_t end)
+                {
+                    for (size_t i = begin; i < end; i++)
+                    {
+                        hits[i].fetch_add(1);
+                    }
+                });
+
+            for (const std::atomic_int& hit : hits)
+            {
+                Assert::AreEqual(1, hit.load());
+            }
+        }
+
+        TEST_METHOD(parallel_for_nested)
+        {
+            std::atomic_size_t count = 0;
+
+            ff::thread_pool::parallel_for(0, 64, [&count](size_t begin, size_t end)
+                {
+                    for (size_t i = begin; i < end; i++)
+                    {
+                        ff::thread_pool::parallel_for(0, 1000, [&count](size_t begin, size_t end)
+                            {
+                                count.fetch_add(end - begin);
+                            }, 10);
+                    }
+                }, 1);
+
+            Assert::AreEqual<size_t>(64000, count.load());
+        }
+
+        TEST_METHOD(parallel_reduce)
+        {
+            const size_t count = 1000000;
+
+            size_t sum = ff::thread_pool::parallel_reduce<size_t>(0, count, 0,
+                [](size_t begin, size_t end)
+                {
+                    size_t sum = 0;
+                    for (size_t i = begin; i < end; i++)
+                    {
+                        sum += i;
+                    }
+
+                    return sum;
+                },
+                [](size_t a, size_t b)
+                {
+                    return a + b;
+                });
+
+            Assert::AreEqual(count * (count - 1) / 2, sum);
+        }
+
+        TEST_METHOD(priorities)
+        {
+            const size_t thread_count = ff::thread_pool::thread_count();
+            Assert::IsTrue(thread_count > 0);
+
+            const size_t count = 100;
+            std::mutex order_mutex;
+            std::vector<ff::thread_pool::task_priority> order;
+            ff::win_event done_event;
+
+            // Block every worker, then free just one so that queued tasks run one at a time in priority order
+            std::atomic_size_t blocked = 0;
+            std::atomic_int keep_blocked = static_cast<int>(thread_count) - 1;
+            ff::win_event all_blocked_event;
+            ff::win_event release_event;
+            ff::win_event finish_event;
+
+            auto release_workers = ff::scope_exit([&release_event, &finish_event]()
+                {
+                    release_event.set();
+                    finish_event.set();
+                });
+
+            for (size_t i = 0; i < thread_count; i++)
+            {
+                ff::thread_pool::add_task([&blocked, &keep_blocked, &all_blocked_event, &release_event, &finish_event, thread_count]()
+                    {
+                        if (blocked.fetch_add(1) + 1 == thread_count)
+                        {
+                            all_blocked_event.set();
+                        }
+
+                        release_event.wait(INFINITE, false);
+
+                        if (keep_blocked.fetch_sub(1) > 0)
+                        {
+                            finish_event.wait(INFINITE, false);
+                        }
+                    });
+            }
+
+            Assert::IsTrue(all_blocked_event.wait(4000));
+
+            // Queued in reverse priority order while nothing can run
+            for (size_t i = static_cast<size_t>(ff::thread_pool::task_priority::count); i-- > 0; )
+            {
+                const ff::thread_pool::task_priority priority = static_cast<ff::thread_pool::task_priority>(i);
+                for (size_t h = 0; h < count; h++)
+                {
+                    ff::thread_pool::add_task([&order_mutex, &order, &done_event, priority, count]()
+                        {
+                            std::scoped_lock lock(order_mutex);
+                            order.push_back(priority);
+
+                            if (order.size() == count * static_cast<size_t>(ff::thread_pool::task_priority::count))
+                            {
+                                done_event.set();
+                            }
+                        }, priority);
+                }
+            }
+
+            release_event.set();
+            Assert::IsTrue(done_event.wait(4000));
+
+            std::scoped_lock lock(order_mutex);
+            for (size_t i = 0; i < order.size(); i++)
+            {
+                Assert::IsTrue(order[i] == static_cast<ff::thread_pool::task_priority>(i / count));
+            }
+        }
+
+        TEST_METHOD(work_stealing_deque)
+        {
+            ff::internal::work_stealing_deque<size_t*> deque(16);
+            std::vector<size_t> values(100000, 1);
+            std::atomic_size_t stolen = 0;
+            std::atomic_bool done = false;
+            size_t popped = 0;
+
+            std::vector<std::jthread> thieves;
+            for (size_t i = 0; i < 3; i++)
+            {
+                thieves.emplace_back([&deque, &stolen, &done]()
+                    {
+                        while (!done || !deque.empty())
+                        {
+                            size_t* value = deque.steal();
+                            if (value)
+                            {
+                                stolen.fetch_add(*value);
+                            }
+                        }
+                    });
+            }
+
+            for (size_t i = 0; i < values.size(); i++)
+            {
+                deque.push(&values[i]);
+
+                if (i % 3 == 0)
+                {
+                    size_t* value = deque.pop();
+                    popped += value ? *value : 0;
+                }
+            }
+
+            for (size_t* value = deque.pop(); value; value = deque.pop())
+            {
+                popped += *value;
+            }
+
+            done = true;
+            thieves.clear();
+
+            Assert::AreEqual(values.size(), popped + stolen.load());
+        }
+
+        TEST_METHOD(perf_add_task)
+        {
+            const size_t count = 100000;
+            std::atomic_size_t done = 0;
+            ff::win_event done_event;
+            auto func = [&done, &done_event, count]()
+            {
+                if (done.fetch_add(1) + 1 == count)
+                {
+                    done_event.set();
+                }
+            };
+
+            // The old path: heap allocated function submitted to the Win32 thread pool
+            ff::timer timer;
+            for (size_t i = 0; i < count; i++)
+            {
+                ::TrySubmitThreadpoolCallback([](PTP_CALLBACK_INSTANCE, void* context)
+                    {
+                        std::unique_ptr<std::function<void()>> func(reinterpret_cast<std::function<void()>*>(context));
+                        (*func)();
+                    }, new std::function<void()>(func), nullptr);
+            }
+
+            Assert::IsTrue(done_event.wait(10000));
+            double win32_seconds = timer.tick();
+
+            done = 0;
+            done_event.reset();
+            timer.tick();
+
+            for (size_t i = 0; i < count; i++)
+            {
+                ff::thread_pool::add_task(std::function<void()>(func));
+            }
+
+            Assert::IsTrue(done_event.wait(10000));
+            double scheduler_seconds = timer.tick();
+
+            ff::log::write(ff::log::type::test, "Tasks: ", count, ", Win32 pool: ", win32_seconds, "s, ff::thread_pool: ", scheduler_seconds, "s, Threads: ", ff::thread_pool::thread_count());
+        }
     };
 }
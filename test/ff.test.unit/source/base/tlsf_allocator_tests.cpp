@@ -0,0 +1,220 @@
+#include "pch.h"
+
+namespace
+{
+    // The sorted first-fit free list that ff::dx12::mem_buffer_free_list used before TLSF
+    class first_fit_allocator
+    {
+    public:
+        first_fit_allocator(uint64_t size)
+            : free_ranges{ range_t{ 0, size } }
+        {}
+
+        ff::tlsf_allocator::range_t alloc(uint64_t size, uint64_t align)
+        {
+            for (auto i = this->free_ranges.begin(); i != this->free_ranges.end(); i++)
+            {
+                uint64_t aligned_start = ff::math::align_up(i->start, align);
+                uint64_t allocated_size = size + aligned_start - i->start;
+
+                if (i->size >= allocated_size)
+                {
+                    ff::tlsf_allocator::range_t range{ aligned_start, size, i->start, allocated_size };
+                    i->start += allocated_size;
+                    i->size -= allocated_size;
+
+                    if (!i->size)
+                    {
+                        this->free_ranges.erase(i);
+                    }
+
+                    return range;
+                }
+            }
+
+            return {};
+        }
+
+        void free(const ff::tlsf_allocator::range_t& range)
+        {
+            range_t range2{ range.allocated_start, range.allocated_size };
+            auto i = std::lower_bound(this->free_ranges.begin(), this->free_ranges.end(), range2,
+                [](const range_t& lhs, const range_t& rhs) { return lhs.start < rhs.start; });
+
+            if (i != this->free_ranges.begin() && std::prev(i)->start + std::prev(i)->size == range2.start)
+            {
+                auto prev = std::prev(i);
+                prev->size += range2.size;
+
+                if (i != this->free_ranges.end() && i->start == prev->start + prev->size)
+                {
+                    prev->size += i->size;
+                    this->free_ranges.erase(i);
+                }
+            }
+            else if (i != this->free_ranges.end() && i->start == range2.start + range2.size)
+            {
+                i->start = range2.start;
+                i->size += range2.size;
+            }
+            else
+            {
+                this->free_ranges.insert(i, range2);
+            }
+        }
+
+    private:
+        struct range_t
+        {
+            uint64_t start;
+            uint64_t size;
+        };
+
+        std::vector<range_t> free_ranges;
+    };
+}
+
+namespace ff::test::base
+{
+    TEST_CLASS(tlsf_allocator_tests)
+    {
+    public:
+        TEST_METHOD(alloc_free)
+        {
+            ff::tlsf_allocator allocator(1024 * 1024);
+            Assert::IsTrue(allocator.empty());
+
+            ff::tlsf_allocator::range_t range1 = allocator.alloc(1000);
+            Assert::IsTrue(range1);
+            Assert::AreEqual<uint64_t>(0, range1.start);
+            Assert::AreEqual<uint64_t>(1000, range1.allocated_size);
+
+            ff::tlsf_allocator::range_t range2 = allocator.alloc(64, 4096);
+            Assert::IsTrue(range2);
+            Assert::AreEqual<uint64_t>(4096, range2.start);
+            Assert::AreEqual<uint64_t>(1000, range2.allocated_start);
+            Assert::AreEqual<uint64_t>(4096 + 64 - 1000, range2.allocated_size);
+
+            ff::tlsf_allocator::range_t range3 = allocator.alloc(5000, 16);
+            Assert::IsTrue(range3);
+            Assert::AreEqual<uint64_t>(0, range3.start % 16);
+            Assert::IsTrue(range3.start >= range2.start + range2.size);
+
+            Assert::IsFalse(allocator.alloc(2 * 1024 * 1024));
+            Assert::IsFalse(allocator.alloc(0));
+
+            ff::tlsf_allocator::stats_t stats = allocator.stats();
+            Assert::AreEqual<size_t>(3, stats.allocation_count);
+            Assert::AreEqual<size_t>(1, stats.free_block_count);
+            Assert::AreEqual(stats.free_size, stats.largest_free_size);
+            Assert::AreEqual(0.0, stats.fragmentation());
+
+            allocator.free(range2.allocated_start);
+            stats = allocator.stats();
+            Assert::AreEqual<size_t>(2, stats.free_block_count);
+            Assert::IsTrue(stats.fragmentation() > 0.0);
+
+            // Fits in the hole left by range2
+            ff::tlsf_allocator::range_t range4 = allocator.alloc(256);
+            Assert::AreEqual<uint64_t>(1000, range4.start);
+            allocator.free(range4.allocated_start);
+
+            allocator.free(range1.allocated_start);
+            allocator.free(range3.allocated_start);
+            stats = allocator.stats();
+            Assert::IsTrue(allocator.empty());
+            Assert::AreEqual<size_t>(1, stats.free_block_count);
+            Assert::AreEqual<uint64_t>(1024 * 1024, stats.largest_free_size);
+        }
+
+        TEST_METHOD(stress)
+        {
+            constexpr uint64_t heap_size = 256 * 1024 * 1024;
+            constexpr size_t op_count = 200000;
+            constexpr size_t max_live = 4000;
+
+            struct op_t
+            {
+                uint64_t size;
+                uint64_t align;
+                size_t free_index; // which live allocation to free, or SIZE_MAX to allocate
+            };
+
+            // Mostly small buffers with some large textures, like a level full of long lived resources
+            std::mt19937 random(7);
+            std::vector<op_t> ops;
+            ops.reserve(op_count);
+            for (size_t i = 0, live = 0; i < op_count; i++)
+            {
+                if (live && (live >= max_live || random() % 2))
+                {
+                    ops.push_back(op_t{ 0, 0, random() % live-- });
+                }
+                else
+                {
+                    const bool texture = (random() % 8) == 0;
+                    const uint64_t size = texture ? (1 + random() % 16) * 65536 : 256 + random() % 16384;
+                    ops.push_back(op_t{ size, texture ? 65536u : 256u, SIZE_MAX });
+                    live++;
+                }
+            }
+
+            auto run = [&ops](auto& allocator, auto&& free_func)
+                {
+                    std::vector<ff::tlsf_allocator::range_t> live;
+                    live.reserve(max_live);
+                    size_t failed = 0;
+                    ff::timer timer;
+
+                    for (const op_t& op : ops)
+                    {
+                        if (op.free_index != SIZE_MAX)
+                        {
+                            if (op.free_index < live.size())
+                            {
+                                free_func(allocator, live[op.free_index]);
+                                live[op.free_index] = live.back();
+                                live.pop_back();
+                            }
+                        }
+                        else if (ff::tlsf_allocator::range_t range = allocator.alloc(op.size, op.align))
+                        {
+                            Assert::AreEqual<uint64_t>(0, range.start % op.align);
+                            live.push_back(range);
+                        }
+                        else
+                        {
+                            failed++;
+                        }
+                    }
+
+                    const double seconds = timer.tick();
+                    ff::tlsf_allocator::stats_t stats{};
+
+                    if constexpr (requires { allocator.stats(); })
+                    {
+                        stats = allocator.stats();
+                    }
+
+                    for (const ff::tlsf_allocator::range_t& range : live)
+                    {
+                        free_func(allocator, range);
+                    }
+
+                    return std::make_tuple(seconds, failed, stats);
+                };
+
+            ff::tlsf_allocator tlsf(heap_size);
+            auto [tlsf_seconds, tlsf_failed, stats] = run(tlsf, [](ff::tlsf_allocator& allocator, const ff::tlsf_allocator::range_t& range) { allocator.free(range.allocated_start); });
+            Assert::IsTrue(tlsf.empty());
+            Assert::AreEqual<size_t>(1, tlsf.stats().free_block_count);
+
+            ::first_fit_allocator first_fit(heap_size);
+            auto [first_fit_seconds, first_fit_failed, first_fit_stats] = run(first_fit, [](::first_fit_allocator& allocator, const ff::tlsf_allocator::range_t& range) { allocator.free(range); });
+
+            ff::log::write(ff::log::type::test, "TLSF stress, ", op_count, " ops, TLSF: ", &std::fixed, std::setprecision(2),
+                tlsf_seconds * 1000.0, "ms (", tlsf_failed, " failed, ", stats.free_block_count, " free blocks, ", stats.fragmentation() * 100.0,
+                "% fragmented), first fit: ", first_fit_seconds * 1000.0, "ms (", first_fit_failed, " failed)");
+        }
+    };
+}
@@ -43,5 +43,207 @@ namespace ff::test::data
                 Assert::IsTrue(!std::memcmp(com_spec_data->data(), uncompress_vector->data(), uncompress_vector->size()));
             }
         }
+
+        TEST_METHOD(compress_blocks)
+        {
+            // Compressible data that doesn't line up with the block size
+            std::vector<uint8_t> source(1000 * 1000 + 123);
+            for (size_t i = 0; i < source.size(); i++)
+            {
+                source[i] = static_cast<uint8_t>((i / 7) ^ (i % 13));
+            }
+
+            std::shared_ptr<ff::data_base> source_data = std::make_shared<ff::data_static>(source.data(), source.size());
+            auto compress_vector = std::make_shared<std::vector<uint8_t>>();
+            {
+                ff::data_reader reader(source_data);
+                ff::data_writer writer(compress_vector);
+                Assert::IsTrue(ff::compression::compress_blocks(reader, source.size(), writer, ff::compression::default_level, 64 * 1024));
+                Assert::AreEqual(source.size(), reader.pos());
+            }
+
+            auto saved_data = std::make_shared<ff::saved_data_static>(std::make_shared<ff::data_vector>(compress_vector), source.size(), ff::saved_data_type::zlib_blocks);
+            std::shared_ptr<ff::data_base> loaded_data = saved_data->loaded_data();
+            Assert::IsNotNull(loaded_data.get());
+            Assert::AreEqual(source.size(), loaded_data->size());
+            Assert::IsTrue(!std::memcmp(source.data(), loaded_data->data(), source.size()));
+
+            const std::array<std::pair<size_t, size_t>, 6> ranges =
+            {
+                std::make_pair<size_t, size_t>(0, 0),
+                std::make_pair<size_t, size_t>(0, 10),
+                std::make_pair<size_t, size_t>(64 * 1024 - 5, 10),
+                std::make_pair<size_t, size_t>(64 * 1024, 64 * 1024),
+                std::make_pair<size_t, size_t>(100000, 300000),
+                std::make_pair<size_t, size_t>(source.size() - 50, 50),
+            };
+
+            // Ranges come from the cached data when it's there, otherwise only their blocks get uncompressed
+            for (bool cached : { false, true })
+            {
+                if (cached)
+                {
+                    saved_data->loaded_data();
+                }
+                else
+                {
+                    ff::saved_data_cache::clear();
+                }
+
+                for (auto [offset, size] : ranges)
+                {
+                    std::shared_ptr<ff::data_base> range_data = saved_data->loaded_data(offset, size);
+                    Assert::IsNotNull(range_data.get());
+                    Assert::AreEqual(size, range_data->size());
+                    Assert::IsTrue(!size || !std::memcmp(source.data() + offset, range_data->data(), size));
+                }
+            }
+
+            // Values flagged for blocks compress when saved
+            ff::value_ptr data_value = ff::value::create<ff::data_base>(source_data, ff::saved_data_type::zlib_blocks);
+            ff::value_ptr saved_value = data_value->try_convert<ff::saved_data_base>();
+            Assert::IsTrue(saved_value->get<ff::saved_data_base>()->saved_size() < source.size());
+            Assert::IsTrue(ff::flags::has(saved_value->get<ff::saved_data_base>()->type(), ff::saved_data_type::zlib_blocks));
+
+            std::shared_ptr<ff::data_base> round_trip_data = saved_value->try_convert<ff::data_base>()->get<ff::data_base>();
+            Assert::AreEqual(source.size(), round_trip_data->size());
+            Assert::IsTrue(!std::memcmp(source.data(), round_trip_data->data(), source.size()));
+        }
+
+        TEST_METHOD(saved_data_cache)
+        {
+            const size_t old_budget = ff::saved_data_cache::budget();
+            ff::saved_data_cache::clear();
+            ff::saved_data_cache::reset_stats();
+            ff::saved_data_cache::budget(2500 * 1000);
+
+            auto create_saved_data = [](size_t seed)
+                {
+                    auto source_data = std::make_shared<ff::data_vector>(std::make_shared<std::vector<uint8_t>>(1000 * 1000, static_cast<uint8_t>(seed)));
+                    ff::value_ptr data_value = ff::value::create<ff::data_base>(source_data, ff::saved_data_type::zlib_compressed);
+                    return data_value->try_convert<ff::saved_data_base>()->get<ff::saved_data_base>();
+                };
+
+            std::array<std::shared_ptr<ff::saved_data_base>, 3> saved_datas{ create_saved_data(1), create_saved_data(2), create_saved_data(3) };
+            std::shared_ptr<ff::data_base> data0 = saved_datas[0]->loaded_data();
+            Assert::AreEqual<size_t>(1000 * 1000, data0->size());
+            Assert::IsTrue(data0 == saved_datas[0]->loaded_data());
+
+            // Same contents in different memory
+            Assert::IsTrue(data0 == create_saved_data(1)->loaded_data());
+
+            ff::saved_data_cache::stats_t stats = ff::saved_data_cache::stats();
+            Assert::AreEqual<size_t>(1, stats.miss_count);
+            Assert::AreEqual<size_t>(2, stats.hit_count);
+            Assert::AreEqual<size_t>(1000 * 1000, stats.byte_size);
+
+            // Over budget, the oldest data is evicted but is still found while it's alive
+            saved_datas[1]->loaded_data();
+            saved_datas[2]->loaded_data();
+            stats = ff::saved_data_cache::stats();
+            Assert::AreEqual<size_t>(3, stats.miss_count);
+            Assert::AreEqual<size_t>(1, stats.eviction_count);
+            Assert::AreEqual<size_t>(2000 * 1000, stats.byte_size);
+            Assert::IsTrue(data0 == saved_datas[0]->loaded_data());
+
+            data0.reset();
+            ff::saved_data_cache::budget(0);
+            Assert::IsTrue(saved_datas[0]->loaded_data() != nullptr);
+            stats = ff::saved_data_cache::stats();
+            Assert::AreEqual<size_t>(4, stats.miss_count);
+            Assert::AreEqual<size_t>(0, stats.byte_size);
+
+            // Only one thread loads when many ask for the same data at once
+            ff::saved_data_cache::budget(old_budget);
+            ff::saved_data_cache::reset_stats();
+            std::atomic<size_t> load_count = 0;
+            {
+                std::vector<std::jthread> threads;
+                for (size_t i = 0; i < 8; i++)
+                {
+                    threads.emplace_back([&load_count]()
+                        {
+                            std::shared_ptr<ff::data_base> data = ff::saved_data_cache::get(12345, [&load_count]()
+                                {
+                                    load_count++;
+                                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                                    return std::make_shared<ff::data_vector>(std::make_shared<std::vector<uint8_t>>(16));
+                                });
+
+                            Assert::AreEqual<size_t>(16, data->size());
+                        });
+                }
+            }
+
+            stats = ff::saved_data_cache::stats();
+            Assert::AreEqual<size_t>(1, load_count);
+            Assert::AreEqual<size_t>(1, stats.miss_count);
+            Assert::AreEqual<size_t>(7, stats.hit_count + stats.wait_count);
+
+            // A load that throws doesn't leave the entry stuck loading
+            Assert::ExpectException<std::runtime_error>([]()
+                {
+                    ff::saved_data_cache::get(67890, []() -> std::shared_ptr<ff::data_base>
+                        {
+                            throw std::runtime_error("load failed");
+                        });
+                });
+
+            std::shared_ptr<ff::data_base> reloaded_data = ff::saved_data_cache::get(67890, []()
+                {
+                    return std::make_shared<ff::data_vector>(std::make_shared<std::vector<uint8_t>>(16));
+                });
+
+            Assert::AreEqual<size_t>(16, reloaded_data->size());
+
+            ff::saved_data_cache::clear();
+        }
+
+        TEST_METHOD(perf_compress_blocks)
+        {
+            std::vector<uint8_t> source(16 * 1024 * 1024);
+            std::mt19937 random(1);
+            for (size_t i = 0; i < source.size(); i++)
+            {
+                // Runs of random bytes, similar to uncompressed image data
+                source[i] = (i % 64 < 48) ? static_cast<uint8_t>(i / 64) : static_cast<uint8_t>(random());
+            }
+
+            auto source_data = std::make_shared<ff::data_static>(source.data(), source.size());
+            auto stream_vector = std::make_shared<std::vector<uint8_t>>();
+            auto blocks_vector = std::make_shared<std::vector<uint8_t>>();
+
+            ff::timer timer;
+            {
+                ff::data_reader reader(source_data);
+                ff::data_writer writer(stream_vector);
+                Assert::IsTrue(ff::compression::compress(reader, source.size(), writer));
+            }
+
+            double stream_compress_seconds = timer.tick();
+            {
+                ff::data_reader reader(source_data);
+                ff::data_writer writer(blocks_vector);
+                Assert::IsTrue(ff::compression::compress_blocks(reader, source.size(), writer));
+            }
+
+            double blocks_compress_seconds = timer.tick();
+            auto stream_saved = std::make_shared<ff::saved_data_static>(std::make_shared<ff::data_vector>(stream_vector), source.size(), ff::saved_data_type::zlib_compressed);
+            Assert::AreEqual(source.size(), stream_saved->loaded_data()->size());
+
+            double stream_uncompress_seconds = timer.tick();
+            auto blocks_saved = std::make_shared<ff::saved_data_static>(std::make_shared<ff::data_vector>(blocks_vector), source.size(), ff::saved_data_type::zlib_blocks);
+            Assert::AreEqual(source.size(), blocks_saved->loaded_data()->size());
+
+            double blocks_uncompress_seconds = timer.tick();
+            ff::saved_data_cache::clear(); // so the range is uncompressed instead of cached
+            timer.tick();
+            Assert::AreEqual<size_t>(4096, blocks_saved->loaded_data(source.size() / 2, 4096)->size());
+            double blocks_range_seconds = timer.tick();
+
+            ff::log::write(ff::log::type::test, "Size: ", source.size(),
+                ", Stream: ", stream_vector->size(), " bytes, compress ", stream_compress_seconds, "s, uncompress ", stream_uncompress_seconds, "s",
+                ", Blocks: ", blocks_vector->size(), " bytes, compress ", blocks_compress_seconds, "s, uncompress ", blocks_uncompress_seconds, "s, 4K range ", blocks_range_seconds, "s");
+        }
     };
 }
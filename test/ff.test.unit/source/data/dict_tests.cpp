@@ -32,5 +32,277 @@ namespace ff::test::data
             Assert::AreEqual<size_t>(1, dict1.size());
             Assert::IsTrue(dict1 == dict2);
         }
+
+        TEST_METHOD(flat_save_load)
+        {
+            ff::dict dict;
+            dict.set<int>("int"sv, 12);
+            dict.set<bool>("bool"sv, true);
+            dict.set<std::string>("string"sv, "Hello, world!");
+            dict.set<ff::point_float>("point"sv, ff::point_float(1.5f, 2.5f));
+
+            ff::dict child;
+            child.set<double>("double"sv, 3.25);
+            dict.set<ff::dict>("child"sv, std::move(child));
+
+            auto bytes = std::make_shared<std::vector<uint8_t>>();
+            ff::data_writer writer(bytes);
+            Assert::IsTrue(dict.save(writer));
+
+            ff::dict loaded_dict;
+            ff::data_reader reader(std::make_shared<ff::data_vector>(bytes));
+            Assert::IsTrue(ff::dict::load(reader, loaded_dict));
+            Assert::AreEqual(bytes->size(), reader.pos());
+            Assert::AreEqual(dict.size(), loaded_dict.size());
+            Assert::AreEqual(12, loaded_dict.get<int>("int"sv));
+            Assert::IsTrue(loaded_dict.get<bool>("bool"sv));
+            Assert::AreEqual(std::string("Hello, world!"), loaded_dict.get<std::string>("string"sv));
+            Assert::IsTrue(ff::point_float(1.5f, 2.5f) == loaded_dict.get<ff::point_float>("point"sv));
+            Assert::AreEqual(3.25, loaded_dict.get<ff::dict>("child"sv).get<double>("double"sv));
+        }
+
+        TEST_METHOD(flat_read_bad_size)
+        {
+            ff::dict dict;
+            dict.set<std::string>("string"sv, "Hello, world!");
+
+            auto bytes = std::make_shared<std::vector<uint8_t>>();
+            ff::data_writer writer(bytes);
+            Assert::IsTrue(dict.save(writer));
+
+            // Truncated stream
+            ff::data_reader truncated_reader(std::make_shared<ff::data_static>(bytes->data(), bytes->size() - 1));
+            Assert::IsTrue(ff::flat_dict::read(truncated_reader) == nullptr);
+
+            // Size in the header is far bigger than the stream
+            const uint64_t huge_size = 1ull << 60;
+            std::memcpy(bytes->data() + 16, &huge_size, sizeof(huge_size)); // after the cookie, version and count
+            ff::data_reader huge_reader(std::make_shared<ff::data_vector>(bytes));
+            Assert::IsTrue(ff::flat_dict::read(huge_reader) == nullptr);
+        }
+
+        TEST_METHOD(flat_lazy_get)
+        {
+            ff::dict dict;
+            for (int i = 0; i < 256; i++)
+            {
+                dict.set<int>(std::to_string(i), i);
+                dict.set<std::string>("str" + std::to_string(i), std::string(i, 'x'));
+            }
+
+            auto bytes = std::make_shared<std::vector<uint8_t>>();
+            ff::data_writer writer(bytes);
+            Assert::IsTrue(dict.save(writer));
+
+            // Opened over static memory, values are only decoded on get
+            ff::flat_dict flat_dict(std::make_shared<ff::data_static>(bytes->data(), bytes->size()));
+            Assert::IsTrue(flat_dict.valid());
+            Assert::AreEqual<size_t>(dict.size(), flat_dict.size());
+            Assert::AreEqual(200, flat_dict.get<int>("200"sv));
+            Assert::AreEqual<size_t>(100, flat_dict.get<std::string>("str100"sv).size());
+            Assert::IsTrue(flat_dict.get("missing"sv) == nullptr);
+            Assert::IsTrue(flat_dict.get("200"sv) == flat_dict.get("200"sv));
+            Assert::IsTrue(flat_dict.to_dict() == dict);
+
+            for (std::string_view name : flat_dict.child_names())
+            {
+                Assert::IsTrue(flat_dict.get(name)->equals(dict.get(name)));
+            }
+        }
+
+        TEST_METHOD(legacy_load)
+        {
+            ff::dict dict;
+            dict.set<int>("int"sv, 12);
+            dict.set<std::string>("string"sv, "Hello!");
+
+            auto bytes = std::make_shared<std::vector<uint8_t>>();
+            ff::data_writer writer(bytes);
+            Assert::IsTrue(dict.save_legacy(writer));
+
+            ff::dict loaded_dict;
+            ff::data_reader reader(std::make_shared<ff::data_vector>(bytes));
+            Assert::IsTrue(ff::dict::load(reader, loaded_dict));
+            Assert::IsTrue(dict == loaded_dict);
+        }
+
+        TEST_METHOD(perf_flat_load)
+        {
+            const size_t count = 20000;
+            ff::dict dict;
+            dict.reserve(count);
+
+            for (size_t i = 0; i < count; i++)
+            {
+                std::string name = "level/object_" + std::to_string(i);
+                if (i % 2)
+                {
+                    dict.set<std::string>(name, name);
+                }
+                else
+                {
+                    dict.set<int>(name, static_cast<int>(i));
+                }
+            }
+
+            auto legacy_bytes = std::make_shared<std::vector<uint8_t>>();
+            auto flat_bytes = std::make_shared<std::vector<uint8_t>>();
+            ff::data_writer legacy_writer(legacy_bytes);
+            ff::data_writer flat_writer(flat_bytes);
+            Assert::IsTrue(dict.save_legacy(legacy_writer));
+            Assert::IsTrue(dict.save(flat_writer));
+
+            ff::timer timer;
+            ff::dict legacy_dict;
+            ff::data_reader legacy_reader(std::make_shared<ff::data_static>(legacy_bytes->data(), legacy_bytes->size()));
+            Assert::IsTrue(ff::dict::load(legacy_reader, legacy_dict));
+            Assert::AreEqual(10, legacy_dict.get<int>("level/object_10"sv));
+            double legacy_seconds = timer.tick();
+
+            ff::flat_dict flat_dict(std::make_shared<ff::data_static>(flat_bytes->data(), flat_bytes->size()));
+            Assert::AreEqual(10, flat_dict.get<int>("level/object_10"sv));
+            double flat_seconds = timer.tick();
+
+            ff::dict flat_full_dict;
+            ff::data_reader flat_reader(std::make_shared<ff::data_static>(flat_bytes->data(), flat_bytes->size()));
+            Assert::IsTrue(ff::dict::load(flat_reader, flat_full_dict));
+            double flat_full_seconds = timer.tick();
+
+            ff::log::write(ff::log::type::test, "Dict entries: ", count,
+                ", Legacy load: ", legacy_seconds * 1000.0, "ms (", legacy_bytes->size(), " bytes)",
+                ", Flat open+get: ", flat_seconds * 1000.0, "ms (", flat_bytes->size(), " bytes)",
+                ", Flat full load: ", flat_full_seconds * 1000.0, "ms");
+        }
+
+        TEST_METHOD(interned_keys)
+        {
+            const std::string name = "dict_tests/interned_keys";
+            Assert::IsFalse(ff::interned_key::find(name).valid());
+
+            ff::interned_key key(name);
+            Assert::IsTrue(key.valid());
+            Assert::IsTrue(key == name);
+            Assert::IsTrue(key.data() != name.data());
+            Assert::IsTrue(key.id() > 0);
+            Assert::IsTrue(key.data() == ff::interned_key(std::string(name)).data());
+            Assert::IsTrue(key.data() == ff::interned_key::find(name).data());
+            Assert::AreEqual(key.id(), ff::interned_key::find(name).id());
+            Assert::AreEqual(key.hash(), ff::interned_key::find(name).hash());
+            Assert::AreNotEqual(key.id(), ff::interned_key(name + "2").id());
+            Assert::AreEqual<uint32_t>(0, ff::interned_key().id());
+
+            ff::dict dict;
+            dict.set<int>(key, 12);
+            Assert::AreEqual(12, dict.get<int>(name));
+            Assert::AreEqual(12, dict.get<int>(key));
+
+            // Names from the dict are interned too
+            for (auto& i : dict)
+            {
+                Assert::IsTrue(i.first.data() == key.data());
+            }
+
+            dict.set(name, nullptr);
+            Assert::IsTrue(dict.empty());
+            Assert::IsTrue(dict.get(key) == nullptr);
+        }
+
+        TEST_METHOD(perf_threaded_build_lookup)
+        {
+            const size_t thread_count = std::max<size_t>(std::thread::hardware_concurrency(), 2);
+            const size_t name_count = 4096;
+            const size_t dict_size = 32;
+            const size_t rounds = 2000;
+
+            std::vector<std::string> names;
+            names.reserve(name_count);
+            for (size_t i = 0; i < name_count; i++)
+            {
+                names.push_back("perf_dict/property_" + std::to_string(i));
+            }
+
+            auto run_threads = [thread_count](const std::function<void(size_t)>& func)
+            {
+                ff::timer timer;
+                std::vector<std::jthread> threads;
+                for (size_t i = 0; i < thread_count; i++)
+                {
+                    threads.emplace_back(func, i);
+                }
+
+                threads.clear();
+                return timer.tick();
+            };
+
+            // Every thread builds small dicts from names that are shared with other threads, then reads every value back
+            std::atomic<size_t> checksum = 0;
+            double build_seconds = run_threads([&](size_t thread_index)
+                {
+                    size_t sum = 0;
+                    for (size_t r = 0; r < rounds; r++)
+                    {
+                        ff::dict dict;
+                        dict.reserve(dict_size);
+
+                        for (size_t i = 0; i < dict_size; i++)
+                        {
+                            dict.set<int>(names[(r * dict_size + i + thread_index) % name_count], static_cast<int>(i));
+                        }
+
+                        for (size_t i = 0; i < dict_size; i++)
+                        {
+                            sum += dict.get<int>(names[(r * dict_size + i + thread_index) % name_count]);
+                        }
+                    }
+
+                    checksum += sum;
+                });
+
+            Assert::AreEqual(thread_count * rounds * (dict_size * (dict_size - 1) / 2), checksum.load());
+
+            std::vector<ff::interned_key> keys;
+            keys.reserve(name_count);
+            ff::dict big_dict;
+            for (size_t i = 0; i < name_count; i++)
+            {
+                keys.emplace_back(names[i]);
+                big_dict.set<size_t>(keys.back(), i);
+            }
+
+            checksum = 0;
+            double name_lookup_seconds = run_threads([&](size_t thread_index)
+                {
+                    size_t sum = 0;
+                    for (size_t r = 0; r < rounds / 16; r++)
+                    {
+                        for (const std::string& name : names)
+                        {
+                            sum += big_dict.get<size_t>(name);
+                        }
+                    }
+
+                    checksum += sum;
+                });
+
+            double key_lookup_seconds = run_threads([&](size_t thread_index)
+                {
+                    size_t sum = 0;
+                    for (size_t r = 0; r < rounds / 16; r++)
+                    {
+                        for (const ff::interned_key& key : keys)
+                        {
+                            sum += big_dict.get<size_t>(key);
+                        }
+                    }
+
+                    checksum += sum;
+                });
+
+            Assert::AreEqual(2 * thread_count * (rounds / 16) * (name_count * (name_count - 1) / 2), checksum.load());
+
+            ff::log::write(ff::log::type::test, "Dict threads: ", thread_count, ", Build+get: ", build_seconds * 1000.0,
+                "ms, Lookup by name: ", name_lookup_seconds * 1000.0, "ms, Lookup by interned key: ", key_lookup_seconds * 1000.0,
+                "ms, Interned strings: ", ff::interned_key::count());
+        }
     };
 }
@@ -192,5 +192,119 @@ namespace ff::test::data
             value = dict.get("/arrays[2][2][1]");
             Assert::IsTrue(value && value->is_type<int>());
         }
+
+        TEST_METHOD(json_structural_differential)
+        {
+            std::vector<std::string> tests =
+            {
+                "{ 'a': 1, 'b': [ true, false, null, -1.5e3 ], // comment\n 'c': 'x\\'y\\\\' /* comment */ }",
+                "{ 'a': { 'b': { 'c': [ [], {}, [ 1, 2, ], ] } }, }",
+                "{ 'key\\u0041': '\\u0042\\n\\t' }",
+                "{ 12abc }",
+                "{ 'a': 12abc }",
+                "{ 'a': 1 2 }",
+                "{ 'a': / }",
+                "{ 'a': 1 /* no end",
+                "{ 'a': 'no end",
+                "{ 'a': 'bad\\x' }",
+                "{ 'a': 'tab\tinside' }",
+                "{ 'a': truex }",
+                "[ 1, 2 ]",
+                "",
+            };
+
+            for (std::string& test : tests)
+            {
+                std::replace(test.begin(), test.end(), '\'', '\"');
+            }
+
+            // Random edits of valid JSON, with strings and comments that cross 64 byte blocks
+            std::string valid_json = "{";
+            for (int i = 0; i < 64; i++)
+            {
+                valid_json += "\"key" + std::to_string(i) + "\\\\\\\"" + std::string(i, 'z') + "\": [ " + std::to_string(i) + ", -" + std::to_string(i * 7) + ".25e-3, true, { \"n\": null } ], /* comment " + std::to_string(i) + " */\n";
+            }
+
+            valid_json += "}";
+            tests.push_back(valid_json);
+
+            std::mt19937 random(1);
+            const std::string_view edit_chars = "{}[]:,\"\\/* \n\t01-.etrunlfa\x01";
+            for (size_t i = 0; i < 2000; i++)
+            {
+                std::string test = valid_json;
+                for (size_t h = random() % 4 + 1; h > 0; h--)
+                {
+                    test[random() % test.size()] = edit_chars[random() % edit_chars.size()];
+                }
+
+                tests.push_back(std::move(test));
+            }
+
+            for (const std::string& test : tests)
+            {
+                ff::dict dict, dict_expect;
+                const char* error_pos = nullptr;
+                const char* error_pos_expect = nullptr;
+                bool status = ff::json_parse(test, dict, &error_pos);
+                bool status_expect = ff::internal::json_parse_tokenizer(test, dict_expect, &error_pos_expect);
+
+                Assert::AreEqual(status_expect, status);
+                Assert::IsTrue(error_pos_expect == error_pos);
+                Assert::IsTrue(!status || dict_expect == dict);
+
+                // SIMD and scalar classification must find the same structural characters
+                ff::internal::json_structural_index index(test);
+                ff::internal::json_structural_index index_scalar(test, false);
+                Assert::IsTrue(index.positions() == index_scalar.positions());
+                Assert::AreEqual(index_scalar.bad_string_char(), index.bad_string_char());
+            }
+        }
+
+        TEST_METHOD(perf_json_parse)
+        {
+            // Similar to .res.json sources: sprite lists, animations with key frames, and nested objects
+            std::ostringstream json;
+            json << "{\n  // Generated assets\n";
+            for (size_t i = 0; i < 2000; i++)
+            {
+                json << "  \"sprites_" << i << "\": {\n"
+                    << "    \"res:type\": \"sprites\",\n"
+                    << "    \"optimize\": true,\n"
+                    << "    \"format\": \"bc3\",\n"
+                    << "    \"sprites\": {\n"
+                    << "      \"player_" << i << "\": { \"file\": \"file:assets/sprites/player_" << i << ".png\", \"pos\": [ " << i % 512 << ", " << i % 64 << " ], \"size\": [ 32, 48 ], \"handle\": [ 16.5, 24 ], \"repeat\": 8 }\n"
+                    << "    }\n"
+                    << "  },\n"
+                    << "  \"anim_" << i << "\": {\n"
+                    << "    \"res:type\": \"animation\", /* key frames */\n"
+                    << "    \"frame_length\": 60, \"frames_per_second\": 30.5, \"loop\": null,\n"
+                    << "    \"keys\": [ { \"frame\": 0, \"value\": [ 0.0, 1.0, -2.5e-3 ] }, { \"frame\": 30, \"value\": [ 1.25, \"\\u0041\\n\" ] } ]\n"
+                    << "  },\n";
+            }
+
+            json << "}\n";
+            std::string text = json.str();
+
+            ff::timer timer;
+            ff::dict dict_old;
+            Assert::IsTrue(ff::internal::json_parse_tokenizer(text, dict_old));
+            double old_seconds = timer.tick();
+
+            ff::internal::json_structural_index index(text);
+            double index_seconds = timer.tick();
+
+            ff::dict dict_new;
+            Assert::IsTrue(ff::json_parse(text, dict_new));
+            double new_seconds = timer.tick();
+
+            Assert::IsTrue(dict_old == dict_new);
+
+            const double mb = text.size() / (1024.0 * 1024.0);
+            ff::log::write(ff::log::type::test, "JSON size: ", mb, "MB",
+                ", Char tokenizer: ", mb / old_seconds, "MB/s",
+                ", Structural index only: ", mb / index_seconds, "MB/s",
+                ", Structural parse: ", mb / new_seconds, "MB/s");
+        }
     };
 }
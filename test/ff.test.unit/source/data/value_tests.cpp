@@ -137,5 +137,116 @@ namespace ff::test::data
                 val_loaded->debug_print_tree();
             }
         }
+
+        TEST_METHOD(value_allocator_stats)
+        {
+            using value_allocator = ff::internal::value_allocator;
+            const size_t count = 1000;
+            const size_t size = 3 * sizeof(size_t);
+            std::vector<void*> blocks(count);
+
+            auto stats_before = value_allocator::stats();
+            for (void*& block : blocks)
+            {
+                block = value_allocator::new_bytes(size);
+            }
+
+            auto stats_allocated = value_allocator::stats();
+            Assert::AreEqual(size, stats_allocated[2].size);
+            Assert::IsTrue(stats_allocated[2].allocs - stats_before[2].allocs >= count);
+            Assert::IsTrue(stats_allocated[2].bytes_live >= count * size);
+
+            // Freed by another thread
+            std::thread([&blocks, size]()
+                {
+                    for (void* block : blocks)
+                    {
+                        ff::internal::value_allocator::delete_bytes(block, size);
+                    }
+                }).join();
+
+            auto stats_freed = value_allocator::stats();
+            Assert::IsTrue(stats_freed[2].frees - stats_allocated[2].frees >= count);
+            Assert::IsTrue(stats_freed[2].remote_frees - stats_allocated[2].remote_frees >= count);
+
+            // Too big for a size class
+            void* big = value_allocator::new_bytes(value_allocator::max_pooled_size + 1);
+            value_allocator::delete_bytes(big, value_allocator::max_pooled_size + 1);
+            Assert::IsTrue(value_allocator::stats().back().allocs > stats_before.back().allocs);
+            value_allocator::flush_thread_cache();
+        }
+
+        TEST_METHOD(perf_value_allocator)
+        {
+            const size_t thread_count = std::max<size_t>(std::thread::hardware_concurrency(), 2);
+            const size_t rounds = 200;
+            const size_t count = 1000;
+
+            auto run_threads = [thread_count](const std::function<void()>& func)
+            {
+                ff::timer timer;
+                std::vector<std::jthread> threads;
+                for (size_t i = 0; i < thread_count; i++)
+                {
+                    threads.emplace_back(func);
+                }
+
+                threads.clear();
+                return timer.tick();
+            };
+
+            // Shared lock free pool without a per-thread cache, like the old allocator
+            static ff::byte_pool_allocator<std::array<size_t, 4>> shared_pool;
+            double shared_seconds = run_threads([&]()
+                {
+                    std::vector<void*> blocks(count);
+                    for (size_t r = 0; r < rounds; r++)
+                    {
+                        for (void*& block : blocks)
+                        {
+                            block = shared_pool.new_bytes();
+                        }
+
+                        for (void* block : blocks)
+                        {
+                            shared_pool.delete_bytes(block);
+                        }
+                    }
+                });
+
+            double magazine_seconds = run_threads([&]()
+                {
+                    std::vector<void*> blocks(count);
+                    for (size_t r = 0; r < rounds; r++)
+                    {
+                        for (void*& block : blocks)
+                        {
+                            block = ff::internal::value_allocator::new_bytes(4 * sizeof(size_t));
+                        }
+
+                        for (void* block : blocks)
+                        {
+                            ff::internal::value_allocator::delete_bytes(block, 4 * sizeof(size_t));
+                        }
+                    }
+                });
+
+            double values_seconds = run_threads([&]()
+                {
+                    for (size_t r = 0; r < rounds; r++)
+                    {
+                        ff::dict dict;
+                        for (size_t i = 0; i < count / 10; i++)
+                        {
+                            dict.set<std::string>("value", "a string value");
+                            dict.set<double>("double", static_cast<double>(i) + 0.5);
+                        }
+                    }
+                });
+
+            const size_t total = thread_count * rounds * count;
+            ff::log::write(ff::log::type::test, "Threads: ", thread_count, ", Alloc+free pairs: ", total,
+                ", Shared pool: ", shared_seconds, "s, Magazines: ", magazine_seconds, "s, Dict values: ", values_seconds, "s");
+        }
     };
 }
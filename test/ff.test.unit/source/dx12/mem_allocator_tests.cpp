@@ -100,5 +100,25 @@ namespace ff::test::dx12
             Assert::AreEqual<uint64_t>(0, range.allocated_start());
             Assert::IsNull(range.cpu_data());
         }
+
+        TEST_METHOD(stats)
+        {
+            const uint64_t one_meg = 1024 * 1024;
+            ff::dx12::mem_allocator allocator(one_meg, one_meg, ff::dx12::heap::usage_t::gpu_buffers);
+
+            ff::dx12::mem_range range1 = allocator.alloc_bytes(65536);
+            ff::dx12::mem_range range2 = allocator.alloc_bytes(65536);
+            ff::dx12::mem_range range3 = allocator.alloc_bytes(65536);
+            range2 = ff::dx12::mem_range();
+
+            ff::dx12::mem_allocator_stats stats = allocator.stats();
+            Assert::AreEqual<size_t>(1, stats.heap_count);
+            Assert::AreEqual<uint64_t>(one_meg, stats.heap_size);
+            Assert::AreEqual<uint64_t>(one_meg - 2 * 65536, stats.free_size);
+            Assert::AreEqual<uint64_t>(one_meg - 3 * 65536, stats.largest_free_size);
+            Assert::AreEqual<size_t>(2, stats.free_block_count);
+            Assert::AreEqual<size_t>(2, stats.allocation_count);
+            Assert::IsTrue(stats.fragmentation() > 0.0);
+        }
     };
 }
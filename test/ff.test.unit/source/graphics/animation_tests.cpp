@@ -84,5 +84,135 @@ namespace ff::test::graphics
             Assert::AreEqual<size_t>(1, events.size());
             Assert::AreEqual<size_t>(ff::stable_hash_func("start"sv), events[0].event_id);
         }
+
+        TEST_METHOD(typed_keys)
+        {
+            ff::create_animation_keys create_float("float", 0, 10, ff::flags::set(ff::animation_keys::method_t::interpolate_spline, ff::animation_keys::method_t::bounds_loop));
+            create_float.add_frame(0, ff::value::create<float>(1));
+            create_float.add_frame(5, ff::value::create<float>(4));
+            create_float.add_frame(10, ff::value::create<float>(-2));
+
+            ff::create_animation_keys create_point("point", 0, 10, ff::flags::set(ff::animation_keys::method_t::interpolate_linear, ff::animation_keys::method_t::bounds_clamp));
+            create_point.add_frame(0, ff::value::create<ff::point_float>(ff::point_float(0, 10)));
+            create_point.add_frame(10, ff::value::create<ff::point_float>(ff::point_float(20, 0)));
+
+            ff::create_animation_keys create_color("color", 0, 0, ff::animation_keys::method_t::default_, ff::value::create<ff::rect_float>(ff::rect_float(1, 0.5f, 0.25f, 1)));
+
+            ff::animation_keys float_keys = create_float.create();
+            ff::animation_keys point_keys = ff::animation_keys::load_from_cache(create_point.create().save_to_cache());
+            ff::animation_keys color_keys = create_color.create();
+
+            Assert::AreEqual<size_t>(1, float_keys.component_count());
+            Assert::AreEqual<size_t>(2, point_keys.component_count());
+            Assert::AreEqual<size_t>(4, color_keys.component_count());
+
+            for (float frame = -5; frame < 25; frame += 0.25f)
+            {
+                float float_value;
+                Assert::IsTrue(float_keys.sample_into(frame, float_value));
+                Assert::AreEqual(float_keys.get_value(frame)->get<float>(), float_value, 0.0001f);
+
+                ff::point_float point_value;
+                Assert::IsTrue(point_keys.sample_into(frame, point_value));
+                Assert::IsTrue(point_keys.get_value(frame)->get<ff::point_float>() == point_value);
+                Assert::IsFalse(point_keys.sample_into(frame, float_value));
+
+                DirectX::XMFLOAT4 color_value;
+                Assert::IsTrue(color_keys.sample_into(frame, color_value));
+                Assert::AreEqual(0.25f, color_value.z);
+            }
+        }
+
+        TEST_METHOD(typed_keys_batch)
+        {
+            ff::create_animation_keys create_float("float", 0, 100, ff::flags::set(ff::animation_keys::method_t::interpolate_spline, ff::animation_keys::method_t::bounds_none));
+            for (int i = 0; i <= 100; i += 10)
+            {
+                create_float.add_frame(static_cast<float>(i), ff::value::create<float>(static_cast<float>(i % 20)));
+            }
+
+            ff::create_animation_keys create_rect("rect", 0, 100, ff::flags::set(ff::animation_keys::method_t::interpolate_linear, ff::animation_keys::method_t::bounds_loop));
+            create_rect.add_frame(0, ff::value::create<ff::rect_float>(ff::rect_float(0, 0, 0, 0)));
+            create_rect.add_frame(100, ff::value::create<ff::rect_float>(ff::rect_float(100, 200, 300, 400)));
+
+            ff::animation_keys float_keys = create_float.create();
+            ff::animation_keys rect_keys = create_rect.create();
+
+            std::vector<float> frames;
+            for (float frame = -10; frame < 130; frame += 0.3f)
+            {
+                frames.push_back(frame);
+            }
+
+            std::vector<float> float_output(frames.size(), -1000.0f);
+            std::vector<float> rect_output(frames.size() * 4);
+            std::array<ff::animation_keys::batch_track, 2> tracks
+            {
+                ff::animation_keys::batch_track{ &float_keys, frames, float_output },
+                ff::animation_keys::batch_track{ &rect_keys, frames, rect_output },
+            };
+
+            ff::animation_keys::sample_batch(tracks);
+
+            for (size_t i = 0; i < frames.size(); i++)
+            {
+                float float_value;
+                if (float_keys.sample_into(frames[i], float_value))
+                {
+                    Assert::AreEqual(float_value, float_output[i], 0.0001f);
+                }
+                else
+                {
+                    Assert::AreEqual(-1000.0f, float_output[i]);
+                }
+
+                ff::rect_float rect_value;
+                Assert::IsTrue(rect_keys.sample_into(frames[i], rect_value));
+                Assert::IsTrue(std::memcmp(&rect_value, &rect_output[i * 4], sizeof(rect_value)) == 0);
+            }
+        }
+
+        TEST_METHOD(perf_typed_keys)
+        {
+            ff::create_animation_keys create_point("point", 0, 60, ff::flags::set(ff::animation_keys::method_t::interpolate_spline, ff::animation_keys::method_t::bounds_loop));
+            for (int i = 0; i <= 60; i += 6)
+            {
+                create_point.add_frame(static_cast<float>(i), ff::value::create<ff::point_float>(ff::point_float(static_cast<float>(i), static_cast<float>(-i))));
+            }
+
+            ff::animation_keys keys = create_point.create();
+            const size_t count = 100000;
+            std::vector<float> frames(count);
+            std::vector<float> output(count * 2);
+
+            for (size_t i = 0; i < count; i++)
+            {
+                frames[i] = static_cast<float>(i % 600) / 10.0f;
+            }
+
+            ff::timer timer;
+            float total = 0;
+
+            for (float frame : frames)
+            {
+                total += keys.get_value(frame)->get<ff::point_float>().x;
+            }
+
+            double value_seconds = timer.tick();
+
+            for (float frame : frames)
+            {
+                ff::point_float value;
+                keys.sample_into(frame, value);
+                total += value.x;
+            }
+
+            double typed_seconds = timer.tick();
+
+            keys.sample_batch(frames, output);
+            double batch_seconds = timer.tick();
+
+            ff::log::write(ff::log::type::test, "Samples: ", count, ", get_value: ", value_seconds, "s, sample_into: ", typed_seconds, "s, sample_batch: ", batch_seconds, "s (", total, ")");
+        }
     };
 }
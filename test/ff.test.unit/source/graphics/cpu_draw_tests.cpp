@@ -0,0 +1,630 @@
+#include "pch.h"
+#include "../utility.h"
+
+static std::shared_ptr<ff::cpu::texture> load_test_texture()
+{
+    ff::data_static texture_mem(ff::get_hinstance(), RT_RCDATA, MAKEINTRESOURCE(ID_TEST_TEXTURE));
+    ff::png_image_reader png(texture_mem.data(), texture_mem.size());
+    return std::make_shared<ff::cpu::texture>(std::make_shared<DirectX::ScratchImage>(std::move(*png.read())));
+}
+
+namespace ff::test::graphics
+{
+    TEST_CLASS(cpu_draw_tests)
+    {
+    public:
+        TEST_METHOD(draw_shapes)
+        {
+            std::shared_ptr<ff::cpu::texture> test_texture = ::load_test_texture();
+            const ff::color clear_color(0.25, 0, 0.5, 1);
+            ff::cpu::target_texture target(std::make_shared<ff::cpu::texture>(ff::point_size(256, 256)));
+            ff::cpu::commands context;
+            target.begin_render(context, &clear_color);
+
+            // Same scene as dx12_draw_tests::draw_shapes, so the result must match the GPU
+            {
+                ff::cpu::depth depth;
+                std::unique_ptr<ff::cpu::draw_device> draw_device = ff::cpu::create_draw_device();
+                ff::dxgi::draw_ptr draw = draw_device->begin_draw(context, target, &depth, ff::rect_fixed(0, 0, 256, 256), ff::rect_fixed(0, 0, 256, 256));
+                Assert::IsTrue(draw != nullptr);
+
+                const ff::color color_tl(1, 1, 0, 0);
+                const ff::color color_tr(1, 0, 1, 1);
+                const ff::color color_br(0, 1, 1, 0);
+                const ff::color color_bl(1, 1, 1, 1);
+                const ff::rect_float rect(32, 32, 224, 224);
+
+                std::array<ff::dxgi::endpoint_t, 6> triangles
+                {
+                    ff::dxgi::endpoint_t{ rect.top_left(), &color_tl },
+                    ff::dxgi::endpoint_t{ rect.top_right(), &color_tr },
+                    ff::dxgi::endpoint_t{ rect.bottom_right(), &color_br },
+
+                    ff::dxgi::endpoint_t{ rect.top_left(), &color_tl },
+                    ff::dxgi::endpoint_t{ rect.bottom_right(), &color_br },
+                    ff::dxgi::endpoint_t{ rect.bottom_left(), &color_bl },
+                };
+
+                ff::dxgi::sprite_data test_sprite(test_texture.get(), ff::rect_float(0, 0, 32, 32), ff::point_float(16, 16), ff::point_float(1, 1), ff::dxgi::sprite_type::opaque);
+
+                draw->draw_triangles(triangles);
+                draw->draw_sprite(test_sprite, ff::pixel_transform(ff::point_fixed(40, 40)));
+                draw->draw_sprite(test_sprite, ff::pixel_transform(ff::point_fixed(216, 216), ff::point_fixed(1, 1), 30));
+                draw->draw_circle(ff::dxgi::pixel_endpoint_t{ { 128, 128 }, &ff::color_yellow(), 16.f }, 4);
+                draw->draw_line(ff::point_fixed(0, 256), ff::point_fixed(256, 0), ff::color_red(), 3);
+                draw.reset();
+
+                const ff::cpu::draw_stats& stats = draw_device->stats();
+                Assert::AreEqual<size_t>(1, stats.flushes);
+                Assert::AreEqual<size_t>(6, stats.instances);
+                Assert::IsTrue(stats.pixels > 0);
+            }
+
+            target.end_render(context);
+
+            std::filesystem::path file_path = ff::filesystem::temp_directory_path() / "cpu_draw_shapes_test.png";
+            {
+                ff::file_writer file_writer(file_path);
+                ff::png_image_writer png(file_writer);
+                bool saved = png.write(*target.shared_texture()->image(), nullptr);
+                Assert::IsTrue(saved);
+            }
+
+            ff::test::assert_image(file_path, ID_DX12_DRAW_SHAPE_RESULT);
+        }
+
+        TEST_METHOD(draw_palette_target)
+        {
+            ff::cpu::target_texture target(std::make_shared<ff::cpu::texture>(ff::point_size(64, 64), DXGI_FORMAT_R8_UINT));
+            ff::cpu::commands context;
+            const ff::color clear_color(3);
+            target.begin_render(context, &clear_color);
+
+            {
+                std::unique_ptr<ff::cpu::draw_device> draw_device = ff::cpu::create_draw_device();
+                ff::dxgi::draw_ptr draw = draw_device->begin_draw(context, target, nullptr, ff::rect_fixed(0, 0, 64, 64), ff::rect_fixed(0, 0, 64, 64));
+                Assert::IsTrue(draw != nullptr);
+
+                draw->draw_rectangle(ff::rect_float(8, 8, 24, 24), ff::color(42));
+                draw->draw_rectangle(ff::rect_float(32, 32, 48, 48), ff::color(7), 2.0f);
+            }
+
+            target.end_render(context);
+
+            const DirectX::Image& image = *target.shared_texture()->image();
+            auto pixel = [&image](size_t x, size_t y)
+                {
+                    return image.pixels[y * image.rowPitch + x];
+                };
+
+            Assert::AreEqual<uint8_t>(3, pixel(0, 0));
+            Assert::AreEqual<uint8_t>(42, pixel(8, 8));
+            Assert::AreEqual<uint8_t>(42, pixel(23, 23));
+            Assert::AreEqual<uint8_t>(3, pixel(24, 24));
+            Assert::AreEqual<uint8_t>(7, pixel(32, 32));
+            Assert::AreEqual<uint8_t>(7, pixel(33, 40));
+            Assert::AreEqual<uint8_t>(3, pixel(40, 40));
+        }
+
+        TEST_METHOD(transparent_batcher)
+        {
+            using namespace ff::dxgi::draw_util;
+            instance_bucket sprites = instance_bucket::create<sprite_instance, instance_bucket_type::sprites_out_transparent>();
+            instance_bucket circles = instance_bucket::create<circle_instance, instance_bucket_type::circles_filled_out_transparent>();
+            ff::dxgi::draw_util::transparent_batcher batcher;
+
+            // Interleaved buckets that don't overlap need only one batch per bucket
+            {
+                std::vector<transparent_instance_entry> entries;
+                std::vector<ff::rect_float> bounds;
+
+                for (size_t i = 0; i < 8; i++)
+                {
+                    entries.push_back(transparent_instance_entry{ (i % 2) ? &circles : &sprites, i / 2, static_cast<float>(i) });
+                    bounds.push_back(ff::rect_float(i * 10.0f, 0, i * 10.0f + 10.0f, 10));
+                }
+
+                Assert::AreEqual<size_t>(2, batcher.batch(entries, bounds));
+                Assert::AreEqual<size_t>(4, batcher.batches()[0].count);
+                Assert::AreEqual<size_t>(4, batcher.batches()[1].count);
+                Assert::IsTrue(batcher.batches()[0].bucket == &sprites);
+
+                const std::array<uint32_t, 8> expect_order{ 0, 2, 4, 6, 1, 3, 5, 7 };
+                Assert::IsTrue(std::ranges::equal(expect_order, batcher.order()));
+            }
+
+            // Overlapping instances from different buckets must stay in order
+            {
+                const std::array<transparent_instance_entry, 4> entries
+                {
+                    transparent_instance_entry{ &sprites, 0, 1 },
+                    transparent_instance_entry{ &circles, 0, 2 },
+                    transparent_instance_entry{ &sprites, 1, 3 }, // overlaps the circle
+                    transparent_instance_entry{ &circles, 1, 4 }, // overlaps nothing
+                };
+
+                const std::array<ff::rect_float, 4> bounds
+                {
+                    ff::rect_float(0, 0, 10, 10),
+                    ff::rect_float(5, 5, 15, 15),
+                    ff::rect_float(12, 12, 20, 20),
+                    ff::rect_float(100, 100, 110, 110),
+                };
+
+                Assert::AreEqual<size_t>(3, batcher.batch(entries, bounds));
+
+                const std::array<uint32_t, 4> expect_order{ 0, 1, 3, 2 };
+                Assert::IsTrue(std::ranges::equal(expect_order, batcher.order()));
+                Assert::AreEqual<size_t>(2, batcher.batches()[1].count);
+            }
+        }
+
+        TEST_METHOD(perf_reorder_transparent)
+        {
+            const ff::rect_float world_rect(0, 0, 1280, 720);
+            const size_t sprite_count = 4000;
+            const size_t frame_count = 10;
+
+            std::shared_ptr<ff::cpu::texture> test_texture = ::load_test_texture();
+            ff::dxgi::sprite_data sprite(test_texture.get(), ff::rect_float(0, 0, 32, 32), ff::point_float(16, 16), ff::point_float(1, 1), ff::dxgi::sprite_type::unknown);
+
+            struct shape_entry
+            {
+                ff::point_float pos;
+                ff::color color;
+                bool circle;
+            };
+
+            std::mt19937 random(1);
+            std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+            std::vector<shape_entry> entries(sprite_count);
+
+            for (shape_entry& entry : entries)
+            {
+                entry.pos = ff::point_float(unit(random) * world_rect.width(), unit(random) * world_rect.height());
+                entry.color = ff::color(unit(random), unit(random), unit(random), 0.5f);
+                entry.circle = unit(random) < 0.25f;
+            }
+
+            std::array<std::shared_ptr<ff::cpu::texture>, 2> results;
+            std::array<size_t, 2> draw_calls{};
+
+            for (size_t pass = 0; pass < 2; pass++)
+            {
+                const ff::dxgi::draw_options options = pass ? ff::dxgi::draw_options::reorder_transparent : ff::dxgi::draw_options::none;
+                results[pass] = std::make_shared<ff::cpu::texture>(world_rect.size().cast<size_t>());
+                ff::cpu::target_texture target(results[pass]);
+                ff::cpu::depth depth;
+                ff::cpu::commands context;
+                std::unique_ptr<ff::cpu::draw_device> draw_device = ff::cpu::create_draw_device();
+                ff::timer timer;
+
+                for (size_t frame = 0; frame < frame_count; frame++)
+                {
+                    target.clear(context, ff::color_black());
+                    ff::dxgi::draw_ptr draw = draw_device->begin_draw(context, target, &depth, world_rect, world_rect, options);
+                    Assert::IsTrue(draw != nullptr);
+
+                    // Alternating between sprites and circles would be one draw call each without reordering
+                    for (const shape_entry& entry : entries)
+                    {
+                        if (entry.circle)
+                        {
+                            draw->draw_circle(ff::dxgi::endpoint_t{ entry.pos, &entry.color, 8.0f });
+                        }
+                        else
+                        {
+                            draw->draw_sprite(sprite, ff::transform(entry.pos, ff::point_float(0.5f, 0.5f), 0.0f, entry.color));
+                        }
+                    }
+                }
+
+                const double seconds = timer.tick();
+                const ff::cpu::draw_stats& stats = draw_device->stats();
+                draw_calls[pass] = stats.draw_calls;
+
+                ff::log::write(ff::log::type::test, "CPU draw transparent ", pass ? "with" : "without", " reordering: ",
+                    stats.draw_calls, " draw calls, ", stats.draw_calls_saved, " saved, ",
+                    static_cast<size_t>(sprite_count * frame_count / seconds), " instances/sec");
+            }
+
+            Assert::IsTrue(draw_calls[1] < draw_calls[0]);
+
+            // Reordering must not change the output
+            const DirectX::Image& image0 = *results[0]->image();
+            const DirectX::Image& image1 = *results[1]->image();
+            for (size_t y = 0; y < image0.height; y++)
+            {
+                Assert::AreEqual(0, std::memcmp(image0.pixels + y * image0.rowPitch, image1.pixels + y * image1.rowPitch, image0.width * 4));
+            }
+        }
+
+        TEST_METHOD(record_parallel)
+        {
+            const ff::rect_float world_rect(0, 0, 512, 512);
+            const size_t shape_count = 2000;
+            const size_t recorder_count = 4;
+
+            std::shared_ptr<ff::cpu::texture> test_texture = ::load_test_texture();
+            ff::dxgi::sprite_data sprite(test_texture.get(), ff::rect_float(0, 0, 32, 32), ff::point_float(16, 16), ff::point_float(1, 1), ff::dxgi::sprite_type::unknown);
+
+            struct shape_entry
+            {
+                ff::point_float pos;
+                ff::color color;
+                float rotate;
+                size_t type;
+            };
+
+            std::mt19937 random(1);
+            std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+            std::vector<shape_entry> entries(shape_count);
+
+            for (shape_entry& entry : entries)
+            {
+                entry.pos = ff::point_float(unit(random) * world_rect.width(), unit(random) * world_rect.height());
+                entry.color = ff::color(unit(random), unit(random), unit(random), (unit(random) < 0.5f) ? 0.5f : 1.0f);
+                entry.rotate = unit(random) * 360.0f;
+                entry.type = static_cast<size_t>(unit(random) * 3.0f) % 3;
+            }
+
+            auto draw_entries = [&sprite, &entries](ff::dxgi::draw_base& draw, size_t start, size_t end)
+                {
+                    for (size_t i = start; i < end; i++)
+                    {
+                        const shape_entry& entry = entries[i];
+                        switch (entry.type)
+                        {
+                            case 0:
+                                draw.draw_sprite(sprite, ff::transform(entry.pos, ff::point_float(1, 1), entry.rotate, entry.color));
+                                break;
+
+                            case 1:
+                                draw.draw_circle(ff::dxgi::endpoint_t{ entry.pos, &entry.color, 10.0f }, 3.0f);
+                                break;
+
+                            default:
+                                draw.draw_rectangle(ff::rect_float(entry.pos, entry.pos + ff::point_float(20, 12)), entry.color);
+                                break;
+                        }
+                    }
+                };
+
+            std::array<std::shared_ptr<ff::cpu::texture>, 2> results;
+
+            for (size_t pass = 0; pass < 2; pass++)
+            {
+                results[pass] = std::make_shared<ff::cpu::texture>(world_rect.size().cast<size_t>());
+                ff::cpu::target_texture target(results[pass]);
+                ff::cpu::depth depth;
+                ff::cpu::commands context;
+                std::unique_ptr<ff::cpu::draw_device> draw_device = ff::cpu::create_draw_device();
+
+                target.clear(context, ff::color_black());
+                ff::dxgi::draw_ptr draw = draw_device->begin_draw(context, target, &depth, world_rect, world_rect);
+                Assert::IsTrue(draw != nullptr);
+
+                if (pass == 0)
+                {
+                    draw_entries(*draw, 0, shape_count);
+                }
+                else
+                {
+                    std::array<ff::dxgi::draw_base*, recorder_count> recorders;
+                    for (ff::dxgi::draw_base*& recorder : recorders)
+                    {
+                        recorder = draw->create_recorder();
+                        Assert::IsNotNull(recorder);
+                    }
+
+                    // Recorders finish in any order, but are merged in the order they were created
+                    ff::thread_pool::parallel_for(0, recorder_count, [&recorders, &draw_entries](size_t start, size_t end)
+                        {
+                            for (size_t i = start; i < end; i++)
+                            {
+                                draw_entries(*recorders[i], i * shape_count / recorder_count, (i + 1) * shape_count / recorder_count);
+                            }
+                        }, 1);
+                }
+
+                draw.reset();
+                Assert::AreEqual(shape_count, draw_device->stats().instances);
+            }
+
+            const DirectX::Image& image0 = *results[0]->image();
+            const DirectX::Image& image1 = *results[1]->image();
+            for (size_t y = 0; y < image0.height; y++)
+            {
+                Assert::AreEqual(0, std::memcmp(image0.pixels + y * image0.rowPitch, image1.pixels + y * image1.rowPitch, image0.width * 4));
+            }
+        }
+
+        TEST_METHOD(draw_sprites_batch)
+        {
+            const ff::rect_float world_rect(0, 0, 256, 256);
+            const size_t sprite_count = 1000;
+
+            std::shared_ptr<ff::cpu::texture> test_texture = ::load_test_texture();
+            std::array<ff::dxgi::sprite_data, 3> sprite_datas
+            {
+                ff::dxgi::sprite_data(test_texture.get(), ff::rect_float(0, 0, 32, 32), ff::point_float(16, 16), ff::point_float(1, 1), ff::dxgi::sprite_type::opaque),
+                ff::dxgi::sprite_data(test_texture.get(), ff::rect_float(32, 0, 48, 16), ff::point_float(8, 8), ff::point_float(1, 1), ff::dxgi::sprite_type::opaque),
+                ff::dxgi::sprite_data(test_texture.get(), ff::rect_float(0, 32, 32, 64), ff::point_float(16, 16), ff::point_float(1, 1), ff::dxgi::sprite_type::transparent),
+            };
+
+            // Runs of the same sprite type with some invisible sprites mixed in
+            std::mt19937 random(1);
+            std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+            std::vector<const ff::dxgi::sprite_data*> sprites;
+            std::vector<ff::transform> transforms;
+            size_t visible_count = 0;
+
+            for (size_t i = 0; i < sprite_count; i++)
+            {
+                const float alpha = (i % 17 == 0) ? 0.0f : ((unit(random) < 0.25f) ? 0.5f : 1.0f);
+                visible_count += (alpha != 0);
+
+                sprites.push_back(&sprite_datas[(i / 50) % 2 ? 2 : random() % 2]);
+                transforms.push_back(ff::transform(
+                    ff::point_float(unit(random) * world_rect.width(), unit(random) * world_rect.height()),
+                    ff::point_float(unit(random) + 0.5f, unit(random) + 0.5f), unit(random) * 360.0f,
+                    ff::color(unit(random), unit(random), unit(random), alpha)));
+            }
+
+            std::array<std::shared_ptr<ff::cpu::texture>, 3> results;
+
+            for (size_t pass = 0; pass < results.size(); pass++)
+            {
+                results[pass] = std::make_shared<ff::cpu::texture>(world_rect.size().cast<size_t>());
+                ff::cpu::target_texture target(results[pass]);
+                ff::cpu::depth depth;
+                ff::cpu::commands context;
+                std::unique_ptr<ff::cpu::draw_device> draw_device = ff::cpu::create_draw_device();
+
+                target.clear(context, ff::color_black());
+                ff::dxgi::draw_ptr draw = draw_device->begin_draw(context, target, &depth, world_rect, world_rect);
+                Assert::IsTrue(draw != nullptr);
+
+                switch (pass)
+                {
+                    case 0:
+                        for (size_t i = 0; i < sprite_count; i++)
+                        {
+                            draw->draw_sprite(*sprites[i], transforms[i]);
+                        }
+                        break;
+
+                    case 1:
+                        draw->draw_sprites(sprites, transforms);
+                        break;
+
+                    default:
+                        {
+                            ff::dxgi::draw_base* recorder = draw->create_recorder();
+                            Assert::IsNotNull(recorder);
+                            recorder->draw_sprites(sprites, transforms);
+                        }
+                        break;
+                }
+
+                draw.reset();
+                Assert::AreEqual(visible_count, draw_device->stats().instances);
+            }
+
+            const DirectX::Image& image0 = *results[0]->image();
+            for (size_t pass = 1; pass < results.size(); pass++)
+            {
+                const DirectX::Image& image = *results[pass]->image();
+                for (size_t y = 0; y < image0.height; y++)
+                {
+                    Assert::AreEqual(0, std::memcmp(image0.pixels + y * image0.rowPitch, image.pixels + y * image.rowPitch, image0.width * 4));
+                }
+            }
+        }
+
+        TEST_METHOD(perf_record_parallel)
+        {
+            const ff::rect_float world_rect(0, 0, 1920, 1080);
+            const size_t sprite_count = 100000;
+            const size_t frame_count = 10;
+            const size_t recorder_count = std::max<size_t>(ff::thread_pool::thread_count(), 1);
+
+            std::shared_ptr<ff::cpu::texture> test_texture = ::load_test_texture();
+            ff::dxgi::sprite_data sprite(test_texture.get(), ff::rect_float(0, 0, 32, 32), ff::point_float(16, 16), ff::point_float(1, 1), ff::dxgi::sprite_type::unknown);
+
+            std::mt19937 random(1);
+            std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+            std::vector<ff::transform> transforms;
+            transforms.reserve(sprite_count);
+
+            for (size_t i = 0; i < sprite_count; i++)
+            {
+                transforms.push_back(ff::transform(
+                    ff::point_float(unit(random) * world_rect.width(), unit(random) * world_rect.height()),
+                    ff::point_float(1, 1), unit(random) * 360.0f, ff::color(unit(random), unit(random), unit(random), 1.0f)));
+            }
+
+            ff::cpu::target_texture target(std::make_shared<ff::cpu::texture>(world_rect.size().cast<size_t>()));
+            ff::cpu::depth depth;
+            ff::cpu::commands context;
+
+            for (bool parallel : { false, true })
+            {
+                // Only measure building instances, not rasterizing them
+                std::unique_ptr<ff::cpu::draw_device> draw_device = ff::cpu::create_draw_device(false);
+                std::vector<ff::dxgi::draw_base*> recorders(recorder_count);
+                ff::timer timer;
+
+                for (size_t frame = 0; frame < frame_count; frame++)
+                {
+                    ff::dxgi::draw_ptr draw = draw_device->begin_draw(context, target, &depth, world_rect, world_rect);
+                    Assert::IsTrue(draw != nullptr);
+
+                    if (parallel)
+                    {
+                        for (ff::dxgi::draw_base*& recorder : recorders)
+                        {
+                            recorder = draw->create_recorder();
+                        }
+
+                        ff::thread_pool::parallel_for(0, recorder_count, [&](size_t start, size_t end)
+                            {
+                                for (size_t i = start; i < end; i++)
+                                {
+                                    for (size_t h = i * sprite_count / recorder_count; h < (i + 1) * sprite_count / recorder_count; h++)
+                                    {
+                                        recorders[i]->draw_sprite(sprite, transforms[h]);
+                                    }
+                                }
+                            }, 1);
+                    }
+                    else
+                    {
+                        for (const ff::transform& transform : transforms)
+                        {
+                            draw->draw_sprite(sprite, transform);
+                        }
+                    }
+                }
+
+                const double seconds = timer.tick();
+                Assert::AreEqual(sprite_count * frame_count, draw_device->stats().instances);
+
+                ff::log::write(ff::log::type::test, "CPU draw ", parallel ? "recording on " : "on ", parallel ? recorder_count : 1, " threads: ",
+                    static_cast<size_t>(sprite_count * frame_count / seconds), " sprites/sec");
+            }
+        }
+
+        TEST_METHOD(perf_draw_sprites)
+        {
+            struct sprite_entry
+            {
+                ff::point_float pos;
+                ff::point_float vel;
+                ff::point_float scale;
+                float rotate;
+                ff::color color;
+            };
+
+            const ff::rect_float world_rect(0, 0, 1920, 1080);
+            const size_t sprite_count = 5000;
+            const size_t frame_count = 10;
+
+            std::shared_ptr<ff::cpu::texture> test_texture = ::load_test_texture();
+            ff::dxgi::sprite_data sprite(test_texture.get(), ff::rect_float(0, 0, 32, 32), ff::point_float(16, 16), ff::point_float(1, 1), ff::dxgi::sprite_type::unknown);
+
+            std::mt19937 random(1);
+            std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+            std::vector<sprite_entry> entries(sprite_count);
+
+            for (sprite_entry& entry : entries)
+            {
+                entry.pos = ff::point_float(unit(random) * world_rect.width(), unit(random) * world_rect.height());
+                entry.vel = ff::point_float(unit(random) * 10 - 5, unit(random) * 10 - 5);
+                entry.scale = ff::point_float(unit(random) * 1.5f + 0.5f, unit(random) * 1.5f + 0.5f);
+                entry.rotate = unit(random) * 360.0f;
+                entry.color = ff::color(unit(random), unit(random), unit(random), (unit(random) < 0.25f) ? 0.5f : 1.0f);
+            }
+
+            ff::cpu::target_texture target(std::make_shared<ff::cpu::texture>(world_rect.size().cast<size_t>()));
+            ff::cpu::depth depth;
+            ff::cpu::commands context;
+
+            for (bool rasterize : { false, true })
+            {
+                std::unique_ptr<ff::cpu::draw_device> draw_device = ff::cpu::create_draw_device(rasterize);
+                ff::timer timer;
+
+                for (size_t frame = 0; frame < frame_count; frame++)
+                {
+                    target.clear(context, ff::color_black());
+                    ff::dxgi::draw_ptr draw = draw_device->begin_draw(context, target, &depth, world_rect, world_rect);
+                    Assert::IsTrue(draw != nullptr);
+
+                    for (sprite_entry& entry : entries)
+                    {
+                        entry.pos += entry.vel;
+                        draw->draw_sprite(sprite, ff::transform(entry.pos, entry.scale, entry.rotate, entry.color));
+                    }
+                }
+
+                const double seconds = timer.tick();
+                const ff::cpu::draw_stats& stats = draw_device->stats();
+                Assert::AreEqual(sprite_count * frame_count, stats.instances);
+
+                ff::log::write(ff::log::type::test, "CPU draw ", rasterize ? "with" : "without", " rasterizing: ",
+                    static_cast<size_t>(sprite_count * frame_count / seconds), " sprites/sec, ",
+                    stats.draw_calls, " draw calls, ", stats.triangles, " triangles, ", stats.pixels, " pixels");
+            }
+        }
+
+        TEST_METHOD(perf_draw_sprites_batch)
+        {
+            const ff::rect_float world_rect(0, 0, 1920, 1080);
+            const size_t sprite_count = 50000;
+            const size_t frame_count = 10;
+
+            // Like a tilemap, many sprites from the same texture
+            std::shared_ptr<ff::cpu::texture> test_texture = ::load_test_texture();
+            std::vector<ff::dxgi::sprite_data> tiles;
+            for (size_t i = 0; i < 16; i++)
+            {
+                const ff::point_float pos(static_cast<float>(i % 4) * 16, static_cast<float>(i / 4) * 16);
+                tiles.emplace_back(test_texture.get(), ff::rect_float(pos, pos + ff::point_float(16, 16)), ff::point_float(), ff::point_float(1, 1), ff::dxgi::sprite_type::unknown);
+            }
+
+            std::mt19937 random(1);
+            std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+            std::vector<const ff::dxgi::sprite_data*> sprites;
+            std::vector<ff::transform> transforms;
+            sprites.reserve(sprite_count);
+            transforms.reserve(sprite_count);
+
+            for (size_t i = 0; i < sprite_count; i++)
+            {
+                sprites.push_back(&tiles[random() % tiles.size()]);
+                transforms.push_back(ff::transform(
+                    ff::point_float(unit(random) * world_rect.width(), unit(random) * world_rect.height()),
+                    ff::point_float(1, 1), 0.0f, ff::color(unit(random), unit(random), unit(random), (unit(random) < 0.25f) ? 0.5f : 1.0f)));
+            }
+
+            ff::cpu::target_texture target(std::make_shared<ff::cpu::texture>(world_rect.size().cast<size_t>()));
+            ff::cpu::depth depth;
+            ff::cpu::commands context;
+
+            for (std::string_view mode : { "draw_sprite"sv, "draw_sprites"sv, "draw_sprites (shared sprite)"sv })
+            {
+                // Only measure building instances, not rasterizing them
+                std::unique_ptr<ff::cpu::draw_device> draw_device = ff::cpu::create_draw_device(false);
+                ff::timer timer;
+
+                for (size_t frame = 0; frame < frame_count; frame++)
+                {
+                    ff::dxgi::draw_ptr draw = draw_device->begin_draw(context, target, &depth, world_rect, world_rect);
+                    Assert::IsTrue(draw != nullptr);
+
+                    if (mode == "draw_sprite"sv)
+                    {
+                        for (size_t i = 0; i < sprite_count; i++)
+                        {
+                            draw->draw_sprite(*sprites[i], transforms[i]);
+                        }
+                    }
+                    else if (mode == "draw_sprites"sv)
+                    {
+                        draw->draw_sprites(sprites, transforms);
+                    }
+                    else
+                    {
+                        draw->draw_sprites(tiles[0], transforms);
+                    }
+                }
+
+                const double seconds = timer.tick();
+                Assert::AreEqual(sprite_count * frame_count, draw_device->stats().instances);
+
+                ff::log::write(ff::log::type::test, "CPU ", mode, ": ", static_cast<size_t>(sprite_count * frame_count / seconds), " sprites/sec");
+            }
+        }
+    };
+}
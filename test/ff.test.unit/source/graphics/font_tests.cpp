@@ -35,8 +35,30 @@ namespace ff::test::graphics
             Assert::IsTrue(font->line_spacing() > 16.25 && font->line_spacing() < 16.5);
 
             ff::point_float size = font->measure_text("Hello, this is text.\r\nAnother line.", ff::point_float(1, 1));
-            Assert::IsTrue(size.x > 95 && size.x < 95.5);
+            Assert::IsTrue(size.x > 94.5 && size.x < 95); // includes the "ex" kerning pair
             Assert::IsTrue(size.y > 32.5 && size.y < 33);
         }
+
+        TEST_METHOD(sprite_font_kerning)
+        {
+            auto result = ff::test::create_resources(R"(
+                {
+                    "test_font": { "res:type": "font_file", "file": "file:test_font.ttf" },
+                    "test_sprite_font": { "res:type": "font", "data": "ref:test_font", "size": 12 }
+                }
+            )");
+
+            auto font = ff::get_resource<ff::sprite_font>(*std::get<0>(result), "test_sprite_font");
+            Assert::IsNotNull(font.get());
+
+            const ff::point_float scale(1, 1);
+            float separate_width = font->measure_text("e", scale).x + font->measure_text("x", scale).x;
+            float pair_width = font->measure_text("ex", scale).x;
+            Assert::IsTrue(pair_width < separate_width - 0.2f);
+
+            // Cached runs must give the same result, scaled
+            Assert::IsTrue(font->measure_text("ex", scale) == font->measure_text("ex", scale));
+            Assert::IsTrue(font->measure_text("ex", ff::point_float(2, 3)) == font->measure_text("ex", scale) * ff::point_float(2, 3));
+        }
     };
 }
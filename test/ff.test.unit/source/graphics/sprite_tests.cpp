@@ -1,6 +1,52 @@
 #include "pch.h"
 #include "../utility.h"
 
+static std::shared_ptr<ff::texture> load_test_texture()
+{
+    ff::data_static texture_mem(ff::get_hinstance(), RT_RCDATA, MAKEINTRESOURCE(ID_TEST_TEXTURE));
+    ff::png_image_reader png(texture_mem.data(), texture_mem.size());
+    auto scratch = std::make_shared<DirectX::ScratchImage>(std::move(*png.read()));
+    return std::make_shared<ff::texture>(ff::dxgi::create_static_texture(scratch, ff::dxgi::sprite_type::unknown));
+}
+
+static std::vector<ff::sprite> create_random_sprites(const std::shared_ptr<ff::texture>& texture, size_t count)
+{
+    const ff::point_int texture_size = texture->dxgi_texture()->size().cast<int>();
+    std::vector<ff::sprite> sprites;
+    sprites.reserve(count);
+    std::mt19937 random(1);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        ff::point_int size(4 + static_cast<int>(random() % 61), 4 + static_cast<int>(random() % 61));
+        size = ff::point_int(std::min(size.x, texture_size.x), std::min(size.y, texture_size.y));
+        ff::point_int pos(static_cast<int>(random() % (texture_size.x - size.x + 1)), static_cast<int>(random() % (texture_size.y - size.y + 1)));
+
+        sprites.emplace_back(std::to_string(i), texture, ff::rect_int(pos, pos + size).cast<float>(),
+            ff::point_float{}, ff::point_float(1, 1), ff::dxgi::sprite_type::unknown);
+    }
+
+    return sprites;
+}
+
+static void assert_no_overlaps(const std::vector<ff::sprite>& sprites)
+{
+    for (size_t i = 0; i < sprites.size(); i++)
+    {
+        const ff::dxgi::sprite_data& data_i = sprites[i].sprite_data();
+        const ff::rect_float rect_i = data_i.texture_rect();
+
+        for (size_t h = i + 1; h < sprites.size(); h++)
+        {
+            const ff::dxgi::sprite_data& data_h = sprites[h].sprite_data();
+            const ff::rect_float rect_h = data_h.texture_rect();
+
+            // Duplicate source pixels share the same destination
+            Assert::IsTrue(data_i.view() != data_h.view() || rect_i == rect_h || !rect_i.intersects(rect_h));
+        }
+    }
+}
+
 namespace ff::test::graphics
 {
     TEST_CLASS(sprite_tests)
@@ -24,5 +70,70 @@ namespace ff::test::graphics
             Assert::IsTrue(sprites->size() == 5);
             Assert::IsNotNull(sprites->get(0)->sprite_data().view());
         }
+
+        TEST_METHOD(sprite_list_packers)
+        {
+            for (std::string_view packer : { "grid"sv, "max_rects"sv, "skyline"sv })
+            {
+                std::string json = "{ \"test_sprites\": { \"res:type\": \"sprites\", \"optimize\": true, \"packer\": \"";
+                json += packer;
+                json += R"(", "max_texture_size": 2048, "sprites": {
+                    "one": { "file": "file:test_texture.png", "pos": [ 16, 16 ], "size": [ 16, 16 ], "handle": [ 8, 8 ] },
+                    "two": { "file": "file:test_texture.png", "pos": [ 16, 32 ], "size": [ 8, 8 ], "handle": [ 4, 4 ], "repeat": 4 } } } })";
+
+                auto result = ff::test::create_resources(json);
+                auto sprites = ff::get_resource<ff::sprite_list>(*std::get<0>(result), "test_sprites");
+                Assert::IsNotNull(sprites.get());
+                Assert::IsTrue(sprites->size() == 5);
+            }
+        }
+
+        TEST_METHOD(optimize_sprites_packers)
+        {
+            std::shared_ptr<ff::texture> texture = ::load_test_texture();
+            std::vector<ff::sprite> sprites = ::create_random_sprites(texture, 256);
+
+            for (ff::internal::sprite_packer packer : { ff::internal::sprite_packer::grid, ff::internal::sprite_packer::max_rects, ff::internal::sprite_packer::skyline })
+            {
+                ff::internal::sprite_optimizer_options options{};
+                options.packer = packer;
+                options.max_texture_size = 256;
+
+                ff::internal::sprite_optimizer_stats stats{};
+                std::vector<ff::sprite> new_sprites = ff::internal::optimize_sprites(sprites, DXGI_FORMAT_R8G8B8A8_UNORM, 1, options, &stats);
+                Assert::AreEqual(sprites.size(), new_sprites.size());
+                Assert::IsTrue(stats.texture_count > 0 && stats.fill_ratio() > 0 && stats.fill_ratio() <= 1);
+                ::assert_no_overlaps(new_sprites);
+
+                for (size_t i = 0; i < sprites.size(); i++)
+                {
+                    Assert::IsTrue(sprites[i].sprite_data().world() == new_sprites[i].sprite_data().world());
+                }
+            }
+        }
+
+        TEST_METHOD(perf_optimize_sprites)
+        {
+            std::shared_ptr<ff::texture> texture = ::load_test_texture();
+            std::vector<ff::sprite> sprites = ::create_random_sprites(texture, 4096);
+
+            for (ff::internal::sprite_packer packer : { ff::internal::sprite_packer::grid, ff::internal::sprite_packer::max_rects, ff::internal::sprite_packer::skyline })
+            {
+                for (size_t max_texture_size : { 1024, 4096 })
+                {
+                    ff::internal::sprite_optimizer_options options{};
+                    options.packer = packer;
+                    options.max_texture_size = max_texture_size;
+
+                    ff::internal::sprite_optimizer_stats stats{};
+                    std::vector<ff::sprite> new_sprites = ff::internal::optimize_sprites(sprites, DXGI_FORMAT_R8G8B8A8_UNORM, 1, options, &stats);
+                    Assert::AreEqual(sprites.size(), new_sprites.size());
+
+                    ff::log::write(ff::log::type::test, "Packer: ", static_cast<int>(packer), ", Max size: ", max_texture_size,
+                        ", Textures: ", stats.texture_count, ", Filled: ", stats.fill_ratio() * 100.0, "%",
+                        ", Pack: ", stats.pack_seconds, "s, Copy: ", stats.copy_seconds, "s");
+                }
+            }
+        }
     };
 }
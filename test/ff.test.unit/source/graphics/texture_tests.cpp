@@ -34,5 +34,56 @@ namespace ff::test::graphics
             Assert::IsTrue(converted_texture.dxgi_texture()->size() == texture.dxgi_texture()->size());
             Assert::IsTrue(converted_texture.dxgi_texture()->mip_count() == 2);
         }
+
+        TEST_METHOD(parallel_compress)
+        {
+            ff::resource_file file(".png", ff::get_hinstance(), RT_RCDATA, MAKEINTRESOURCE(ID_TEST_TEXTURE));
+            ff::texture texture(file);
+            std::shared_ptr<DirectX::ScratchImage> data = texture.dxgi_texture()->data();
+
+            DirectX::ScratchImage expected;
+            Assert::IsTrue(SUCCEEDED(DirectX::Compress(*data->GetImages(), DXGI_FORMAT_BC3_UNORM, DirectX::TEX_COMPRESS_DEFAULT, 0, expected)));
+
+            // Compressing in bands across threads must give the same blocks
+            DirectX::ScratchImage actual;
+            Assert::IsTrue(SUCCEEDED(actual.InitializeFromImage(*data->GetImages())));
+            Assert::IsTrue(ff::internal::texture_processor::convert(actual, DXGI_FORMAT_BC3_UNORM));
+            Assert::AreEqual(expected.GetPixelsSize(), actual.GetPixelsSize());
+            Assert::AreEqual(0, std::memcmp(expected.GetPixels(), actual.GetPixels(), expected.GetPixelsSize()));
+        }
+
+        TEST_METHOD(processed_cache)
+        {
+            auto data = std::make_shared<DirectX::ScratchImage>();
+            Assert::IsTrue(SUCCEEDED(data->Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, 256, 128, 1, 1)));
+
+            std::mt19937 random(21);
+            std::generate(data->GetPixels(), data->GetPixels() + data->GetPixelsSize(), [&random]() { return static_cast<uint8_t>(random()); });
+
+            // Off by default, only the resource build tool turns it on
+            ff::internal::texture_processor::reset_stats();
+            std::shared_ptr<DirectX::ScratchImage> data0 = ff::internal::convert_texture_data(data, DXGI_FORMAT_BC1_UNORM, 3);
+            ff::internal::texture_processor::stats_t stats0 = ff::internal::texture_processor::stats();
+            Assert::IsTrue(data0 != nullptr);
+            Assert::AreEqual<size_t>(0, stats0.cache_hit_count + stats0.cache_miss_count);
+
+            ff::internal::texture_processor::cache_enabled(true);
+            auto disable_cache = ff::scope_exit([]()
+                {
+                    ff::internal::texture_processor::cache_enabled(false);
+                });
+
+            ff::internal::texture_processor::reset_stats();
+            std::shared_ptr<DirectX::ScratchImage> data1 = ff::internal::convert_texture_data(data, DXGI_FORMAT_BC1_UNORM, 3);
+            std::shared_ptr<DirectX::ScratchImage> data2 = ff::internal::convert_texture_data(data, DXGI_FORMAT_BC1_UNORM, 3);
+            ff::internal::texture_processor::stats_t stats = ff::internal::texture_processor::stats();
+
+            Assert::IsTrue(data1 && data2);
+            Assert::IsTrue(data2->GetMetadata().format == DXGI_FORMAT_BC1_UNORM && data2->GetMetadata().mipLevels == 3);
+            Assert::AreEqual(data1->GetPixelsSize(), data2->GetPixelsSize());
+            Assert::AreEqual(0, std::memcmp(data1->GetPixels(), data2->GetPixels(), data1->GetPixelsSize()));
+            Assert::IsTrue(stats.cache_hit_count >= 1);
+            Assert::AreEqual<size_t>(2, stats.cache_hit_count + stats.cache_miss_count);
+        }
     };
 }
@@ -0,0 +1,135 @@
+#include "pch.h"
+
+namespace
+{
+    class test_input_device : public ff::input_device_base
+    {
+    public:
+        virtual bool pressing(int vk) const override
+        {
+            return this->states[vk].pressing;
+        }
+
+        virtual int press_count(int vk) const override
+        {
+            return this->states[vk].press_count;
+        }
+
+        virtual float analog_value(int vk) const override
+        {
+            return this->states[vk].analog_value;
+        }
+
+        virtual void update() override
+        {}
+
+        virtual void kill_pending() override
+        {}
+
+        void notify(const ff::input_device_event& event)
+        {
+            this->device_event.notify(event);
+        }
+
+        std::array<ff::internal::input_vk_state, ff::internal::input_record_vk_count> states{};
+    };
+}
+
+namespace ff::test::input
+{
+    TEST_CLASS(record_tests)
+    {
+    public:
+        TEST_METHOD(record_replay)
+        {
+            ::test_input_device device;
+            ff::input_recorder recorder(device);
+
+            recorder.update();
+            device.states['A'] = { 1, 1.0f, true };
+            device.notify(ff::input_device_event_key_press('A', 1));
+            recorder.update();
+            device.states['A'].press_count = 0;
+            device.states[VK_GAMEPAD_LEFT_THUMBSTICK_RIGHT] = { 0, 0.5f, false };
+            recorder.update();
+            device.states = {};
+            recorder.update();
+
+            Assert::AreEqual<size_t>(4, recorder.update_count());
+
+            ff::input_replay_device replay(std::make_shared<ff::data_vector>(std::vector<uint8_t>(recorder.data())));
+            std::vector<ff::input_device_event> events;
+            ff::signal_connection connection = replay.event_sink().connect([&events](const ff::input_device_event& event)
+                {
+                    events.push_back(event);
+                });
+
+            Assert::IsTrue(replay.valid());
+            Assert::AreEqual<size_t>(4, replay.update_count());
+
+            replay.update();
+            Assert::IsFalse(replay.pressing('A'));
+            Assert::IsTrue(events.empty());
+
+            replay.update();
+            Assert::IsTrue(replay.pressing('A'));
+            Assert::AreEqual(1, replay.press_count('A'));
+            Assert::AreEqual<size_t>(1, events.size());
+            Assert::IsTrue(events[0].type == ff::input_device_event_type::key_press && events[0].id == 'A' && events[0].count == 1);
+
+            replay.update();
+            Assert::IsTrue(replay.pressing('A'));
+            Assert::AreEqual(0, replay.press_count('A'));
+            Assert::AreEqual(0.5f, replay.analog_value(VK_GAMEPAD_LEFT_THUMBSTICK_RIGHT));
+
+            replay.update();
+            Assert::IsFalse(replay.pressing('A'));
+            Assert::AreEqual(0.0f, replay.analog_value(VK_GAMEPAD_LEFT_THUMBSTICK_RIGHT));
+            Assert::IsTrue(replay.done());
+        }
+
+        TEST_METHOD(headless_replay)
+        {
+            constexpr size_t update_count = 1000;
+            std::filesystem::path path = ff::filesystem::temp_directory_path() / "input_record_test.bin";
+            {
+                ::test_input_device device;
+                ff::input_recorder recorder(device);
+
+                for (size_t i = 0; i < update_count; i++)
+                {
+                    device.states['A'] = { (i % 10) == 0, 1.0f, (i % 10) < 5 };
+                    recorder.update();
+                }
+
+                Assert::IsTrue(recorder.save(path));
+            }
+
+            uint64_t state{};
+            ff::init_app_params app_params;
+            app_params.game_update_func = [&state]()
+                {
+                    const ff::input_vk& input = ff::input::combined_devices();
+                    state = state * 31 + input.pressing('A') + input.press_count('A') * 7 + ff::app_time().update_count;
+                };
+
+            ff::headless_params params;
+            params.replay_path = path;
+            params.checksum_interval = 100;
+            params.checksum_func = [&state]()
+                {
+                    return state;
+                };
+
+            ff::headless_results results1 = ff::run_headless(app_params, params);
+            state = 0;
+            ff::headless_results results2 = ff::run_headless(app_params, params);
+            std::filesystem::remove(path);
+
+            Assert::AreEqual(update_count, results1.update_count);
+            Assert::AreEqual<size_t>(update_count / params.checksum_interval, results1.checksums.size());
+            Assert::IsTrue(results1.checksums == results2.checksums);
+            Assert::IsTrue(results1.update_ms_p50 <= results1.update_ms_p99 && results1.update_ms_p99 <= results1.update_ms_max);
+        }
+    };
+}
@@ -64,5 +64,219 @@ namespace ff::test::resource
             Assert::IsTrue(data1->size() == test_string1.size() + 3 && !std::memcmp(data1->data() + 3, test_string1.data(), test_string1.size()));
             Assert::IsTrue(data2->size() == test_string2.size() + 3 && !std::memcmp(data2->data() + 3, test_string2.data(), test_string2.size()));
         }
+
+        TEST_METHOD(indexed_pack)
+        {
+            ff::dict dict;
+            dict.set<std::string>("one", "value one");
+            dict.set<std::string>("two", "value two");
+            dict.set<int>("three", 3);
+
+            auto pack_vector = std::make_shared<std::vector<uint8_t>>();
+            {
+                ff::resource_objects resources(dict);
+                ff::data_writer writer(pack_vector);
+                Assert::IsTrue(resources.save(writer));
+            }
+
+            auto pack_data = std::make_shared<ff::data_vector>(pack_vector);
+            ff::resource_objects resources;
+            Assert::IsTrue(resources.add_resources(pack_data));
+            Assert::AreEqual<size_t>(3, resources.resource_object_names().size());
+
+            std::shared_ptr<ff::resource> two = resources.get_resource_object("two");
+            Assert::AreEqual(std::string("value two"), two->value()->get<std::string>());
+            Assert::AreEqual(3, resources.get_resource_object("three")->value()->get<int>());
+            Assert::IsTrue(resources.get_resource_object("four")->value()->is_type<nullptr_t>());
+            Assert::IsTrue(two == resources.get_resource_object("two"));
+
+            // Saving again includes resources that were never requested
+            ff::dict saved_dict;
+            Assert::IsTrue(resources.save(saved_dict));
+            Assert::AreEqual(std::string("value one"), saved_dict.get<std::string>("one"));
+        }
+
+        TEST_METHOD(perf_pack_load)
+        {
+            const size_t count = 50000;
+            ff::dict dict;
+            for (size_t i = 0; i < count; i++)
+            {
+                dict.set<std::string>("resource_" + std::to_string(i), "value_" + std::to_string(i));
+            }
+
+            auto pack_vector = std::make_shared<std::vector<uint8_t>>();
+            {
+                ff::resource_objects resources(dict);
+                ff::data_writer writer(pack_vector);
+                Assert::IsTrue(resources.save(writer));
+            }
+
+            auto pack_data = std::make_shared<ff::data_vector>(pack_vector);
+            ff::timer timer;
+
+            // Every resource is created up front when reading from a stream
+            {
+                ff::data_reader reader(pack_data);
+                ff::resource_objects resources;
+                Assert::IsTrue(resources.add_resources(reader));
+            }
+
+            double eager_seconds = timer.tick();
+
+            ff::resource_objects resources;
+            Assert::IsTrue(resources.add_resources(pack_data));
+            double indexed_seconds = timer.tick();
+
+            std::shared_ptr<ff::resource> res = resources.get_resource_object("resource_12345");
+            double first_get_seconds = timer.tick();
+
+            Assert::AreEqual(std::string("value_12345"), res->value()->get<std::string>());
+            Assert::AreEqual(count, resources.resource_object_names().size());
+
+            ff::log::write(ff::log::type::test, "Resources: ", count, ", Pack: ", pack_vector->size(), " bytes",
+                ", Stream load: ", eager_seconds, "s, Indexed load: ", indexed_seconds, "s, First get: ", first_get_seconds, "s");
+        }
+
+        TEST_METHOD(perf_reload_cached)
+        {
+            const size_t count = 64;
+            const size_t data_size = 256 * 1024;
+            const size_t reload_count = 10;
+
+            std::mt19937 random(3);
+            ff::dict dict;
+            for (size_t i = 0; i < count; i++)
+            {
+                auto bytes = std::make_shared<std::vector<uint8_t>>(data_size);
+                std::generate(bytes->begin(), bytes->end(), [&random]() { return static_cast<uint8_t>(random() % 16); });
+                dict.set<ff::data_base>("data_" + std::to_string(i), std::make_shared<ff::data_vector>(bytes), ff::saved_data_type::zlib_compressed);
+            }
+
+            auto pack_vector = std::make_shared<std::vector<uint8_t>>();
+            {
+                ff::resource_objects resources(dict);
+                ff::data_writer writer(pack_vector);
+                Assert::IsTrue(resources.save(writer));
+            }
+
+            auto pack_data = std::make_shared<ff::data_vector>(pack_vector);
+            const size_t old_budget = ff::saved_data_cache::budget();
+
+            // Like reloading resources after every change, nothing else holds onto the data between reloads
+            for (size_t budget : { size_t(0), ff::saved_data_cache::default_budget })
+            {
+                ff::saved_data_cache::clear();
+                ff::saved_data_cache::reset_stats();
+                ff::saved_data_cache::budget(budget);
+                ff::timer timer;
+
+                for (size_t reload = 0; reload < reload_count; reload++)
+                {
+                    ff::resource_objects resources;
+                    Assert::IsTrue(resources.add_resources(pack_data));
+
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        std::shared_ptr<ff::resource> res = resources.get_resource_object("data_" + std::to_string(i));
+                        ff::value_ptr data_value = res->value()->try_convert<ff::data_base>();
+                        Assert::AreEqual(data_size, data_value->get<ff::data_base>()->size());
+                    }
+                }
+
+                const double seconds = timer.tick();
+                const ff::saved_data_cache::stats_t stats = ff::saved_data_cache::stats();
+                Assert::IsTrue(!budget || stats.hit_count >= count * (reload_count - 1));
+
+                ff::log::write(ff::log::type::test, "Reload ", count, " compressed resources ", reload_count, " times, budget ", budget,
+                    ": ", seconds, "s, hits: ", stats.hit_count, ", misses: ", stats.miss_count, ", evictions: ", stats.eviction_count);
+            }
+
+            ff::saved_data_cache::budget(old_budget);
+            ff::saved_data_cache::clear();
+        }
+
+        TEST_METHOD(perf_incremental_build)
+        {
+            const size_t count = 2000;
+            const size_t file_size = 32 * 1024;
+            std::filesystem::path temp_path = ff::filesystem::temp_directory_path() / "resource_incremental_test";
+            std::filesystem::path source_path = temp_path / "res.json";
+            std::filesystem::path cache_path;
+            ff::scope_exit cleanup([&temp_path, &cache_path]()
+                {
+                    ff::filesystem::remove_all(temp_path);
+                    ff::filesystem::remove(cache_path);
+                });
+
+            auto file_path = [&temp_path](size_t i)
+                {
+                    return temp_path / ("file" + std::to_string(i) + ".bin");
+                };
+
+            std::mt19937 random(7);
+            std::vector<uint8_t> bytes(file_size);
+            std::ostringstream json_source;
+            json_source << "{\n";
+
+            Assert::IsTrue(ff::filesystem::create_directories(temp_path));
+            for (size_t i = 0; i < count; i++)
+            {
+                std::generate(bytes.begin(), bytes.end(), [&random]() { return static_cast<uint8_t>(random() % 16); });
+                Assert::IsTrue(ff::filesystem::write_binary_file(file_path(i), bytes.data(), bytes.size()));
+                json_source << (i ? ",\n" : "") << "  \"file_" << i << "\": { \"res:type\": \"file\", \"file\": \"file:file" << i << ".bin\", \"compress\": true }";
+            }
+
+            json_source << "\n}\n";
+            Assert::IsTrue(ff::filesystem::write_text_file(source_path, json_source.str()));
+
+            // Full build
+            ff::timer timer;
+            ff::load_resources_result result = ff::load_resources_from_file(source_path, ff::resource_cache_t::rebuild_cache, true);
+            const double full_seconds = timer.tick();
+            cache_path = result.cache_path;
+            Assert::IsTrue(result.resources && result.errors.empty() && !result.loaded_from_cache);
+            Assert::AreEqual(count, result.rebuilt_count);
+            Assert::IsFalse(cache_path.empty());
+
+            // Like a fresh checkout, every file is newer than the cache but nothing changed
+            for (size_t i = 0; i < count; i++)
+            {
+                std::filesystem::last_write_time(file_path(i), std::filesystem::file_time_type::clock::now());
+            }
+
+            timer.tick();
+            result = ff::load_resources_from_file(source_path, ff::resource_cache_t::use_cache_in_memory, true);
+            const double noop_seconds = timer.tick();
+            Assert::IsTrue(result.resources && result.loaded_from_cache);
+
+            // Only the changed file goes through its factory
+            bytes.assign(file_size, 1);
+            Assert::IsTrue(ff::filesystem::write_binary_file(file_path(123), bytes.data(), bytes.size()));
+
+            timer.tick();
+            result = ff::load_resources_from_file(source_path, ff::resource_cache_t::use_cache_in_memory, true);
+            const double one_changed_seconds = timer.tick();
+            Assert::IsTrue(result.resources && result.errors.empty() && !result.loaded_from_cache);
+            Assert::AreEqual<size_t>(1, result.rebuilt_count);
+            Assert::AreEqual(count - 1, result.reused_count);
+            Assert::AreEqual(count, result.resources->resource_object_names().size());
+
+            ff::auto_resource<ff::resource_file> changed_file = result.resources->get_resource_object("file_123");
+            std::shared_ptr<ff::data_base> changed_data = changed_file->saved_data()->loaded_data();
+            Assert::IsTrue(changed_data->size() == bytes.size() && !std::memcmp(changed_data->data(), bytes.data(), bytes.size()));
+
+            ff::auto_resource<ff::resource_file> reused_file = result.resources->get_resource_object("file_124");
+            std::shared_ptr<ff::data_base> reused_data = reused_file->saved_data()->loaded_data();
+            Assert::AreEqual(file_size, reused_data->size());
+
+            // The spliced pack can be reused as is
+            result = ff::load_resources_from_file(source_path, ff::resource_cache_t::use_cache_in_memory, true);
+            Assert::IsTrue(result.resources && result.loaded_from_cache);
+            Assert::AreEqual(count, result.resources->resource_object_names().size());
+
+            ff::log::write(ff::log::type::test, "Incremental build, ", count, " files: Full: ", full_seconds, "s, No-op: ", noop_seconds,
+                "s, One changed: ", one_changed_seconds, "s");
+        }
     };
 }